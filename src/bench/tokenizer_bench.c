@@ -0,0 +1,337 @@
+#include "tokenizer_bench.h"
+
+#include "../core/vector.h"
+#include "../core/cabortime.h"
+#include "../language/tokenizer.h"
+#include "../logging/logging.h"
+#include "../debug/cabor_debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DEFAULT_SOURCE_SIZE (8 * 1024 * 1024)
+#define BENCH_DEFAULT_WARMUP_RUNS 3
+#define BENCH_DEFAULT_RUNS 20
+#define BENCH_DEFAULT_SEED 0xcab0u
+
+#define BENCH_MAX_EXPRESSION_DEPTH 48
+#define BENCH_BLOCK_STATEMENTS 256
+#define BENCH_MAX_IDENTIFIER_LENGTH 32
+
+typedef struct
+{
+    cabor_vector* source;
+    uint32_t rng;
+    size_t counter; // keeps generated variable names unique
+} bench_writer;
+
+static const char* binary_operators[] = { "+", "-", "*", "/", "%", "<", "<=", "==", "!=", "and", "or" };
+static const char* keywords[] = { "if", "then", "else", "while", "return", "for", "do", "var", "true", "false", "or", "and", "not" };
+static const char identifier_chars[] = "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+// xorshift32, good enough to vary the programs and fully determined by the seed
+static uint32_t next_random(bench_writer* writer)
+{
+    uint32_t x = writer->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    writer->rng = x;
+    return x;
+}
+
+static uint32_t random_range(bench_writer* writer, uint32_t min, uint32_t max)
+{
+    return min + next_random(writer) % (max - min + 1);
+}
+
+static void write_str(bench_writer* writer, const char* str)
+{
+    cabor_vector_push_str(writer->source, str, false);
+}
+
+static void write_int(bench_writer* writer, uint32_t value)
+{
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u", value);
+    write_str(writer, buffer);
+}
+
+static void write_identifier(bench_writer* writer, uint32_t length)
+{
+    // Identifiers can't start with a digit, the digits are at the end of identifier_chars
+    cabor_vector_push_char(writer->source, identifier_chars[next_random(writer) % (sizeof(identifier_chars) - 11)]);
+    for (uint32_t i = 1; i < length; i++)
+        cabor_vector_push_char(writer->source, identifier_chars[next_random(writer) % (sizeof(identifier_chars) - 1)]);
+
+    // Keep the programs parseable, "do" and "if" come up often enough with short identifiers
+    const char* text = (const char*)writer->source->vector_mem.mem + writer->source->size - length;
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++)
+    {
+        if (strlen(keywords[i]) == length && !memcmp(text, keywords[i], length))
+        {
+            cabor_vector_push_char(writer->source, '_');
+            break;
+        }
+    }
+}
+
+static void write_operand(bench_writer* writer)
+{
+    if (next_random(writer) & 1)
+        write_int(writer, random_range(writer, 0, 100000));
+    else
+        write_identifier(writer, random_range(writer, 1, 6));
+}
+
+static void write_binary_operator(bench_writer* writer)
+{
+    size_t count = sizeof(binary_operators) / sizeof(binary_operators[0]);
+    write_str(writer, " ");
+    write_str(writer, binary_operators[next_random(writer) % count]);
+    write_str(writer, " ");
+}
+
+// (a + (12 * (b - (...))))
+static void write_nested_expression(bench_writer* writer, uint32_t depth)
+{
+    for (uint32_t i = 0; i < depth; i++)
+    {
+        write_str(writer, "(");
+        write_operand(writer);
+        write_binary_operator(writer);
+    }
+
+    write_operand(writer);
+
+    for (uint32_t i = 0; i < depth; i++)
+        write_str(writer, ")");
+}
+
+static void write_deep_expression_statement(bench_writer* writer)
+{
+    write_str(writer, "var d");
+    write_int(writer, (uint32_t)writer->counter++);
+    write_str(writer, " = ");
+    write_nested_expression(writer, random_range(writer, 1, BENCH_MAX_EXPRESSION_DEPTH));
+    write_str(writer, ";\n");
+}
+
+static void write_long_block_statement(bench_writer* writer)
+{
+    write_str(writer, "while i < ");
+    write_int(writer, random_range(writer, 1, 1000));
+    write_str(writer, " do {\n");
+
+    for (uint32_t i = 0; i < BENCH_BLOCK_STATEMENTS; i++)
+    {
+        switch (next_random(writer) % 3)
+        {
+        case 0:
+            write_str(writer, "    var x");
+            write_int(writer, i);
+            write_str(writer, " = i * ");
+            write_int(writer, random_range(writer, 1, 9));
+            write_str(writer, ";\n");
+            break;
+        case 1:
+            write_str(writer, "    i = i + 1;\n");
+            break;
+        default:
+            write_str(writer, "    if i % 2 == 0 then print_int(i) else print_int(0 - i);\n");
+            break;
+        }
+    }
+
+    write_str(writer, "}\n");
+}
+
+static void write_comment_text(bench_writer* writer, uint32_t words)
+{
+    for (uint32_t i = 0; i < words; i++)
+    {
+        write_str(writer, " ");
+        write_identifier(writer, random_range(writer, 2, 9));
+    }
+}
+
+static void write_comment_heavy_statement(bench_writer* writer)
+{
+    if (next_random(writer) & 1)
+    {
+        write_str(writer, "//");
+        write_comment_text(writer, random_range(writer, 4, 12));
+        write_str(writer, "\n");
+    }
+    else
+    {
+        write_str(writer, "/*");
+        uint32_t lines = random_range(writer, 1, 4);
+        for (uint32_t i = 0; i < lines; i++)
+        {
+            write_comment_text(writer, random_range(writer, 4, 12));
+            write_str(writer, "\n  ");
+        }
+        write_str(writer, "*/\n");
+    }
+
+    write_str(writer, "x = x + ");
+    write_int(writer, random_range(writer, 0, 100));
+    write_str(writer, ";\n");
+}
+
+static void write_identifier_heavy_statement(bench_writer* writer)
+{
+    write_str(writer, "var ");
+    write_identifier(writer, random_range(writer, 8, BENCH_MAX_IDENTIFIER_LENGTH));
+    write_str(writer, " = ");
+    write_identifier(writer, random_range(writer, 8, BENCH_MAX_IDENTIFIER_LENGTH));
+    write_str(writer, "(");
+
+    uint32_t args = random_range(writer, 0, 4);
+    for (uint32_t i = 0; i < args; i++)
+    {
+        if (i > 0)
+            write_str(writer, ", ");
+        write_identifier(writer, random_range(writer, 4, BENCH_MAX_IDENTIFIER_LENGTH));
+    }
+
+    write_str(writer, ")");
+    write_binary_operator(writer);
+    write_identifier(writer, random_range(writer, 8, BENCH_MAX_IDENTIFIER_LENGTH));
+    write_str(writer, ";\n");
+}
+
+cabor_tokenizer_bench_config cabor_default_tokenizer_bench_config()
+{
+    cabor_tokenizer_bench_config config;
+    config.source_size = BENCH_DEFAULT_SOURCE_SIZE;
+    config.warmup_runs = BENCH_DEFAULT_WARMUP_RUNS;
+    config.runs = BENCH_DEFAULT_RUNS;
+    config.seed = BENCH_DEFAULT_SEED;
+    return config;
+}
+
+cabor_file* cabor_generate_bench_program(cabor_bench_shape shape, size_t size, uint32_t seed)
+{
+    bench_writer writer;
+    writer.source = cabor_create_vector(size + 4096, CABOR_CHAR, false);
+    writer.rng = seed ? seed : 1; // xorshift gets stuck at 0
+    writer.counter = 0;
+
+    while (writer.source->size < size)
+    {
+        switch (shape)
+        {
+        case CABOR_BENCH_DEEP_EXPRESSIONS:   write_deep_expression_statement(&writer); break;
+        case CABOR_BENCH_LONG_BLOCKS:        write_long_block_statement(&writer); break;
+        case CABOR_BENCH_COMMENT_HEAVY:      write_comment_heavy_statement(&writer); break;
+        case CABOR_BENCH_IDENTIFIER_HEAVY:   write_identifier_heavy_statement(&writer); break;
+        default: CABOR_RUNTIME_ERROR("unknown bench shape");
+        }
+    }
+
+    cabor_file* file = cabor_file_from_buffer(writer.source->vector_mem.mem, writer.source->size);
+    cabor_destroy_vector(writer.source);
+    return file;
+}
+
+const char* cabor_bench_shape_to_str(cabor_bench_shape shape)
+{
+    switch (shape)
+    {
+    case CABOR_BENCH_DEEP_EXPRESSIONS:   return "deep expressions";
+    case CABOR_BENCH_LONG_BLOCKS:        return "long blocks";
+    case CABOR_BENCH_COMMENT_HEAVY:      return "comment heavy";
+    case CABOR_BENCH_IDENTIFIER_HEAVY:   return "identifier heavy";
+    default:                             return "unknown";
+    }
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank percentile of sorted samples
+static double percentile(const double* sorted, size_t count, double p)
+{
+    size_t rank = (size_t)(p * count + 0.999999);
+    if (rank == 0)
+        rank = 1;
+    if (rank > count)
+        rank = count;
+    return sorted[rank - 1];
+}
+
+void cabor_run_tokenizer_bench(cabor_bench_shape shape, const cabor_tokenizer_bench_config* config,
+    cabor_tokenizer_bench_result* result)
+{
+    CABOR_ASSERT(config->runs > 0, "tokenizer bench needs at least one timed run");
+
+    cabor_file* file = cabor_generate_bench_program(shape, config->source_size, config->seed);
+    cabor_allocation samples_mem = CABOR_MALLOC(config->runs * sizeof(double));
+    double* samples = samples_mem.mem;
+    size_t tokens = 0;
+
+    for (size_t i = 0; i < config->warmup_runs + config->runs; i++)
+    {
+        double start = cabor_get_time();
+        cabor_vector* vec = cabor_tokenize(file);
+        double end = cabor_get_time();
+
+        tokens = vec->size;
+        cabor_destroy_vector(vec);
+
+        if (i >= config->warmup_runs)
+            samples[i - config->warmup_runs] = end - start;
+    }
+
+    qsort(samples, config->runs, sizeof(double), compare_doubles);
+
+    result->bytes = file->size;
+    result->tokens = tokens;
+    result->min = samples[0];
+    result->p50 = percentile(samples, config->runs, 0.50);
+    result->p90 = percentile(samples, config->runs, 0.90);
+    result->p99 = percentile(samples, config->runs, 0.99);
+    result->max = samples[config->runs - 1];
+    result->mb_per_sec = result->p50 > 0 ? (double)result->bytes / (1024.0 * 1024.0) / result->p50 : 0;
+    result->tokens_per_sec = result->p50 > 0 ? (double)result->tokens / result->p50 : 0;
+
+    CABOR_FREE(&samples_mem);
+    cabor_destroy_file(file);
+}
+
+void cabor_run_tokenizer_benchmarks(const cabor_tokenizer_bench_config* config)
+{
+    CABOR_LOG_F("Tokenizer benchmark: %zu bytes per program, %zu warmup runs, %zu runs, seed %u",
+        config->source_size, config->warmup_runs, config->runs, config->seed);
+    CABOR_LOG("----------------------------------------------------------------------------------------------------------------");
+    CABOR_LOG_F("  %-18s | %-10s | %-9s | %-8s | %-8s | %-8s | %-8s | %-8s | %-9s | %-8s",
+        "Shape", "Tokens", "MB", "min(ms)", "p50(ms)", "p90(ms)", "p99(ms)", "max(ms)", "MB/s", "Mtok/s");
+    CABOR_LOG("----------------------------------------------------------------------------------------------------------------");
+
+    for (int shape = 0; shape < CABOR_BENCH_NUM_SHAPES; shape++)
+    {
+        cabor_tokenizer_bench_result result;
+        cabor_run_tokenizer_bench((cabor_bench_shape)shape, config, &result);
+
+        CABOR_LOG_F("  %-18s | %-10zu | %-9.2f | %-8.3f | %-8.3f | %-8.3f | %-8.3f | %-8.3f | %-9.1f | %-8.2f",
+            cabor_bench_shape_to_str((cabor_bench_shape)shape),
+            result.tokens,
+            (double)result.bytes / (1024.0 * 1024.0),
+            result.min * 1000.0,
+            result.p50 * 1000.0,
+            result.p90 * 1000.0,
+            result.p99 * 1000.0,
+            result.max * 1000.0,
+            result.mb_per_sec,
+            result.tokens_per_sec / 1000000.0);
+    }
+
+    CABOR_LOG("----------------------------------------------------------------------------------------------------------------");
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../filesystem/filesystem.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Tokenizer throughput benchmark. Programs are generated from a seed so the same config always
+// measures the same input, the numbers can be compared between builds to catch regressions.
+
+typedef enum
+{
+    CABOR_BENCH_DEEP_EXPRESSIONS,   // long chains of nested parenthesized arithmetic
+    CABOR_BENCH_LONG_BLOCKS,        // while loops with hundreds of short statements each
+    CABOR_BENCH_COMMENT_HEAVY,      // line and block comments between short statements
+    CABOR_BENCH_IDENTIFIER_HEAVY,   // long identifiers and function calls
+    CABOR_BENCH_NUM_SHAPES
+} cabor_bench_shape;
+
+typedef struct
+{
+    size_t source_size;  // bytes per generated program, sources of at least
+                         // CABOR_TOKENIZER_PARALLEL_MIN_SIZE are tokenized in parallel
+    size_t warmup_runs;  // untimed runs before measuring
+    size_t runs;         // timed runs, percentiles are taken over these
+    uint32_t seed;
+} cabor_tokenizer_bench_config;
+
+typedef struct
+{
+    size_t bytes;
+    size_t tokens;
+
+    // Seconds per run
+    double min;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+
+    // Throughput of the median run
+    double mb_per_sec;
+    double tokens_per_sec;
+} cabor_tokenizer_bench_result;
+
+// Default config used by --bench
+cabor_tokenizer_bench_config cabor_default_tokenizer_bench_config();
+
+// Generates a program of the given shape that is at least size bytes long, ending at a statement boundary.
+// The same shape, size and seed always generate the same program.
+cabor_file* cabor_generate_bench_program(cabor_bench_shape shape, size_t size, uint32_t seed);
+
+const char* cabor_bench_shape_to_str(cabor_bench_shape shape);
+
+void cabor_run_tokenizer_bench(cabor_bench_shape shape, const cabor_tokenizer_bench_config* config,
+    cabor_tokenizer_bench_result* result);
+
+// Runs every shape and logs a table of the results
+void cabor_run_tokenizer_benchmarks(const cabor_tokenizer_bench_config* config);
@@ -0,0 +1,141 @@
+#include "allocation_trace.h"
+#include "atomic.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static size_t hash_site(const char* site)
+{
+    // Fibonacci hashing on the address, the low bits of string literal addresses are mostly zero
+    uint64_t h = (uint64_t)(uintptr_t)site * 11400714819323198485llu;
+    return (size_t)(h >> 32) & (CABOR_ALLOCATION_TRACE_SITES - 1);
+}
+
+static cabor_allocation_site* find_site(cabor_allocation_trace_table* table, const char* site)
+{
+    size_t index = hash_site(site);
+    for (size_t i = 0; i < CABOR_ALLOCATION_TRACE_MAX_PROBES; i++)
+    {
+        cabor_allocation_site* entry = &table->sites[(index + i) & (CABOR_ALLOCATION_TRACE_SITES - 1)];
+        // Only this thread writes to the table so its own reads need no ordering
+        if (entry->site == site)
+            return entry;
+        if (!entry->site)
+        {
+            // The counts of an empty slot are zero, readers that see the site see them zeroed
+            cabor_atomic_store_ptr_release((const void**)&entry->site, site);
+            return entry;
+        }
+    }
+    return &table->overflow;
+}
+
+void cabor_trace_allocation(cabor_allocation_trace_table* table, const char* site, size_t bytes)
+{
+    cabor_allocation_site* entry = find_site(table, site);
+    cabor_atomic_add_size(&entry->alloc_count, 1);
+    cabor_atomic_add_size(&entry->alloc_bytes, bytes);
+}
+
+void cabor_trace_deallocation(cabor_allocation_trace_table* table, const char* site, size_t bytes)
+{
+    cabor_allocation_site* entry = find_site(table, site);
+    cabor_atomic_add_size(&entry->free_count, 1);
+    cabor_atomic_add_size(&entry->free_bytes, bytes);
+}
+
+// Copy of an entry that another thread may be writing to, site is NULL if the slot is still empty
+static cabor_allocation_site load_site(const cabor_allocation_site* entry)
+{
+    cabor_allocation_site copy =
+    {
+        .site = cabor_atomic_load_ptr_acquire((const void* const*)&entry->site),
+        .alloc_count = cabor_atomic_load_size(&entry->alloc_count),
+        .alloc_bytes = cabor_atomic_load_size(&entry->alloc_bytes),
+        .free_count = cabor_atomic_load_size(&entry->free_count),
+        .free_bytes = cabor_atomic_load_size(&entry->free_bytes),
+    };
+    return copy;
+}
+
+static int compare_site_names(const void* a, const void* b)
+{
+    const cabor_allocation_site* lhs = a;
+    const cabor_allocation_site* rhs = b;
+    return strcmp(lhs->site, rhs->site);
+}
+
+static int compare_site_bytes(const void* a, const void* b)
+{
+    const cabor_allocation_site* lhs = a;
+    const cabor_allocation_site* rhs = b;
+    if (lhs->alloc_bytes != rhs->alloc_bytes)
+        return lhs->alloc_bytes < rhs->alloc_bytes ? 1 : -1;
+    return strcmp(lhs->site, rhs->site);
+}
+
+size_t cabor_format_allocation_trace(cabor_allocation_trace_table** tables, size_t num_tables, char* buffer, size_t buffer_size)
+{
+    // Uses plain malloc so producing the report doesn't show up in it
+    size_t capacity = num_tables * (CABOR_ALLOCATION_TRACE_SITES + 1);
+    cabor_allocation_site* merged = malloc((capacity ? capacity : 1) * sizeof(cabor_allocation_site));
+    size_t num_sites = 0;
+
+    for (size_t t = 0; t < num_tables; t++)
+    {
+        for (size_t i = 0; i < CABOR_ALLOCATION_TRACE_SITES; i++)
+        {
+            cabor_allocation_site entry = load_site(&tables[t]->sites[i]);
+            if (entry.site)
+                merged[num_sites++] = entry;
+        }
+
+        cabor_allocation_site overflow = load_site(&tables[t]->overflow);
+        if (overflow.alloc_count || overflow.free_count)
+        {
+            overflow.site = "<other call sites>";
+            merged[num_sites++] = overflow;
+        }
+    }
+
+    // Identical string literals aren't guaranteed to share an address so merge by name
+    qsort(merged, num_sites, sizeof(cabor_allocation_site), compare_site_names);
+
+    size_t num_unique = 0;
+    for (size_t i = 0; i < num_sites; i++)
+    {
+        if (num_unique > 0 && strcmp(merged[num_unique - 1].site, merged[i].site) == 0)
+        {
+            cabor_allocation_site* dst = &merged[num_unique - 1];
+            dst->alloc_count += merged[i].alloc_count;
+            dst->alloc_bytes += merged[i].alloc_bytes;
+            dst->free_count += merged[i].free_count;
+            dst->free_bytes += merged[i].free_bytes;
+        }
+        else
+        {
+            merged[num_unique++] = merged[i];
+        }
+    }
+
+    qsort(merged, num_unique, sizeof(cabor_allocation_site), compare_site_bytes);
+
+    size_t written = 0;
+    for (size_t i = 0; i < num_unique; i++)
+    {
+        cabor_allocation_site* s = &merged[i];
+        char* dst = buffer && written < buffer_size ? buffer + written : NULL;
+        size_t dst_size = dst ? buffer_size - written : 0;
+        int len = snprintf(dst, dst_size, "%s allocs: %zu (%zu B) frees: %zu (%zu B)\n",
+            s->site, s->alloc_count, s->alloc_bytes, s->free_count, s->free_bytes);
+        written += len > 0 ? (size_t)len : 0;
+    }
+
+    if (buffer && buffer_size > 0 && written == 0)
+        buffer[0] = '\0';
+
+    free(merged);
+    return written;
+}
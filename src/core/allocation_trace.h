@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../cabor_defines.h"
+
+#include <stddef.h>
+
+// Per call site allocation statistics for memory debug builds. Every per thread heap context owns
+// one table and is the only writer to it, so recording an allocation takes no locks. Sites are published
+// with release stores and counts are updated with relaxed atomic stores so other threads can read the
+// table while its owner keeps allocating. The table has
+// a fixed size and a bounded number of probes, call sites that don't fit are summed into the
+// overflow entry instead. Tables are merged into a report on demand, see cabor_create_allocation_trace_report().
+
+#define CABOR_ALLOCATION_TRACE_SITES 1024 // must be power of two
+#define CABOR_ALLOCATION_TRACE_MAX_PROBES 8
+
+typedef struct
+{
+    const char* site; // __FILE__:__LINE__ string literal, NULL when the slot is empty
+    size_t alloc_count;
+    size_t alloc_bytes;
+    size_t free_count;
+    size_t free_bytes;
+} cabor_allocation_site;
+
+typedef struct
+{
+    cabor_allocation_site sites[CABOR_ALLOCATION_TRACE_SITES];
+    cabor_allocation_site overflow;
+} cabor_allocation_trace_table;
+
+void cabor_trace_allocation(cabor_allocation_trace_table* table, const char* site, size_t bytes);
+void cabor_trace_deallocation(cabor_allocation_trace_table* table, const char* site, size_t bytes);
+
+// Merges the given tables by call site and appends one line per site into buffer, sorted by allocated bytes.
+// Returns the length of the full report like snprintf does, buffer may be NULL to query the size.
+// Other threads may keep allocating while this runs so the numbers are a best effort snapshot.
+size_t cabor_format_allocation_trace(cabor_allocation_trace_table** tables, size_t num_tables, char* buffer, size_t buffer_size);
@@ -0,0 +1,141 @@
+#include "arena.h"
+#include "memory.h"
+
+#include <string.h>
+
+#include "../debug/cabor_debug.h"
+
+// Every block starts with this header and the allocations follow it. Each allocation is
+// prefixed with the requested size so the arena can implement realloc without fat pointers.
+typedef struct cabor_arena_block_t
+{
+    struct cabor_arena_block_t* next;
+    cabor_allocation block_mem;
+    size_t capacity; // usable bytes after the header
+    size_t used;
+} cabor_arena_block;
+
+#define CABOR_ARENA_ALLOCATION_HEADER_SIZE CABOR_ARENA_ALIGNMENT
+
+static size_t align_up(size_t size)
+{
+    return (size + CABOR_ARENA_ALIGNMENT - 1) & ~((size_t)CABOR_ARENA_ALIGNMENT - 1);
+}
+
+static char* block_data(cabor_arena_block* block)
+{
+    return (char*)block + align_up(sizeof(cabor_arena_block));
+}
+
+static cabor_arena_block* allocate_block(cabor_arena* arena, size_t capacity)
+{
+    size_t total = align_up(sizeof(cabor_arena_block)) + capacity;
+    cabor_allocation alloc = CABOR_MALLOC_CTX(arena->parent, total);
+
+    cabor_arena_block* block = alloc.mem;
+    block->next = NULL;
+    block->block_mem = alloc;
+    block->capacity = capacity;
+    block->used = 0;
+
+    arena->reserved += total;
+    return block;
+}
+
+// Allocations larger than the block size get a block of their own. It's linked after the current
+// block so the free space left in the current block can still be used.
+static cabor_arena_block* push_block(cabor_arena* arena, size_t needed)
+{
+    if (needed > arena->block_size && arena->blocks)
+    {
+        cabor_arena_block* block = allocate_block(arena, needed);
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+        return block;
+    }
+
+    size_t capacity = needed > arena->block_size ? needed : arena->block_size;
+    cabor_arena_block* block = allocate_block(arena, capacity);
+    block->next = arena->blocks;
+    arena->blocks = block;
+    return block;
+}
+
+void cabor_arena_init(cabor_arena* arena, struct cabor_allocator_context_t* parent, size_t block_size)
+{
+    arena->parent = parent;
+    arena->blocks = NULL;
+    arena->block_size = align_up(block_size);
+    arena->reserved = 0;
+}
+
+void cabor_arena_release(cabor_arena* arena)
+{
+    cabor_arena_block* block = arena->blocks;
+    while (block)
+    {
+        cabor_arena_block* next = block->next;
+        cabor_allocation alloc = block->block_mem;
+        CABOR_FREE_CTX(arena->parent, &alloc);
+        block = next;
+    }
+    arena->blocks = NULL;
+    arena->reserved = 0;
+}
+
+void* cabor_arena_alloc(cabor_arena* arena, size_t size)
+{
+    size_t needed = CABOR_ARENA_ALLOCATION_HEADER_SIZE + align_up(size);
+    cabor_arena_block* block = arena->blocks;
+
+    if (!block || block->capacity - block->used < needed)
+        block = push_block(arena, needed);
+
+    char* header = block_data(block) + block->used;
+    block->used += needed;
+
+    *(size_t*)header = size;
+    return header + CABOR_ARENA_ALLOCATION_HEADER_SIZE;
+}
+
+void* cabor_arena_realloc(cabor_arena* arena, void* mem, size_t size)
+{
+    if (!mem)
+        return cabor_arena_alloc(arena, size);
+
+    size_t old_size = cabor_arena_allocation_size(mem);
+    cabor_arena_block* current = arena->blocks;
+
+    // Growing the latest allocation of the current block is common (vectors being pushed to)
+    // so we try to extend it in place before falling back to allocate + copy
+    if (current && (char*)mem + align_up(old_size) == block_data(current) + current->used)
+    {
+        size_t new_used = current->used - align_up(old_size) + align_up(size);
+        if (new_used <= current->capacity)
+        {
+            current->used = new_used;
+            *(size_t*)((char*)mem - CABOR_ARENA_ALLOCATION_HEADER_SIZE) = size;
+            return mem;
+        }
+    }
+
+    void* new_mem = cabor_arena_alloc(arena, size);
+    memcpy(new_mem, mem, old_size < size ? old_size : size);
+    return new_mem;
+}
+
+size_t cabor_arena_allocation_size(void* mem)
+{
+    return *(size_t*)((char*)mem - CABOR_ARENA_ALLOCATION_HEADER_SIZE);
+}
+
+bool cabor_arena_owns(cabor_arena* arena, void* mem)
+{
+    for (cabor_arena_block* block = arena->blocks; block; block = block->next)
+    {
+        char* begin = block_data(block);
+        if ((char*)mem >= begin && (char*)mem < begin + block->used)
+            return true;
+    }
+    return false;
+}
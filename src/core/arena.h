@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../cabor_defines.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Region allocator used behind cabor_allocator_context. Memory is handed out by bumping a cursor
+// inside large blocks that are requested from the parent allocator context. Individual allocations
+// are never freed, instead the whole arena is released at once with cabor_arena_release().
+//
+// The intended usage is one arena per compilation, see cabor_compile().
+
+#define CABOR_ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+#define CABOR_ARENA_ALIGNMENT 16
+
+struct cabor_allocator_context_t;
+struct cabor_arena_block_t;
+
+typedef struct
+{
+    struct cabor_allocator_context_t* parent; // arena blocks are allocated from here
+    struct cabor_arena_block_t* blocks;       // current block first
+    size_t block_size;
+    size_t reserved;                          // total bytes in all blocks, including headers
+} cabor_arena;
+
+void cabor_arena_init(cabor_arena* arena, struct cabor_allocator_context_t* parent, size_t block_size);
+
+// Frees every block owned by the arena, all pointers returned by the arena become invalid
+void cabor_arena_release(cabor_arena* arena);
+
+void* cabor_arena_alloc(cabor_arena* arena, size_t size);
+void* cabor_arena_realloc(cabor_arena* arena, void* mem, size_t size);
+
+// Size of the allocation as it was requested, mem must be returned by this arena
+size_t cabor_arena_allocation_size(void* mem);
+
+bool cabor_arena_owns(cabor_arena* arena, void* mem);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+
+// Loads and stores of values that one thread writes while other threads read them, like the per thread
+// allocation counters. The project is C99 so these map to the compiler builtins instead of stdatomic.h.
+//
+// Relaxed accesses only guarantee that a reader sees a whole value that was written at some point, they
+// don't order anything else. Acquire loads and release stores of a pointer also make everything the
+// writer did before the store visible to a reader that sees the pointer, use them to publish entries.
+
+#if defined(_MSC_VER)
+
+// Aligned pointer sized accesses don't tear on x86 and x64, volatile keeps the compiler from caching or
+// splitting them. With the default /volatile:ms volatile loads acquire and volatile stores release.
+static inline size_t cabor_atomic_load_size(const size_t* value)             { return *(const volatile size_t*)value; }
+static inline void   cabor_atomic_store_size(size_t* value, size_t new_value) { *(volatile size_t*)value = new_value; }
+static inline const void* cabor_atomic_load_ptr_acquire(const void* const* ptr)              { return *(const void* const volatile*)ptr; }
+static inline void        cabor_atomic_store_ptr_release(const void** ptr, const void* value) { *(const void* volatile*)ptr = value; }
+
+#else
+
+static inline size_t cabor_atomic_load_size(const size_t* value)             { return __atomic_load_n(value, __ATOMIC_RELAXED); }
+static inline void   cabor_atomic_store_size(size_t* value, size_t new_value) { __atomic_store_n(value, new_value, __ATOMIC_RELAXED); }
+static inline const void* cabor_atomic_load_ptr_acquire(const void* const* ptr)              { return __atomic_load_n(ptr, __ATOMIC_ACQUIRE); }
+static inline void        cabor_atomic_store_ptr_release(const void** ptr, const void* value) { __atomic_store_n(ptr, value, __ATOMIC_RELEASE); }
+
+#endif
+
+// Counters with a single writer, the read-modify-write doesn't have to be atomic as a whole because no
+// other thread stores to the value. Readers on other threads see either the old or the new total.
+static inline void cabor_atomic_add_size(size_t* value, size_t delta)
+{
+    cabor_atomic_store_size(value, cabor_atomic_load_size(value) + delta);
+}
+
+static inline void cabor_atomic_sub_size(size_t* value, size_t delta)
+{
+    cabor_atomic_store_size(value, cabor_atomic_load_size(value) - delta);
+}
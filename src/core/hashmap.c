@@ -4,16 +4,37 @@
 #include "../logging/logging.h"
 #include "../debug/cabor_debug.h"
 
-cabor_hash_map* cabor_create_hash_map(size_t initial_size)
+static size_t round_up_capacity(size_t size)
 {
+    size_t capacity = CABOR_HASH_MAP_MIN_CAPACITY;
+    while (capacity < size)
+        capacity <<= 1;
+    return capacity;
+}
+
+static cabor_hash_map* create_hash_map(size_t initial_size, bool owns_keys)
+{
+    size_t capacity = round_up_capacity(initial_size);
+
     CABOR_NEW(cabor_hash_map, map);
-    map->table = cabor_create_vector(initial_size, CABOR_MAP_ENTRY, false);
-    map->table->size = initial_size;
-    memset(map->table->vector_mem.mem, 0, cabor_get_map_entry_size() * map->table->size);
+    map->table = cabor_create_vector(capacity, CABOR_MAP_ENTRY, true);
+    map->table->size = capacity;
+    map->count = 0;
+    map->owns_keys = owns_keys;
     return map;
 }
 
-void cabor_free_key(const char* key)
+cabor_hash_map* cabor_create_hash_map(size_t initial_size)
+{
+    return create_hash_map(initial_size, true);
+}
+
+cabor_hash_map* cabor_create_hash_map_with_borrowed_keys(size_t initial_size)
+{
+    return create_hash_map(initial_size, false);
+}
+
+static void free_key(cabor_allocator_context* allocator, const char* key)
 {
     cabor_allocation alloc =
     {
@@ -22,31 +43,32 @@ void cabor_free_key(const char* key)
         .size = strlen(key) + 1 // + null terminator
 #endif
     };
-    CABOR_FREE(&alloc);
+    CABOR_FREE_CTX(allocator, &alloc);
 }
 
-void cabor_destroy_hash_map(cabor_hash_map* map)
+void cabor_free_key(const char* key)
 {
-    for (size_t i = 0; i < map->table->size; i++)
-    {
-        cabor_map_entry* entry = cabor_vector_get_map_entry(map->table, i);
+    free_key(cabor_get_current_allocator_context(), key);
+}
 
-        if (entry->key)
-            cabor_free_key(entry->key);
+void cabor_destroy_hash_map(cabor_hash_map* map)
+{
+    // Keys live in the same allocator context as the table
+    cabor_allocator_context* allocator = map->table->allocator;
 
-        cabor_map_entry* next = entry->next;
-        while (next)
+    if (map->owns_keys)
+    {
+        for (size_t i = 0; i < map->table->size; i++)
         {
-            cabor_map_entry* temp = next;
-            next = next->next;
-            if (temp->key)
-                cabor_free_key(temp->key);
-            CABOR_DELETE(cabor_map_entry, temp);
+            cabor_map_entry* entry = cabor_vector_get_map_entry(map->table, i);
+            if (entry->key)
+                free_key(allocator, entry->key);
         }
     }
 
     cabor_destroy_vector(map->table);
-    CABOR_DELETE(cabor_hash_map, map);
+    cabor_allocation map_alloc = CABOR_DEALLOC(cabor_hash_map, map);
+    CABOR_FREE_CTX(allocator, &map_alloc);
 }
 
 uint32_t cabor_hash_string(const char* str)
@@ -66,101 +88,157 @@ uint32_t cabor_hash_string_with_size(const char* str, size_t size)
 {
     // FNV-1a hashing
     uint32_t hash = 2166136261u;
-    while (*str)
+    for (size_t i = 0; i < size && str[i]; i++)
     {
-        if (str > size)
-            break;
-        hash ^= (uint8_t)(*str);
+        hash ^= (uint8_t)str[i];
         hash *= 16777619u;
-        str++;
     }
     return hash;
 }
 
-cabor_map_entry* cabor_map_insert(cabor_hash_map* map, const char* key, int value)
+static cabor_map_entry* map_entries(cabor_hash_map* map)
 {
-    const size_t table_size = map->table->size;
-    uint32_t index;
-    if (table_size > 0)
-    {
-        index = cabor_hash_string(key) % table_size;
-    }
-    else
-    {
-        index = cabor_hash_string(key) % table_size;
-    }
+    return (cabor_map_entry*)map->table->vector_mem.mem;
+}
 
-    cabor_map_entry* entry = cabor_vector_get_map_entry(map->table, index);
+// How far the entry in slot idx is from the slot its hash points to
+static size_t probe_distance(const cabor_map_entry* entry, size_t idx, size_t mask)
+{
+    return (idx - (entry->hash & mask)) & mask;
+}
 
-    if (entry->key == NULL) // No collision, store (key,value) directly in the entry
+static cabor_map_entry* find_entry(cabor_hash_map* map, const char* key, uint32_t hash)
+{
+    cabor_map_entry* entries = map_entries(map);
+    const size_t mask = map->table->size - 1;
+
+    for (size_t idx = hash & mask, dist = 0; ; idx = (idx + 1) & mask, dist++)
     {
-        entry->key = cabor_strdup(key);
-        entry->value = value;
-        entry->next = NULL;
-        return entry;
+        cabor_map_entry* entry = &entries[idx];
+
+        // Robin hood ordering guarantees the key would have been placed before a richer entry
+        if (!entry->key || probe_distance(entry, idx, mask) < dist)
+            return NULL;
+
+        // Maps with interned keys usually get the same pointer back
+        if (entry->hash == hash && (entry->key == key || strcmp(entry->key, key) == 0))
+            return entry;
     }
+}
+
+// entry must not be in the map yet, returns the slot where entry ended up
+static cabor_map_entry* place_entry(cabor_hash_map* map, cabor_map_entry entry)
+{
+    cabor_map_entry* entries = map_entries(map);
+    const size_t mask = map->table->size - 1;
+    cabor_map_entry* placed = NULL;
 
-    while (true) // Check for collisions
+    for (size_t idx = entry.hash & mask, dist = 0; ; idx = (idx + 1) & mask, dist++)
     {
-        if (strcmp(entry->key, key) == 0) // No collision, allow shadowing
+        cabor_map_entry* slot = &entries[idx];
+
+        if (!slot->key)
         {
-            entry->value = value;
-            return entry;
+            *slot = entry;
+            return placed ? placed : slot;
         }
 
-        if (entry->next)
-            entry = entry->next;
-        else
-            break;
+        size_t slot_dist = probe_distance(slot, idx, mask);
+        if (slot_dist < dist)
+        {
+            // Take the slot and keep looking for a place for the displaced entry
+            cabor_map_entry displaced = *slot;
+            *slot = entry;
+            entry = displaced;
+            dist = slot_dist;
+
+            if (!placed)
+                placed = slot;
+        }
     }
+}
 
-    // collision, append the bucket with new value
-    CABOR_NEW(cabor_map_entry, new_entry);
-    new_entry->key = cabor_strdup(key);
-    new_entry->value = value;
-    new_entry->next = NULL;
-    entry->next = new_entry;
+static void grow_map(cabor_hash_map* map)
+{
+    cabor_vector* table = map->table;
+    cabor_allocation old_mem = table->vector_mem;
+    size_t old_capacity = table->size;
+    size_t new_capacity = old_capacity * 2;
+
+    table->vector_mem = CABOR_CALLOC_CTX(table->allocator, new_capacity, sizeof(cabor_map_entry));
+    table->capacity = new_capacity;
+    table->size = new_capacity;
+
+    // Stored hashes mean keys are moved over without rehashing or copying
+    cabor_map_entry* old_entries = old_mem.mem;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old_entries[i].key)
+            place_entry(map, old_entries[i]);
+    }
 
-    return new_entry;
+    CABOR_FREE_CTX(table->allocator, &old_mem);
 }
 
-int cabor_map_get(cabor_hash_map* map, const char* key, bool* found)
+static cabor_map_entry* insert_with_hash(cabor_hash_map* map, const char* key, uint32_t hash, int value)
 {
-    const size_t table_size = map->table->size;
-    uint32_t index = cabor_hash_string(key) % table_size;
-    cabor_map_entry* entry = cabor_vector_get_map_entry(map->table, index);
-
-    while (entry->key)
+    cabor_map_entry* existing = find_entry(map, key, hash);
+    if (existing) // allow shadowing
     {
-        if (strcmp(entry->key, key) == 0)
-        {
-            *found = true;
-            return entry->value;
-        }
-        entry = entry->next;
+        existing->value = value;
+        return existing;
     }
-    *found = false;
-    return -1;
+
+    if ((map->count + 1) * 100 > map->table->size * CABOR_HASH_MAP_MAX_LOAD_PERCENT)
+        grow_map(map);
+
+    cabor_map_entry entry =
+    {
+        .key = map->owns_keys ? cabor_strdup_ctx(map->table->allocator, key) : (char*)key,
+        .value = value,
+        .hash = hash
+    };
+
+    map->count++;
+    return place_entry(map, entry);
+}
+
+cabor_map_entry* cabor_map_insert(cabor_hash_map* map, const char* key, int value)
+{
+    return insert_with_hash(map, key, cabor_hash_string(key), value);
+}
+
+int cabor_map_get(cabor_hash_map* map, const char* key, bool* found)
+{
+    cabor_map_entry* entry = find_entry(map, key, cabor_hash_string(key));
+    *found = entry != NULL;
+    return entry ? entry->value : -1;
 }
 
 cabor_map_entry* cabor_map_get_entry(cabor_hash_map* map, const char* key, bool* found)
 {
-    const size_t table_size = map->table->size;
-    uint32_t index = cabor_hash_string(key) % table_size;
-    cabor_map_entry* entry = cabor_vector_get_map_entry(map->table, index);
+    cabor_map_entry* entry = find_entry(map, key, cabor_hash_string(key));
+    *found = entry != NULL;
+    return entry;
+}
 
-    while (entry->key)
-    {
-        if (strcmp(entry->key, key) == 0)
-        {
-            *found = true;
-            return entry;
-        }
-        entry = entry->next;
-    }
-    *found = false;
-    return NULL;
+cabor_map_entry* cabor_map_insert_atom(cabor_hash_map* map, cabor_atom key, int value)
+{
+    return insert_with_hash(map, cabor_atom_str(key), cabor_atom_hash(key), value);
+}
 
+int cabor_map_get_atom(cabor_hash_map* map, cabor_atom key, bool* found)
+{
+    cabor_map_entry* entry = find_entry(map, cabor_atom_str(key), cabor_atom_hash(key));
+    *found = entry != NULL;
+    return entry ? entry->value : -1;
+}
+
+cabor_map_entry* cabor_map_get_entry_atom(cabor_hash_map* map, cabor_atom key, bool* found)
+{
+    cabor_map_entry* entry = find_entry(map, cabor_atom_str(key), cabor_atom_hash(key));
+    *found = entry != NULL;
+    return entry;
 }
 
 size_t cabor_get_map_entry_size()
@@ -3,20 +3,36 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "vector.h"
+#include "intern.h"
+
+// Open addressing hash map from c string to int. Collisions are resolved with linear probing and
+// robin hood ordering (an entry that is further away from its home slot takes the slot over), the
+// table doubles when the load factor goes over CABOR_HASH_MAP_MAX_LOAD_PERCENT.
+//
+// Entries move around when inserting, entry pointers returned by the map are only valid until the next insert.
+
+#define CABOR_HASH_MAP_MAX_LOAD_PERCENT 75
+#define CABOR_HASH_MAP_MIN_CAPACITY 8
 
 typedef struct cabor_map_entry_t
 {
-    char* key;
+    char* key; // NULL for empty slots
     int value;
-    struct cabor_map_entry_t* next;
+    uint32_t hash;
 } cabor_map_entry;
 
 typedef struct
 {
-    cabor_vector* table;
+    cabor_vector* table; // size is always a power of two, iterate it and skip entries without key
+    size_t count;
+    bool owns_keys;      // keys are copied into the map unless it was created with borrowed keys
 } cabor_hash_map;
 
 cabor_hash_map* cabor_create_hash_map(size_t initial_size);
+
+// Keys are stored as is, the caller keeps them alive for the lifetime of the map (string literals, interned strings)
+cabor_hash_map* cabor_create_hash_map_with_borrowed_keys(size_t initial_size);
+
 void cabor_free_key(const char* key);
 void cabor_destroy_hash_map(cabor_hash_map* map);
 
@@ -26,4 +42,10 @@ cabor_map_entry* cabor_map_insert(cabor_hash_map* map, const char* key, int valu
 int cabor_map_get(cabor_hash_map* map, const char* key, bool* found);
 cabor_map_entry* cabor_map_get_entry(cabor_hash_map* map, const char* key, bool* found);
 
+// Same as above with interned keys, the hash comes from the intern pool. In maps with borrowed keys the
+// stored key is the interned string itself so lookups end with a pointer compare.
+cabor_map_entry* cabor_map_insert_atom(cabor_hash_map* map, cabor_atom key, int value);
+int cabor_map_get_atom(cabor_hash_map* map, cabor_atom key, bool* found);
+cabor_map_entry* cabor_map_get_entry_atom(cabor_hash_map* map, cabor_atom key, bool* found);
+
 size_t cabor_get_map_entry_size();
@@ -0,0 +1,377 @@
+#include "intern.h"
+
+#include <string.h>
+
+#include "memory.h"
+#include "mutex.h"
+#include "hashmap.h"
+#include "../debug/cabor_debug.h"
+
+#define CABOR_INTERN_INITIAL_CAPACITY 256
+#define CABOR_INTERN_ARENA_BLOCK_SIZE (16 * 1024)
+
+typedef struct
+{
+    const char* str;
+    uint32_t hash;
+    uint32_t length;
+} cabor_atom_info;
+
+typedef struct
+{
+    uint64_t generation; // cache is cleared when it doesn't match the generation of the table in use
+    cabor_atom atoms[CABOR_INTERN_CACHE_SIZE];
+} cabor_intern_cache;
+
+typedef cabor_atom_info* cabor_atom_page[CABOR_INTERN_PAGE_SIZE];
+
+// The process wide pool and each intern scope. Slots and pages hold indices into the table, the atoms
+// of a scope are the index with CABOR_ATOM_LOCAL_BIT set.
+typedef struct
+{
+    // Only taken when a string is not found in the thread cache
+    cabor_mutex* lock;
+
+    // Strings, atom chunks and slots live here until the table is destroyed, nothing in it ever moves
+    cabor_allocator_context arena;
+
+    // Atom -> string lookup. Pages and chunks are published before their atoms are handed out and never
+    // reallocated, so reading an atom that was returned by cabor_intern() needs no lock.
+    cabor_atom_page* pages[CABOR_INTERN_MAX_PAGES];
+    size_t count;
+
+    // String -> atom lookup, open addressing with linear probing, CABOR_ATOM_INVALID marks an empty slot.
+    // Outgrown slot arrays are left in the arena.
+    cabor_atom* slots;
+    size_t capacity;
+
+    uint64_t generation;
+} cabor_intern_table;
+
+struct cabor_intern_scope_t
+{
+    cabor_intern_table table;
+};
+
+static cabor_intern_table g_intern_pool;
+
+// Every table gets its own generation so a thread cache is never used with another table
+static uint64_t g_intern_generation;
+
+static CABOR_THREAD_LOCAL cabor_intern_cache t_intern_cache;
+static CABOR_THREAD_LOCAL cabor_intern_scope* t_intern_scope;
+
+static const char* g_builtin_atom_strings[] =
+{
+#define CABOR_BUILTIN_ATOM_STRING(name, str) str,
+    CABOR_BUILTIN_ATOMS(CABOR_BUILTIN_ATOM_STRING)
+#undef CABOR_BUILTIN_ATOM_STRING
+};
+
+static cabor_atom_info** atom_chunk(cabor_intern_table* table, cabor_atom index)
+{
+    size_t chunk = index / CABOR_INTERN_CHUNK_SIZE;
+    return &(*table->pages[chunk / CABOR_INTERN_PAGE_SIZE])[chunk % CABOR_INTERN_PAGE_SIZE];
+}
+
+static cabor_atom_info* table_info(cabor_intern_table* table, cabor_atom index)
+{
+    return &(*atom_chunk(table, index))[index % CABOR_INTERN_CHUNK_SIZE];
+}
+
+// The table of an atom, local atoms belong to the scope set on the thread
+static cabor_intern_table* atom_table(cabor_atom atom)
+{
+    return (atom & CABOR_ATOM_LOCAL_BIT) ? &t_intern_scope->table : &g_intern_pool;
+}
+
+static cabor_atom_info* atom_info(cabor_atom atom)
+{
+    return table_info(atom_table(atom), atom & ~CABOR_ATOM_LOCAL_BIT);
+}
+
+// Only reads the page and chunk of the atom, the count of the table changes under the lock
+static bool atom_is_interned(cabor_atom atom)
+{
+    if ((atom & CABOR_ATOM_LOCAL_BIT) && !t_intern_scope)
+        return false;
+
+    cabor_intern_table* table = atom_table(atom);
+    cabor_atom index = atom & ~CABOR_ATOM_LOCAL_BIT;
+    size_t chunk = index / CABOR_INTERN_CHUNK_SIZE;
+    return table->pages[chunk / CABOR_INTERN_PAGE_SIZE] && *atom_chunk(table, index);
+}
+
+static bool info_equals(const cabor_atom_info* info, const char* str, size_t size, uint32_t hash)
+{
+    return info->hash == hash && info->length == size && memcmp(info->str, str, size) == 0;
+}
+
+static cabor_atom push_atom(cabor_intern_table* table, const char* str, size_t size, uint32_t hash)
+{
+    CABOR_ASSERT(table->count < CABOR_ATOM_LOCAL_BIT, "ran out of atoms");
+
+    size_t chunk = table->count / CABOR_INTERN_CHUNK_SIZE;
+    size_t page = chunk / CABOR_INTERN_PAGE_SIZE;
+
+    if (!table->pages[page])
+    {
+        cabor_allocation page_alloc = CABOR_CALLOC_CTX(&table->arena, 1, sizeof(cabor_atom_page));
+        table->pages[page] = page_alloc.mem;
+    }
+
+    cabor_atom_info** chunk_slot = &(*table->pages[page])[chunk % CABOR_INTERN_PAGE_SIZE];
+    if (!*chunk_slot)
+    {
+        cabor_allocation chunk_alloc = CABOR_MALLOC_CTX(&table->arena, CABOR_INTERN_CHUNK_SIZE * sizeof(cabor_atom_info));
+        *chunk_slot = chunk_alloc.mem;
+    }
+
+    cabor_allocation str_alloc = CABOR_MALLOC_CTX(&table->arena, size + 1);
+    char* copy = str_alloc.mem;
+    memcpy(copy, str, size);
+    copy[size] = '\0';
+
+    cabor_atom index = (cabor_atom)table->count++;
+    cabor_atom_info* info = table_info(table, index);
+    info->str = copy;
+    info->hash = hash;
+    info->length = (uint32_t)size;
+    return index;
+}
+
+static void insert_slot(cabor_intern_table* table, cabor_atom* slots, size_t capacity, cabor_atom index)
+{
+    size_t mask = capacity - 1;
+    size_t idx = table_info(table, index)->hash & mask;
+    while (slots[idx] != CABOR_ATOM_INVALID)
+        idx = (idx + 1) & mask;
+    slots[idx] = index;
+}
+
+static void grow_slots(cabor_intern_table* table)
+{
+    size_t new_capacity = table->capacity * 2;
+    cabor_allocation new_slots = CABOR_CALLOC_CTX(&table->arena, new_capacity, sizeof(cabor_atom));
+
+    // Stored hashes are reused, strings are not touched
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        if (table->slots[i] != CABOR_ATOM_INVALID)
+            insert_slot(table, new_slots.mem, new_capacity, table->slots[i]);
+    }
+
+    table->slots = new_slots.mem;
+    table->capacity = new_capacity;
+}
+
+// Slot that holds the string, or the empty slot where it goes
+static cabor_atom* find_slot_locked(cabor_intern_table* table, const char* str, size_t size, uint32_t hash)
+{
+    size_t mask = table->capacity - 1;
+
+    for (size_t idx = hash & mask;; idx = (idx + 1) & mask)
+    {
+        cabor_atom* slot = &table->slots[idx];
+        if (*slot == CABOR_ATOM_INVALID || info_equals(table_info(table, *slot), str, size, hash))
+            return slot;
+    }
+}
+
+static cabor_atom insert_locked(cabor_intern_table* table, cabor_atom* slot, const char* str, size_t size, uint32_t hash)
+{
+    cabor_atom index = push_atom(table, str, size, hash);
+    *slot = index;
+
+    // Keep the load under 50% so misses stay short
+    if (table->count * 2 > table->capacity)
+        grow_slots(table);
+
+    return index;
+}
+
+static cabor_atom find_or_insert_locked(cabor_intern_table* table, const char* str, size_t size, uint32_t hash)
+{
+    cabor_atom* slot = find_slot_locked(table, str, size, hash);
+    return *slot != CABOR_ATOM_INVALID ? *slot : insert_locked(table, slot, str, size, hash);
+}
+
+// Strings the pool already has keep their atom so builtins compare equal in every scope, the rest are
+// added to the scope. The scope is searched first, a string keeps its local atom even if the pool gets
+// the same string later.
+static cabor_atom find_or_insert_in_scope(cabor_intern_scope* scope, const char* str, size_t size, uint32_t hash)
+{
+    cabor_intern_table* table = &scope->table;
+    cabor_atom atom;
+
+    CABOR_SCOPED_LOCK(table->lock)
+    {
+        cabor_atom* slot = find_slot_locked(table, str, size, hash);
+        if (*slot != CABOR_ATOM_INVALID)
+        {
+            atom = *slot | CABOR_ATOM_LOCAL_BIT;
+        }
+        else
+        {
+            CABOR_SCOPED_LOCK(g_intern_pool.lock)
+            {
+                atom = *find_slot_locked(&g_intern_pool, str, size, hash);
+            }
+
+            if (atom == CABOR_ATOM_INVALID)
+                atom = insert_locked(table, slot, str, size, hash) | CABOR_ATOM_LOCAL_BIT;
+        }
+    }
+
+    return atom;
+}
+
+static void create_table(cabor_intern_table* table)
+{
+    table->lock = cabor_create_mutex();
+    create_cabor_arena_allocator_context(&table->arena, CABOR_GET_ALLOCATOR(), CABOR_INTERN_ARENA_BLOCK_SIZE);
+
+    memset(table->pages, 0, sizeof(table->pages));
+    table->count = 0;
+    table->capacity = CABOR_INTERN_INITIAL_CAPACITY;
+    table->slots = CABOR_CALLOC_CTX(&table->arena, table->capacity, sizeof(cabor_atom)).mem;
+
+    // Index 0 is the empty string, it is CABOR_ATOM_INVALID and not in the lookup table
+    push_atom(table, "", 0, cabor_hash_string(""));
+}
+
+static void destroy_table(cabor_intern_table* table)
+{
+    destroy_cabor_allocator_context(&table->arena);
+    cabor_destroy_mutex(table->lock);
+
+    memset(table->pages, 0, sizeof(table->pages));
+    table->count = 0;
+    table->slots = NULL;
+    table->capacity = 0;
+    table->lock = NULL;
+}
+
+void cabor_create_intern_pool()
+{
+    create_table(&g_intern_pool);
+    g_intern_pool.generation = ++g_intern_generation;
+
+    for (size_t i = CABOR_ATOM_INVALID + 1; i < CABOR_BUILTIN_ATOM_COUNT; i++)
+    {
+        cabor_atom atom = cabor_intern(g_builtin_atom_strings[i]);
+        CABOR_ASSERT(atom == i, "builtin atom was interned twice");
+    }
+}
+
+void cabor_destroy_intern_pool()
+{
+    destroy_table(&g_intern_pool);
+}
+
+cabor_intern_scope* cabor_create_intern_scope()
+{
+    CABOR_ASSERT(g_intern_pool.lock != NULL, "intern pool was not created");
+
+    CABOR_NEW(cabor_intern_scope, scope);
+    create_table(&scope->table);
+
+    CABOR_SCOPED_LOCK(g_intern_pool.lock)
+    {
+        scope->table.generation = ++g_intern_generation;
+    }
+
+    return scope;
+}
+
+void cabor_destroy_intern_scope(cabor_intern_scope* scope)
+{
+    CABOR_ASSERT(t_intern_scope != scope, "intern scope was destroyed while it was set");
+
+    destroy_table(&scope->table);
+    CABOR_DELETE(cabor_intern_scope, scope);
+}
+
+cabor_intern_scope* cabor_set_intern_scope(cabor_intern_scope* scope)
+{
+    cabor_intern_scope* previous = t_intern_scope;
+    t_intern_scope = scope;
+    return previous;
+}
+
+cabor_intern_scope* cabor_get_intern_scope()
+{
+    return t_intern_scope;
+}
+
+cabor_atom cabor_intern(const char* str)
+{
+    return cabor_intern_with_size(str, strlen(str));
+}
+
+cabor_atom cabor_intern_with_size(const char* str, size_t size)
+{
+    CABOR_ASSERT(g_intern_pool.lock != NULL, "intern pool was not created");
+
+    if (size == 0)
+        return CABOR_ATOM_INVALID;
+
+    uint32_t hash = cabor_hash_string_with_size(str, size);
+    cabor_intern_scope* scope = t_intern_scope;
+    uint64_t generation = scope ? scope->table.generation : g_intern_pool.generation;
+
+    cabor_intern_cache* cache = &t_intern_cache;
+    if (cache->generation != generation)
+    {
+        memset(cache->atoms, 0, sizeof(cache->atoms));
+        cache->generation = generation;
+    }
+
+    cabor_atom* cached = &cache->atoms[hash & (CABOR_INTERN_CACHE_SIZE - 1)];
+    if (*cached != CABOR_ATOM_INVALID && info_equals(atom_info(*cached), str, size, hash))
+        return *cached;
+
+    cabor_atom atom;
+    if (scope)
+    {
+        atom = find_or_insert_in_scope(scope, str, size, hash);
+    }
+    else
+    {
+        CABOR_SCOPED_LOCK(g_intern_pool.lock)
+        {
+            atom = find_or_insert_locked(&g_intern_pool, str, size, hash);
+        }
+    }
+
+    *cached = atom;
+    return atom;
+}
+
+const char* cabor_atom_str(cabor_atom atom)
+{
+    CABOR_ASSERT(atom_is_interned(atom), "atom doesn't belong to the intern pool or the current scope");
+    return atom_info(atom)->str;
+}
+
+size_t cabor_atom_length(cabor_atom atom)
+{
+    CABOR_ASSERT(atom_is_interned(atom), "atom doesn't belong to the intern pool or the current scope");
+    return atom_info(atom)->length;
+}
+
+uint32_t cabor_atom_hash(cabor_atom atom)
+{
+    CABOR_ASSERT(atom_is_interned(atom), "atom doesn't belong to the intern pool or the current scope");
+    return atom_info(atom)->hash;
+}
+
+size_t cabor_get_interned_count()
+{
+    size_t count;
+    CABOR_SCOPED_LOCK(g_intern_pool.lock)
+    {
+        count = g_intern_pool.count;
+    }
+    return count;
+}
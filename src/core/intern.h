@@ -0,0 +1,127 @@
+#pragma once
+
+#include "../cabor_defines.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// String interning. Every distinct string gets a small integer id (atom) so identifiers, keywords and
+// operators can be compared with == instead of strcmp. The string behind an atom is stored once and never
+// moves, it can be used as a borrowed hash map key.
+//
+// Lifetime: the process wide pool keeps its strings until it is destroyed, it only grows. It holds the
+// builtins and whatever is interned while no intern scope is set. A compile sets a scope of its own
+// (cabor_create_intern_scope()) so the names of the program go to the scope instead and are freed with
+// it, a long running server doesn't keep the names of every program it compiled. Strings that are in the
+// pool already keep their pool atom inside a scope, the others get a local atom that is only valid on
+// threads that have the scope set and only until it is destroyed.
+//
+// The pool and scopes are shared between threads. Inserting takes a lock, looking up the string or hash
+// of an atom doesn't. Each thread also keeps a small cache of recently interned strings so repeated
+// lookups of the same identifier don't touch the lock.
+
+typedef uint32_t cabor_atom;
+
+#define CABOR_ATOM_LOCAL_BIT ((cabor_atom)1 << 31) // set in the atoms of an intern scope
+
+#define CABOR_INTERN_CHUNK_SIZE 4096  // atoms per chunk, chunks are never reallocated
+#define CABOR_INTERN_PAGE_SIZE 1024   // chunks per page, pages and chunks are allocated when first needed
+#define CABOR_INTERN_MAX_PAGES ((uint64_t)CABOR_ATOM_LOCAL_BIT / ((uint64_t)CABOR_INTERN_CHUNK_SIZE * CABOR_INTERN_PAGE_SIZE))
+#define CABOR_INTERN_CACHE_SIZE 256   // entries in the per thread cache, power of two
+
+// Strings that the compiler itself looks for. These are interned first when the pool is created so the
+// atom values are compile time constants. CABOR_ATOM_INVALID is 0 and stands for the empty string.
+// Keywords must stay together, see cabor_atom_is_keyword().
+#define CABOR_BUILTIN_ATOMS(X)        \
+    X(INVALID,     "")                \
+    X(IF,          "if")              \
+    X(THEN,        "then")            \
+    X(ELSE,        "else")            \
+    X(WHILE,       "while")           \
+    X(RETURN,      "return")          \
+    X(FOR,         "for")             \
+    X(DO,          "do")              \
+    X(VAR,         "var")             \
+    X(TRUE,        "true")            \
+    X(FALSE,       "false")           \
+    X(ASSIGN,      "=")               \
+    X(OR,          "or")              \
+    X(AND,         "and")             \
+    X(NOT,         "not")             \
+    X(EQ,          "==")              \
+    X(NE,          "!=")              \
+    X(LT,          "<")               \
+    X(LE,          "<=")              \
+    X(GT,          ">")               \
+    X(GE,          ">=")              \
+    X(PLUS,        "+")               \
+    X(MINUS,       "-")               \
+    X(MULTIPLY,    "*")               \
+    X(DIVIDE,      "/")               \
+    X(REMAINDER,   "%")               \
+    X(LPAREN,      "(")               \
+    X(RPAREN,      ")")               \
+    X(LBRACE,      "{")               \
+    X(RBRACE,      "}")               \
+    X(COMMA,       ",")               \
+    X(SEMICOLON,   ";")               \
+    X(COLON,       ":")               \
+    X(INT,         "Int")             \
+    X(BOOL,        "Bool")            \
+    X(UNIT,        "<UNIT>")          \
+    X(ERROR,       "<ERROR>")         \
+    X(PRINT_INT,   "print_int")       \
+    X(PRINT_BOOL,  "print_bool")      \
+    X(READ_INT,    "read_int")        \
+    X(UNARY_MINUS, "unary_-")         \
+    X(UNARY_NOT,   "unary_not")
+
+#define CABOR_DECLARE_BUILTIN_ATOM(name, str) CABOR_ATOM_##name,
+
+typedef enum
+{
+    CABOR_BUILTIN_ATOMS(CABOR_DECLARE_BUILTIN_ATOM)
+    CABOR_BUILTIN_ATOM_COUNT
+} cabor_builtin_atom;
+
+#undef CABOR_DECLARE_BUILTIN_ATOM
+
+#define CABOR_ATOM_FIRST_KEYWORD CABOR_ATOM_IF
+#define CABOR_ATOM_LAST_KEYWORD CABOR_ATOM_VAR
+
+static inline bool cabor_atom_is_keyword(cabor_atom atom)
+{
+    return atom >= CABOR_ATOM_FIRST_KEYWORD && atom <= CABOR_ATOM_LAST_KEYWORD;
+}
+
+// Called once from main before any thread interns strings and after every thread is done with them
+void cabor_create_intern_pool();
+void cabor_destroy_intern_pool();
+
+// Names interned while a compile runs, see the lifetime notes at the top
+typedef struct cabor_intern_scope_t cabor_intern_scope;
+
+cabor_intern_scope* cabor_create_intern_scope();
+void cabor_destroy_intern_scope(cabor_intern_scope* scope);
+
+// Scope of the calling thread, NULL interns into the pool. Returns the previous scope. Work handed to
+// other threads has to set the same scope there before it touches local atoms.
+cabor_intern_scope* cabor_set_intern_scope(cabor_intern_scope* scope);
+cabor_intern_scope* cabor_get_intern_scope();
+
+cabor_atom cabor_intern(const char* str);
+
+// str doesn't have to be null terminated
+cabor_atom cabor_intern_with_size(const char* str, size_t size);
+
+// Null terminated copy owned by the pool or the scope of the atom
+const char* cabor_atom_str(cabor_atom atom);
+
+size_t cabor_atom_length(cabor_atom atom);
+
+// Same value as cabor_hash_string(cabor_atom_str(atom)), computed once when the string was interned
+uint32_t cabor_atom_hash(cabor_atom atom);
+
+// Atoms in the process wide pool, scopes don't count
+size_t cabor_get_interned_count();
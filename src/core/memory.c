@@ -3,7 +3,10 @@
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <stdint.h>
 
+#include "atomic.h"
+#include "mutex.h"
 #include "../debug/cabor_debug.h"
 
 static cabor_allocator_context g_allocator;
@@ -17,44 +20,147 @@ static cabor_allocator_context g_allocator;
 #endif
 
 
+static CABOR_THREAD_LOCAL cabor_allocator_context* t_current_allocator;
+static CABOR_THREAD_LOCAL cabor_allocator_context* t_thread_allocator;
+
+// Only taken when a thread allocates for the first time, or when totals are summed up
+static cabor_mutex* g_thread_allocators_lock;
+static cabor_allocator_context* g_thread_allocators;
+
 void create_cabor_allocator_context(cabor_allocator_context* alloc_ctx)
 {
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+    alloc_ctx->kind = CABOR_ALLOCATOR_HEAP;
     alloc_ctx->allocated_mem = 0;
+    alloc_ctx->next_thread_ctx = NULL;
+    alloc_ctx->thread_ctx_mem = NULL;
+
+    // Slabs come straight from malloc so only the objects show up in accounting and leak checks
+    for (size_t i = 0; i < CABOR_POOL_SIZE_CLASSES; i++)
+    {
+        size_t object_size = (size_t)CABOR_POOL_SMALLEST_CLASS << i;
+        cabor_pool_init(&alloc_ctx->pools[i], NULL, object_size, CABOR_POOL_SLAB_SIZE / object_size);
+    }
+#if CABOR_ENABLE_MEMORY_DEBUGGING
+    alloc_ctx->trace = calloc(1, sizeof(cabor_allocation_trace_table));
 #endif
+}
+
+void create_cabor_arena_allocator_context(cabor_allocator_context* alloc_ctx, cabor_allocator_context* parent, size_t block_size)
+{
+    alloc_ctx->kind = CABOR_ALLOCATOR_ARENA;
+    alloc_ctx->allocated_mem = 0;
+    alloc_ctx->next_thread_ctx = NULL;
+    alloc_ctx->thread_ctx_mem = NULL;
+    cabor_arena_init(&alloc_ctx->arena, parent, block_size);
 #if CABOR_ENABLE_MEMORY_DEBUGGING
-    alloc_ctx->debug_size = 0;
-    alloc_ctx->alloc_lock = cabor_create_mutex_default_malloc();
-    alloc_ctx->dealloc_lock = cabor_create_mutex_default_malloc();
+    alloc_ctx->trace = NULL;
 #endif
 }
 
 void destroy_cabor_allocator_context(cabor_allocator_context* alloc_ctx)
 {
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+    if (alloc_ctx->kind == CABOR_ALLOCATOR_ARENA)
+    {
+        cabor_arena_release(&alloc_ctx->arena);
+        alloc_ctx->allocated_mem = 0;
+        return;
+    }
+
     alloc_ctx->allocated_mem = 0;
-#endif
+    for (size_t i = 0; i < CABOR_POOL_SIZE_CLASSES; i++)
+        cabor_pool_release(&alloc_ctx->pools[i]);
 #if CABOR_ENABLE_MEMORY_DEBUGGING
-    alloc_ctx->debug_size = 0;
-    cabor_destroy_mutex_default_malloc(alloc_ctx->alloc_lock);
-    cabor_destroy_mutex_default_malloc(alloc_ctx->dealloc_lock);
+    free(alloc_ctx->trace);
+    alloc_ctx->trace = NULL;
 #endif
 }
 
+void create_cabor_global_allocator_context()
+{
+    create_cabor_allocator_context(&g_allocator);
+    g_thread_allocators_lock = cabor_create_mutex_default_malloc();
+    g_thread_allocators = NULL;
+}
+
+void destroy_cabor_global_allocator_context()
+{
+    cabor_allocator_context* ctx = g_thread_allocators;
+    while (ctx)
+    {
+        cabor_allocator_context* next = ctx->next_thread_ctx;
+        destroy_cabor_allocator_context(ctx);
+        free(ctx->thread_ctx_mem);
+        ctx = next;
+    }
+    g_thread_allocators = NULL;
+    t_thread_allocator = NULL;
+
+    cabor_destroy_mutex_default_malloc(g_thread_allocators_lock);
+    g_thread_allocators_lock = NULL;
+    destroy_cabor_allocator_context(&g_allocator);
+}
+
+static cabor_allocator_context* create_thread_allocator_context()
+{
+    // Whole cache lines, aligned, so counters of different threads never share a line
+    size_t size = (sizeof(cabor_allocator_context) + CABOR_CACHE_LINE_SIZE - 1) & ~((size_t)CABOR_CACHE_LINE_SIZE - 1);
+    char* mem = malloc(size + CABOR_CACHE_LINE_SIZE);
+    if (!mem)
+    {
+        fputs("Failed to allocate thread allocator context!", stderr);
+        assert(0);
+        exit(1);
+    }
+
+    uintptr_t aligned = ((uintptr_t)mem + CABOR_CACHE_LINE_SIZE - 1) & ~((uintptr_t)CABOR_CACHE_LINE_SIZE - 1);
+    cabor_allocator_context* alloc_ctx = (cabor_allocator_context*)aligned;
+    create_cabor_allocator_context(alloc_ctx);
+    alloc_ctx->thread_ctx_mem = mem;
+
+    CABOR_SCOPED_LOCK(g_thread_allocators_lock)
+    {
+        alloc_ctx->next_thread_ctx = g_thread_allocators;
+        g_thread_allocators = alloc_ctx;
+    }
+
+    return alloc_ctx;
+}
+
+cabor_allocator_context* cabor_get_thread_allocator_context()
+{
+    if (!t_thread_allocator)
+        t_thread_allocator = create_thread_allocator_context();
+    return t_thread_allocator;
+}
+
+// Global context forwards to the calling thread, heap memory can be freed from any thread
+static cabor_allocator_context* resolve_allocator_context(cabor_allocator_context* alloc_ctx)
+{
+    return alloc_ctx == &g_allocator ? cabor_get_thread_allocator_context() : alloc_ctx;
+}
+
 cabor_allocation cabor_malloc(cabor_allocator_context* alloc_ctx, size_t size, const char* debug)
 {
-#if CABOR_ENABLE_MEMORY_DEBUGGING
-    CABOR_SCOPED_LOCK(alloc_ctx->alloc_lock)
+    alloc_ctx = resolve_allocator_context(alloc_ctx);
+
+    if (alloc_ctx->kind == CABOR_ALLOCATOR_ARENA)
     {
-#endif
+        cabor_atomic_add_size(&alloc_ctx->allocated_mem, size);
+        cabor_allocation arena_alloc =
+        {
+            .mem = cabor_arena_alloc(&alloc_ctx->arena, size),
 #ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-        alloc_ctx->allocated_mem += size;
+            .size = size
 #endif
-#if CABOR_ENABLE_MEMORY_DEBUGGING 
-        alloc_ctx->debug[alloc_ctx->debug_size++] = debug;
+        };
+        return arena_alloc;
+    }
+
+#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+    cabor_atomic_add_size(&alloc_ctx->allocated_mem, size);
 #endif
 #if CABOR_ENABLE_MEMORY_DEBUGGING
-    }
+    cabor_trace_allocation(alloc_ctx->trace, debug, size);
 #endif
 
     cabor_allocation alloc =
@@ -77,18 +183,30 @@ cabor_allocation cabor_malloc(cabor_allocator_context* alloc_ctx, size_t size, c
 
 cabor_allocation cabor_realloc(cabor_allocator_context* alloc_ctx, cabor_allocation* old_alloc, size_t size, const char* debug)
 {
-#if CABOR_ENABLE_MEMORY_DEBUGGING
-    CABOR_SCOPED_LOCK(alloc_ctx->alloc_lock)
+    alloc_ctx = resolve_allocator_context(alloc_ctx);
+
+    if (alloc_ctx->kind == CABOR_ALLOCATOR_ARENA)
     {
+        CABOR_ASSERT((old_alloc->mem == NULL || cabor_arena_owns(&alloc_ctx->arena, old_alloc->mem)), "cabor_realloc on arena with memory it doesn't own!");
+        size_t old_size = old_alloc->mem ? cabor_arena_allocation_size(old_alloc->mem) : 0;
+        cabor_atomic_add_size(&alloc_ctx->allocated_mem, size - old_size);
+        cabor_allocation arena_alloc =
+        {
+            .mem = cabor_arena_realloc(&alloc_ctx->arena, old_alloc->mem, size),
+#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+            .size = size
 #endif
+        };
+        return arena_alloc;
+    }
+
 #ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-        alloc_ctx->allocated_mem = alloc_ctx->allocated_mem - old_alloc->size + size;
+    cabor_atomic_add_size(&alloc_ctx->allocated_mem, size - old_alloc->size);
 #endif
 #if CABOR_ENABLE_MEMORY_DEBUGGING
-        alloc_ctx->debug[alloc_ctx->debug_size++] = debug;
-#endif
-#if CABOR_ENABLE_MEMORY_DEBUGGING
-    }
+    if (old_alloc->mem)
+        cabor_trace_deallocation(alloc_ctx->trace, debug, old_alloc->size);
+    cabor_trace_allocation(alloc_ctx->trace, debug, size);
 #endif
 
     cabor_allocation new_alloc =
@@ -112,18 +230,20 @@ cabor_allocation cabor_realloc(cabor_allocator_context* alloc_ctx, cabor_allocat
 
 cabor_allocation cabor_calloc(cabor_allocator_context* alloc_ctx, size_t num, size_t size, const char* debug)
 {
-#if CABOR_ENABLE_MEMORY_DEBUGGING
-    CABOR_SCOPED_LOCK(alloc_ctx->alloc_lock)
+    alloc_ctx = resolve_allocator_context(alloc_ctx);
+
+    if (alloc_ctx->kind == CABOR_ALLOCATOR_ARENA)
     {
-#endif
+        cabor_allocation arena_alloc = cabor_malloc(alloc_ctx, num * size, debug);
+        memset(arena_alloc.mem, 0, num * size);
+        return arena_alloc;
+    }
+
 #ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-        alloc_ctx->allocated_mem += num * size;
-#endif
-#if CABOR_ENABLE_MEMORY_DEBUGGING
-        alloc_ctx->debug[alloc_ctx->debug_size++] = debug;
+    cabor_atomic_add_size(&alloc_ctx->allocated_mem, num * size);
 #endif
 #if CABOR_ENABLE_MEMORY_DEBUGGING
-    }
+    cabor_trace_allocation(alloc_ctx->trace, debug, num * size);
 #endif
 
     cabor_allocation alloc =
@@ -146,22 +266,90 @@ cabor_allocation cabor_calloc(cabor_allocator_context* alloc_ctx, size_t num, si
 
 void cabor_free(cabor_allocator_context* alloc_ctx, cabor_allocation* alloc, const char* dealloc)
 {
-#if CABOR_ENABLE_MEMORY_DEBUGGING
-    CABOR_SCOPED_LOCK(alloc_ctx->alloc_lock)
+    alloc_ctx = resolve_allocator_context(alloc_ctx);
+
+    if (alloc_ctx->kind == CABOR_ALLOCATOR_ARENA)
     {
+        // Arena memory is released in bulk by destroy_cabor_allocator_context
+        CABOR_ASSERT((alloc->mem == NULL || cabor_arena_owns(&alloc_ctx->arena, alloc->mem)), "cabor_free on arena with memory it doesn't own!");
+        if (alloc->mem)
+            cabor_atomic_sub_size(&alloc_ctx->allocated_mem, cabor_arena_allocation_size(alloc->mem));
+#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+        alloc->size = 0;
 #endif
+        return;
+    }
+
 #ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-        alloc_ctx->allocated_mem -= alloc->size;
+    cabor_atomic_sub_size(&alloc_ctx->allocated_mem, alloc->size);
 #endif
 
 #if CABOR_ENABLE_MEMORY_DEBUGGING
-        alloc_ctx->dealloc[alloc_ctx->dealloc_size++] = dealloc;
+    cabor_trace_deallocation(alloc_ctx->trace, dealloc, alloc->size);
+#endif
+    
+    free(alloc->mem);
+
+#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+    alloc->size = 0;
+#endif
+}
+
+static size_t pool_size_class(size_t size)
+{
+    size_t size_class = 0;
+    size_t class_size = CABOR_POOL_SMALLEST_CLASS;
+    while (class_size < size)
+    {
+        class_size <<= 1;
+        size_class++;
+    }
+    return size_class;
+}
+
+cabor_allocation cabor_pooled_malloc(cabor_allocator_context* alloc_ctx, size_t size, const char* debug)
+{
+    alloc_ctx = resolve_allocator_context(alloc_ctx);
+
+    if (alloc_ctx->kind == CABOR_ALLOCATOR_ARENA || size > CABOR_POOL_MAX_OBJECT_SIZE)
+        return cabor_malloc(alloc_ctx, size, debug);
+
+#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+    cabor_atomic_add_size(&alloc_ctx->allocated_mem, size);
 #endif
 #if CABOR_ENABLE_MEMORY_DEBUGGING
+    cabor_trace_allocation(alloc_ctx->trace, debug, size);
+#endif
+
+    cabor_allocation alloc =
+    {
+        .mem = cabor_pool_alloc(&alloc_ctx->pools[pool_size_class(size)]),
+#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+        .size = size
+#endif
+    };
+    return alloc;
+}
+
+void cabor_pooled_free(cabor_allocator_context* alloc_ctx, cabor_allocation* alloc, size_t size, const char* dealloc)
+{
+    alloc_ctx = resolve_allocator_context(alloc_ctx);
+
+    if (alloc_ctx->kind == CABOR_ALLOCATOR_ARENA || size > CABOR_POOL_MAX_OBJECT_SIZE)
+    {
+        cabor_free(alloc_ctx, alloc, dealloc);
+        return;
     }
+
+#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+    CABOR_ASSERT(alloc->size == size, "cabor_pooled_free with different size than the object was allocated with!");
+    cabor_atomic_sub_size(&alloc_ctx->allocated_mem, alloc->size);
+#endif
+#if CABOR_ENABLE_MEMORY_DEBUGGING
+    cabor_trace_deallocation(alloc_ctx->trace, dealloc, size);
 #endif
-    
-    free(alloc->mem);
+
+    cabor_pool_free(&alloc_ctx->pools[pool_size_class(size)], alloc->mem);
 
 #ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
     alloc->size = 0;
@@ -173,9 +361,78 @@ cabor_allocator_context* cabor_get_global_allocator_context()
     return &g_allocator;
 }
 
+cabor_allocator_context* cabor_get_current_allocator_context()
+{
+    return t_current_allocator ? t_current_allocator : &g_allocator;
+}
+
+cabor_allocator_context* cabor_set_current_allocator_context(cabor_allocator_context* alloc_ctx)
+{
+    cabor_allocator_context* previous = cabor_get_current_allocator_context();
+    t_current_allocator = alloc_ctx;
+    return previous;
+}
+
+cabor_allocator_context* cabor_get_first_thread_allocator_context()
+{
+    return g_thread_allocators;
+}
+
+cabor_allocation cabor_create_allocation_trace_report(size_t* size)
+{
+#if CABOR_ENABLE_MEMORY_DEBUGGING
+    cabor_allocation_trace_table** tables = NULL;
+    size_t num_tables = 0;
+
+    CABOR_SCOPED_LOCK(g_thread_allocators_lock)
+    {
+        for (cabor_allocator_context* ctx = g_thread_allocators; ctx; ctx = ctx->next_thread_ctx)
+            num_tables++;
+
+        tables = malloc((num_tables ? num_tables : 1) * sizeof(cabor_allocation_trace_table*));
+        size_t i = 0;
+        for (cabor_allocator_context* ctx = g_thread_allocators; ctx; ctx = ctx->next_thread_ctx)
+            tables[i++] = ctx->trace;
+    }
+
+    // Per thread contexts live until the global context is destroyed so the tables stay valid without the lock.
+    // Counts can change while formatting, including by allocating the report itself, so retry until it fits.
+    size_t report_size = cabor_format_allocation_trace(tables, num_tables, NULL, 0);
+    cabor_allocation report = CABOR_MALLOC(report_size + 1);
+    size_t written = cabor_format_allocation_trace(tables, num_tables, report.mem, report_size + 1);
+    while (written > report_size)
+    {
+        CABOR_FREE(&report);
+        report_size = written * 2;
+        report = CABOR_MALLOC(report_size + 1);
+        written = cabor_format_allocation_trace(tables, num_tables, report.mem, report_size + 1);
+    }
+    *size = written;
+
+    free(tables);
+    return report;
+#else
+    const char note[] = "Allocation tracing is only available in memory debug builds\n";
+    cabor_allocation report = CABOR_MALLOC(sizeof(note));
+    memcpy(report.mem, note, sizeof(note));
+    *size = sizeof(note) - 1;
+    return report;
+#endif
+}
+
 size_t cabor_get_current_allocated(cabor_allocator_context* alloc_ctx)
 {
-    return alloc_ctx->allocated_mem;
+    if (alloc_ctx != &g_allocator)
+        return cabor_atomic_load_size(&alloc_ctx->allocated_mem);
+
+    // Unsigned wrap around cancels out when memory is freed on a different thread than it was allocated on
+    size_t total = 0;
+    CABOR_SCOPED_LOCK(g_thread_allocators_lock)
+    {
+        for (cabor_allocator_context* ctx = g_thread_allocators; ctx; ctx = ctx->next_thread_ctx)
+            total += cabor_atomic_load_size(&ctx->allocated_mem);
+    }
+    return total;
 }
 
 const char* cabor_convert_bytes_to_human_readable(size_t bytes, double* converted)
@@ -195,6 +452,11 @@ const char* cabor_convert_bytes_to_human_readable(size_t bytes, double* converte
 }
 
 char* cabor_strdup(const char* src)
+{
+    return cabor_strdup_ctx(cabor_get_current_allocator_context(), src);
+}
+
+char* cabor_strdup_ctx(cabor_allocator_context* alloc_ctx, const char* src)
 {
     if (!src)
     {
@@ -203,7 +465,7 @@ char* cabor_strdup(const char* src)
     }
 
     size_t len = strlen(src) + 1; // + 1 for null terminator
-    cabor_allocation alloc = CABOR_MALLOC(len);
+    cabor_allocation alloc = CABOR_MALLOC_CTX(alloc_ctx, len);
     char* dest = (char*)alloc.mem;
 
     memcpy(dest, src, len);
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "../cabor_defines.h"
+#include "arena.h"
+#include "pool.h"
+#include "allocation_trace.h"
 
 #include <stddef.h>
 
@@ -9,21 +12,48 @@
 #define LINE_STRING STRINGIZE(__LINE__)
 #define FUNC_STRING __func__
 
-#define CABOR_MEMORY_DEBUG_STR_ALLOC __FILE__ ":" LINE_STRING " ALLOCATION\n"
-#define CABOR_MEMORY_DEBUG_STR_DEALLOC __FILE__ ":" LINE_STRING " DEALLOCATION\n"
+// Call site strings for allocation tracing, see allocation_trace.h
+#define CABOR_MEMORY_DEBUG_STR_ALLOC __FILE__ ":" LINE_STRING
+#define CABOR_MEMORY_DEBUG_STR_DEALLOC __FILE__ ":" LINE_STRING
 
-#define CABOR_MALLOC(size) cabor_malloc(cabor_get_global_allocator_context(), size, CABOR_MEMORY_DEBUG_STR_ALLOC)
-#define CABOR_REALLOC(mem, size) cabor_realloc(cabor_get_global_allocator_context(), mem, size, CABOR_MEMORY_DEBUG_STR_ALLOC)
-#define CABOR_CALLOC(num, size) cabor_calloc(cabor_get_global_allocator_context(), num, size, CABOR_MEMORY_DEBUG_STR_ALLOC)
-#define CABOR_FREE(mem) cabor_free(cabor_get_global_allocator_context(), mem, CABOR_MEMORY_DEBUG_STR_DEALLOC)
+#if defined(_MSC_VER)
+#define CABOR_THREAD_LOCAL __declspec(thread)
+#else
+#define CABOR_THREAD_LOCAL __thread
+#endif
+
+// These allocate from the current allocator context of the calling thread, see cabor_set_current_allocator_context()
+#define CABOR_MALLOC(size) cabor_malloc(cabor_get_current_allocator_context(), size, CABOR_MEMORY_DEBUG_STR_ALLOC)
+#define CABOR_REALLOC(mem, size) cabor_realloc(cabor_get_current_allocator_context(), mem, size, CABOR_MEMORY_DEBUG_STR_ALLOC)
+#define CABOR_CALLOC(num, size) cabor_calloc(cabor_get_current_allocator_context(), num, size, CABOR_MEMORY_DEBUG_STR_ALLOC)
+#define CABOR_FREE(mem) cabor_free(cabor_get_current_allocator_context(), mem, CABOR_MEMORY_DEBUG_STR_DEALLOC)
 
-#define CABOR_CREATE_ALLOCATOR() create_cabor_allocator_context(cabor_get_global_allocator_context())
-#define CABOR_DESTROY_ALLOCATOR() destroy_cabor_allocator_context(cabor_get_global_allocator_context())
+// Same as above but with explicit allocator context, used by containers that remember where their memory came from
+#define CABOR_MALLOC_CTX(ctx, size) cabor_malloc(ctx, size, CABOR_MEMORY_DEBUG_STR_ALLOC)
+#define CABOR_REALLOC_CTX(ctx, mem, size) cabor_realloc(ctx, mem, size, CABOR_MEMORY_DEBUG_STR_ALLOC)
+#define CABOR_CALLOC_CTX(ctx, num, size) cabor_calloc(ctx, num, size, CABOR_MEMORY_DEBUG_STR_ALLOC)
+#define CABOR_FREE_CTX(ctx, mem) cabor_free(ctx, mem, CABOR_MEMORY_DEBUG_STR_DEALLOC)
+
+// Small fixed size objects (ast nodes, map entries, connection structs) that are allocated and freed one by one.
+// The size must be passed back when freeing because the size class can't be recovered from the pointer.
+#define CABOR_POOL_MALLOC(size) cabor_pooled_malloc(cabor_get_current_allocator_context(), size, CABOR_MEMORY_DEBUG_STR_ALLOC)
+#define CABOR_POOL_FREE(mem, size) cabor_pooled_free(cabor_get_current_allocator_context(), mem, size, CABOR_MEMORY_DEBUG_STR_DEALLOC)
+#define CABOR_POOL_MALLOC_CTX(ctx, size) cabor_pooled_malloc(ctx, size, CABOR_MEMORY_DEBUG_STR_ALLOC)
+#define CABOR_POOL_FREE_CTX(ctx, mem, size) cabor_pooled_free(ctx, mem, size, CABOR_MEMORY_DEBUG_STR_DEALLOC)
+
+#define CABOR_CREATE_ALLOCATOR() create_cabor_global_allocator_context()
+#define CABOR_DESTROY_ALLOCATOR() destroy_cabor_global_allocator_context()
 
 #define CABOR_GET_ALLOCATED() cabor_get_current_allocated(cabor_get_global_allocator_context())
 #define CABOR_GET_ALLOCATOR() cabor_get_global_allocator_context()
 
-#define CABOR_MEMORY_DEBUG_ARRAY_SIZE 65536
+// Size classes of the per context object pools: 16, 32, 64, 128, 256 and 512 bytes
+#define CABOR_POOL_SIZE_CLASSES 6
+#define CABOR_POOL_SMALLEST_CLASS 16
+#define CABOR_POOL_MAX_OBJECT_SIZE (CABOR_POOL_SMALLEST_CLASS << (CABOR_POOL_SIZE_CLASSES - 1))
+
+// Per thread heap contexts are padded and aligned to this so workers never write to the same cache line
+#define CABOR_CACHE_LINE_SIZE 64
 
 #ifdef NDEBUG
 #define CABOR_ENABLE_MEMORY_DEBUGGING 0
@@ -32,7 +62,6 @@
 #endif
 
 #if CABOR_ENABLE_MEMORY_DEBUGGING
-#include "../core/mutex.h"
 #define CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
 #endif
 
@@ -53,6 +82,15 @@ type* variable = variable##_alloc.mem
 cabor_allocation variable##_alloc = CABOR_DEALLOC(type, variable);\
 CABOR_FREE(&variable##_alloc)
 
+// Same as above for objects that come from the size class pools
+#define CABOR_POOL_NEW(type, variable)\
+cabor_allocation variable##_alloc = CABOR_POOL_MALLOC(sizeof(type));\
+type* variable = variable##_alloc.mem
+
+#define CABOR_POOL_DELETE(type, variable)\
+cabor_allocation variable##_alloc = CABOR_DEALLOC(type, variable);\
+CABOR_POOL_FREE(&variable##_alloc, sizeof(type))
+
 typedef struct
 {
     void* mem;
@@ -61,21 +99,27 @@ typedef struct
 #endif
 } cabor_allocation;
 
-typedef struct 
+typedef enum
 {
-    size_t allocated_mem;
+    CABOR_ALLOCATOR_HEAP,  // malloc/free
+    CABOR_ALLOCATOR_ARENA, // bump allocation, cabor_free is a no-op and everything is released on destroy
+} cabor_allocator_kind;
 
-#if CABOR_ENABLE_MEMORY_DEBUGGING
-    // Debug info for allocations
-    char* debug[CABOR_MEMORY_DEBUG_ARRAY_SIZE];
-    size_t debug_size;
-    cabor_mutex* alloc_lock;
+typedef struct cabor_allocator_context_t
+{
+    cabor_allocator_kind kind;
+    // Only the thread that owns the context writes this, others read it with cabor_atomic_load_size().
+    // Wraps around when memory allocated on another thread is freed here, sums are still exact.
+    size_t allocated_mem;
+    cabor_arena arena;    // only used with CABOR_ALLOCATOR_ARENA
+    cabor_pool pools[CABOR_POOL_SIZE_CLASSES]; // only used with CABOR_ALLOCATOR_HEAP
 
-    // Debug info for deallocation
-    char* dealloc[CABOR_MEMORY_DEBUG_ARRAY_SIZE];
-    size_t dealloc_size;
-    cabor_mutex* dealloc_lock;
+    // Per thread heap contexts are linked together so the global context can report totals
+    struct cabor_allocator_context_t* next_thread_ctx;
+    void* thread_ctx_mem; // unaligned memory the per thread context lives in
 
+#if CABOR_ENABLE_MEMORY_DEBUGGING
+    cabor_allocation_trace_table* trace; // arenas don't record call sites
 #endif
 
 } cabor_allocator_context;
@@ -83,14 +127,44 @@ typedef struct
 void create_cabor_allocator_context  (cabor_allocator_context* alloc_ctx);
 void destroy_cabor_allocator_context (cabor_allocator_context* alloc_ctx);
 
+// The global context holds no state of its own. Allocating through it uses the heap context of the
+// calling thread, which is created on first use. Nothing is shared between threads so there is no
+// locking on the allocation path. Destroying the global context destroys every per thread context.
+void create_cabor_global_allocator_context();
+void destroy_cabor_global_allocator_context();
+
+// Arena context gets its blocks from parent, destroy_cabor_allocator_context() frees everything at once
+void create_cabor_arena_allocator_context(cabor_allocator_context* alloc_ctx, cabor_allocator_context* parent, size_t block_size);
+
 cabor_allocation cabor_malloc  (cabor_allocator_context* alloc_ctx, size_t size, const char* debug);
 cabor_allocation cabor_realloc (cabor_allocator_context* alloc_ctx, cabor_allocation* old_alloc, size_t size, const char* debug);
 cabor_allocation cabor_calloc  (cabor_allocator_context* alloc_ctx, size_t num, size_t size, const char* debug);
 void             cabor_free    (cabor_allocator_context* alloc_ctx, cabor_allocation* alloc, const char* dealloc);
 
+// Heap contexts serve these from the pool of the matching size class, arenas and bigger sizes use cabor_malloc/cabor_free.
+// Objects can be freed on any thread, they go to the free list of the freeing thread.
+cabor_allocation cabor_pooled_malloc (cabor_allocator_context* alloc_ctx, size_t size, const char* debug);
+void             cabor_pooled_free   (cabor_allocator_context* alloc_ctx, cabor_allocation* alloc, size_t size, const char* dealloc);
+
 cabor_allocator_context* cabor_get_global_allocator_context();
+cabor_allocator_context* cabor_get_thread_allocator_context();
+
+// Iterates every per thread heap context. Don't call while other threads allocate.
+cabor_allocator_context* cabor_get_first_thread_allocator_context();
+
+// Allocation statistics per call site merged over all threads as text, safe to call while other threads
+// allocate. Only memory debug builds trace allocations, other builds get a short note instead.
+cabor_allocation cabor_create_allocation_trace_report(size_t* size);
+
+// Current allocator context is thread local and defaults to the global context. Returns the previous
+// context so the caller can restore it, passing NULL restores the global context.
+cabor_allocator_context* cabor_get_current_allocator_context();
+cabor_allocator_context* cabor_set_current_allocator_context(cabor_allocator_context* alloc_ctx);
 
+// For the global context this is the sum over all threads. Other threads can keep allocating while it is
+// summed, the total then mixes counters read at slightly different times but each of them is whole.
 size_t cabor_get_current_allocated(cabor_allocator_context* alloc_ctx);
 const char* cabor_convert_bytes_to_human_readable(size_t bytes, double* converted);
 
 char* cabor_strdup(const char* src);
+char* cabor_strdup_ctx(cabor_allocator_context* alloc_ctx, const char* src);
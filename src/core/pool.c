@@ -0,0 +1,120 @@
+#include "pool.h"
+#include "memory.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "../debug/cabor_debug.h"
+
+typedef struct cabor_pool_slab_t
+{
+    struct cabor_pool_slab_t* next;
+    cabor_allocation slab_mem;
+} cabor_pool_slab;
+
+// Objects start after the slab header, aligned the same way as arena allocations
+#define CABOR_POOL_SLAB_HEADER_SIZE ((sizeof(cabor_pool_slab) + CABOR_ARENA_ALIGNMENT - 1) & ~((size_t)CABOR_ARENA_ALIGNMENT - 1))
+
+static char* slab_objects(cabor_pool_slab* slab)
+{
+    return (char*)slab + CABOR_POOL_SLAB_HEADER_SIZE;
+}
+
+static cabor_pool_slab* push_slab(cabor_pool* pool)
+{
+    size_t total = CABOR_POOL_SLAB_HEADER_SIZE + pool->object_size * pool->objects_per_slab;
+
+    cabor_allocation alloc;
+    if (pool->parent)
+    {
+        alloc = CABOR_MALLOC_CTX(pool->parent, total);
+    }
+    else
+    {
+        alloc.mem = malloc(total);
+#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+        alloc.size = total;
+#endif
+        if (!alloc.mem)
+        {
+            fputs("Failed to allocate pool slab!", stderr);
+            assert(0);
+            exit(1);
+        }
+    }
+
+    cabor_pool_slab* slab = alloc.mem;
+    slab->next = pool->slabs;
+    slab->slab_mem = alloc;
+
+    pool->slabs = slab;
+    pool->slab_cursor = 0;
+    return slab;
+}
+
+void cabor_pool_init(cabor_pool* pool, struct cabor_allocator_context_t* parent, size_t object_size, size_t objects_per_slab)
+{
+    if (object_size < CABOR_POOL_MIN_OBJECT_SIZE)
+        object_size = CABOR_POOL_MIN_OBJECT_SIZE;
+
+    pool->parent = parent;
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+    pool->object_size = (object_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    pool->objects_per_slab = objects_per_slab > 0 ? objects_per_slab : 1;
+    pool->slab_cursor = 0;
+}
+
+void cabor_pool_release(cabor_pool* pool)
+{
+    cabor_pool_slab* slab = pool->slabs;
+    while (slab)
+    {
+        cabor_pool_slab* next = slab->next;
+        cabor_allocation alloc = slab->slab_mem;
+        if (pool->parent)
+            CABOR_FREE_CTX(pool->parent, &alloc);
+        else
+            free(alloc.mem);
+        slab = next;
+    }
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+    pool->slab_cursor = 0;
+}
+
+void* cabor_pool_alloc(cabor_pool* pool)
+{
+    if (pool->free_list)
+    {
+        void* mem = pool->free_list;
+        pool->free_list = *(void**)mem;
+        return mem;
+    }
+
+    if (!pool->slabs || pool->slab_cursor == pool->objects_per_slab)
+        push_slab(pool);
+
+    return slab_objects(pool->slabs) + pool->object_size * pool->slab_cursor++;
+}
+
+void cabor_pool_free(cabor_pool* pool, void* mem)
+{
+    if (!mem)
+        return;
+
+    *(void**)mem = pool->free_list;
+    pool->free_list = mem;
+}
+
+bool cabor_pool_owns(cabor_pool* pool, void* mem)
+{
+    for (cabor_pool_slab* slab = pool->slabs; slab; slab = slab->next)
+    {
+        char* begin = slab_objects(slab);
+        if ((char*)mem >= begin && (char*)mem < begin + pool->object_size * pool->objects_per_slab)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../cabor_defines.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Fixed size object allocator. Objects are carved out of slabs in order so objects allocated one
+// after another end up next to each other, freed objects go to a free list and are handed out
+// again before the slab cursor moves. Both allocation and free are O(1). Slabs are only returned
+// when the whole pool is released.
+//
+// Every heap allocator context keeps one pool per size class, see cabor_pooled_malloc() in memory.h.
+
+#define CABOR_POOL_SLAB_SIZE (64 * 1024)
+#define CABOR_POOL_MIN_OBJECT_SIZE sizeof(void*) // free list link is stored inside free objects
+
+struct cabor_allocator_context_t;
+struct cabor_pool_slab_t;
+
+typedef struct
+{
+    struct cabor_allocator_context_t* parent; // slabs are allocated from here, NULL for plain malloc
+    struct cabor_pool_slab_t* slabs;          // current slab first
+    void* free_list;
+    size_t object_size;
+    size_t objects_per_slab;
+    size_t slab_cursor;                       // objects handed out from the current slab
+} cabor_pool;
+
+void cabor_pool_init(cabor_pool* pool, struct cabor_allocator_context_t* parent, size_t object_size, size_t objects_per_slab);
+
+// Frees every slab, all objects of the pool become invalid
+void cabor_pool_release(cabor_pool* pool);
+
+void* cabor_pool_alloc(cabor_pool* pool);
+void cabor_pool_free(cabor_pool* pool, void* mem);
+
+bool cabor_pool_owns(cabor_pool* pool, void* mem);
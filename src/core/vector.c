@@ -51,6 +51,7 @@ static size_t get_element_type_size(cabor_element_type type)
             return cabor_get_x64_instruction_size();
         case CABOR_X64_INTRINSIC:
             return cabor_get_x64_intrinsic_size();
+        case CABOR_GENERIC:
         case CABOR_UNKNOWN:
             return 0;
     }
@@ -59,51 +60,77 @@ static size_t get_element_type_size(cabor_element_type type)
 
 static void vector_resize(cabor_vector* v, size_t capacity)
 {
-    size_t stride = get_element_type_size(v->type);
-    cabor_allocation alloc = CABOR_REALLOC(&v->vector_mem, stride * capacity);
+    cabor_allocation alloc = CABOR_REALLOC_CTX(v->allocator, &v->vector_mem, v->stride * capacity);
 
     v->vector_mem = alloc;
     v->capacity = capacity;
 }
 
-static void pushback_vector(cabor_vector* v, void* element)
+static void pushback_vector(cabor_vector* v, const void* element)
 {
-    size_t stride = get_element_type_size(v->type);
-
     if (v->size == v->capacity)
-        vector_resize(v, v->capacity * CABOR_VECTOR_MULTIPLICATION_FACTOR);
-    memcpy((char*) v->vector_mem.mem + stride * v->size++, element, stride);
+        cabor_vector_grow(v);
+    memcpy((char*) v->vector_mem.mem + v->stride * v->size++, element, v->stride);
 }
 
 static void* vector_get(cabor_vector* v, size_t idx)
 {
     CABOR_ASSERT(idx < v->size, "Cabor vector index out of bounds!");
-    size_t stride = get_element_type_size(v->type);
-    return (char*) v->vector_mem.mem + stride * idx;
+    return (char*) v->vector_mem.mem + v->stride * idx;
 }
 
 static void* peek_next(cabor_vector* v)
 {
-    size_t stride = get_element_type_size(v->type);
-    return (char*) v->vector_mem.mem + stride * v->size;
+    return (char*) v->vector_mem.mem + v->stride * v->size;
 }
 
-cabor_vector* cabor_create_vector(size_t initial_capacity, cabor_element_type type, bool zero_initialize)
+static cabor_vector* create_vector(size_t initial_capacity, cabor_element_type type, size_t stride, bool zero_initialize)
 {
-    size_t stride = get_element_type_size(type);
+    cabor_allocator_context* allocator = cabor_get_current_allocator_context();
     CABOR_NEW(cabor_vector, v);
 
     *v = (cabor_vector)
     {
         .type       = type,
+        .stride     = stride,
         .capacity   = initial_capacity,
         .size       = 0,
-        .vector_mem = zero_initialize ? CABOR_CALLOC(initial_capacity, stride) : CABOR_MALLOC(initial_capacity * stride)
+        .vector_mem = zero_initialize ? CABOR_CALLOC_CTX(allocator, initial_capacity, stride) : CABOR_MALLOC_CTX(allocator, initial_capacity * stride),
+        .allocator  = allocator
     };
     
     return v;
 }
 
+cabor_vector* cabor_create_vector(size_t initial_capacity, cabor_element_type type, bool zero_initialize)
+{
+    CABOR_ASSERT(type != CABOR_GENERIC, "use cabor_create_vector_with_stride for generic vectors!");
+    return create_vector(initial_capacity, type, get_element_type_size(type), zero_initialize);
+}
+
+cabor_vector* cabor_create_vector_with_stride(size_t initial_capacity, size_t stride, bool zero_initialize)
+{
+    CABOR_ASSERT(stride > 0, "generic vector needs non zero stride!");
+    return create_vector(initial_capacity, CABOR_GENERIC, stride, zero_initialize);
+}
+
+void cabor_vector_push(cabor_vector* v, const void* element)
+{
+    pushback_vector(v, element);
+}
+
+void* cabor_vector_get(cabor_vector* v, size_t idx)
+{
+    return vector_get(v, idx);
+}
+
+void cabor_vector_grow(cabor_vector* v)
+{
+    // Vectors created with zero capacity would never grow by multiplying alone
+    size_t capacity = v->capacity * CABOR_VECTOR_MULTIPLICATION_FACTOR;
+    vector_resize(v, capacity > 0 ? capacity : 1);
+}
+
 void cabor_vector_push_float(cabor_vector* v, float value)
 {
     CABOR_ASSERT(v->type == CABOR_FLOAT, "pushing float to non float vector!");
@@ -307,12 +334,16 @@ void cabor_vector_reserve(cabor_vector* v, size_t size)
 
 void cabor_destroy_vector(cabor_vector* v)
 {
-    CABOR_FREE(&v->vector_mem);
+    cabor_allocator_context* allocator = v->allocator;
+    CABOR_FREE_CTX(allocator, &v->vector_mem);
     v->vector_mem.mem = NULL;
     v->type = 0;
+    v->stride = 0;
     v->capacity = 0;
     v->size = 0;
-    CABOR_DELETE(cabor_vector, v);
+    v->allocator = NULL;
+    cabor_allocation v_alloc = CABOR_DEALLOC(cabor_vector, v);
+    CABOR_FREE_CTX(allocator, &v_alloc);
 }
 
 float* cabor_vector_peek_float(cabor_vector* v)
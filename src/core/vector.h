@@ -5,6 +5,8 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
 
 #define CABOR_VECTOR_MULTIPLICATION_FACTOR 2
 
@@ -38,19 +40,58 @@ typedef enum
     CABOR_STACK_LOCATION,
     CABOR_X64_INSTRUCTION,
     CABOR_X64_INTRINSIC,
+    CABOR_GENERIC, // element size is given at creation, see cabor_create_vector_with_stride()
     CABOR_UNKNOWN
 } cabor_element_type;
 
 typedef struct
 {
-    cabor_element_type type;
-    size_t             capacity;
-    size_t             size;
-    cabor_allocation   vector_mem;
+    cabor_element_type       type;
+    size_t                   stride;    // element size in bytes, resolved once at creation
+    size_t                   capacity;
+    size_t                   size;
+    cabor_allocation         vector_mem;
+    cabor_allocator_context* allocator; // context that was current at creation, all resizes go here
 } cabor_vector;
 
+// The generated accessors below assert with CABOR_ASSERT. cabor_debug.h includes the logger which
+// stores a cabor_vector, so it can only be included once the type is complete.
+#include "../debug/cabor_debug.h"
 
 cabor_vector* cabor_create_vector(size_t initial_capacity, cabor_element_type type, bool zero_initialize);
+cabor_vector* cabor_create_vector_with_stride(size_t initial_capacity, size_t stride, bool zero_initialize);
+
+// Type erased access, element points to stride bytes
+void  cabor_vector_push(cabor_vector* v, const void* element);
+void* cabor_vector_get(cabor_vector* v, size_t idx);
+
+// Doubles the capacity, used by the generated accessors below
+void cabor_vector_grow(cabor_vector* v);
+
+// Generates typed inline accessors for any vector whose stride is sizeof(type):
+//
+// CABOR_VECTOR_DEFINE_ACCESSORS(token, cabor_token)
+//     cabor_token* cabor_vector_at_token(cabor_vector* v, size_t idx);
+//     void         cabor_vector_append_token(cabor_vector* v, const cabor_token* value);
+//
+// These compile down to indexed loads and stores, use them in hot loops instead of cabor_vector_get_*
+#define CABOR_VECTOR_DEFINE_ACCESSORS(name, type)\
+static inline type* cabor_vector_at_##name(cabor_vector* v, size_t idx)\
+{\
+    CABOR_ASSERT(v->stride == sizeof(type), "cabor_vector_at_" #name " on vector of different stride!");\
+    CABOR_ASSERT(idx < v->size, "Cabor vector index out of bounds!");\
+    return (type*)v->vector_mem.mem + idx;\
+}\
+static inline void cabor_vector_append_##name(cabor_vector* v, const type* value)\
+{\
+    CABOR_ASSERT(v->stride == sizeof(type), "cabor_vector_append_" #name " on vector of different stride!");\
+    if (v->size == v->capacity)\
+        cabor_vector_grow(v);\
+    memcpy((type*)v->vector_mem.mem + v->size++, value, sizeof(type));\
+}
+
+CABOR_VECTOR_DEFINE_ACCESSORS(u8, uint8_t)
+CABOR_VECTOR_DEFINE_ACCESSORS(u32, uint32_t)
 
 void cabor_vector_push_float  (cabor_vector* v, float value);
 void cabor_vector_push_double (cabor_vector* v, double value);
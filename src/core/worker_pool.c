@@ -0,0 +1,166 @@
+#include "worker_pool.h"
+
+#include <stdbool.h>
+#include <uv.h>
+
+#include "../debug/cabor_debug.h"
+
+typedef struct cabor_worker_job_t
+{
+    cabor_worker_func func;
+    char* items;
+    size_t item_size;
+    size_t count;
+    size_t next;      // next item to hand out
+    size_t remaining; // items that haven't finished yet
+    struct cabor_worker_job_t* next_job;
+} cabor_worker_job;
+
+static bool g_worker_pool_created;
+static uv_mutex_t g_worker_lock;
+static uv_cond_t g_worker_wake; // a job was queued or the pool is shutting down
+static uv_cond_t g_worker_done; // a job finished its last item
+static bool g_worker_shutdown;
+
+// Jobs that still have items to hand out, the submitting thread owns the job memory
+static cabor_worker_job* g_jobs_head;
+static cabor_worker_job* g_jobs_tail;
+
+static uv_thread_t g_workers[CABOR_WORKER_POOL_MAX_THREADS];
+static size_t g_worker_count;
+
+static void unlink_job(cabor_worker_job* job)
+{
+    cabor_worker_job* prev = NULL;
+    for (cabor_worker_job* it = g_jobs_head; it; prev = it, it = it->next_job)
+    {
+        if (it != job)
+            continue;
+
+        if (prev)
+            prev->next_job = job->next_job;
+        else
+            g_jobs_head = job->next_job;
+
+        if (g_jobs_tail == job)
+            g_jobs_tail = prev;
+        return;
+    }
+}
+
+// Runs the next item of the job, called and returns with g_worker_lock held
+static void run_next_item(cabor_worker_job* job)
+{
+    size_t item = job->next++;
+    if (job->next == job->count)
+        unlink_job(job);
+
+    uv_mutex_unlock(&g_worker_lock);
+    job->func(job->items + item * job->item_size);
+    uv_mutex_lock(&g_worker_lock);
+
+    if (--job->remaining == 0)
+        uv_cond_broadcast(&g_worker_done);
+}
+
+static void worker_thread(void* arg)
+{
+    uv_mutex_lock(&g_worker_lock);
+    for (;;)
+    {
+        while (!g_jobs_head && !g_worker_shutdown)
+            uv_cond_wait(&g_worker_wake, &g_worker_lock);
+
+        // Queued jobs are finished before shutting down
+        if (!g_jobs_head)
+            break;
+
+        run_next_item(g_jobs_head);
+    }
+    uv_mutex_unlock(&g_worker_lock);
+}
+
+void cabor_create_worker_pool()
+{
+    CABOR_ASSERT(!g_worker_pool_created, "worker pool was created twice");
+
+    uv_mutex_init(&g_worker_lock);
+    uv_cond_init(&g_worker_wake);
+    uv_cond_init(&g_worker_done);
+    g_worker_shutdown = false;
+    g_jobs_head = NULL;
+    g_jobs_tail = NULL;
+
+    // The thread that submits a job works on it as well, keep one core for it
+    size_t num_cores = uv_available_parallelism();
+    g_worker_count = num_cores > 1 ? num_cores - 1 : 1;
+    if (g_worker_count > CABOR_WORKER_POOL_MAX_THREADS)
+        g_worker_count = CABOR_WORKER_POOL_MAX_THREADS;
+
+    for (size_t i = 0; i < g_worker_count; i++)
+        uv_thread_create(&g_workers[i], worker_thread, NULL);
+
+    g_worker_pool_created = true;
+}
+
+void cabor_destroy_worker_pool()
+{
+    uv_mutex_lock(&g_worker_lock);
+    g_worker_shutdown = true;
+    uv_cond_broadcast(&g_worker_wake);
+    uv_mutex_unlock(&g_worker_lock);
+
+    for (size_t i = 0; i < g_worker_count; i++)
+        uv_thread_join(&g_workers[i]);
+
+    uv_cond_destroy(&g_worker_done);
+    uv_cond_destroy(&g_worker_wake);
+    uv_mutex_destroy(&g_worker_lock);
+
+    g_worker_count = 0;
+    g_worker_pool_created = false;
+}
+
+size_t cabor_get_worker_count()
+{
+    return g_worker_count;
+}
+
+void cabor_worker_pool_run(cabor_worker_func func, void* items, size_t item_size, size_t count)
+{
+    if (!g_worker_pool_created || count <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            func((char*)items + i * item_size);
+        return;
+    }
+
+    cabor_worker_job job =
+    {
+        .func = func,
+        .items = items,
+        .item_size = item_size,
+        .count = count,
+        .next = 0,
+        .remaining = count,
+        .next_job = NULL,
+    };
+
+    uv_mutex_lock(&g_worker_lock);
+
+    if (g_jobs_tail)
+        g_jobs_tail->next_job = &job;
+    else
+        g_jobs_head = &job;
+    g_jobs_tail = &job;
+    uv_cond_broadcast(&g_worker_wake);
+
+    while (job.next < job.count)
+        run_next_item(&job);
+
+    // The last items may still be running on the workers
+    while (job.remaining > 0)
+        uv_cond_wait(&g_worker_done, &g_worker_lock);
+
+    uv_mutex_unlock(&g_worker_lock);
+}
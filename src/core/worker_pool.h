@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../cabor_defines.h"
+
+#include <stddef.h>
+
+// Fixed set of threads shared by the compiler stages that split their work, the parallel tokenizer and
+// the type checker. The threads are started once from main and live until the pool is destroyed, so a
+// long running server doesn't start threads or grow thread allocator contexts for every compile.
+//
+// Any number of threads can hand work to the pool at the same time, jobs are served in the order they
+// were submitted.
+
+#define CABOR_WORKER_POOL_MAX_THREADS 64
+
+typedef void (*cabor_worker_func)(void* item);
+
+// Called once from main before any stage runs in parallel and after every stage is done
+void cabor_create_worker_pool();
+void cabor_destroy_worker_pool();
+
+// Threads in the pool, the thread that runs a job works on it too
+size_t cabor_get_worker_count();
+
+// Calls func for each of the count items of item_size bytes and returns when all of them are done.
+// The calling thread takes items too. Without a pool every item runs on the calling thread.
+void cabor_worker_pool_run(cabor_worker_func func, void* items, size_t item_size, size_t count);
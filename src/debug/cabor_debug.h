@@ -1,16 +1,18 @@
 #pragma once
 
 #include "../cabor_defines.h"
-#include "../logging/logging.h"
 #include <stdlib.h>
 #include <assert.h>
 
+// Defined before the logger is included, the vector accessors it pulls in use CABOR_ASSERT
 #ifndef NDEBUG
 #define CABOR_ASSERT(eval, reason) assert(eval && reason)
 #else
 #define CABOR_ASSERT(eval, reason)
 #endif
 
+#include "../logging/logging.h"
+
 #ifdef CABOR_ENABLE_BREAK_ON_RUNTIME_ERROR
 #define CABOR_DEBUG_BREAK assert(0)
 #else
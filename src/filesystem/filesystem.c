@@ -6,6 +6,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 cabor_file* cabor_file_from_buffer(const char* buffer, size_t length)
 {
     size_t size = length;
@@ -13,6 +22,7 @@ cabor_file* cabor_file_from_buffer(const char* buffer, size_t length)
     file->filename = "<internal_buffer>";
     file->file_memory = CABOR_MALLOC(size);
     file->size = size;
+    file->mapped = false;
     memcpy(file->file_memory.mem, buffer, length);
 #ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
     file->file_memory.size = size;
@@ -56,6 +66,100 @@ cabor_file* cabor_load_file(const char* filename)
     return file;
 }
 
+// Empty files are not mapped, mem is left NULL for them
+#if defined(_WIN32) || defined(_WIN64)
+static bool map_file(const char* filename, void** mem, size_t* size)
+{
+    HANDLE file_handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    bool ok = GetFileSizeEx(file_handle, &file_size);
+    *size = ok ? (size_t)file_size.QuadPart : 0;
+    *mem = NULL;
+
+    if (ok && *size > 0)
+    {
+        // The view keeps the mapping alive after the handles are closed
+        HANDLE mapping = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL)
+        {
+            *mem = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        ok = *mem != NULL;
+    }
+
+    CloseHandle(file_handle);
+    return ok;
+}
+
+static void unmap_file(void* mem, size_t size)
+{
+    UnmapViewOfFile(mem);
+}
+#else
+static bool map_file(const char* filename, void** mem, size_t* size)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    *size = ok ? (size_t)st.st_size : 0;
+    *mem = NULL;
+
+    if (ok && *size > 0)
+    {
+        // The mapping stays valid after the descriptor is closed
+        void* mapping = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = mapping != MAP_FAILED;
+        if (ok)
+        {
+            madvise(mapping, *size, MADV_SEQUENTIAL);
+            *mem = mapping;
+        }
+    }
+
+    close(fd);
+    return ok;
+}
+
+static void unmap_file(void* mem, size_t size)
+{
+    munmap(mem, size);
+}
+#endif
+
+cabor_file* cabor_map_file(const char* filename)
+{
+    void* mem;
+    size_t file_size;
+    if (!map_file(filename, &mem, &file_size))
+    {
+        CABOR_LOG_ERR_F("Failed to map %s", filename);
+        CABOR_RUNTIME_ERROR("failed to map file");
+    }
+
+    CABOR_NEW(cabor_file, file);
+
+    *file = (cabor_file)
+    {
+        .filename = filename,
+        .size = file_size,
+        .file_memory = { .mem = mem },
+        .mapped = true
+    };
+
+#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
+    file->file_memory.size = file_size;
+#endif
+
+    return file;
+}
+
 void cabor_dump_file_to_disk(cabor_file* file, const char* filename)
 {
     FILE* fp = fopen(filename, "w");
@@ -66,7 +170,15 @@ void cabor_dump_file_to_disk(cabor_file* file, const char* filename)
 
 void cabor_destroy_file(cabor_file* file)
 {
-    CABOR_FREE(&file->file_memory);
+    if (file->mapped)
+    {
+        if (file->file_memory.mem)
+            unmap_file(file->file_memory.mem, file->size);
+    }
+    else
+    {
+        CABOR_FREE(&file->file_memory);
+    }
     file->file_memory.mem = NULL;
     file->size = 0;
 #ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
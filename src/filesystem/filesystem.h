@@ -2,15 +2,22 @@
 
 #include "../core/memory.h"
 
+#include <stdbool.h>
+
 typedef struct
 {
     const char* filename;
     size_t size;
     cabor_allocation file_memory;
+    bool mapped; // file_memory is a read-only mapping of the file instead of heap memory
 } cabor_file;
 
 cabor_file* cabor_file_from_buffer(const char* buffer, size_t length);
 cabor_file* cabor_load_file(const char* filename);
+
+// Maps the file read-only instead of reading it into memory. The contents are not NUL terminated,
+// use file->size. Nothing is copied, pages are read in by the os as the tokenizer walks the file.
+cabor_file* cabor_map_file(const char* filename);
 void cabor_dump_file_to_disk(cabor_file* file, const char* filename);
 void cabor_destroy_file(cabor_file* file);
 char cabor_read_byte_from_file(cabor_file* file, size_t idx);
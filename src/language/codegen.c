@@ -45,7 +45,7 @@ void add_intrinsic(cabor_x64_assembly* asmbl, const char* name, cabor_intr_func
 
     intr.intrinsic = intrinsic;
 
-    cabor_vector_push_x64_instruction(asmbl->intrinsics, &intr);
+    cabor_vector_append_x64_intrinsic(asmbl->intrinsics, &intr);
 }
 
 void cabor_intr_unary_minus(cabor_intrinsic_args* arg, cabor_x64_assembly* asmbl) 
@@ -161,7 +161,7 @@ void cabor_emit_line(cabor_x64_assembly* asmbl, const char* fmt, ...)
     vsnprintf(inst.text, CABOR_MAX_X64_INSTRUCTION_LENGTH, fmt, args);
     va_end(args);
 
-    cabor_vector_push_x64_instruction(asmbl->instructions, &inst);
+    cabor_vector_append_x64_instruction(asmbl->instructions, &inst);
 }
 
 void cabor_destroy_locals(cabor_locals* locals)
@@ -177,13 +177,13 @@ void cabor_init_locals(cabor_ir_data* ir_data, cabor_locals* locals)
     locals->locations->size = ir_data->ir_vars->size;
     for (cabor_ir_var_idx idx = 0; idx < ir_vars->size; idx++)
     {
-        cabor_ir_var* ir_var = cabor_vector_get_ir_var(ir_data->ir_vars, idx);
+        cabor_ir_var* ir_var = cabor_vector_at_ir_var(ir_data->ir_vars, idx);
         if (IS_IR_VAR_VALID(ir_var))
         {
             cabor_stack_location src_loc;
             snprintf(src_loc.location, CABOR_STACK_LOCATION_MAX_STR_SIZE, "-%d(%%rbp)", (idx + 1) * 8);
 
-            cabor_stack_location* dst_loc = cabor_vector_get_stack_location(locals->locations, idx);
+            cabor_stack_location* dst_loc = cabor_vector_at_stack_location(locals->locations, idx);
             memcpy(dst_loc, &src_loc, sizeof(cabor_stack_location));
 
             locals->stack_used += 8;
@@ -195,11 +195,11 @@ const char* cabor_get_stack_slot(cabor_ir_var_idx ir_var, cabor_locals* locals)
 {
     if (ir_var == -2)
     {
-        cabor_stack_location* l0 = cabor_vector_get_stack_location(locals->locations, 0);
+        cabor_stack_location* l0 = cabor_vector_at_stack_location(locals->locations, 0);
         return l0->location;
     }
 
-    cabor_stack_location* loc = cabor_vector_get_stack_location(locals->locations, ir_var);
+    cabor_stack_location* loc = cabor_vector_at_stack_location(locals->locations, ir_var);
     return loc->location;
 }
 
@@ -213,6 +213,29 @@ bool cabor_is_binary_args(int num_args)
     return true;
 }
 
+bool cabor_is_intrinsic_call(cabor_atom fun)
+{
+    switch (fun)
+    {
+    case CABOR_ATOM_UNARY_MINUS:
+    case CABOR_ATOM_UNARY_NOT:
+    case CABOR_ATOM_PLUS:
+    case CABOR_ATOM_MINUS:
+    case CABOR_ATOM_MULTIPLY:
+    case CABOR_ATOM_DIVIDE:
+    case CABOR_ATOM_REMAINDER:
+    case CABOR_ATOM_EQ:
+    case CABOR_ATOM_NE:
+    case CABOR_ATOM_LT:
+    case CABOR_ATOM_LE:
+    case CABOR_ATOM_GT:
+    case CABOR_ATOM_GE:
+        return true;
+    default:
+        return false;
+    }
+}
+
 void cabor_call_args_to_intrinisc_args(cabor_ir_data* ir_data, cabor_ir_call* call, cabor_intrinsic_args* args, cabor_locals* locals)
 {
     cabor_ir_var_idx call_dest = call->dest;
@@ -220,7 +243,7 @@ void cabor_call_args_to_intrinisc_args(cabor_ir_data* ir_data, cabor_ir_call* ca
 
     args->num_args = call->num_args;
 
-    CABOR_ASSERT(args->num_args != 1 || args->num_args != 2, "invalid number of args");
+    CABOR_ASSERT(args->num_args == 1 || args->num_args == 2, "invalid number of args");
 
     if (strlen(resulterf) < CABOR_MAX_X64_INTRINSIC_LENGTH)
     {
@@ -231,10 +254,13 @@ void cabor_call_args_to_intrinisc_args(cabor_ir_data* ir_data, cabor_ir_call* ca
         CABOR_LOG_ERR_F("codegen error: call result var was too small for intrinsic dest %s", resulterf);
     }
 
-    for (size_t i = 0; i < call->num_args; i++)
+    // Intrinsics have at most two operands, anything past that has no slot in arg_refs
+    size_t num_refs = call->num_args < 2 ? call->num_args : 2;
+
+    for (size_t i = 0; i < num_refs; i++)
     {
-        cabor_ir_var_idx call_arg = call->args[i];
-        cabor_ir_var* call_var = cabor_vector_get_ir_var(ir_data->ir_vars, call_arg);
+        cabor_ir_var_idx call_arg = cabor_ir_call_arg(ir_data, call, (int)i);
+        cabor_ir_var* call_var = cabor_vector_at_ir_var(ir_data->ir_vars, call_arg);
         char* intr_arg = args->arg_refs[i];
         const char* callref = cabor_get_stack_slot(call_arg, locals);
         if (strlen(callref) < CABOR_MAX_X64_INTRINSIC_LENGTH)
@@ -252,7 +278,7 @@ void cabor_generate_assembly(cabor_ir_data* ir_data, cabor_locals* locals, cabor
 {
     for (cabor_ir_inst_idx idx = 0; idx < ir_data->ir_instructions->size; idx++)
     {
-        cabor_ir_instruction* inst = cabor_vector_get_ir_instruction(ir_data->ir_instructions, idx);
+        cabor_ir_instruction* inst = cabor_vector_at_ir_instruction(ir_data->ir_instructions, idx);
         switch (inst->type)
         {
         case CABOR_IR_INST_LOAD_BOOL:
@@ -282,8 +308,8 @@ void cabor_generate_assembly(cabor_ir_data* ir_data, cabor_locals* locals, cabor
         {
             const char* cond = cabor_get_stack_slot(inst->cond_jump.cond, locals);
             cabor_emit_cmp_imm(asmbl, 0, cond);
-            cabor_ir_label* then_label = cabor_vector_get_ir_label(ir_data->ir_labels, inst->cond_jump.then_label);
-            cabor_ir_label* else_label = cabor_vector_get_ir_label(ir_data->ir_labels, inst->cond_jump.else_label);
+            cabor_ir_label* then_label = cabor_vector_at_ir_label(ir_data->ir_labels, inst->cond_jump.then_label);
+            cabor_ir_label* else_label = cabor_vector_at_ir_label(ir_data->ir_labels, inst->cond_jump.else_label);
             cabor_emit_jne(asmbl, then_label);
             cabor_emit_jmp(asmbl, else_label);
             break;
@@ -291,14 +317,14 @@ void cabor_generate_assembly(cabor_ir_data* ir_data, cabor_locals* locals, cabor
 
         case CABOR_IR_INST_JUMP:
         {
-            cabor_ir_label* jmp_label = cabor_vector_get_ir_label(ir_data->ir_labels, inst->jump.label);
+            cabor_ir_label* jmp_label = cabor_vector_at_ir_label(ir_data->ir_labels, inst->jump.label);
             cabor_emit_jmp(asmbl, jmp_label);
             break;
         }
 
         case CABOR_IR_INST_LABEL:
         {
-            cabor_ir_label* inst_label = cabor_vector_get_ir_label(ir_data->ir_labels, inst->label.idx);
+            cabor_ir_label* inst_label = cabor_vector_at_ir_label(ir_data->ir_labels, inst->label.idx);
             cabor_emit_label(asmbl, inst_label->name);
             break;
         }
@@ -306,61 +332,67 @@ void cabor_generate_assembly(cabor_ir_data* ir_data, cabor_locals* locals, cabor
         case CABOR_IR_INST_CALL:
         {
             cabor_ir_call* call = &inst->call;
-            cabor_ir_var* fun = cabor_vector_get_ir_var(ir_data->ir_vars, call->fun);
-            cabor_intrinsic_args args;
-            cabor_call_args_to_intrinisc_args(ir_data, call, &args, locals);
+            cabor_ir_var* fun = cabor_vector_at_ir_var(ir_data->ir_vars, call->fun);
 
-            if (strcmp(fun, "unary_-") == 0)
-            {
-                cabor_intr_unary_minus(&args, asmbl);
-            }
-            else if (strcmp(fun, "unary_not") == 0)
-            {
-                cabor_intr_unary_not(&args, asmbl);
-            }
-            else if (strcmp(fun, "+") == 0)
-            {
-                cabor_intr_plus(&args, asmbl);
-            }
-            else if (strcmp(fun, "-") == 0)
-            {
-                cabor_intr_minus(&args, asmbl);
-            }
-            else if (strcmp(fun, "*") == 0)
-            {
-                cabor_intr_multiply(&args, asmbl);
-            }
-            else if (strcmp(fun, "/") == 0)
-            {
-                cabor_intr_divide(&args, asmbl);
-            }
-            else if (strcmp(fun, "%") == 0)
+            if (cabor_is_intrinsic_call(fun->atom))
             {
-                cabor_intr_remainder(&args, asmbl);
-            }
-            else if (strcmp(fun, "==") == 0)
-            {
-                cabor_intr_eq(&args, asmbl);
-            }
-            else if (strcmp(fun, "!=") == 0)
-            {
-                cabor_intr_ne(&args, asmbl);
-            }
-            else if (strcmp(fun, "<") == 0)
-            {
-                cabor_intr_le(&args, asmbl);
-            }
-            else if (strcmp(fun, "<=") == 0)
-            {
-                cabor_intr_lt(&args, asmbl);
-            }
-            else if (strcmp(fun, ">") == 0)
-            {
-                cabor_intr_gt(&args, asmbl);
-            }
-            else if (strcmp(fun, ">=") == 0)
-            {
-                cabor_intr_ge(&args, asmbl);
+                cabor_intrinsic_args args;
+                cabor_call_args_to_intrinisc_args(ir_data, call, &args, locals);
+
+                if (fun->atom == CABOR_ATOM_UNARY_MINUS)
+                {
+                    cabor_intr_unary_minus(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_UNARY_NOT)
+                {
+                    cabor_intr_unary_not(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_PLUS)
+                {
+                    cabor_intr_plus(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_MINUS)
+                {
+                    cabor_intr_minus(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_MULTIPLY)
+                {
+                    cabor_intr_multiply(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_DIVIDE)
+                {
+                    cabor_intr_divide(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_REMAINDER)
+                {
+                    cabor_intr_remainder(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_EQ)
+                {
+                    cabor_intr_eq(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_NE)
+                {
+                    cabor_intr_ne(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_LT)
+                {
+                    cabor_intr_le(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_LE)
+                {
+                    cabor_intr_lt(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_GT)
+                {
+                    cabor_intr_gt(&args, asmbl);
+                }
+                else if (fun->atom == CABOR_ATOM_GE)
+                {
+                    cabor_intr_ge(&args, asmbl);
+                }
+
+                break;
             }
 
             // Handle non intrinsic calls
@@ -375,7 +407,7 @@ void cabor_generate_assembly(cabor_ir_data* ir_data, cabor_locals* locals, cabor
 
             for (size_t i = 0; i < call->num_args; i++)
             {
-                const char* arg_slot = cabor_get_stack_slot(call->args[i], locals);
+                const char* arg_slot = cabor_get_stack_slot(cabor_ir_call_arg(ir_data, call, (int)i), locals);
                 cabor_emit_mov_reg(asmbl, arg_slot, arg_regs[i]);
             }
 
@@ -416,7 +448,16 @@ void cabor_destroy_x64_assembly(cabor_x64_assembly* asmbl)
 
 void cabor_emit_mov_imm(cabor_x64_assembly* asmbl, int64_t imm, const char* dest)
 {
-    cabor_emit_line(asmbl, "movq $%ld, %s\n", imm, dest);
+    // movq only takes a sign extended 32-bit immediate, wider constants go through %rax with movabsq
+    if (imm >= INT32_MIN && imm <= INT32_MAX)
+    {
+        cabor_emit_line(asmbl, "movq $%lld, %s\n", (long long)imm, dest);
+    }
+    else
+    {
+        cabor_emit_line(asmbl, "movabsq $%lld, %%rax\n", (long long)imm);
+        cabor_emit_line(asmbl, "movq %%rax, %s\n", dest);
+    }
 }
 
 void cabor_emit_mov_reg(cabor_x64_assembly* asmbl, const char* src, const char* dest)
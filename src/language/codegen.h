@@ -16,11 +16,15 @@ typedef struct cabor_stack_location_t
     char* location[CABOR_STACK_LOCATION_MAX_STR_SIZE];
 } cabor_stack_location;
 
+CABOR_VECTOR_DEFINE_ACCESSORS(stack_location, cabor_stack_location)
+
 typedef struct cabor_x64_instruction_t
 {
     char* text[CABOR_MAX_X64_INSTRUCTION_LENGTH];
 } cabor_x64_instruction;
 
+CABOR_VECTOR_DEFINE_ACCESSORS(x64_instruction, cabor_x64_instruction)
+
 typedef struct
 {
     cabor_vector* locations; // maps ir_var (int) -> stack location
@@ -48,6 +52,8 @@ typedef struct cabor_intrinsic_t
     cabor_intr_func intrinsic;
 } cabor_intrinsic;
 
+CABOR_VECTOR_DEFINE_ACCESSORS(x64_intrinsic, cabor_intrinsic)
+
 void add_intrinsic(cabor_x64_assembly* asmbl, const char* name, cabor_intr_func intrinsic);
 
 void cabor_intr_unary_minus(cabor_intrinsic_args* arg, cabor_x64_assembly* asmbl);
@@ -74,6 +80,7 @@ void cabor_destroy_locals(cabor_locals* locals);
 const char* cabor_get_stack_slot(cabor_ir_var_idx ir_var, cabor_locals* locals);
 
 bool cabor_is_binary_args(int num_args);
+bool cabor_is_intrinsic_call(cabor_atom fun);
 void cabor_call_args_to_intrinisc_args(cabor_ir_data* ir_data, cabor_ir_call* call, cabor_intrinsic_args* args, cabor_locals* locals);
 
 void cabor_init_locals(cabor_ir_data* ir_data, cabor_locals* cabor_locals);
@@ -3,25 +3,59 @@
 #include <string.h>
 #include <stdio.h>
 
-cabor_x64_assembly* cabor_compile(const char* code, const char* filename)
+cabor_x64_assembly* cabor_compile(const cabor_file* source, const char* filename)
+{
+    return cabor_compile_span(source->file_memory.mem, source->size, filename);
+}
+
+cabor_x64_assembly* cabor_compile_span(const char* source, size_t size, const char* filename)
+{
+    return cabor_compile_span_with_diagnostics(source, size, filename, NULL);
+}
+
+cabor_x64_assembly* cabor_compile_span_with_diagnostics(const char* source, size_t size, const char* filename, cabor_vector* diagnostics)
 {
     cabor_ir_data* ir_data;
     cabor_symbol_table* symtab;
 
-    cabor_file* file = cabor_file_from_buffer(code, strlen(code));
-    cabor_vector* tokens = cabor_tokenize(file);
-    cabor_ast* ast = cabor_parse(tokens);
-    cabor_ast_node* root = cabor_access_ast_node(ast->root);
+    // The assembly is returned to the caller so it has to outlive the compilation arena
+    cabor_x64_assembly* asmbl = cabor_create_assembly();
+
+    // Names of the program are interned in a scope of the compilation, not in the process wide pool
+    cabor_intern_scope* intern_scope = cabor_create_intern_scope();
+    cabor_intern_scope* previous_scope = cabor_set_intern_scope(intern_scope);
+
+    // Everything else allocated during the compilation comes from this arena
+    // and gets released in one go at the end of this function
+    cabor_allocator_context arena;
+    create_cabor_arena_allocator_context(&arena, cabor_get_current_allocator_context(), CABOR_COMPILER_ARENA_BLOCK_SIZE);
+    cabor_allocator_context* previous_allocator = cabor_set_current_allocator_context(&arena);
+
+    cabor_ast* ast = cabor_parse_source(source, size);
+    if (ast->root == CABOR_AST_NODE_INVALID || ast->diagnostics->size > 0)
+    {
+        CABOR_LOG_ERR_F("Failed to parse %s, %zu errors", filename, ast->diagnostics->size);
+        cabor_set_current_allocator_context(previous_allocator);
+
+        // The ast goes away with the arena, copy the errors out first
+        for (size_t i = 0; diagnostics && i < ast->diagnostics->size; i++)
+            cabor_vector_append_diagnostic(diagnostics, cabor_vector_at_diagnostic(ast->diagnostics, i));
+
+        destroy_cabor_allocator_context(&arena);
+        cabor_set_intern_scope(previous_scope);
+        cabor_destroy_intern_scope(intern_scope);
+        cabor_destroy_x64_assembly(asmbl);
+        return NULL;
+    }
+
     symtab = cabor_create_symbol_table();
-    cabor_type type = cabor_typecheck(ast, root, symtab);
+    cabor_type type = cabor_typecheck_ast(ast, symtab);
     ir_data = cabor_create_ir_data();
     cabor_generate_ir(ir_data, ast);
 
     cabor_locals* locals = cabor_create_locals();
     cabor_init_locals(ir_data, locals);
 
-    cabor_x64_assembly* asmbl = cabor_create_assembly();
-
     cabor_emit_line(asmbl, ".global _start\n");
     cabor_emit_line(asmbl, ".global main\n");
     cabor_emit_line(asmbl, ".extern print_int\n");
@@ -42,7 +76,7 @@ cabor_x64_assembly* cabor_compile(const char* code, const char* filename)
 
     for (size_t i = 0; i < instructions->size; i++)
     {
-        cabor_ir_instruction* inst = cabor_vector_get_ir_instruction(instructions, i);
+        cabor_ir_instruction* inst = cabor_vector_at_ir_instruction(instructions, i);
         char buffer[128] = {0};
         cabor_format_ir_instruction(ir_data, i, buffer, 128);
         CABOR_LOG_F("COMPILED IR: %s", buffer);
@@ -50,20 +84,18 @@ cabor_x64_assembly* cabor_compile(const char* code, const char* filename)
 
     for (size_t i = 0; i < asmbl->instructions->size; i++)
     {
-        cabor_x64_instruction* inst = cabor_vector_get_x64_instruction(asmbl->instructions, i);
+        cabor_x64_instruction* inst = cabor_vector_at_x64_instruction(asmbl->instructions, i);
         CABOR_LOG_F("COMPILED x64: %s", inst->text);
     }
 
     // write to output to a file and feed it to assembler + linker
     cabor_write_asmbl_to_file(filename, asmbl); // writes to "filename.s"
 
-    cabor_destroy_ast(ast);
-    cabor_destroy_vector(tokens);
-    cabor_destroy_file(file);
-    cabor_destroy_locals(locals);
-
-    cabor_destroy_ir_data(ir_data);
-    cabor_destroy_symbol_table(symtab);
+    // No need to destroy the ast, tokens, symbol tables etc. one by one, they all live in the arena
+    cabor_set_current_allocator_context(previous_allocator);
+    destroy_cabor_allocator_context(&arena);
+    cabor_set_intern_scope(previous_scope);
+    cabor_destroy_intern_scope(intern_scope);
 
     return asmbl;
 }
@@ -73,7 +105,7 @@ void cabor_write_asmbl_to_file(const char* filename, cabor_x64_assembly* asmbl)
     size_t total_size = 0;
     for (size_t i = 0; i < asmbl->instructions->size; i++)
     {
-        cabor_x64_instruction* instr = cabor_vector_get_x64_instruction(asmbl->instructions, i);
+        cabor_x64_instruction* instr = cabor_vector_at_x64_instruction(asmbl->instructions, i);
         total_size += strlen(instr->text);
     }
 
@@ -83,7 +115,7 @@ void cabor_write_asmbl_to_file(const char* filename, cabor_x64_assembly* asmbl)
 
     for (size_t i = 0; i < asmbl->instructions->size; i++)
     {
-        cabor_x64_instruction* instr = cabor_vector_get_x64_instruction(asmbl->instructions, i);
+        cabor_x64_instruction* instr = cabor_vector_at_x64_instruction(asmbl->instructions, i);
         size_t line_size = strlen(instr->text);
         memcpy(line_begin, instr->text, line_size);
         line_begin += line_size;
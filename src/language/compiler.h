@@ -2,7 +2,20 @@
 
 #include "ir.h"
 #include "codegen.h"
+#include "../filesystem/filesystem.h"
 
-cabor_x64_assembly* cabor_compile(const char* code, const char* filename);
+#define CABOR_COMPILER_ARENA_BLOCK_SIZE (256 * 1024)
+
+// The source is tokenized straight from the file memory, a mapped file is never copied.
+// Returns NULL when the source fails to parse, the errors have been logged.
+cabor_x64_assembly* cabor_compile(const cabor_file* source, const char* filename);
+
+// Compiles size bytes of source borrowed from the caller. The source doesn't have to be NUL terminated
+// and is only read during the call.
+cabor_x64_assembly* cabor_compile_span(const char* source, size_t size, const char* filename);
+
+// Same as above, the errors of a source that fails to parse are appended to diagnostics (cabor_diagnostic)
+// so they can be shown to the user together. The vector must not be allocated from inside a compilation.
+cabor_x64_assembly* cabor_compile_span_with_diagnostics(const char* source, size_t size, const char* filename, cabor_vector* diagnostics);
 void cabor_write_asmbl_to_file(const char* filename, cabor_x64_assembly* asmbl);
 
@@ -6,12 +6,15 @@
 #include "../logging/logging.h"
 #include "../debug/cabor_debug.h"
 
-#define ROOT(n) cabor_access_ast_node(n)
 #define TOKEN(n) cabor_access_ast_token(ast, n)
-#define EDGE(n, e) cabor_access_ast_node(&n->edges[e])
+#define EDGE(n, e) cabor_ast_edge(ast, n, e)
+#define NUM_EDGES(n) cabor_ast_num_edges(ast, n)
+#define NODE_TYPE(n) cabor_ast_node_type_of(ast, n)
+#define TYPE(n) cabor_ast_type_of(ast, n)
+#define SET_TYPE(n, t) cabor_ast_set_type(ast, n, t)
 
 #define IR_ENTRY(symtab, str) cabor_get_ir_var_entry(symtab, str)
-#define IR_VAR_IDX(ir_data, idx) cabor_vector_get_ir_var(ir_data->ir_vars, idx)
+#define IR_VAR_IDX(ir_data, idx) cabor_vector_at_ir_var(ir_data->ir_vars, idx)
 #define IR_VAR_KEY(entry) entry->key
 #define IR_VAR_TYPE(entry) (cabor_type)entry->value
 
@@ -37,9 +40,10 @@ cabor_ir_data* cabor_create_ir_data()
 {
     CABOR_NEW(cabor_ir_data, ir_data);
     ir_data->ir_vars = cabor_create_vector(1024, CABOR_IR_VAR, false);
-    ir_data->ir_var_types = cabor_create_hash_map(1024);
+    ir_data->ir_var_types = cabor_create_hash_map(CABOR_SYMBOL_TABLE_INITIAL_SIZE);
     ir_data->ir_labels = cabor_create_vector(1024, CABOR_IR_LABEL, false);
     ir_data->ir_call_args = cabor_create_vector(1024, CABOR_INT, false);
+    ir_data->ir_pending_args = cabor_create_vector(64, CABOR_INT, false);
     ir_data->ir_symtab = cabor_create_symbol_table();
     ir_data->ir_instructions = cabor_create_vector(1024, CABOR_IR_INSTRUCTION, false);
     return ir_data;
@@ -51,18 +55,19 @@ void cabor_destroy_ir_data(cabor_ir_data* ir_data)
     cabor_destroy_hash_map(ir_data->ir_var_types);
     cabor_destroy_vector(ir_data->ir_labels);
     cabor_destroy_vector(ir_data->ir_call_args);
+    cabor_destroy_vector(ir_data->ir_pending_args);
     cabor_destroy_symbol_table(ir_data->ir_symtab);
     cabor_destroy_vector(ir_data->ir_instructions);
     CABOR_DELETE(cabor_ir_data, ir_data);
 }
 
-cabor_ir_var_idx cabor_create_ir_var(cabor_ir_data* ir_data, const char* var, cabor_type type)
+static cabor_ir_var_idx append_ir_var(cabor_ir_data* ir_data, const char* var, cabor_atom atom, cabor_type type)
 {
     cabor_ir_var_idx idx = (cabor_ir_var_idx)ir_data->ir_vars->size;
-    cabor_ir_var ir_var = { .id = idx, .type = type };
-    size_t len = strlen(var);
+    cabor_ir_var ir_var = { .id = idx, .type = type, .atom = atom };
 
-    if (len > CABOR_MAX_IR_VAR_LENGTH)
+    size_t len = strlen(var);
+    if (len >= CABOR_MAX_IR_VAR_LENGTH)
     {
         CABOR_LOG_ERR_F("IR error: IR var storage was too small for %s", var);
         return CABOR_IR_VAR_INVALID;
@@ -70,32 +75,29 @@ cabor_ir_var_idx cabor_create_ir_var(cabor_ir_data* ir_data, const char* var, ca
 
     strcpy(ir_var.name, var);
 
-    cabor_vector_push_ir_var(ir_data->ir_vars, &ir_var);
+    cabor_vector_append_ir_var(ir_data->ir_vars, &ir_var);
+
+    return idx;
+}
+
+cabor_ir_var_idx cabor_create_ir_var(cabor_ir_data* ir_data, const char* var, cabor_type type)
+{
+    cabor_ir_var_idx idx = append_ir_var(ir_data, var, cabor_intern(var), type);
 
-    cabor_map_insert(ir_data->ir_var_types, var, (int)type);
+    if (idx != CABOR_IR_VAR_INVALID)
+        cabor_map_insert(ir_data->ir_var_types, var, (int)type);
 
     return idx;
 }
 
-cabor_map_entry* cabor_create_ir_var_with_entry(cabor_ir_data* ir_data, const char* var, cabor_type type, cabor_symbol_table* symbtab)
+cabor_map_entry* cabor_create_ir_var_with_entry(cabor_ir_data* ir_data, cabor_atom var, cabor_type type, cabor_symbol_table* symbtab)
 {
-    cabor_ir_var_idx idx = (cabor_ir_var_idx)ir_data->ir_vars->size;
-    cabor_ir_var ir_var = { .id = idx, .type = type };
+    cabor_ir_var_idx idx = append_ir_var(ir_data, cabor_atom_str(var), var, type);
 
-    size_t len = strlen(var);
-    if (len < CABOR_MAX_IR_VAR_LENGTH)
-    {
-        strcpy(ir_var.name, var);
-    }
-    else
-    {
-        CABOR_LOG_ERR_F("IR error: IR var storage was too small for %s", var);
+    if (idx == CABOR_IR_VAR_INVALID)
         return NULL;
-    }
 
-    cabor_vector_push_ir_var(ir_data->ir_vars, &ir_var);
-
-   return cabor_map_insert(symbtab->map, var, (int)idx);
+    return cabor_map_insert_atom(symbtab->map, var, (int)idx);
 }
 
 cabor_ir_var_idx cabor_create_unique_ir_var(cabor_ir_data* ir_data, cabor_type type)
@@ -109,7 +111,11 @@ cabor_ir_var_idx cabor_create_unique_ir_var(cabor_ir_data* ir_data, cabor_type t
         CABOR_RUNTIME_ERROR("snprintf overflow");
     }
 
-    return cabor_create_ir_var(ir_data, buffer, type);
+    // Temporaries are never looked up by name so they are not interned
+    idx = append_ir_var(ir_data, buffer, CABOR_ATOM_INVALID, type);
+    cabor_map_insert(ir_data->ir_var_types, buffer, (int)type);
+
+    return idx;
 }
 
 cabor_ir_label_idx cabor_create_ir_label(cabor_ir_data* ir_data, const char* label)
@@ -129,7 +135,7 @@ cabor_ir_label_idx cabor_create_ir_label(cabor_ir_data* ir_data, const char* lab
         CABOR_LOG_ERR_F("IR error: label name overflow: %s", label);
     }
 
-    cabor_vector_push_ir_label(ir_data->ir_labels, &ir_label);
+    cabor_vector_append_ir_label(ir_data->ir_labels, &ir_label);
     return idx;
 }
 
@@ -144,7 +150,7 @@ cabor_ir_inst_idx cabor_push_ir_label(cabor_ir_data* ir_data, cabor_ir_label_idx
             .idx = label 
         }
     };
-    cabor_vector_push_ir_instruction(ir_data->ir_instructions, &instr);
+    cabor_vector_append_ir_instruction(ir_data->ir_instructions, &instr);
     return idx;
 }
 
@@ -162,11 +168,11 @@ cabor_ir_inst_idx cabor_create_ir_load_bool_const(cabor_ir_data* ir_data, bool v
         }
     };
 
-    cabor_vector_push_ir_instruction(ir_data->ir_instructions, &instr);
+    cabor_vector_append_ir_instruction(ir_data->ir_instructions, &instr);
     return idx;
 }
 
-cabor_ir_inst_idx cabor_create_ir_load_int_const(cabor_ir_data* ir_data, int value, int dest)
+cabor_ir_inst_idx cabor_create_ir_load_int_const(cabor_ir_data* ir_data, int64_t value, int dest)
 {
     cabor_ir_inst_idx idx = (cabor_ir_inst_idx)ir_data->ir_instructions->size;
     cabor_ir_instruction instr =
@@ -178,7 +184,7 @@ cabor_ir_inst_idx cabor_create_ir_load_int_const(cabor_ir_data* ir_data, int val
             .dest = dest
         }
     };
-    cabor_vector_push_ir_instruction(ir_data->ir_instructions, &instr);
+    cabor_vector_append_ir_instruction(ir_data->ir_instructions, &instr);
     return idx;
 }
 
@@ -194,19 +200,17 @@ cabor_ir_inst_idx cabor_create_ir_copy(cabor_ir_data* ir_data, int source, int d
             .dest = dest
         }
     };
-    cabor_vector_push_ir_instruction(ir_data->ir_instructions, &instr);
+    cabor_vector_append_ir_instruction(ir_data->ir_instructions, &instr);
     return idx;
 }
 
 cabor_ir_inst_idx cabor_create_ir_call(cabor_ir_data* ir_data, int fun, int* args, int num_args, int dest)
 {
     cabor_ir_inst_idx idx = (cabor_ir_inst_idx)ir_data->ir_instructions->size;
-    int args_idx = (int)ir_data->ir_call_args->size;
-    cabor_vector_reserve(ir_data->ir_call_args, ir_data->ir_call_args->size + num_args);
-    int* args_begin = (int*)ir_data->ir_call_args->vector_mem.mem + ir_data->ir_call_args->size;
-    ir_data->ir_call_args->size += num_args;
+    uint32_t first_arg = (uint32_t)ir_data->ir_call_args->size;
 
-    memcpy(args_begin, args, num_args * sizeof(int));
+    for (int i = 0; i < num_args; i++)
+        cabor_vector_append_ir_var_idx(ir_data->ir_call_args, &args[i]);
 
     cabor_ir_instruction instr = 
     {
@@ -214,13 +218,13 @@ cabor_ir_inst_idx cabor_create_ir_call(cabor_ir_data* ir_data, int fun, int* arg
         .call =
         {
             .fun = fun,
-            .args = args_begin,
+            .first_arg = first_arg,
             .num_args = num_args,
             .dest = dest
         }
     };
 
-    cabor_vector_push_ir_instruction(ir_data->ir_instructions, &instr);
+    cabor_vector_append_ir_instruction(ir_data->ir_instructions, &instr);
     return idx;
 }
 
@@ -235,7 +239,7 @@ cabor_ir_inst_idx cabor_create_ir_jump(cabor_ir_data* ir_data, int label)
             .label = label
         }
     };
-    cabor_vector_push_ir_instruction(ir_data->ir_instructions, &instr);
+    cabor_vector_append_ir_instruction(ir_data->ir_instructions, &instr);
     return idx;
 }
 
@@ -252,17 +256,17 @@ cabor_ir_inst_idx cabor_create_ir_condjump(cabor_ir_data* ir_data, int cond, int
             .else_label = else_label
         }
     };
-    cabor_vector_push_ir_instruction(ir_data->ir_instructions, &instr);
+    cabor_vector_append_ir_instruction(ir_data->ir_instructions, &instr);
     return idx;
 }
 
-cabor_ir_var_entry* cabor_get_ir_var_entry(cabor_symbol_table* sym_tab, const char* ir_var)
+cabor_ir_var_entry* cabor_get_ir_var_entry(cabor_symbol_table* sym_tab, cabor_atom ir_var)
 {
     bool found = false;
-    cabor_map_entry* entry = cabor_map_get_entry(sym_tab->map, ir_var, &found);
+    cabor_map_entry* entry = cabor_map_get_entry_atom(sym_tab->map, ir_var, &found);
     if (!found)
     {
-        CABOR_LOG_ERR_F("IR gen error: failed to get ir var entry for %s", ir_var);
+        CABOR_LOG_ERR_F("IR gen error: failed to get ir var entry for %s", cabor_atom_str(ir_var));
         return NULL;
     }
     return entry;
@@ -284,13 +288,13 @@ void cabor_generate_ir(cabor_ir_data* ir_data, cabor_ast* ast)
         }
     }
 
-    cabor_map_entry* print_int_entry = cabor_get_ir_var_entry(ir_data->ir_symtab, "print_int");
-    cabor_map_entry* print_bool_entry = cabor_get_ir_var_entry(ir_data->ir_symtab, "print_bool");
+    cabor_map_entry* print_int_entry = cabor_get_ir_var_entry(ir_data->ir_symtab, CABOR_ATOM_PRINT_INT);
+    cabor_map_entry* print_bool_entry = cabor_get_ir_var_entry(ir_data->ir_symtab, CABOR_ATOM_PRINT_BOOL);
 
     print_int_entry->value = print_int;
     print_bool_entry->value = print_bool;
 
-    cabor_ast_node* root_expr = cabor_access_ast_node(ast->root);
+    cabor_ast_node_idx root_expr = ast->root;
 
     cabor_ir_var_idx final_var_idx = cabor_visit_ir_node(ir_data, ast, root_expr, ir_data->ir_symtab);
     cabor_type var_type;
@@ -318,7 +322,7 @@ void cabor_generate_ir(cabor_ir_data* ir_data, cabor_ast* ast)
 
 void cabor_format_ir_instruction(cabor_ir_data* ir_data, cabor_ir_inst_idx inst, char* buffer, size_t bufSize)
 {
-    cabor_ir_instruction* instruction = cabor_vector_get_ir_instruction(ir_data->ir_instructions, inst);
+    cabor_ir_instruction* instruction = cabor_vector_at_ir_instruction(ir_data->ir_instructions, inst);
     switch (instruction->type)
     {
     case CABOR_IR_INST_LOAD_BOOL:
@@ -333,8 +337,8 @@ void cabor_format_ir_instruction(cabor_ir_data* ir_data, cabor_ir_inst_idx inst,
     case CABOR_IR_INST_LOAD_INT:
     {
         snprintf(buffer, bufSize,
-            "LoadIntConst(%d, x%d)",
-            instruction->load_int_const.value,
+            "LoadIntConst(%lld, x%d)",
+            (long long)instruction->load_int_const.value,
             instruction->load_int_const.dest);
         break;
     }
@@ -350,7 +354,7 @@ void cabor_format_ir_instruction(cabor_ir_data* ir_data, cabor_ir_inst_idx inst,
 
     case CABOR_IR_INST_CALL:
     {
-        cabor_ir_var* fun_var = cabor_vector_get_ir_var(ir_data->ir_vars, instruction->call.fun);
+        cabor_ir_var* fun_var = cabor_vector_at_ir_var(ir_data->ir_vars, instruction->call.fun);
         int written = snprintf(buffer, bufSize, "Call(%s, [", fun_var->name);
 
         for (int i = 0; i < instruction->call.num_args; ++i)
@@ -358,7 +362,7 @@ void cabor_format_ir_instruction(cabor_ir_data* ir_data, cabor_ir_inst_idx inst,
             if (written < bufSize)
             {
                 written += snprintf(buffer + written, bufSize - written,
-                    "%sx%d", i == 0 ? "" : ", ", instruction->call.args[i]);
+                    "%sx%d", i == 0 ? "" : ", ", cabor_ir_call_arg(ir_data, &instruction->call, i));
             }
         }
 
@@ -373,7 +377,7 @@ void cabor_format_ir_instruction(cabor_ir_data* ir_data, cabor_ir_inst_idx inst,
 
     case CABOR_IR_INST_JUMP:
     {
-        cabor_ir_label* label = cabor_vector_get_ir_label(ir_data->ir_labels, instruction->jump.label);
+        cabor_ir_label* label = cabor_vector_at_ir_label(ir_data->ir_labels, instruction->jump.label);
         snprintf(buffer, bufSize,
             "Jump(%s)", label->name);
         break;
@@ -381,8 +385,8 @@ void cabor_format_ir_instruction(cabor_ir_data* ir_data, cabor_ir_inst_idx inst,
 
     case CABOR_IR_INST_CONDJUMP:
     {
-        cabor_ir_label* then_label = cabor_vector_get_ir_label(ir_data->ir_labels, instruction->cond_jump.then_label);
-        cabor_ir_label* else_label = cabor_vector_get_ir_label(ir_data->ir_labels, instruction->cond_jump.else_label);
+        cabor_ir_label* then_label = cabor_vector_at_ir_label(ir_data->ir_labels, instruction->cond_jump.then_label);
+        cabor_ir_label* else_label = cabor_vector_at_ir_label(ir_data->ir_labels, instruction->cond_jump.else_label);
 
         snprintf(buffer, bufSize,
             "CondJump(x%d, %s, %s)",
@@ -394,7 +398,7 @@ void cabor_format_ir_instruction(cabor_ir_data* ir_data, cabor_ir_inst_idx inst,
 
     case CABOR_IR_INST_LABEL:
     {
-        cabor_ir_label* label = cabor_vector_get_ir_label(ir_data->ir_labels, instruction->label.idx);
+        cabor_ir_label* label = cabor_vector_at_ir_label(ir_data->ir_labels, instruction->label.idx);
         snprintf(buffer, bufSize,
             "Label(%s)",
             label->name);
@@ -407,10 +411,10 @@ void cabor_format_ir_instruction(cabor_ir_data* ir_data, cabor_ir_inst_idx inst,
     }
 }
 
-cabor_map_entry* cabor_require_ir_var(cabor_ir_data* ir_data, cabor_symbol_table* symtab, const char* var, cabor_type type)
+cabor_map_entry* cabor_require_ir_var(cabor_ir_data* ir_data, cabor_symbol_table* symtab, cabor_atom var, cabor_type type)
 {
     bool found = false;
-    cabor_map_entry* entry = cabor_map_get_entry(symtab->map, var, &found);
+    cabor_map_entry* entry = cabor_map_get_entry_atom(symtab->map, var, &found);
 
     if (!found)
     {
@@ -420,42 +424,47 @@ cabor_map_entry* cabor_require_ir_var(cabor_ir_data* ir_data, cabor_symbol_table
     return entry;
 }
 
-cabor_ir_var_idx cabor_visit_ir_binaryop(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_table)
+cabor_ir_var_idx cabor_visit_ir_binaryop(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_table)
 {
     cabor_token* root_t = TOKEN(root_expr);
-    cabor_ir_var_entry* var_op = cabor_require_ir_var(ir_data, root_table, root_t->data, root_expr->type);
+    // Read the value right away, visiting the operands inserts into the map and moves entries around
+    cabor_ir_var_idx var_op = cabor_require_ir_var(ir_data, root_table, root_t->atom, TYPE(root_expr))->value;
 
-    cabor_ir_var_idx left = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[0]), root_table);
-    cabor_ir_var_idx right = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[1]), root_table);
+    cabor_ir_var_idx left = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 0), root_table);
+    cabor_ir_var_idx right = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 1), root_table);
 
-    cabor_ir_var_idx var_result = cabor_create_unique_ir_var(ir_data, root_expr->type);
+    cabor_ir_var_idx var_result = cabor_create_unique_ir_var(ir_data, TYPE(root_expr));
 
     cabor_ir_var_idx args[] = { left, right };
-    cabor_ir_inst_idx inst = cabor_create_ir_call(ir_data, var_op->value, args, 2, var_result);
+    cabor_ir_inst_idx inst = cabor_create_ir_call(ir_data, var_op, args, 2, var_result);
 
     return var_result;
 }
 
-cabor_ir_var_idx cabor_visit_ir_unaryop(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_unaryop(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
     cabor_token* token = TOKEN(root_expr);
-    const char* op = token->data;
-
-    char unary_op_buf[64];
-    snprintf(unary_op_buf, sizeof(unary_op_buf), "unary_%s", op);
 
-    bool found = false;
-    cabor_map_entry* fun_entry = cabor_require_ir_var(ir_data, root_tab, unary_op_buf, token->type);
-    cabor_ir_var_idx fun = cabor_map_get(root_tab->map, unary_op_buf, &found);
-    if (!found)
+    cabor_atom unary_op;
+    if (cabor_token_is(token, CABOR_ATOM_MINUS))
+    {
+        unary_op = CABOR_ATOM_UNARY_MINUS;
+    }
+    else if (cabor_token_is(token, CABOR_ATOM_NOT))
+    {
+        unary_op = CABOR_ATOM_UNARY_NOT;
+    }
+    else
     {
-        CABOR_LOG_ERR_F("IR error: unary operator '%s' not found in symbol table", op);
+        CABOR_LOG_ERR_F("IR error: unknown unary operator '%s'", cabor_token_str(token));
         return CABOR_IR_VAR_INVALID;
     }
 
-    cabor_ir_var_idx arg = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[0]), root_tab);
+    cabor_ir_var_idx fun = cabor_require_ir_var(ir_data, root_tab, unary_op, token->type)->value;
+
+    cabor_ir_var_idx arg = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 0), root_tab);
 
-    cabor_ir_var_idx result = cabor_create_unique_ir_var(ir_data, root_expr->type);
+    cabor_ir_var_idx result = cabor_create_unique_ir_var(ir_data, TYPE(root_expr));
 
     cabor_ir_var_idx args[] = { arg };
     cabor_create_ir_call(ir_data, fun, args, 1, result);
@@ -463,10 +472,10 @@ cabor_ir_var_idx cabor_visit_ir_unaryop(cabor_ir_data* ir_data, cabor_ast* ast,
     return result;
 }
 
-cabor_ir_var_idx cabor_visit_ir_literal(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_literal(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
     cabor_token* token = TOKEN(root_expr);
-    cabor_type type = root_expr->type;
+    cabor_type type = TYPE(root_expr);
 
     cabor_ir_var_idx var = cabor_create_unique_ir_var(ir_data, type);;
 
@@ -475,17 +484,17 @@ cabor_ir_var_idx cabor_visit_ir_literal(cabor_ir_data* ir_data, cabor_ast* ast,
         case CABOR_TYPE_BOOL:
         {
             bool value;
-            if (strcmp(token->data, "true") == 0)
+            if (cabor_token_is(token, CABOR_ATOM_TRUE))
             {
                 value = true;
             }
-            else if (strcmp(token->data, "false") == 0)
+            else if (cabor_token_is(token, CABOR_ATOM_FALSE))
             {
                 value = false;
             }
             else
             {
-                CABOR_LOG_ERR_F("IR error: bool wasn't 'true' or 'false' it was %s", token->data);
+                CABOR_LOG_ERR_F("IR error: bool wasn't 'true' or 'false' it was %s", cabor_token_str(token));
                 return CABOR_IR_VAR_INVALID;
             }
             cabor_create_ir_load_bool_const(ir_data, value, var);
@@ -493,13 +502,8 @@ cabor_ir_var_idx cabor_visit_ir_literal(cabor_ir_data* ir_data, cabor_ast* ast,
         }
         case CABOR_TYPE_INT:
         {
-            char* endptr;
-            long num = strtol(token->data, &endptr, 10);
-            if (*endptr != '\0')
-            {
-                CABOR_LOG_ERR_F("IR error: %s wasn't convertible to int", token->data);
-            }
-            cabor_create_ir_load_int_const(ir_data, (int)num, var);
+            // The tokenizer already parsed the value, overflow was reported by the type checker
+            cabor_create_ir_load_int_const(ir_data, token->value, var);
             return var;
         }
         case CABOR_TYPE_UNIT:
@@ -514,70 +518,81 @@ cabor_ir_var_idx cabor_visit_ir_literal(cabor_ir_data* ir_data, cabor_ast* ast,
     }
 }
 
-cabor_ir_var_idx cabor_visit_ir_identifier(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_identifier(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
     cabor_token* token = TOKEN(root_expr);
     bool found = false;
-    cabor_ir_var_idx var_idx = cabor_map_get(root_tab->map, token->data, &found);
+    cabor_ir_var_idx var_idx = cabor_symbol_table_lookup(root_tab, token->atom, &found);
 
     if (!found)
     {
-        CABOR_LOG_ERR_F("IR error: visit_ir_identifier didn't find ir var for %s", token->data);
+        CABOR_LOG_ERR_F("IR error: visit_ir_identifier didn't find ir var for %s", cabor_token_str(token));
         return CABOR_IR_VAR_INVALID;
     }
 
     return var_idx;
 }
 
-cabor_ir_var_idx cabor_visit_ir_function_call(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_function_call(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
     cabor_token* token = TOKEN(root_expr);
     bool found = false;
-    cabor_ir_var_idx fun_idx = cabor_map_get(root_tab->map, token->data, &found);
+    cabor_ir_var_idx fun_idx = cabor_symbol_table_lookup(root_tab, token->atom, &found);
+
+    if (!found)
+    {
+        CABOR_LOG_ERR_F("IR error: visit_ir_function_call didn't find function %s", cabor_token_str(token));
+        return CABOR_IR_VAR_INVALID;
+    }
 
-    int num_args = root_expr->num_edges;
-    cabor_ir_var_idx args[16]; // max 16 args for now
+    // Arguments can contain calls of their own, each call keeps its arguments on top of the pending stack
+    // until all of them have been generated
+    int num_args = NUM_EDGES(root_expr);
+    size_t first_pending = ir_data->ir_pending_args->size;
     for (int i = 0; i < num_args; i++)
     {
-        args[i] = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[i]), root_tab);
+        cabor_ir_var_idx arg = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, i), root_tab);
+        cabor_vector_append_ir_var_idx(ir_data->ir_pending_args, &arg);
     }
 
-    cabor_ir_var_idx dest = cabor_create_unique_ir_var(ir_data, root_expr->type);
+    cabor_ir_var_idx* args = num_args > 0 ? cabor_vector_at_ir_var_idx(ir_data->ir_pending_args, first_pending) : NULL;
+    cabor_ir_var_idx dest = cabor_create_unique_ir_var(ir_data, TYPE(root_expr));
     cabor_create_ir_call(ir_data, fun_idx, args, num_args, dest);
+    ir_data->ir_pending_args->size = first_pending;
     return dest;
 }
 
-cabor_ir_var_idx cabor_visit_ir_unit(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_unit(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
     return CABOR_IR_VAR_UNIT;
 }
 
-cabor_ir_var_idx cabor_visit_ir_block(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_block(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
     cabor_ir_var_idx result = CABOR_IR_VAR_UNIT;
 
     cabor_symbol_table* new_scope = cabor_create_new_symbol_scope(root_tab);
 
-    for (int i = 0; i < root_expr->num_edges; i++)
+    for (int i = 0; i < NUM_EDGES(root_expr); i++)
     {
-        result = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[i]), new_scope);
+        result = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, i), new_scope);
     }
 
     return result;
 }
 
-cabor_ir_var_idx cabor_visit_ir_if_then_else(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_if_then_else(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
-    if (root_expr->num_edges == 2)
+    if (NUM_EDGES(root_expr) == 2)
     {
         cabor_ir_label_idx l_then = cabor_create_ir_label(ir_data, "then");
         cabor_ir_label_idx l_end = cabor_create_ir_label(ir_data, "end");
 
-        cabor_ir_var_idx var_cond = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[0]), root_tab);
+        cabor_ir_var_idx var_cond = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 0), root_tab);
         cabor_ir_inst_idx cond_jump = cabor_create_ir_condjump(ir_data, var_cond, l_then, l_end);
 
         cabor_push_ir_label(ir_data, l_then);
-        cabor_ir_var_idx var_then = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[1]), root_tab);
+        cabor_ir_var_idx var_then = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 1), root_tab);
         cabor_ir_inst_idx jump_end = cabor_create_ir_jump(ir_data, l_end);
 
         cabor_push_ir_label(ir_data, l_then);
@@ -590,18 +605,18 @@ cabor_ir_var_idx cabor_visit_ir_if_then_else(cabor_ir_data* ir_data, cabor_ast*
         cabor_ir_label_idx l_end = cabor_create_ir_label(ir_data, "end");
         cabor_ir_label_idx l_else = cabor_create_ir_label(ir_data, "else");
 
-        cabor_ir_var_idx var_cond = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[0]), root_tab);
+        cabor_ir_var_idx var_cond = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 0), root_tab);
         cabor_ir_inst_idx cond_jump = cabor_create_ir_condjump(ir_data, var_cond, l_then, l_else);
         cabor_push_ir_label(ir_data, l_then);
 
-        cabor_ir_var_idx var_then = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[1]), root_tab);
+        cabor_ir_var_idx var_then = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 1), root_tab);
         cabor_ir_var_idx var_result = cabor_create_unique_ir_var(ir_data, IR_VAR_IDX(ir_data, var_then)->type);
         cabor_ir_var_idx copy1 = cabor_create_ir_copy(ir_data, var_then, var_result);
 
         cabor_ir_inst_idx jump_to_end_from_then = cabor_create_ir_jump(ir_data, l_end);
 
         cabor_push_ir_label(ir_data, l_else);
-        cabor_ir_var_idx var_else = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[2]), root_tab);
+        cabor_ir_var_idx var_else = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 2), root_tab);
         cabor_ir_var_idx copy2 = cabor_create_ir_copy(ir_data, var_else, var_result);
         cabor_ir_inst_idx jump_to_end_from_else = cabor_create_ir_jump(ir_data, l_end);
 
@@ -611,18 +626,18 @@ cabor_ir_var_idx cabor_visit_ir_if_then_else(cabor_ir_data* ir_data, cabor_ast*
     }
 }
 
-cabor_ir_var_idx cabor_visit_ir_while(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_while(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
     cabor_ir_label_idx l_start = cabor_create_ir_label(ir_data, "while_start");
     cabor_ir_label_idx l_body = cabor_create_ir_label(ir_data, "while_body");
     cabor_ir_label_idx l_end = cabor_create_ir_label(ir_data, "while_end");
 
     cabor_push_ir_label(ir_data, l_start);
-    cabor_ir_var_idx cond = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[0]), root_tab);
+    cabor_ir_var_idx cond = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 0), root_tab);
     cabor_create_ir_condjump(ir_data, cond, l_body, l_end);
 
     cabor_push_ir_label(ir_data, l_body);
-    cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[1]), root_tab);
+    cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 1), root_tab);
     cabor_create_ir_jump(ir_data, l_start);
 
     cabor_push_ir_label(ir_data, l_end);
@@ -630,27 +645,27 @@ cabor_ir_var_idx cabor_visit_ir_while(cabor_ir_data* ir_data, cabor_ast* ast, ca
     return CABOR_IR_VAR_UNIT;
 }
 
-cabor_ir_var_idx cabor_visit_ir_var_expr(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_var_expr(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
-    cabor_token* token = TOKEN(ROOT(&root_expr->edges[0]));
-    cabor_type type = root_expr->type;
-    cabor_ir_var_idx var = cabor_create_ir_var(ir_data, token->data, type);
+    cabor_token* token = TOKEN(EDGE(root_expr, 0));
+    cabor_type type = TYPE(root_expr);
+    cabor_ir_var_idx var = cabor_create_ir_var(ir_data, cabor_token_str(token), type);
 
-    cabor_ir_var_idx value = cabor_visit_ir_node(ir_data, ast, ROOT(&root_expr->edges[1]), root_tab);
+    cabor_ir_var_idx value = cabor_visit_ir_node(ir_data, ast, EDGE(root_expr, 1), root_tab);
     cabor_create_ir_copy(ir_data, value, var);
-    cabor_map_insert(root_tab->map, token->data, var);
+    cabor_map_insert_atom(root_tab->map, token->atom, var);
 
     return CABOR_IR_VAR_UNIT;
 }
 
-cabor_ir_var_idx cabor_visit_ir_declaration(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_declaration(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
     // no reason to do anything here
 }
 
-cabor_ir_var_idx cabor_visit_ir_node(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab)
+cabor_ir_var_idx cabor_visit_ir_node(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab)
 {
-    switch (root_expr->node_type)
+    switch (NODE_TYPE(root_expr))
     {
     case CABOR_NODE_TYPE_BINARY_OP:
         return cabor_visit_ir_binaryop(ir_data, ast, root_expr, root_tab);
@@ -685,6 +700,7 @@ cabor_ir_var_idx cabor_visit_ir_node(cabor_ir_data* ir_data, cabor_ast* ast, cab
     case CABOR_NODE_TYPE_DECLARATION:
         return cabor_visit_ir_declaration(ir_data, ast, root_expr, root_tab);
 
+    case CABOR_NODE_TYPE_ERROR:
     case CABOR_NODE_TYPE_UNKNOWN:
         return -1;
     }
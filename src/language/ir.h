@@ -15,13 +15,18 @@ typedef int cabor_ir_inst_idx;
 typedef int cabor_ir_inst_idx;
 typedef cabor_map_entry cabor_ir_var_entry;
 
+CABOR_VECTOR_DEFINE_ACCESSORS(ir_var_idx, cabor_ir_var_idx)
+
 typedef struct cabor_ir_var_t
 {
     char name[CABOR_MAX_IR_VAR_LENGTH];
     cabor_ir_var_idx id; // ir vars are unique
     cabor_type type;
+    cabor_atom atom;     // interned name, CABOR_ATOM_INVALID for temporaries
 } cabor_ir_var;
 
+CABOR_VECTOR_DEFINE_ACCESSORS(ir_var, cabor_ir_var)
+
 typedef struct
 {
     cabor_hash_map*      ir_var_types;     // maps all global names like 'print_int', '+' to to their types
@@ -30,8 +35,10 @@ typedef struct
     cabor_vector*        ir_labels;        // all cabor_ir_label objects
     cabor_vector*        ir_instructions;  // all cabor_ir_instruction objects
     cabor_vector*        ir_call_args;     // storage for all function call argument lists stored just after each other in memory:
-} cabor_ir_data;                           // [1, 4, 7 ,3], [2, 3, 8] <- indices to ir_vars array
+                                           // [1, 4, 7 ,3], [2, 3, 8] <- indices to ir_vars array
                                            //   call1        call2    ...
+    cabor_vector*        ir_pending_args;  // arguments of the calls still being generated, nested calls push theirs on top
+} cabor_ir_data;
 typedef enum
 {
     CABOR_IR_INST_LOAD_BOOL,
@@ -52,6 +59,8 @@ typedef struct cabor_ir_label_t
     char name[CABOR_MAX_LABEL_LENGTH];
 } cabor_ir_label;
 
+CABOR_VECTOR_DEFINE_ACCESSORS(ir_label, cabor_ir_label)
+
 typedef struct
 {
     cabor_ir_label_idx idx;
@@ -65,7 +74,7 @@ typedef struct
 
 typedef struct
 {
-    int value;
+    int64_t value;
     cabor_ir_var_idx dest;
 } cabor_ir_load_int_const;
 
@@ -78,7 +87,7 @@ typedef struct
 typedef struct
 {
     cabor_ir_var_idx fun;
-    cabor_ir_var_idx* args;
+    uint32_t first_arg; // index into ir_call_args, an offset because the storage moves when it grows
     int num_args;
     cabor_ir_var_idx dest;
 } cabor_ir_call;
@@ -110,6 +119,14 @@ typedef struct cabor_ir_instruction_t
     };
 } cabor_ir_instruction;
 
+CABOR_VECTOR_DEFINE_ACCESSORS(ir_instruction, cabor_ir_instruction)
+
+static inline cabor_ir_var_idx cabor_ir_call_arg(const cabor_ir_data* ir_data, const cabor_ir_call* call, int arg)
+{
+    CABOR_ASSERT(arg < call->num_args, "ir call argument out of bounds");
+    return *cabor_vector_at_ir_var_idx(ir_data->ir_call_args, call->first_arg + arg);
+}
+
 
 size_t cabor_get_ir_instruction_size();
 size_t cabor_get_ir_var_size();
@@ -121,37 +138,37 @@ void cabor_destroy_ir_data(cabor_ir_data* ir_var_types);
 
 // No need to bother with deallocating individual ir instructions, cabor_destroy_ir_data handles that
 cabor_ir_var_idx cabor_create_ir_var(cabor_ir_data* ir_data, const char* var, cabor_type type);
-cabor_map_entry* cabor_create_ir_var_with_entry(cabor_ir_data* ir_data, const char* var, cabor_type type, cabor_symbol_table* symtab);
+cabor_map_entry* cabor_create_ir_var_with_entry(cabor_ir_data* ir_data, cabor_atom var, cabor_type type, cabor_symbol_table* symtab);
 cabor_ir_var_idx cabor_create_unique_ir_var(cabor_ir_data* ir_data, cabor_type type);
 cabor_ir_label_idx cabor_create_ir_label(cabor_ir_data* ir_data, const char* label);
 cabor_ir_inst_idx cabor_push_ir_label(cabor_ir_data* ir_data, cabor_ir_label_idx label);
 cabor_ir_inst_idx cabor_create_ir_load_bool_const(cabor_ir_data* ir_data, bool value, int dest);
-cabor_ir_inst_idx cabor_create_ir_load_int_const(cabor_ir_data* ir_data, int value, int dest);
+cabor_ir_inst_idx cabor_create_ir_load_int_const(cabor_ir_data* ir_data, int64_t value, int dest);
 cabor_ir_inst_idx cabor_create_ir_copy(cabor_ir_data* ir_data, int source, int dest);
 cabor_ir_inst_idx cabor_create_ir_call(cabor_ir_data* ir_data, int fun, int* args, int num_args, int dest);
 cabor_ir_inst_idx cabor_create_ir_jump(cabor_ir_data* ir_data, int label);
 cabor_ir_inst_idx cabor_create_ir_condjump(cabor_ir_data* ir_data, int cond, int then_label, int else_label);
 
 // Get ir var from scoped sym tab
-cabor_ir_var_entry* cabor_get_ir_var_entry(cabor_symbol_table* sym_tab, const char* ir_var);
+cabor_ir_var_entry* cabor_get_ir_var_entry(cabor_symbol_table* sym_tab, cabor_atom ir_var);
 
 void cabor_generate_ir(cabor_ir_data* ir_data, cabor_ast* ast);
 
 void cabor_format_ir_instruction(cabor_ir_data* ir_data, cabor_ir_inst_idx inst, char* buffer, size_t bufSize);
 
-cabor_map_entry* cabor_require_ir_var(cabor_ir_data* ir_data, cabor_symbol_table* symtab, const char* var, cabor_type type);
+cabor_map_entry* cabor_require_ir_var(cabor_ir_data* ir_data, cabor_symbol_table* symtab, cabor_atom var, cabor_type type);
 
-cabor_ir_var_idx cabor_visit_ir_binaryop(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
-cabor_ir_var_idx cabor_visit_ir_unaryop(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
-cabor_ir_var_idx cabor_visit_ir_literal(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
-cabor_ir_var_idx cabor_visit_ir_identifier(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
-cabor_ir_var_idx cabor_visit_ir_function_call(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
-cabor_ir_var_idx cabor_visit_ir_unit(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
-cabor_ir_var_idx cabor_visit_ir_block(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
-cabor_ir_var_idx cabor_visit_ir_if_then_else(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
-cabor_ir_var_idx cabor_visit_ir_while(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
-cabor_ir_var_idx cabor_visit_ir_var_expr(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
-cabor_ir_var_idx cabor_visit_ir_declaration(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_binaryop(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_unaryop(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_literal(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_identifier(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_function_call(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_unit(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_block(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_if_then_else(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_while(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_var_expr(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
+cabor_ir_var_idx cabor_visit_ir_declaration(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
 
 // Returns index to IR_VAR in ir_data->ir_vars
-int cabor_visit_ir_node(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node* root_expr, cabor_symbol_table* root_tab);
+int cabor_visit_ir_node(cabor_ir_data* ir_data, cabor_ast* ast, cabor_ast_node_idx root_expr, cabor_symbol_table* root_tab);
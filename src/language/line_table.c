@@ -0,0 +1,73 @@
+#include "line_table.h"
+
+#include "../core/memory.h"
+
+#include <stdio.h>
+#include <string.h>
+
+cabor_line_table* cabor_create_line_table()
+{
+    CABOR_NEW(cabor_line_table, table);
+    table->line_starts = cabor_create_vector_with_stride(CABOR_LINE_TABLE_DEFAULT_CAPACITY, sizeof(uint32_t), false);
+
+    uint32_t first_line = 0;
+    cabor_vector_append_u32(table->line_starts, &first_line);
+    return table;
+}
+
+void cabor_destroy_line_table(cabor_line_table* table)
+{
+    cabor_destroy_vector(table->line_starts);
+    CABOR_DELETE(cabor_line_table, table);
+}
+
+void cabor_line_table_clear(cabor_line_table* table)
+{
+    table->line_starts->size = 1;
+}
+
+void cabor_line_table_append(cabor_line_table* table, const cabor_line_table* other)
+{
+    cabor_vector* starts = table->line_starts;
+    cabor_vector* other_starts = other->line_starts;
+
+    // Skip the implicit first line of other
+    size_t count = other_starts->size - 1;
+    cabor_vector_reserve(starts, starts->size + count);
+    memcpy((uint32_t*)starts->vector_mem.mem + starts->size, (uint32_t*)other_starts->vector_mem.mem + 1, count * sizeof(uint32_t));
+    starts->size += count;
+}
+
+size_t cabor_line_table_line_count(const cabor_line_table* table)
+{
+    return table->line_starts->size;
+}
+
+cabor_source_location cabor_line_table_lookup(const cabor_line_table* table, size_t offset)
+{
+    const uint32_t* starts = table->line_starts->vector_mem.mem;
+
+    // Last line that starts at or before offset
+    size_t low = 0;
+    size_t high = table->line_starts->size;
+    while (high - low > 1)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (starts[mid] <= offset)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    cabor_source_location location =
+    {
+        .line = (uint32_t)(low + 1),
+        .column = (uint32_t)(offset - starts[low] + 1)
+    };
+    return location;
+}
+
+void cabor_format_source_location(cabor_source_location location, char* buffer, size_t size)
+{
+    snprintf(buffer, size, "%u:%u", location.line, location.column);
+}
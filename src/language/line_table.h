@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../core/vector.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CABOR_LINE_TABLE_DEFAULT_CAPACITY 256
+
+// Buffer size that fits any string from cabor_format_source_location()
+#define CABOR_SOURCE_LOCATION_STR_SIZE 32
+
+// Offsets where the lines of a source begin, recorded by the tokenizer as it skips over whitespace and
+// comments. Tokens only keep their 32-bit offset, line and column are looked up here with a binary
+// search when a diagnostic needs them.
+typedef struct
+{
+    cabor_vector* line_starts; // uint32_t, ascending, the first line starts at 0
+} cabor_line_table;
+
+typedef struct
+{
+    uint32_t line;   // 1-based
+    uint32_t column; // 1-based, counted in bytes
+} cabor_source_location;
+
+cabor_line_table* cabor_create_line_table();
+void cabor_destroy_line_table(cabor_line_table* table);
+
+// Called for every '\n' in the source in order, offset is the offset of the new line character
+static inline void cabor_line_table_add_newline(cabor_line_table* table, size_t offset)
+{
+    uint32_t line_start = (uint32_t)(offset + 1);
+    cabor_vector_append_u32(table->line_starts, &line_start);
+}
+
+// Back to a single line starting at 0
+void cabor_line_table_clear(cabor_line_table* table);
+
+// Line starts of other are appended to table, other has to cover the source after table
+void cabor_line_table_append(cabor_line_table* table, const cabor_line_table* other);
+
+size_t cabor_line_table_line_count(const cabor_line_table* table);
+cabor_source_location cabor_line_table_lookup(const cabor_line_table* table, size_t offset);
+
+// "line:column"
+void cabor_format_source_location(cabor_source_location location, char* buffer, size_t size);
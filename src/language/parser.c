@@ -1,128 +1,157 @@
 #include "parser.h"
 #include "../core/memory.h"
-#include "../core/stack.h"
 #include "../debug/cabor_debug.h"
 #include "../language/tokenizer.h"
 
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 
-#define CABOR_FUNCTION_PARSER_MAX_ARGS 100
-#define CABOR_MAX_BINARY_OPS_PER_PRECEDENCE_LEVEL 10
-#define CABOR_LAST_BINARY_PRECEDENCE_LEVEL 6
-#define CABOR_MAX_BLOCK_EDGES 1000 // This determines maximum number of lines of code ended by ; inside a block
-
-#define IS_VALID_TOKEN(token) token != NULL
-#define IS_VALID_NODE(node) node.node_mem.mem != NULL
-
-#define NULL_AST (cabor_ast_allocated_node) { .node_mem.mem = NULL }
+#define CABOR_AST_DEFAULT_CAPACITY 256
+#define CABOR_AST_TRAVERSAL_STACK_CAPACITY 64
+
+#define IS_VALID_TOKEN(token) ((token) != NULL)
+#define IS_VALID_NODE(node) ((node) != CABOR_AST_NODE_INVALID)
+
+// Binding power of each binary operator indexed by its atom, 0 for atoms that aren't binary operators.
+// Operators that bind tighter have higher power, all of them are left associative.
+static const uint8_t binary_binding_powers[CABOR_BUILTIN_ATOM_COUNT] =
+{
+    [CABOR_ATOM_ASSIGN]    = 1,
+    [CABOR_ATOM_OR]        = 2,
+    [CABOR_ATOM_AND]       = 3,
+    [CABOR_ATOM_EQ]        = 4,
+    [CABOR_ATOM_NE]        = 4,
+    [CABOR_ATOM_LT]        = 5,
+    [CABOR_ATOM_LE]        = 5,
+    [CABOR_ATOM_GT]        = 5,
+    [CABOR_ATOM_GE]        = 5,
+    [CABOR_ATOM_PLUS]      = 6,
+    [CABOR_ATOM_MINUS]     = 6,
+    [CABOR_ATOM_MULTIPLY]  = 7,
+    [CABOR_ATOM_DIVIDE]    = 7,
+    [CABOR_ATOM_REMAINDER] = 7,
+};
 
-typedef struct 
+static cabor_token* current(cabor_token_stream* stream)
 {
-    size_t numOps;
-    const char* ops[CABOR_MAX_BINARY_OPS_PER_PRECEDENCE_LEVEL];
-} binary_precedence_level;
+    return cabor_token_stream_peek(stream, 0);
+}
 
-static const binary_precedence_level binary_precedence_levels[] =
+static cabor_token* lookahead(cabor_token_stream* stream)
 {
-    {1, "="},
-    {1, "or"},
-    {1, "and"},
-    {2, "==", "!="},
-    {4, "<", "<=", ">", ">="},
-    {2, "+", "-"},
-    {3, "*", "/", "%"},
-};
+    return cabor_token_stream_peek(stream, 1);
+}
 
-static cabor_token* next(cabor_vector* tokens, size_t* cursor)
+static cabor_token* next(cabor_token_stream* stream)
 {
-    size_t next_pos = *cursor + 1;
-    if (next_pos < tokens->size)
-    {
-        return cabor_vector_get_token(tokens, ++(*cursor));
-    }
-    else
-    {
-        return NULL;
-    }
+    return cabor_token_stream_next(stream);
 }
 
-static bool token_is_term(cabor_token* token)
+// Position of a token for error messages, the buffer lives until the end of the enclosing block
+#define LOCATION(token) cabor_ast_location_str(ast, token, (char[CABOR_SOURCE_LOCATION_STR_SIZE]){0}, CABOR_SOURCE_LOCATION_STR_SIZE)
+
+// Text of a token for error messages, the buffer lives until the end of the enclosing block
+#define TOKEN_TEXT(token) token_text(token, (char[CABOR_TOKEN_TEXT_SIZE]){0})
+
+static const char* token_text(const cabor_token* token, char* buffer)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_IDENTIFIER || token->type == CABOR_INTEGER_LITERAL || token->type == CABOR_OPERATOR || token->type == CABOR_KEYWORD;
+    return token ? cabor_token_text(token, buffer, CABOR_TOKEN_TEXT_SIZE) : "nothing";
 }
 
-static bool is_if_token(cabor_token* token)
+static void report(cabor_ast* ast, const cabor_token* token, const char* format, ...)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_KEYWORD && strcmp(token->data, "if") == 0;
+    char message[CABOR_DIAGNOSTIC_MESSAGE_SIZE];
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    cabor_ast_add_diagnostic(ast, token, message);
 }
 
-static bool is_then_token(cabor_token* token)
+static cabor_ast_node_idx error_node(cabor_ast* ast)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_KEYWORD && strcmp(token->data, "then") == 0;
+    cabor_token error_token = cabor_create_synthetic_token(CABOR_TOKEN_UNKNOWN, CABOR_ATOM_ERROR);
+    ast->panic = true;
+    return cabor_allocate_ast_node(ast, &error_token, NULL, 0, CABOR_NODE_TYPE_ERROR);
 }
 
-static bool is_else_token(cabor_token* token)
+// Reports a syntax error at token and puts the parser in panic mode, evaluates to the error node that
+// takes the place of the construct that failed to parse
+#define SYNTAX_ERROR(token, ...) (report(ast, token, __VA_ARGS__), error_node(ast))
+
+// Returns the child when it failed to parse: CABOR_AST_NODE_INVALID past the nesting limit, or a node
+// with a syntax error that the enclosing block still has to recover from
+#define RETURN_IF_FAILED(node) do { if (!IS_VALID_NODE(node) || ast->panic) return (node); } while (0)
+
+static bool is_if_token(cabor_token* token)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_KEYWORD && strcmp(token->data, "else") == 0;
+    return IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_IF);
 }
 
-static bool is_plus_minus_operator(cabor_token* token)
+static bool is_then_token(cabor_token* token)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_OPERATOR && (token->data[0] == '+' || token->data[0] == '-');
+    return IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_THEN);
 }
 
-static bool is_multiply_divide_operator(cabor_token* token)
+static bool is_else_token(cabor_token* token)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_OPERATOR && (token->data[0] == '*' || token->data[0] == '/');
+    return IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_ELSE);
 }
 
 static bool is_while_token(cabor_token* token)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_KEYWORD && (strcmp(token->data, "while") == 0);
+    return IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_WHILE);
 }
 
 static bool is_do_token(cabor_token* token)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_KEYWORD && (strcmp(token->data, "do") == 0);
+    return IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_DO);
 }
 
 static bool is_var_token(cabor_token* token)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_KEYWORD && (strcmp(token->data, "var") == 0);
+    return IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_VAR);
 }
 
 static bool is_token_beginning_of_block(cabor_token* token)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_PUNCTUATION && (strcmp(token->data, "{") == 0);
+    return IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_LBRACE);
 }
 
 static bool is_token_ending_of_block(cabor_token* token)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_PUNCTUATION && (strcmp(token->data, "}") == 0);
+    return IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_RBRACE);
 }
 
+static bool is_rparen_token(cabor_token* token)
+{
+    return IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_RPAREN);
+}
 
 static bool is_token_semicolon(cabor_token* token)
 {
-    return IS_VALID_TOKEN(token) && token->type == CABOR_PUNCTUATION && (strcmp(token->data, ";") == 0);
+    return IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_SEMICOLON);
 }
 
-static bool is_binary_op_at_current_precedence_level(cabor_token* token, size_t current_level)
+static inline bool is_operand_node(const cabor_ast* ast, cabor_ast_node_idx node)
 {
-    CABOR_ASSERT(current_level <= CABOR_LAST_BINARY_PRECEDENCE_LEVEL, "Current level is greater than last precedence level");
-    if (IS_VALID_TOKEN(token) && token->type == CABOR_OPERATOR)
-    {
-        binary_precedence_level current = binary_precedence_levels[current_level];
-        for (size_t i = 0; i < current.numOps; i++)
-        {
-            char* op = current.ops[i];
-            if (strcmp(op, token->data) == 0)
-                return true;
-        }
-    }
-    return false;
+    if (!IS_VALID_NODE(node))
+        return false;
+
+    cabor_ast_node_type type = cabor_ast_node_type_of(ast, node);
+    return type != CABOR_NODE_TYPE_DECLARATION && type != CABOR_NODE_TYPE_ERROR && type != CABOR_NODE_TYPE_UNKNOWN;
+}
+
+static uint8_t binary_binding_power(cabor_token* token)
+{
+    if (!IS_VALID_TOKEN(token) || token->type != CABOR_OPERATOR || token->atom >= CABOR_BUILTIN_ATOM_COUNT)
+        return 0;
+
+    return binary_binding_powers[token->atom];
 }
 
 const char* cabor_type_to_str(cabor_type type)
@@ -144,680 +173,803 @@ const char* cabor_type_to_str(cabor_type type)
     }
 }
 
-cabor_ast* cabor_parse(cabor_vector* tokens)
+cabor_ast* cabor_create_ast()
 {
     CABOR_NEW(cabor_ast, ast);
-    size_t cursor = 0;
-    ast->tokens = tokens;
-    CABOR_NEW(cabor_ast_allocated_node, root);
-    *root = cabor_parse_expression(tokens, &cursor);
-    ast->root = root;
+    ast->node_types = cabor_create_vector_with_stride(CABOR_AST_DEFAULT_CAPACITY, sizeof(uint8_t), false);
+    ast->types = cabor_create_vector_with_stride(CABOR_AST_DEFAULT_CAPACITY, sizeof(uint8_t), false);
+    ast->tokens = cabor_create_vector(CABOR_AST_DEFAULT_CAPACITY, CABOR_TOKEN, false);
+    ast->first_edges = cabor_create_vector_with_stride(CABOR_AST_DEFAULT_CAPACITY, sizeof(uint32_t), false);
+    ast->num_edges = cabor_create_vector_with_stride(CABOR_AST_DEFAULT_CAPACITY, sizeof(uint32_t), false);
+    ast->edges = cabor_create_vector_with_stride(CABOR_AST_DEFAULT_CAPACITY, sizeof(cabor_ast_node_idx), false);
+    ast->root = CABOR_AST_NODE_INVALID;
+    ast->lines = NULL;
+    ast->diagnostics = cabor_create_vector_with_stride(CABOR_AST_TRAVERSAL_STACK_CAPACITY, sizeof(cabor_diagnostic), false);
+    ast->pending_edges = cabor_create_vector_with_stride(CABOR_AST_TRAVERSAL_STACK_CAPACITY, sizeof(cabor_ast_node_idx), false);
+    ast->depth = 0;
+    ast->max_depth = CABOR_PARSER_DEFAULT_MAX_DEPTH;
+    ast->panic = false;
+    return ast;
+}
+
+static cabor_ast_node_idx parse_top_level(cabor_ast* ast, cabor_token_stream* stream);
+
+static cabor_ast* parse_stream(cabor_token_stream* stream, size_t max_depth)
+{
+    cabor_ast* ast = cabor_create_ast();
+    ast->max_depth = max_depth;
+    ast->lines = cabor_token_stream_release_lines(stream);
+
+    if (IS_VALID_TOKEN(current(stream)))
+        ast->root = parse_top_level(ast, stream);
+    else
+        ast->root = SYNTAX_ERROR(NULL, "Expected an expression but the input is empty");
+
+    cabor_destroy_token_stream(stream);
     return ast;
 }
 
+cabor_ast* cabor_parse(cabor_vector* tokens)
+{
+    return parse_stream(cabor_create_token_stream_from_vector(tokens), CABOR_PARSER_DEFAULT_MAX_DEPTH);
+}
+
+cabor_ast* cabor_parse_source(const char* source, size_t size)
+{
+    return cabor_parse_source_with_max_depth(source, size, CABOR_PARSER_DEFAULT_MAX_DEPTH);
+}
+
+cabor_ast* cabor_parse_source_with_max_depth(const char* source, size_t size, size_t max_depth)
+{
+    return parse_stream(cabor_create_token_stream(source, size), max_depth);
+}
+
 void cabor_destroy_ast(cabor_ast* ast)
 {
-    cabor_free_ast(ast->root);
-    cabor_ast_allocated_node* root_node = ast->root;
-    CABOR_DELETE(cabor_ast_allocated_node, root_node);
+    cabor_destroy_vector(ast->node_types);
+    cabor_destroy_vector(ast->types);
+    cabor_destroy_vector(ast->tokens);
+    cabor_destroy_vector(ast->first_edges);
+    cabor_destroy_vector(ast->num_edges);
+    cabor_destroy_vector(ast->edges);
+    cabor_destroy_vector(ast->pending_edges);
+    cabor_destroy_vector(ast->diagnostics);
+    if (ast->lines)
+        cabor_destroy_line_table(ast->lines);
     CABOR_DELETE(cabor_ast, ast);
 }
 
-cabor_token* cabor_access_ast_token(const cabor_ast* ast, const cabor_ast_node* node)
+size_t cabor_get_ast_node_count(const cabor_ast* ast)
 {
-    return cabor_vector_get_token(ast->tokens, node->token_index);
+    return ast->node_types->size;
 }
 
-cabor_token* cabor_access_ast_token_edge(const cabor_ast* ast, const cabor_ast_allocated_node* node, int edge_index)
+const char* cabor_ast_location_str(const cabor_ast* ast, const cabor_token* token, char* buffer, size_t size)
 {
-    cabor_ast_node* n = cabor_access_ast_node(node);
-    cabor_ast_allocated_node edge_alloc = n->edges[edge_index];
-    cabor_ast_node* edge = cabor_access_ast_node(&edge_alloc);
-    CABOR_ASSERT(edge_index < n->num_edges, "ast node edge overflow");
-    return cabor_access_ast_token(ast, edge);
+    if (!token)
+        snprintf(buffer, size, "end of input");
+    else if (!ast->lines || !cabor_token_has_source(token))
+        snprintf(buffer, size, "?:?");
+    else
+        cabor_format_source_location(cabor_line_table_lookup(ast->lines, token->offset), buffer, size);
+
+    return buffer;
 }
 
-cabor_ast_allocated_node cabor_parse_block(cabor_vector* tokens, size_t* cursor)
+void cabor_ast_add_diagnostic(cabor_ast* ast, const cabor_token* token, const char* message)
 {
-    cabor_token* token = cabor_vector_get_token(tokens, *cursor);
-    if (!is_token_beginning_of_block(token))
-    {
-        CABOR_LOG_ERR_F("Expected token { but got %s", token->data);
-        return NULL_AST;
-    }
+    cabor_diagnostic diagnostic = {0};
+    snprintf(diagnostic.message, sizeof(diagnostic.message), "%s", message);
 
-    size_t block_begin_index = *cursor;
+    if (token && ast->lines && cabor_token_has_source(token))
+        diagnostic.location = cabor_line_table_lookup(ast->lines, token->offset);
 
-    bool error = false;
+    cabor_vector_append_diagnostic(ast->diagnostics, &diagnostic);
 
-    cabor_ast_allocated_node edges[CABOR_MAX_BLOCK_EDGES];
-    size_t edge_idx = 0;
+    CABOR_LOG_ERR_F("%s: %s", LOCATION(token), message);
+}
+
+cabor_token* cabor_access_ast_token(const cabor_ast* ast, cabor_ast_node_idx node)
+{
+    return cabor_vector_at_token(ast->tokens, node);
+}
+
+cabor_token* cabor_access_ast_token_edge(const cabor_ast* ast, cabor_ast_node_idx node, size_t edge_index)
+{
+    return cabor_access_ast_token(ast, cabor_ast_edge(ast, node, edge_index));
+}
+
+// Allocates a node whose edges are the pending edges from first_pending up and pops them
+static cabor_ast_node_idx allocate_node_with_pending_edges(cabor_ast* ast, const cabor_token* token, size_t first_pending, cabor_ast_node_type type)
+{
+    size_t count = ast->pending_edges->size - first_pending;
+    cabor_ast_node_idx* edges = count > 0 ? cabor_vector_at_u32(ast->pending_edges, first_pending) : NULL;
+    cabor_ast_node_idx node = cabor_allocate_ast_node(ast, token, edges, count, type);
+    ast->pending_edges->size = first_pending;
+    return node;
+}
+
+// Panic mode recovery: skips the rest of a statement that failed to parse, stopping at the ';' or '}' that
+// ends it. Parentheses and blocks opened on the way are skipped whole, a ')' without an opening one
+// belongs to the broken statement. Returns the token it stopped at, or NULL if the input ended first.
+static cabor_token* synchronize(cabor_token_stream* stream)
+{
+    cabor_token* token = current(stream);
+    size_t nesting = 0;
 
     while (IS_VALID_TOKEN(token))
     {
-        token = next(tokens, cursor);
+        if (nesting == 0 && (is_token_semicolon(token) || is_token_ending_of_block(token)))
+            return token;
 
-        cabor_ast_allocated_node expr = cabor_parse_expression(tokens, cursor);
-        if (IS_VALID_NODE(expr))
-        {
-            edges[edge_idx++] = expr;
-        }
-        else
+        if (cabor_token_is(token, CABOR_ATOM_LPAREN) || is_token_beginning_of_block(token))
+            nesting++;
+        else if (nesting > 0 && (cabor_token_is(token, CABOR_ATOM_RPAREN) || is_token_ending_of_block(token)))
+            nesting--;
+
+        token = next(stream);
+    }
+
+    return NULL;
+}
+
+cabor_ast_node_idx cabor_parse_block(cabor_ast* ast, cabor_token_stream* stream)
+{
+    cabor_token* token = current(stream);
+    if (!is_token_beginning_of_block(token))
+        return SYNTAX_ERROR(token, "Expected token { but got %s", TOKEN_TEXT(token));
+
+    cabor_token block_token = *token;
+
+    // Children are collected on the shared pending stack instead of the c stack, nested blocks push
+    // theirs on top and pop them before this block continues
+    size_t first_pending = ast->pending_edges->size;
+
+    while (true)
+    {
+        token = next(stream);
+        if (!IS_VALID_TOKEN(token))
         {
-            CABOR_LOG_ERR("Got null ast node when attempting to parse expression inside block");
-            error = true;
+            report(ast, NULL, "Expected '}' to close the block at %s but the input ended", LOCATION(&block_token));
+            ast->panic = true;
             break;
         }
 
-        token = next(tokens, cursor);
-        bool is_ending_of_block = is_token_ending_of_block(token);
-        bool is_semicolon = is_token_semicolon(token);
-
-        if (!is_ending_of_block && !is_semicolon)
+        cabor_ast_node_idx expr = cabor_parse_expression(ast, stream);
+        if (!IS_VALID_NODE(expr))
         {
-            CABOR_LOG_ERR_F("Expected '}' or ';' after expression in block but got %s", token->data);
-            error = true;
-            break;
+            // Past the nesting limit, the expression already reported why
+            ast->pending_edges->size = first_pending;
+            return CABOR_AST_NODE_INVALID;
         }
 
-        if (is_semicolon && !(*cursor + 1 < tokens->size))
+        cabor_vector_append_u32(ast->pending_edges, &expr);
+
+        if (!ast->panic)
         {
-            CABOR_LOG_ERR("Expected more tokens after ';' in block but got none!");
-            error = true;
-            break;
+            token = next(stream);
+            if (!is_token_ending_of_block(token) && !is_token_semicolon(token))
+                SYNTAX_ERROR(token, "Expected '}' or ';' after expression in block but got %s", TOKEN_TEXT(token));
         }
 
-        if (is_semicolon)
+        if (ast->panic)
         {
-            cabor_token* next_t = cabor_vector_get_token(tokens, *cursor + 1);
-
-            // When block is ended by ;} it means the block should evaluate to None
-            // When block is ended by only } it means the block should evaluate to value of the last expression
-            // To differentiate between the two easily we add unit token as the last edge if we encounter ;}
-            if (is_token_ending_of_block(next_t)) 
-            {
-                cabor_token unit_token = { .type = CABOR_UNIT, .data = "<UNIT>\0"};
-                cabor_vector_push_token(tokens, &unit_token);
-                size_t unit_token_idx = tokens->size - 1;
-                edges[edge_idx++] = cabor_allocate_ast_node(unit_token_idx, NULL, 0, CABOR_NODE_TYPE_UNIT);
-                token = next(tokens, cursor);
+            // The statement already reported its error, continue from the end of it. When the input ends
+            // first the panic is left on so the enclosing blocks stop as well without more errors.
+            token = synchronize(stream);
+            if (!IS_VALID_TOKEN(token))
                 break;
-            }
+
+            ast->panic = false;
         }
 
-        if (is_ending_of_block)
+        if (is_token_ending_of_block(token))
             break;
 
+        // When block is ended by ;} it means the block should evaluate to None
+        // When block is ended by only } it means the block should evaluate to value of the last expression
+        // To differentiate between the two easily we add unit token as the last edge if we encounter ;}
+        if (is_token_ending_of_block(lookahead(stream)))
+        {
+            cabor_token unit_token = cabor_create_synthetic_token(CABOR_UNIT, CABOR_ATOM_UNIT);
+            cabor_ast_node_idx unit = cabor_allocate_ast_node(ast, &unit_token, NULL, 0, CABOR_NODE_TYPE_UNIT);
+            cabor_vector_append_u32(ast->pending_edges, &unit);
+            next(stream);
+            break;
+        }
     }
 
-    // Expect }
-    if (!is_token_ending_of_block(token))
-    {
-        CABOR_LOG_ERR_F("Expected token } but got %s", token->data);
-        error = true;
-    }
+    // A block with errors is kept with the statements that did parse, the errors are nodes among them
+    return allocate_node_with_pending_edges(ast, &block_token, first_pending, CABOR_NODE_TYPE_BLOCK);
+}
 
-    cabor_ast_allocated_node block;
+// The program is a sequence of expressions separated by ';' like the inside of a block, and recovers
+// from errors the same way. A single expression is the root as is, more of them are put in a block
+// that has no braces in the source.
+static cabor_ast_node_idx parse_top_level(cabor_ast* ast, cabor_token_stream* stream)
+{
+    size_t first_pending = ast->pending_edges->size;
 
-    if (error)
+    while (true)
     {
-        block = NULL_AST;
-        for (size_t i = 0; i < edge_idx; i++)
+        cabor_ast_node_idx expr = cabor_parse_expression(ast, stream);
+        if (!IS_VALID_NODE(expr))
+        {
+            ast->pending_edges->size = first_pending;
+            return CABOR_AST_NODE_INVALID;
+        }
+
+        cabor_vector_append_u32(ast->pending_edges, &expr);
+
+        cabor_token* token = NULL;
+        if (!ast->panic)
+        {
+            token = next(stream);
+            if (!IS_VALID_TOKEN(token))
+                break;
+
+            if (!is_token_semicolon(token))
+                SYNTAX_ERROR(token, "Expected ';' or end of input after expression but got %s", TOKEN_TEXT(token));
+        }
+
+        if (ast->panic)
         {
-            cabor_ast_allocated_node edge = edges[i];
-            cabor_free_ast_node(&edge);
+            // A '}' without an opening one stops the skip like a ';' does, the error is already reported
+            token = synchronize(stream);
+            if (!IS_VALID_TOKEN(token))
+                break;
+
+            ast->panic = false;
+        }
+
+        // A program ending in ';' evaluates to unit, the same as a block ending in ;}
+        token = next(stream);
+        if (!IS_VALID_TOKEN(token))
+        {
+            cabor_token unit_token = cabor_create_synthetic_token(CABOR_UNIT, CABOR_ATOM_UNIT);
+            cabor_ast_node_idx unit = cabor_allocate_ast_node(ast, &unit_token, NULL, 0, CABOR_NODE_TYPE_UNIT);
+            cabor_vector_append_u32(ast->pending_edges, &unit);
+            break;
         }
     }
-    else
+
+    if (ast->pending_edges->size - first_pending == 1)
     {
-        block = cabor_allocate_ast_node(block_begin_index, edges, edge_idx, CABOR_NODE_TYPE_BLOCK);
+        cabor_ast_node_idx root = *cabor_vector_at_u32(ast->pending_edges, first_pending);
+        ast->pending_edges->size = first_pending;
+        return root;
     }
 
-    return block;
+    cabor_token block_token = cabor_create_synthetic_token(CABOR_PUNCTUATION, CABOR_ATOM_LBRACE);
+    return allocate_node_with_pending_edges(ast, &block_token, first_pending, CABOR_NODE_TYPE_BLOCK);
 }
 
 // Parse unary '-' and 'not'
-cabor_ast_allocated_node cabor_parse_unary(cabor_vector* tokens, size_t* cursor)
+cabor_ast_node_idx cabor_parse_unary(cabor_ast* ast, cabor_token_stream* stream)
 {
-    size_t op = *cursor;
-    next(tokens, cursor);
+    cabor_token op = *current(stream);
+    next(stream);
 
-    cabor_ast_allocated_node operand = cabor_parse_factor(tokens, cursor);
-    cabor_ast_allocated_node edges[] = { operand };
+    cabor_ast_node_idx operand = cabor_parse_factor(ast, stream);
+    RETURN_IF_FAILED(operand);
 
-    return cabor_allocate_ast_node(op, edges, 1, CABOR_NODE_TYPE_UNARY_OP);
+    cabor_ast_node_idx edges[] = { operand };
+
+    return cabor_allocate_ast_node(ast, &op, edges, 1, CABOR_NODE_TYPE_UNARY_OP);
 }
 
-cabor_ast_allocated_node cabor_parse_identifier(cabor_vector* tokens, size_t op_index)
+cabor_ast_node_idx cabor_parse_identifier(cabor_ast* ast, const cabor_token* token)
 {
-    CABOR_ASSERT(op_index < tokens->size, "op_index is out of bounds!");
-
-    cabor_token* token = cabor_vector_get_token(tokens, op_index);
+    CABOR_ASSERT(IS_VALID_TOKEN(token), "identifier token is null!");
 
     // This is bit of a hack. The tokenizer identifies 'True' and 'False' as identifiers which is fine
     // for the purposes of parsing but when it comes to type checking this is bad. Proper solution would be to
     // make the tokenizer recognize these as literals but that's tricky due to how the code works. As a hack we
     // instead switch the type here to literal;
     cabor_type type = CABOR_NODE_TYPE_IDENTIFIER;
-    if (strcmp(token->data, "true") == 0 || strcmp(token->data, "false") == 0)
+    if (cabor_token_is(token, CABOR_ATOM_TRUE) || cabor_token_is(token, CABOR_ATOM_FALSE))
     {
         type = CABOR_NODE_TYPE_LITERAL;
     }
 
-    cabor_ast_allocated_node root_alloc = cabor_allocate_ast_node(op_index, NULL, 0, type);
+    cabor_ast_node_idx root_alloc = cabor_allocate_ast_node(ast, token, NULL, 0, type);
     return root_alloc;
 }
 
-cabor_ast_allocated_node cabor_parse_integer_literal(cabor_vector* tokens, size_t op_index)
+cabor_ast_node_idx cabor_parse_integer_literal(cabor_ast* ast, const cabor_token* token)
 {
-    CABOR_ASSERT(op_index < tokens->size, "op_index is out of bounds!");
-    cabor_ast_allocated_node root_alloc = cabor_allocate_ast_node(op_index, NULL, 0, CABOR_NODE_TYPE_LITERAL);
+    CABOR_ASSERT(IS_VALID_TOKEN(token), "integer literal token is null!");
+
+    // The tokenizer clamps literals that don't fit, the value is wrong so the program can't be compiled.
+    // It still parses as a literal, nothing around it has to be skipped.
+    if (token->flags & CABOR_TOKEN_FLAG_OVERFLOW)
+        report(ast, token, "Integer literal doesn't fit in 64 bits");
+
+    cabor_ast_node_idx root_alloc = cabor_allocate_ast_node(ast, token, NULL, 0, CABOR_NODE_TYPE_LITERAL);
     return root_alloc;
 }
 
-cabor_ast_allocated_node cabor_parse_parenthesized(cabor_vector* tokens, size_t* op_index)
+cabor_ast_node_idx cabor_parse_parenthesized(cabor_ast* ast, cabor_token_stream* stream)
 {
-    cabor_token* begin = cabor_vector_get_token(tokens, *op_index);
-    CABOR_ASSERT(begin->data[0] == '(', "Begin token not (");
+    cabor_token* begin = current(stream);
+    CABOR_ASSERT(cabor_token_is(begin, CABOR_ATOM_LPAREN), "Begin token not (");
 
-    next(tokens, op_index);
-    cabor_ast_allocated_node expr = cabor_parse_binary_expression(tokens, op_index, 0);
-    next(tokens, op_index);
+    if (!next(stream))
+        return SYNTAX_ERROR(NULL, "Expected an expression after ( but the input ended");
 
-    cabor_token* end = cabor_vector_get_token(tokens, *op_index);
-    CABOR_ASSERT(end->data[0] == ')', "End token not )");
+    cabor_ast_node_idx expr = cabor_parse_binary_expression(ast, stream, 0);
+    RETURN_IF_FAILED(expr);
+
+    cabor_token* end = next(stream);
+    if (!is_rparen_token(end))
+        return SYNTAX_ERROR(end, "Expected ) but got %s", TOKEN_TEXT(end));
 
     return expr;
 }
 
-cabor_ast_allocated_node cabor_parse_operator(cabor_vector* tokens, size_t op_index, cabor_ast_allocated_node left, cabor_ast_allocated_node right)
+cabor_ast_node_idx cabor_parse_operator(cabor_ast* ast, const cabor_token* op, cabor_ast_node_idx left, cabor_ast_node_idx right)
 {
-    cabor_token* left_token = cabor_vector_get_token(tokens, cabor_access_ast_node(&left)->token_index);
-    cabor_token* right_token = cabor_vector_get_token(tokens, cabor_access_ast_node(&right)->token_index);
-    cabor_token* root_token = cabor_vector_get_token(tokens, op_index);
-
-    CABOR_ASSERT(token_is_term(left_token), "left token not term in expression!");
-    CABOR_ASSERT(token_is_term(right_token), "right token not term in expression!");
-    CABOR_ASSERT(root_token->type == CABOR_OPERATOR, "root_token token not operator in expression!");
+    // Any factor can be an operand, blocks and parenthesized expressions included, so only the kind of
+    // the operand nodes is checked and not their tokens
+    CABOR_ASSERT(is_operand_node(ast, left), "left operand is not an expression!");
+    CABOR_ASSERT(is_operand_node(ast, right), "right operand is not an expression!");
+    CABOR_ASSERT(op->type == CABOR_OPERATOR, "root_token token not operator in expression!");
 
-    cabor_ast_allocated_node edges[] = { left, right };
-    cabor_ast_allocated_node root_alloc = cabor_allocate_ast_node(op_index, edges, 2, CABOR_NODE_TYPE_BINARY_OP);
+    cabor_ast_node_idx edges[] = { left, right };
+    cabor_ast_node_idx root_alloc = cabor_allocate_ast_node(ast, op, edges, 2, CABOR_NODE_TYPE_BINARY_OP);
 
     return root_alloc;
 }
 
-cabor_ast_allocated_node cabor_parse_binary_expression(cabor_vector* tokens, size_t* cursor, size_t current_precedence_level)
+// Precedence climbing: parses a factor and then every following operator that binds at least as tightly
+// as min_binding_power. The right operand of an operator only takes operators binding tighter than it,
+// which makes equal powers group to the left.
+cabor_ast_node_idx cabor_parse_binary_expression(cabor_ast* ast, cabor_token_stream* stream, size_t min_binding_power)
 {
-    CABOR_ASSERT(*cursor < tokens->size, "cursor overflow");
-    cabor_ast_allocated_node left;
-    if (current_precedence_level == CABOR_LAST_BINARY_PRECEDENCE_LEVEL)
-    {
-        left = cabor_parse_factor(tokens, cursor);
-    }
-    else
-    {
-        left = cabor_parse_binary_expression(tokens, cursor, current_precedence_level + 1);
-    }
+    CABOR_ASSERT(IS_VALID_TOKEN(current(stream)), "cursor overflow");
+    cabor_ast_node_idx left = cabor_parse_factor(ast, stream);
+    RETURN_IF_FAILED(left);
 
-    if (*cursor + 1 >= tokens->size)
-        return left;
+    uint8_t binding_power = binary_binding_power(lookahead(stream));
 
-    // lookahead
-    cabor_token* next_t = cabor_vector_get_token(tokens, *cursor + 1);
-
-    while (is_binary_op_at_current_precedence_level(next_t, current_precedence_level))
+    while (binding_power != 0 && binding_power >= min_binding_power)
     {
-        cabor_token* op = next(tokens, cursor);
-        size_t opi = *cursor;
-
-        next(tokens, cursor);
+        cabor_token op = *next(stream);
 
-        cabor_ast_allocated_node right;
+        if (!next(stream))
+            return SYNTAX_ERROR(NULL, "Expected an expression after %s but the input ended", cabor_token_str(&op));
 
-        if (current_precedence_level == CABOR_LAST_BINARY_PRECEDENCE_LEVEL)
-        {
-            right = cabor_parse_factor(tokens, cursor);
-        }
-        else
-        {
-            right = cabor_parse_binary_expression(tokens, cursor, current_precedence_level + 1);
-        }
+        cabor_ast_node_idx right = cabor_parse_binary_expression(ast, stream, binding_power + 1);
+        RETURN_IF_FAILED(right);
 
-        left = cabor_parse_operator(tokens, opi, left, right);
+        left = cabor_parse_operator(ast, &op, left, right);
 
-        if (*cursor + 1 < tokens->size)
-        {
-            next_t = cabor_vector_get_token(tokens, *cursor + 1);
-        }
-        else
-            break;
+        binding_power = binary_binding_power(lookahead(stream));
     }
 
     return left;
 }
 
-// Parse + - expression
-cabor_ast_allocated_node cabor_parse_expression(cabor_vector* tokens, size_t* cursor)
+// Parse a full expression, every binary operator is allowed
+cabor_ast_node_idx cabor_parse_expression(cabor_ast* ast, cabor_token_stream* stream)
 {
-    CABOR_ASSERT(*cursor < tokens->size, "cursor overflow");
-    return cabor_parse_binary_expression(tokens, cursor, 0);
+    CABOR_ASSERT(IS_VALID_TOKEN(current(stream)), "cursor overflow");
+    return cabor_parse_binary_expression(ast, stream, 0);
 }
 
-cabor_ast_allocated_node cabor_parse_if_then_else_expression(cabor_vector* tokens, size_t* cursor)
+cabor_ast_node_idx cabor_parse_if_then_else_expression(cabor_ast* ast, cabor_token_stream* stream)
 {
-    CABOR_ASSERT(*cursor < tokens->size, "cursor overflow");
-    cabor_token* token = cabor_vector_get_token(tokens, *cursor);
+    cabor_token* token = current(stream);
+    CABOR_ASSERT(IS_VALID_TOKEN(token), "cursor overflow");
     size_t edge_count = 2;
 
-    cabor_ast_allocated_node null_node;
-    null_node.node_mem.mem = NULL;
-
     if (!is_if_token(token))
-    {
-        return null_node;
-    }
+        return SYNTAX_ERROR(token, "Expected 'if' but got %s", TOKEN_TEXT(token));
 
-    const size_t root_token_index = *cursor;
+    cabor_token if_token = *token;
 
-    if (!next(tokens, cursor)) // Parse expression inside if expression
-    {
-        CABOR_LOG_ERR("Not enough tokens to parse if expression!");
-        return null_node;
-    }
+    if (!next(stream)) // Parse expression inside if expression
+        return SYNTAX_ERROR(NULL, "Expected a condition after 'if' but the input ended");
 
-    cabor_ast_allocated_node if_exp = cabor_parse_expression(tokens, cursor);
+    cabor_ast_node_idx if_exp = cabor_parse_expression(ast, stream);
+    RETURN_IF_FAILED(if_exp);
 
-    token = next(tokens, cursor);
+    token = next(stream);
 
     if (!is_then_token(token))
-    {
-        CABOR_LOG_ERR("Expected 'then' after 'while' but got something else");
-        return null_node;
-    }
+        return SYNTAX_ERROR(token, "Expected 'then' after 'if' but got %s", TOKEN_TEXT(token));
 
-    token = next(tokens, cursor); // token after then
+    if (!next(stream)) // token after then
+        return SYNTAX_ERROR(NULL, "Expected an expression after 'then' but the input ended");
 
-    if (!IS_VALID_TOKEN(token)) 
+    cabor_ast_node_idx then_exp = cabor_parse_expression(ast, stream);
+    RETURN_IF_FAILED(then_exp);
+
+    // Check for 'else', it's fine if we don't find it since it's optional. Only peek at the next token so
+    // the one ending the expression is left for the caller when there is no else.
+    cabor_ast_node_idx else_exp;
+    if (is_else_token(lookahead(stream)))
     {
-        // No more tokens after then
-        CABOR_LOG_ERR("Not enough tokens to parse after then expression!");
-        return null_node;
-    }
+        next(stream);
 
-    cabor_ast_allocated_node then_exp = cabor_parse_expression(tokens, cursor);
-    token = next(tokens, cursor);
+        if (!next(stream))
+            return SYNTAX_ERROR(NULL, "Expected an expression after 'else' but the input ended");
 
-    // Check for 'else', it's fine if we don't find it since it's optional
-    cabor_ast_allocated_node else_exp;
-    if (is_else_token(token))
-    {
-        if (next(tokens, cursor))
-        {
-            // Looks like we have more tokens after else;
-            else_exp = cabor_parse_expression(tokens, cursor);
-            ++edge_count;
-        }
+        else_exp = cabor_parse_expression(ast, stream);
+        RETURN_IF_FAILED(else_exp);
+
+        ++edge_count;
     }
 
-    cabor_ast_allocated_node edges[3];
+    cabor_ast_node_idx edges[3];
     edges[0] = if_exp;
     edges[1] = then_exp;
 
     if (edge_count == 3)
         edges[2] = else_exp;
 
-    cabor_ast_allocated_node root = cabor_allocate_ast_node(*cursor, edges, edge_count, CABOR_NODE_TYPE_IF_THEN_ELSE);
-    cabor_access_ast_node(&root)->token_index = root_token_index;
-
-    return root;
+    return cabor_allocate_ast_node(ast, &if_token, edges, edge_count, CABOR_NODE_TYPE_IF_THEN_ELSE);
 }
 
-cabor_ast_allocated_node cabor_parse_while_expression(cabor_vector* tokens, size_t* cursor)
+cabor_ast_node_idx cabor_parse_while_expression(cabor_ast* ast, cabor_token_stream* stream)
 {
-    CABOR_ASSERT(*cursor < tokens->size, "cursor overflow");
-    cabor_token* token = cabor_vector_get_token(tokens, *cursor);
+    cabor_token* token = current(stream);
+    CABOR_ASSERT(IS_VALID_TOKEN(token), "cursor overflow");
 
     if (!is_while_token(token))
-    {
-        CABOR_LOG_ERR_F("Expected 'while' token but got %s", token->data);
-        return NULL_AST;
-    }
+        return SYNTAX_ERROR(token, "Expected 'while' token but got %s", TOKEN_TEXT(token));
+
+    cabor_token while_token = *token;
 
-    size_t while_token_index = *cursor;
-    token = next(tokens, cursor);
+    if (!next(stream))
+        return SYNTAX_ERROR(NULL, "Expected a condition after 'while' but the input ended");
 
     // Parse condition expr
-    cabor_ast_allocated_node condition_expr = cabor_parse_expression(tokens, cursor);
-    token = next(tokens, cursor);
+    cabor_ast_node_idx condition_expr = cabor_parse_expression(ast, stream);
+    RETURN_IF_FAILED(condition_expr);
+
+    token = next(stream);
 
     if (!is_do_token(token))
-    {
-        CABOR_LOG_ERR_F("Expected 'do' after 'while' but got %s", token->data);
-        return NULL_AST;
-    }
-    token = next(tokens, cursor);
+        return SYNTAX_ERROR(token, "Expected 'do' after 'while' but got %s", TOKEN_TEXT(token));
+
+    if (!next(stream))
+        return SYNTAX_ERROR(NULL, "Expected an expression after 'do' but the input ended");
 
-    cabor_ast_allocated_node do_expr = cabor_parse_expression(tokens, cursor);
+    cabor_ast_node_idx do_expr = cabor_parse_expression(ast, stream);
+    RETURN_IF_FAILED(do_expr);
 
-    cabor_ast_allocated_node edges[] = { condition_expr, do_expr };
-    return cabor_allocate_ast_node(while_token_index, edges, 2, CABOR_NODE_TYPE_WHILE);
+    cabor_ast_node_idx edges[] = { condition_expr, do_expr };
+    return cabor_allocate_ast_node(ast, &while_token, edges, 2, CABOR_NODE_TYPE_WHILE);
 }
 
-cabor_ast_allocated_node cabor_parse_var_expression(cabor_vector* tokens, size_t* cursor)
+cabor_ast_node_idx cabor_parse_var_expression(cabor_ast* ast, cabor_token_stream* stream)
 {
-    CABOR_ASSERT(*cursor < tokens->size, "cursor overflow");
-    cabor_token* token = cabor_vector_get_token(tokens, *cursor);
+    cabor_token* token = current(stream);
+    CABOR_ASSERT(IS_VALID_TOKEN(token), "cursor overflow");
     if (!is_var_token(token))
-    {
-        CABOR_LOG_ERR("Expected 'var' token");
-        return NULL_AST;
-    }
+        return SYNTAX_ERROR(token, "Expected 'var' token but got %s", TOKEN_TEXT(token));
 
-    size_t var_token_index = *cursor;
-    token = next(tokens, cursor);
+    cabor_token var_token = *token;
+    token = next(stream);
 
     // Expect variable name
     if (!IS_VALID_TOKEN(token) || token->type != CABOR_IDENTIFIER)
-    {
-        CABOR_LOG_ERR("Expected identifier after 'var'");
-        return NULL_AST;
-    }
+        return SYNTAX_ERROR(token, "Expected identifier after 'var' but got %s", TOKEN_TEXT(token));
 
-    size_t identifier_token_index = *cursor;
+    cabor_token identifier_token = *token;
 
-    token = next(tokens, cursor);
+    token = next(stream);
 
     bool has_type_declaration = false;
-    size_t type_declaration_token_index = 0;
+    cabor_token type_declaration_token;
 
     // If there is : after the identifier it means we have the optional type declaration
-    if (strcmp(token->data, ":") == 0)
+    if (IS_VALID_TOKEN(token) && cabor_token_is(token, CABOR_ATOM_COLON))
     {
-        token = next(tokens, cursor); // this should be the type identifier
+        token = next(stream); // this should be the type identifier
+        if (!IS_VALID_TOKEN(token) || token->type != CABOR_IDENTIFIER)
+            return SYNTAX_ERROR(token, "Expected type after ':' but got %s", TOKEN_TEXT(token));
+
         has_type_declaration = true;
-        type_declaration_token_index = *cursor;
-        token = next(tokens, cursor);
+        type_declaration_token = *token;
+        token = next(stream);
     }
 
     // expect '=' operator
-    if (!IS_VALID_TOKEN(token) || token->type != CABOR_OPERATOR || strcmp(token->data, "=") != 0)
-    {
-        CABOR_LOG_ERR("Expected '=' after variable name");
-        return NULL_AST;
-    }
+    if (!IS_VALID_TOKEN(token) || !cabor_token_is(token, CABOR_ATOM_ASSIGN))
+        return SYNTAX_ERROR(token, "Expected '=' after variable name but got %s", TOKEN_TEXT(token));
 
-    token = next(tokens, cursor);
+    if (!next(stream))
+        return SYNTAX_ERROR(NULL, "Expected an expression after '=' but the input ended");
 
     size_t num_edges = has_type_declaration ? 3 : 2;
 
-    cabor_ast_allocated_node assigned_expr = cabor_parse_expression(tokens, cursor);
-    cabor_ast_allocated_node edges[3] = { cabor_parse_identifier(tokens, identifier_token_index), assigned_expr };
+    cabor_ast_node_idx assigned_expr = cabor_parse_expression(ast, stream);
+    RETURN_IF_FAILED(assigned_expr);
+    cabor_ast_node_idx edges[3] = { cabor_parse_identifier(ast, &identifier_token), assigned_expr };
 
     if (has_type_declaration)
     {
-        edges[2] = cabor_allocate_ast_node(type_declaration_token_index, NULL, 0, CABOR_NODE_TYPE_DECLARATION);
+        edges[2] = cabor_allocate_ast_node(ast, &type_declaration_token, NULL, 0, CABOR_NODE_TYPE_DECLARATION);
     }
 
-    return cabor_allocate_ast_node(var_token_index, edges, num_edges, CABOR_NODE_TYPE_VAR_EXPR);
+    return cabor_allocate_ast_node(ast, &var_token, edges, num_edges, CABOR_NODE_TYPE_VAR_EXPR);
 }
 
-// Parse * / term
-cabor_ast_allocated_node cabor_parse_term(cabor_vector* tokens, size_t* cursor)
+// Same as cabor_parse_expression(), precedence is handled by cabor_parse_binary_expression()
+cabor_ast_node_idx cabor_parse_term(cabor_ast* ast, cabor_token_stream* stream)
 {
-    return cabor_parse_binary_expression(tokens, cursor, 0);
+    return cabor_parse_binary_expression(ast, stream, 0);
 }
 
-cabor_ast_allocated_node cabor_parse_factor(cabor_vector* tokens, size_t* op_index)
+static cabor_ast_node_idx parse_factor(cabor_ast* ast, cabor_token_stream* stream)
 {
-    CABOR_ASSERT(*op_index < tokens->size, "op_index is out of bounds!");
-
-    cabor_token* token = cabor_vector_get_token(tokens, *op_index);
+    cabor_token* token = current(stream);
+    CABOR_ASSERT(IS_VALID_TOKEN(token), "op_index is out of bounds!");
 
     switch (token->type)
     {
     case CABOR_IDENTIFIER:
     {
-        if (*op_index + 1 < tokens->size)
+        cabor_token* next_token = lookahead(stream);
+        if (IS_VALID_TOKEN(next_token) && cabor_token_is(next_token, CABOR_ATOM_LPAREN))
         {
-            cabor_token* next_token = cabor_vector_get_token(tokens, *op_index + 1);
-            if (next_token->type == CABOR_PUNCTUATION && strcmp(next_token->data, "(") == 0)
-            {
-                return cabor_parse_function(tokens, op_index);
-            }
+            return cabor_parse_function(ast, stream);
         }
-        return cabor_parse_identifier(tokens, *op_index);
+        return cabor_parse_identifier(ast, token);
     }
     case CABOR_INTEGER_LITERAL:
     {
-        return cabor_parse_integer_literal(tokens, *op_index);
+        return cabor_parse_integer_literal(ast, token);
     }
     case CABOR_OPERATOR: // parse unary operators '-' and 'not' here
     {
-        if (strcmp(token->data, "-") == 0 || strcmp(token->data, "not") == 0)
+        if (cabor_token_is(token, CABOR_ATOM_MINUS) || cabor_token_is(token, CABOR_ATOM_NOT))
         {
-            return cabor_parse_unary(tokens, op_index);
+            return cabor_parse_unary(ast, stream);
         }
         break;
     }
     case CABOR_PUNCTUATION:
     {
-        if (token->data[0] == '(')
-        {
-            return cabor_parse_parenthesized(tokens, op_index);
-        }
-        else if (token->data[0] == '{')
+        if (cabor_token_is(token, CABOR_ATOM_LPAREN))
         {
-            return cabor_parse_block(tokens, op_index);
+            return cabor_parse_parenthesized(ast, stream);
         }
-        else
+        else if (cabor_token_is(token, CABOR_ATOM_LBRACE))
         {
-            CABOR_RUNTIME_ERROR("Failed to parse factor! punctuation was not (");
+            return cabor_parse_block(ast, stream);
         }
         break;
     }
     case CABOR_KEYWORD:
     {
-        if (strcmp(token->data, "if") == 0)
+        if (cabor_token_is(token, CABOR_ATOM_IF))
         {
-            return cabor_parse_if_then_else_expression(tokens, op_index);
+            return cabor_parse_if_then_else_expression(ast, stream);
         }
-        else if (strcmp(token->data, "while") == 0)
+        else if (cabor_token_is(token, CABOR_ATOM_WHILE))
         {
-            return cabor_parse_while_expression(tokens, op_index);
+            return cabor_parse_while_expression(ast, stream);
         }
-        else if (strcmp(token->data, "var") == 0)
+        else if (cabor_token_is(token, CABOR_ATOM_VAR))
         {
-            return cabor_parse_var_expression(tokens, op_index);
+            return cabor_parse_var_expression(ast, stream);
         }
         break;
     }
     default:
-        CABOR_RUNTIME_ERROR("Failed to parse factor!");
+        break;
     }
+
+    return SYNTAX_ERROR(token, "Unexpected %s", TOKEN_TEXT(token));
 }
 
-cabor_ast_allocated_node cabor_parse_function(cabor_vector* tokens, size_t* cursor)
+// Every nested construct goes through here, so this is where the nesting limit is enforced
+cabor_ast_node_idx cabor_parse_factor(cabor_ast* ast, cabor_token_stream* stream)
 {
-    cabor_token* token = cabor_vector_get_token(tokens, *cursor);
+    // depth is the number of constructs around this factor
+    if (ast->depth > ast->max_depth)
+    {
+        report(ast, current(stream), "Expression is nested deeper than %zu levels", ast->max_depth);
+        return CABOR_AST_NODE_INVALID;
+    }
+
+    ast->depth++;
+    cabor_ast_node_idx node = parse_factor(ast, stream);
+    ast->depth--;
+
+    return node;
+}
+
+cabor_ast_node_idx cabor_parse_function(cabor_ast* ast, cabor_token_stream* stream)
+{
+    cabor_token* token = current(stream);
 
     // First token should be the function name
     CABOR_ASSERT(token->type == CABOR_IDENTIFIER, "First token in function parser wasn't identifier");
 
-    size_t function_name_token_idx = *cursor;
+    cabor_token function_name_token = *token;
 
-    token = next(tokens, cursor); // second token should be (
+    token = next(stream); // second token should be (
     CABOR_ASSERT(token->type == CABOR_PUNCTUATION, "Second token in function parser wasn't punctuation");
 
     // Now parse argument list, call expression parser for each arg
-    token = next(tokens, cursor);
+    token = next(stream);
 
-    cabor_ast_allocated_node args[CABOR_FUNCTION_PARSER_MAX_ARGS];
-    size_t argCount = 0;
-    bool valid = false;
+    size_t first_pending = ast->pending_edges->size;
 
-    while (IS_VALID_TOKEN(token))
+    while (!is_rparen_token(token))
     {
-        if (token->data[0] == ')')
+        if (!IS_VALID_TOKEN(token))
         {
-            valid = true;
-            break;
+            ast->pending_edges->size = first_pending;
+            return SYNTAX_ERROR(NULL, "Expected ) to close the call to %s but the input ended", cabor_token_str(&function_name_token));
         }
 
-        args[argCount++] = cabor_parse_expression(tokens, cursor);
-
-        bool found_comma = false;
-        while (IS_VALID_TOKEN(token)) // we allow expressions inside arg list so each arg can be multiple tokens long
+        cabor_ast_node_idx arg = cabor_parse_expression(ast, stream);
+        if (!IS_VALID_NODE(arg) || ast->panic)
         {
-            if (token->data[0] == ',')
-            {
-                found_comma = true;
-                break;
-            }
-
-            if (token->data[0] == ')')
-            {
-                valid = true;
-                break;
-            }
-
-            token = next(tokens, cursor);
+            ast->pending_edges->size = first_pending;
+            return arg;
         }
 
-        if (!valid && !found_comma)
-        {
-            CABOR_LOG_ERR("Expected , in function parser but ran out of tokens");
+        cabor_vector_append_u32(ast->pending_edges, &arg);
+        token = next(stream); // token after the argument
+
+        if (is_rparen_token(token))
             break;
-        }
 
-        if (token->data[0] == ')')
+        if (!IS_VALID_TOKEN(token) || !cabor_token_is(token, CABOR_ATOM_COMMA))
         {
-            break;
+            ast->pending_edges->size = first_pending;
+            return SYNTAX_ERROR(token, "Expected , or ) after argument of %s but got %s", cabor_token_str(&function_name_token), TOKEN_TEXT(token));
         }
 
-        token = next(tokens, cursor);
+        token = next(stream);
     }
 
-    if (!valid)
-    {
-        CABOR_LOG_ERR("Failed to parse function");
-        return cabor_allocate_ast_node(0, NULL, 0, CABOR_NODE_TYPE_UNKNOWN);
-    }
+    return allocate_node_with_pending_edges(ast, &function_name_token, first_pending, CABOR_NODE_TYPE_FUNCTION_CALL);
+}
+
+cabor_ast_node_idx cabor_allocate_ast_node(cabor_ast* ast, const cabor_token* token, cabor_ast_node_idx* edges, size_t num_edges, cabor_ast_node_type type)
+{
+    cabor_ast_node_idx node = (cabor_ast_node_idx)cabor_get_ast_node_count(ast);
+
+    uint8_t node_type = (uint8_t)type;
+    uint8_t unchecked = (uint8_t)CABOR_TYPE_ERROR;
+    uint32_t first_edge = (uint32_t)ast->edges->size;
+    uint32_t edge_count = edges != NULL ? (uint32_t)num_edges : 0;
 
-    cabor_ast_allocated_node* edges = argCount > 0 ? args : NULL;
-    cabor_ast_allocated_node function_root = cabor_allocate_ast_node(function_name_token_idx, edges, argCount, CABOR_NODE_TYPE_FUNCTION_CALL);
+    // Edges are copied to the end of the shared edge array so they stay contiguous
+    for (uint32_t i = 0; i < edge_count; i++)
+        cabor_vector_append_u32(ast->edges, &edges[i]);
 
-    return function_root;
+    cabor_vector_append_u8(ast->node_types, &node_type);
+    cabor_vector_append_u8(ast->types, &unchecked);
+    cabor_vector_append_token(ast->tokens, token);
+    cabor_vector_append_u32(ast->first_edges, &first_edge);
+    cabor_vector_append_u32(ast->num_edges, &edge_count);
+
+    return node;
 }
 
-cabor_ast_allocated_node cabor_allocate_ast_node(size_t token_index, cabor_ast_allocated_node* edges, size_t num_edges, cabor_ast_node_type type)
+typedef struct
 {
-    cabor_ast_allocated_node allocated_node =
-    {
-        .node_mem = CABOR_MALLOC(sizeof(cabor_ast_node))
-    };
+    cabor_ast_node_idx node;
+    uint32_t next_edge;
+} cabor_ast_frame;
+
+CABOR_VECTOR_DEFINE_ACCESSORS(ast_frame, cabor_ast_frame)
+
+// The ast is a tree so every node is reached exactly once, no visited set is needed
+bool cabor_ast_visit_preorder(const cabor_ast* ast, cabor_ast_node_idx root, cabor_ast_visitor visitor, void* user_data)
+{
+    cabor_vector* stack = cabor_create_vector_with_stride(CABOR_AST_TRAVERSAL_STACK_CAPACITY, sizeof(cabor_ast_node_idx), false);
+    cabor_vector_append_u32(stack, &root);
 
-    cabor_ast_node* node = cabor_access_ast_node(&allocated_node);
+    bool completed = true;
 
-    node->node_type = type;
-    node->token_index = token_index;
-    
-    if (edges != NULL && num_edges > 0)
+    while (stack->size > 0)
     {
-        // Copy edges to the freshly allocated node
-        for (size_t i = 0; i < num_edges; i++)
+        cabor_ast_node_idx node = *cabor_vector_at_u32(stack, stack->size - 1);
+        stack->size--;
+
+        cabor_ast_visit_result result = visitor(ast, node, user_data);
+        if (result == CABOR_AST_VISIT_STOP)
         {
-            node->edges[i] = edges[i];
-        };
+            completed = false;
+            break;
+        }
 
-        node->num_edges = num_edges;
-    }
-    else
-    {
-        node->num_edges = 0;
+        if (result == CABOR_AST_VISIT_SKIP_CHILDREN)
+            continue;
+
+        // Pushed left to right so the right-most child is popped first
+        size_t num_edges = cabor_ast_num_edges(ast, node);
+        for (size_t i = 0; i < num_edges; i++)
+        {
+            cabor_ast_node_idx edge = cabor_ast_edge(ast, node, i);
+            cabor_vector_append_u32(stack, &edge);
+        }
     }
 
-    node->type = CABOR_TYPE_ERROR;
-    return allocated_node;
-}
+    cabor_destroy_vector(stack);
 
-static bool is_visited(cabor_vector* nodes, cabor_ast_node* node)
-{
-    for (size_t i = 0; i < nodes->size; i++)
-    {
-        if (cabor_vector_get_ptr(nodes, i) == node)
-            return true;
-    }
-    return false;
+    return completed;
 }
 
-// Get ast tree as list of nodes, note we store node pointers in the list,
-// the list does not own the memory for the tree.
-cabor_vector* cabor_get_ast_node_list_al(cabor_ast_allocated_node* root)
+bool cabor_ast_visit_postorder(const cabor_ast* ast, cabor_ast_node_idx root, cabor_ast_visitor visitor, void* user_data)
 {
-    // Implement DFS
+    cabor_vector* stack = cabor_create_vector_with_stride(CABOR_AST_TRAVERSAL_STACK_CAPACITY, sizeof(cabor_ast_frame), false);
+    cabor_ast_frame root_frame = { .node = root, .next_edge = 0 };
+    cabor_vector_append_ast_frame(stack, &root_frame);
 
-    size_t stack_capacity = 100;
-    cabor_stack* stack = cabor_create_stack(stack_capacity);
+    bool completed = true;
 
-    cabor_vector* nodes = cabor_create_vector(100, CABOR_PTR, true);
-    cabor_ast_node* root_node = cabor_access_ast_node(root);
+    while (stack->size > 0)
+    {
+        cabor_ast_frame* top = cabor_vector_at_ast_frame(stack, stack->size - 1);
 
-    cabor_stack_push(stack, root_node);
+        if (top->next_edge < cabor_ast_num_edges(ast, top->node))
+        {
+            // top is invalidated by the append below
+            cabor_ast_frame child = { .node = cabor_ast_edge(ast, top->node, top->next_edge++), .next_edge = 0 };
+            cabor_vector_append_ast_frame(stack, &child);
+            continue;
+        }
 
-    while (true)
-    {
-        cabor_ast_node* node;
-        if (!cabor_stack_pop(stack, (void**)&node))
-            break; // stack is empty
+        stack->size--;
 
-        if (!is_visited(nodes, node))
+        // SKIP_CHILDREN means nothing here, the children have already been visited
+        if (visitor(ast, top->node, user_data) == CABOR_AST_VISIT_STOP)
         {
-            cabor_vector_push_ptr(nodes, node);
-
-            // Add neighbours to stack
-            if (node)
-            {
-                for (size_t i = 0; i < node->num_edges; i++)
-                {
-                    cabor_ast_node* neighbour = cabor_access_ast_node(&node->edges[i]);
-                    cabor_stack_push(stack, (void*)neighbour);
-                }
-            }
+            completed = false;
+            break;
         }
     }
 
-    cabor_destroy_stack(stack);
+    cabor_destroy_vector(stack);
+
+    return completed;
+}
+
+static cabor_ast_visit_result append_node_to_list(const cabor_ast* ast, cabor_ast_node_idx node, void* user_data)
+{
+    cabor_vector_append_u32((cabor_vector*)user_data, &node);
+    return CABOR_AST_VISIT_CONTINUE;
+}
 
+cabor_vector* cabor_get_ast_node_list(const cabor_ast* ast, cabor_ast_node_idx root)
+{
+    cabor_vector* nodes = cabor_create_vector_with_stride(CABOR_AST_TRAVERSAL_STACK_CAPACITY, sizeof(cabor_ast_node_idx), false);
+    cabor_ast_visit_preorder(ast, root, append_node_to_list, nodes);
     return nodes;
 }
 
-cabor_vector* cabor_get_ast_node_list(cabor_ast_node* root)
+cabor_vector* cabor_get_ast_node_list_postorder(const cabor_ast* ast, cabor_ast_node_idx root)
 {
-    cabor_ast_allocated_node an =
-    {
-        .node_mem.mem = root,
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-        .node_mem.size = sizeof(cabor_ast_node),
-#endif
-    };
-    return cabor_get_ast_node_list_al(&an);
+    cabor_vector* nodes = cabor_create_vector_with_stride(CABOR_AST_TRAVERSAL_STACK_CAPACITY, sizeof(cabor_ast_node_idx), false);
+    cabor_ast_visit_postorder(ast, root, append_node_to_list, nodes);
+    return nodes;
 }
 
-void cabor_ast_node_to_string_al(cabor_vector* tokens, cabor_ast_allocated_node* allocated_node, char* buffer, size_t size, bool typecheck)
+void cabor_ast_node_to_string(const cabor_ast* ast, cabor_ast_node_idx node, char* buffer, size_t size, bool typecheck)
 {
-    cabor_ast_node* node = cabor_access_ast_node(allocated_node);
-    cabor_token* token = cabor_vector_get_token(tokens, node->token_index);
+    cabor_token* token = cabor_access_ast_token(ast, node);
+    size_t num_edges = cabor_ast_num_edges(ast, node);
     size_t cursor = 0;
-    cursor += snprintf(buffer, size, "root: %s, edges: [", token->data);
+    char text[CABOR_TOKEN_TEXT_SIZE];
+    cursor += snprintf(buffer, size, "root: %s, edges: [", cabor_token_text(token, text, sizeof(text)));
 
-    for (size_t i = 0; i < node->num_edges; i++)
+    for (size_t i = 0; i < num_edges; i++)
     {
-        cabor_ast_node* neighbour = cabor_access_ast_node(&node->edges[i]);
-        cabor_token* neighbour_token = cabor_vector_get_token(tokens, neighbour->token_index);
-        if (i != node->num_edges - 1)
-            cursor += snprintf(buffer + cursor, size - cursor, "'%s', ", neighbour_token->data);
+        cabor_token* neighbour_token = cabor_access_ast_token_edge(ast, node, i);
+        if (i != num_edges - 1)
+            cursor += snprintf(buffer + cursor, size - cursor, "'%s', ", cabor_token_text(neighbour_token, text, sizeof(text)));
         else
-            cursor += snprintf(buffer + cursor, size - cursor, "'%s'", neighbour_token->data);
+            cursor += snprintf(buffer + cursor, size - cursor, "'%s'", cabor_token_text(neighbour_token, text, sizeof(text)));
     }
 
     CABOR_ASSERT(cursor + 1 < size, "out of bounds!");
@@ -828,59 +980,10 @@ void cabor_ast_node_to_string_al(cabor_vector* tokens, cabor_ast_allocated_node*
     {
         ++cursor;
         buffer[cursor++] = ',';
-        const char* type_string = cabor_type_to_str(node->type);
+        const char* type_string = cabor_type_to_str(cabor_ast_type_of(ast, node));
         cursor += snprintf(buffer + cursor, size - cursor, " type: '%s'", type_string);
         CABOR_ASSERT(cursor + 1 < size, "out of bounds!");
     }
 
     buffer[cursor + 1] = '\0';
 }
-
-void cabor_ast_node_to_string(cabor_vector* tokens, cabor_ast_node* node, char* buffer, size_t size, bool typecheck)
-{
-    cabor_ast_allocated_node an =
-    {
-        .node_mem.mem = node,
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-        .node_mem.size = sizeof(cabor_ast_node),
-#endif
-    };
-    return cabor_ast_node_to_string_al(tokens, &an, buffer, size, typecheck);
-}
-
-// Free only the current node and don't care about freeing any edges
-void cabor_free_ast_node(cabor_ast_allocated_node* node)
-{
-    CABOR_FREE(&node->node_mem);
-}
-
-// Free the whole tree
-void cabor_free_ast(cabor_ast_allocated_node* root)
-{
-    cabor_vector* nodes = cabor_get_ast_node_list_al(root);
-
-    for (size_t i = 0; i < nodes->size; i++)
-    {
-        cabor_ast_node* node = cabor_vector_get_ptr(nodes, i);
-        cabor_allocation allocation =
-        {
-            .mem = node,
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-            .size = sizeof(cabor_ast_node)
-#endif
-        };
-
-        cabor_ast_allocated_node allocated_node =
-        {
-            .node_mem = allocation
-        };
-
-        cabor_free_ast_node(&allocated_node);
-    }
-    cabor_destroy_vector(nodes);
-}
-
-cabor_ast_node* cabor_access_ast_node(cabor_ast_allocated_node* node)
-{
-    return (cabor_ast_node*)node->node_mem.mem;
-}
@@ -1,11 +1,11 @@
 #pragma once
 
 #include "../language/tokenizer.h"
+#include "../language/token_stream.h"
 #include "../core/vector.h"
 #include "../cabor_defines.h"
 #include <stddef.h>
-
-#define CABOR_AST_NODE_MAX_EDGES 10
+#include <stdint.h>
 
 typedef enum
 {
@@ -20,6 +20,7 @@ typedef enum
     CABOR_NODE_TYPE_WHILE,
     CABOR_NODE_TYPE_VAR_EXPR,
     CABOR_NODE_TYPE_DECLARATION,
+    CABOR_NODE_TYPE_ERROR,       // stands in for a construct that failed to parse, see cabor_ast::diagnostics
     CABOR_NODE_TYPE_UNKNOWN
 } cabor_ast_node_type;
 
@@ -33,68 +34,150 @@ typedef enum
     CABOR_NUM_TYPES
 } cabor_type;
 
-// same as cabor_ast_node but allocated from heap
-typedef struct cabor_ast_allocated_node
-{
-    // Where we store cabor_ast_node
-    cabor_allocation node_mem;
-} cabor_ast_allocated_node;
+typedef uint32_t cabor_ast_node_idx;
 
-typedef struct cabor_ast_node
-{
-    size_t token_index; // index into tokens vector
-    struct cabor_ast_allocated_node edges[CABOR_AST_NODE_MAX_EDGES];
-    size_t num_edges;
-    cabor_ast_node_type node_type;
-    cabor_type type;
-} cabor_ast_node;
+#define CABOR_AST_NODE_INVALID UINT32_MAX
+
+// Deepest nesting of parentheses, blocks, unary operators, if, while and var the parser accepts. The parser
+// recurses a few small frames per level and keeps the children of blocks and calls on the heap, so this
+// bounds the stack a parse needs. Chains like a + b + c are parsed in a loop and don't count.
+#define CABOR_PARSER_DEFAULT_MAX_DEPTH 2048
 
+#define CABOR_DIAGNOSTIC_MESSAGE_SIZE 128
+
+// An error found in the source. The parser keeps going after a syntax error, so a program can have
+// many of these and they are handed to the caller together instead of stopping at the first one.
+typedef struct
+{
+    cabor_source_location location; // line 0 when the error is at the end of the input or lines aren't known
+    char message[CABOR_DIAGNOSTIC_MESSAGE_SIZE];
+} cabor_diagnostic;
+
+CABOR_VECTOR_DEFINE_ACCESSORS(diagnostic, cabor_diagnostic)
+
+// The tree is stored in flat arrays indexed by cabor_ast_node_idx, one array per node field so a pass
+// only touches the fields it reads. The edges of a node are a contiguous range of the shared edges
+// array. Nodes are appended after their edges have been parsed so children always have smaller
+// indices than their parent. Nothing is freed per node, destroying the ast releases the arrays.
+// Each node keeps a copy of its token so the ast doesn't depend on the token stream it was parsed from,
+// synthetic tokens like the unit of a block ending in ;} only exist here.
 typedef struct cabor_ast
 {
-    cabor_ast_allocated_node* root;
-    cabor_vector* tokens;
+    cabor_vector* node_types;    // uint8_t, cabor_ast_node_type
+    cabor_vector* types;         // uint8_t, cabor_type, filled in by the type checker
+    cabor_vector* tokens;        // cabor_token
+    cabor_vector* first_edges;   // uint32_t, index into edges
+    cabor_vector* num_edges;     // uint32_t
+    cabor_vector* edges;         // cabor_ast_node_idx, shared by all nodes
+    cabor_line_table* lines;     // NULL when the ast was parsed from tokens without line information
+    cabor_vector* diagnostics;   // cabor_diagnostic, every syntax error in source order
+    cabor_ast_node_idx root;
+
+    // Parser state
+    cabor_vector* pending_edges; // cabor_ast_node_idx, children of the blocks and calls still being parsed
+    size_t depth;                // nesting depth of the expression being parsed
+    size_t max_depth;            // deeper expressions fail to parse, CABOR_PARSER_DEFAULT_MAX_DEPTH by default
+    bool panic;                  // a syntax error was found and the enclosing block hasn't skipped past it yet
 } cabor_ast;
 
 const char* cabor_type_to_str(cabor_type type);
 
-// Main entrypoint to the parser
-// remarks: Ast doesn't store tokens in the tree but references tokens instead so
-// tokens array must be kept alive for whole lifetime of the ast
+// Syntax errors don't stop the parser. Each one is added to ast->diagnostics and replaced by a
+// CABOR_NODE_TYPE_ERROR node, then the enclosing block skips to the next ';' or '}' and carries on
+// with the statement after it. The top level is parsed like the inside of a block without the braces. The tree can only be compiled when diagnostics is empty.
+// Nesting deeper than the limit is the one error the parser gives up on, root is then CABOR_AST_NODE_INVALID.
+
+// Main entrypoint to the parser, parses already tokenized input
 cabor_ast* cabor_parse(cabor_vector* tokens);
+
+// Tokenizes and parses in one pass, tokens are produced as the parser asks for them and
+// only a small window of them is alive at a time
+cabor_ast* cabor_parse_source(const char* source, size_t size);
+
+// Same as above with a different nesting limit, root is CABOR_AST_NODE_INVALID if the input goes deeper
+cabor_ast* cabor_parse_source_with_max_depth(const char* source, size_t size, size_t max_depth);
+
+// Empty ast, the cabor_parse_* functions below append nodes to it
+cabor_ast* cabor_create_ast();
 void cabor_destroy_ast(cabor_ast* ast);
 
-// Access token stored inside ast node
+size_t cabor_get_ast_node_count(const cabor_ast* ast);
 
-cabor_token* cabor_access_ast_token(const cabor_ast* ast, const cabor_ast_node* node);
-cabor_token* cabor_access_ast_token_edge(const cabor_ast* ast, const cabor_ast_allocated_node* node, int edge_index);
-
-cabor_ast_allocated_node cabor_parse_block(cabor_vector* tokens, size_t* cursor);
-cabor_ast_allocated_node cabor_parse_unary(cabor_vector* tokens, size_t* cursor);
-cabor_ast_allocated_node cabor_parse_identifier(cabor_vector* tokens, size_t op_index);
-cabor_ast_allocated_node cabor_parse_integer_literal(cabor_vector* tokens, size_t op_index);
-cabor_ast_allocated_node cabor_parse_parenthesized(cabor_vector* tokens, size_t* op_index);
-cabor_ast_allocated_node cabor_parse_operator(cabor_vector* tokens, size_t op_index, cabor_ast_allocated_node left, cabor_ast_allocated_node right);
-cabor_ast_allocated_node cabor_parse_binary_expression(cabor_vector* tokens, size_t* cursor, size_t current_precedence_level);
-cabor_ast_allocated_node cabor_parse_expression(cabor_vector* tokens, size_t* cursor);
-cabor_ast_allocated_node cabor_parse_if_then_else_expression(cabor_vector* tokens, size_t* cursor);
-cabor_ast_allocated_node cabor_parse_while_expression(cabor_vector* tokens, size_t* cursor);
-cabor_ast_allocated_node cabor_parse_var_expression(cabor_vector* tokens, size_t* cursor);
-cabor_ast_allocated_node cabor_parse_term(cabor_vector* tokens, size_t* cursor);
-cabor_ast_allocated_node cabor_parse_factor(cabor_vector* tokens, size_t* op_index);
-cabor_ast_allocated_node cabor_parse_function(cabor_vector* tokens, size_t* cursor);
-cabor_ast_allocated_node cabor_allocate_ast_node(size_t token_index, cabor_ast_allocated_node* edges, size_t num_edges, cabor_ast_node_type type);
-
-cabor_vector* cabor_get_ast_node_list_al(cabor_ast_allocated_node* root);
-cabor_vector* cabor_get_ast_node_list(cabor_ast_node* root);
+static inline cabor_ast_node_type cabor_ast_node_type_of(const cabor_ast* ast, cabor_ast_node_idx node)
+{
+    return (cabor_ast_node_type)*cabor_vector_at_u8(ast->node_types, node);
+}
 
-// Prints the root token and neighbors
-void cabor_ast_node_to_string_al(cabor_vector* tokens, cabor_ast_allocated_node* allocated_node, char* buffer, size_t size, bool typecheck);
-void cabor_ast_node_to_string(cabor_vector* tokens, cabor_ast_node* node, char* buffer, size_t size, bool typecheck);
+static inline cabor_type cabor_ast_type_of(const cabor_ast* ast, cabor_ast_node_idx node)
+{
+    return (cabor_type)*cabor_vector_at_u8(ast->types, node);
+}
 
-void cabor_free_ast_node(cabor_ast_allocated_node* node);
-void cabor_free_ast(cabor_ast_allocated_node* root);
+static inline void cabor_ast_set_type(cabor_ast* ast, cabor_ast_node_idx node, cabor_type type)
+{
+    *cabor_vector_at_u8(ast->types, node) = (uint8_t)type;
+}
+
+static inline size_t cabor_ast_num_edges(const cabor_ast* ast, cabor_ast_node_idx node)
+{
+    return *cabor_vector_at_u32(ast->num_edges, node);
+}
+
+static inline cabor_ast_node_idx cabor_ast_edge(const cabor_ast* ast, cabor_ast_node_idx node, size_t edge_index)
+{
+    CABOR_ASSERT(edge_index < cabor_ast_num_edges(ast, node), "ast node edge overflow");
+    return *cabor_vector_at_u32(ast->edges, *cabor_vector_at_u32(ast->first_edges, node) + edge_index);
+}
+
+// "line:column" of the token for diagnostics, or a placeholder when it isn't known. Token can be NULL
+// when the input ran out.
+const char* cabor_ast_location_str(const cabor_ast* ast, const cabor_token* token, char* buffer, size_t size);
+
+// Records an error at token, NULL when the input ran out, and logs it
+void cabor_ast_add_diagnostic(cabor_ast* ast, const cabor_token* token, const char* message);
 
-// "unwraps" allocated node into cabor_ast_node
-cabor_ast_node* cabor_access_ast_node(cabor_ast_allocated_node* node);
+// Access token stored inside ast node
+cabor_token* cabor_access_ast_token(const cabor_ast* ast, cabor_ast_node_idx node);
+cabor_token* cabor_access_ast_token_edge(const cabor_ast* ast, cabor_ast_node_idx node, size_t edge_index);
+
+// Each parse function starts at the current token of the stream and leaves the last token it
+// consumed as the current one
+cabor_ast_node_idx cabor_parse_block(cabor_ast* ast, cabor_token_stream* stream);
+cabor_ast_node_idx cabor_parse_unary(cabor_ast* ast, cabor_token_stream* stream);
+cabor_ast_node_idx cabor_parse_identifier(cabor_ast* ast, const cabor_token* token);
+cabor_ast_node_idx cabor_parse_integer_literal(cabor_ast* ast, const cabor_token* token);
+cabor_ast_node_idx cabor_parse_parenthesized(cabor_ast* ast, cabor_token_stream* stream);
+cabor_ast_node_idx cabor_parse_operator(cabor_ast* ast, const cabor_token* op, cabor_ast_node_idx left, cabor_ast_node_idx right);
+cabor_ast_node_idx cabor_parse_binary_expression(cabor_ast* ast, cabor_token_stream* stream, size_t min_binding_power);
+cabor_ast_node_idx cabor_parse_expression(cabor_ast* ast, cabor_token_stream* stream);
+cabor_ast_node_idx cabor_parse_if_then_else_expression(cabor_ast* ast, cabor_token_stream* stream);
+cabor_ast_node_idx cabor_parse_while_expression(cabor_ast* ast, cabor_token_stream* stream);
+cabor_ast_node_idx cabor_parse_var_expression(cabor_ast* ast, cabor_token_stream* stream);
+cabor_ast_node_idx cabor_parse_term(cabor_ast* ast, cabor_token_stream* stream);
+cabor_ast_node_idx cabor_parse_factor(cabor_ast* ast, cabor_token_stream* stream);
+cabor_ast_node_idx cabor_parse_function(cabor_ast* ast, cabor_token_stream* stream);
+cabor_ast_node_idx cabor_allocate_ast_node(cabor_ast* ast, const cabor_token* token, cabor_ast_node_idx* edges, size_t num_edges, cabor_ast_node_type type);
+
+typedef enum
+{
+    CABOR_AST_VISIT_CONTINUE,
+    CABOR_AST_VISIT_SKIP_CHILDREN, // pre-order only
+    CABOR_AST_VISIT_STOP
+} cabor_ast_visit_result;
 
+typedef cabor_ast_visit_result (*cabor_ast_visitor)(const cabor_ast* ast, cabor_ast_node_idx node, void* user_data);
 
+// Iterative walks over the subtree of root, each node is visited once using an explicit stack so
+// deep trees don't recurse. Both return false if the visitor stopped the walk early.
+//
+// Pre-order visits a node before its children, right-most child first.
+// Post-order visits a node after its children, left-most child first.
+bool cabor_ast_visit_preorder(const cabor_ast* ast, cabor_ast_node_idx root, cabor_ast_visitor visitor, void* user_data);
+bool cabor_ast_visit_postorder(const cabor_ast* ast, cabor_ast_node_idx root, cabor_ast_visitor visitor, void* user_data);
+
+// Node indices of the subtree in pre-order / post-order
+cabor_vector* cabor_get_ast_node_list(const cabor_ast* ast, cabor_ast_node_idx root);
+cabor_vector* cabor_get_ast_node_list_postorder(const cabor_ast* ast, cabor_ast_node_idx root);
+
+// Prints the root token and neighbors
+void cabor_ast_node_to_string(const cabor_ast* ast, cabor_ast_node_idx node, char* buffer, size_t size, bool typecheck);
@@ -0,0 +1,359 @@
+#include "scan.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CABOR_SCAN_X86
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CABOR_SCAN_TARGET(isa)
+#else
+// Lets the vector versions be compiled without enabling AVX2 for the whole build
+#define CABOR_SCAN_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+static bool is_whitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool is_identifier(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || is_digit(c) || c == '_';
+}
+
+// Scalar versions, also used for the tail that is too short for a full vector
+
+static size_t skip_whitespace_scalar(const char* buffer, size_t cursor, size_t size)
+{
+    while (cursor < size && is_whitespace(buffer[cursor]))
+        cursor++;
+    return cursor;
+}
+
+static size_t skip_identifier_scalar(const char* buffer, size_t cursor, size_t size)
+{
+    while (cursor < size && is_identifier(buffer[cursor]))
+        cursor++;
+    return cursor;
+}
+
+static size_t skip_digits_scalar(const char* buffer, size_t cursor, size_t size)
+{
+    while (cursor < size && is_digit(buffer[cursor]))
+        cursor++;
+    return cursor;
+}
+
+static size_t find_line_end_scalar(const char* buffer, size_t cursor, size_t size)
+{
+    if (cursor >= size)
+        return size;
+
+    const char* newline = memchr(buffer + cursor, '\n', size - cursor);
+    return newline ? (size_t)(newline - buffer) : size;
+}
+
+static size_t find_block_comment_end_scalar(const char* buffer, size_t cursor, size_t size)
+{
+    for (; cursor + 1 < size; cursor++)
+    {
+        if (buffer[cursor] == '*' && buffer[cursor + 1] == '/')
+            return cursor;
+    }
+    return size;
+}
+
+static const cabor_scanner g_scalar_scanner =
+{
+    .skip_whitespace = skip_whitespace_scalar,
+    .skip_identifier = skip_identifier_scalar,
+    .skip_digits = skip_digits_scalar,
+    .find_line_end = find_line_end_scalar,
+    .find_block_comment_end = find_block_comment_end_scalar,
+};
+
+#ifdef CABOR_SCAN_X86
+
+static unsigned first_set_bit(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+// The vector versions build a mask of the bytes that are part of the run and stop at the first zero bit.
+// Range checks use signed compares so bytes >= 0x80 never match.
+
+// SSE2, 16 bytes per step
+
+static CABOR_SCAN_TARGET("sse2") __m128i whitespace_mask_sse2(__m128i v)
+{
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+    __m128i newline = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    return _mm_or_si128(space, newline);
+}
+
+static CABOR_SCAN_TARGET("sse2") __m128i digit_mask_sse2(__m128i v)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+}
+
+static CABOR_SCAN_TARGET("sse2") __m128i identifier_mask_sse2(__m128i v)
+{
+    // Setting bit 5 folds A-Z onto a-z
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), lower));
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(letter, underscore), digit_mask_sse2(v));
+}
+
+static CABOR_SCAN_TARGET("sse2") size_t skip_whitespace_sse2(const char* buffer, size_t cursor, size_t size)
+{
+    for (; cursor + 16 <= size; cursor += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buffer + cursor));
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(whitespace_mask_sse2(v)) & 0xFFFF;
+        if (stop)
+            return cursor + first_set_bit(stop);
+    }
+    return skip_whitespace_scalar(buffer, cursor, size);
+}
+
+static CABOR_SCAN_TARGET("sse2") size_t skip_identifier_sse2(const char* buffer, size_t cursor, size_t size)
+{
+    for (; cursor + 16 <= size; cursor += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buffer + cursor));
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(identifier_mask_sse2(v)) & 0xFFFF;
+        if (stop)
+            return cursor + first_set_bit(stop);
+    }
+    return skip_identifier_scalar(buffer, cursor, size);
+}
+
+static CABOR_SCAN_TARGET("sse2") size_t skip_digits_sse2(const char* buffer, size_t cursor, size_t size)
+{
+    for (; cursor + 16 <= size; cursor += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buffer + cursor));
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(digit_mask_sse2(v)) & 0xFFFF;
+        if (stop)
+            return cursor + first_set_bit(stop);
+    }
+    return skip_digits_scalar(buffer, cursor, size);
+}
+
+static CABOR_SCAN_TARGET("sse2") size_t find_line_end_sse2(const char* buffer, size_t cursor, size_t size)
+{
+    for (; cursor + 16 <= size; cursor += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buffer + cursor));
+        uint32_t found = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        if (found)
+            return cursor + first_set_bit(found);
+    }
+    return find_line_end_scalar(buffer, cursor, size);
+}
+
+static CABOR_SCAN_TARGET("sse2") size_t find_block_comment_end_sse2(const char* buffer, size_t cursor, size_t size)
+{
+    // The second load is shifted by one so each lane compares a '*' with the byte after it
+    for (; cursor + 17 <= size; cursor += 16)
+    {
+        __m128i star = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buffer + cursor)), _mm_set1_epi8('*'));
+        __m128i slash = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buffer + cursor + 1)), _mm_set1_epi8('/'));
+        uint32_t found = (uint32_t)_mm_movemask_epi8(_mm_and_si128(star, slash));
+        if (found)
+            return cursor + first_set_bit(found);
+    }
+    return find_block_comment_end_scalar(buffer, cursor, size);
+}
+
+static const cabor_scanner g_sse2_scanner =
+{
+    .skip_whitespace = skip_whitespace_sse2,
+    .skip_identifier = skip_identifier_sse2,
+    .skip_digits = skip_digits_sse2,
+    .find_line_end = find_line_end_sse2,
+    .find_block_comment_end = find_block_comment_end_sse2,
+};
+
+// AVX2, 32 bytes per step, same masks as above
+
+static CABOR_SCAN_TARGET("avx2") __m256i whitespace_mask_avx2(__m256i v)
+{
+    __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+    __m256i newline = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+    return _mm256_or_si256(space, newline);
+}
+
+static CABOR_SCAN_TARGET("avx2") __m256i digit_mask_avx2(__m256i v)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+}
+
+static CABOR_SCAN_TARGET("avx2") __m256i identifier_mask_avx2(__m256i v)
+{
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_or_si256(_mm256_or_si256(letter, underscore), digit_mask_avx2(v));
+}
+
+static CABOR_SCAN_TARGET("avx2") size_t skip_whitespace_avx2(const char* buffer, size_t cursor, size_t size)
+{
+    for (; cursor + 32 <= size; cursor += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buffer + cursor));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(whitespace_mask_avx2(v));
+        if (stop)
+            return cursor + first_set_bit(stop);
+    }
+    return skip_whitespace_sse2(buffer, cursor, size);
+}
+
+static CABOR_SCAN_TARGET("avx2") size_t skip_identifier_avx2(const char* buffer, size_t cursor, size_t size)
+{
+    for (; cursor + 32 <= size; cursor += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buffer + cursor));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(identifier_mask_avx2(v));
+        if (stop)
+            return cursor + first_set_bit(stop);
+    }
+    return skip_identifier_sse2(buffer, cursor, size);
+}
+
+static CABOR_SCAN_TARGET("avx2") size_t skip_digits_avx2(const char* buffer, size_t cursor, size_t size)
+{
+    for (; cursor + 32 <= size; cursor += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buffer + cursor));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(digit_mask_avx2(v));
+        if (stop)
+            return cursor + first_set_bit(stop);
+    }
+    return skip_digits_sse2(buffer, cursor, size);
+}
+
+static CABOR_SCAN_TARGET("avx2") size_t find_line_end_avx2(const char* buffer, size_t cursor, size_t size)
+{
+    for (; cursor + 32 <= size; cursor += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buffer + cursor));
+        uint32_t found = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        if (found)
+            return cursor + first_set_bit(found);
+    }
+    return find_line_end_sse2(buffer, cursor, size);
+}
+
+static CABOR_SCAN_TARGET("avx2") size_t find_block_comment_end_avx2(const char* buffer, size_t cursor, size_t size)
+{
+    for (; cursor + 33 <= size; cursor += 32)
+    {
+        __m256i star = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buffer + cursor)), _mm256_set1_epi8('*'));
+        __m256i slash = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buffer + cursor + 1)), _mm256_set1_epi8('/'));
+        uint32_t found = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(star, slash));
+        if (found)
+            return cursor + first_set_bit(found);
+    }
+    return find_block_comment_end_sse2(buffer, cursor, size);
+}
+
+static const cabor_scanner g_avx2_scanner =
+{
+    .skip_whitespace = skip_whitespace_avx2,
+    .skip_identifier = skip_identifier_avx2,
+    .skip_digits = skip_digits_avx2,
+    .find_line_end = find_line_end_avx2,
+    .find_block_comment_end = find_block_comment_end_avx2,
+};
+
+#if defined(_MSC_VER)
+static bool cpu_supports_avx2()
+{
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // The os has to save the ymm registers too, not only the cpu support them
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+#endif
+
+#endif // CABOR_SCAN_X86
+
+cabor_scan_level cabor_detect_scan_level()
+{
+#if defined(CABOR_SCAN_X86) && defined(_MSC_VER)
+    // SSE2 is part of the msvc x86 baseline
+    return cpu_supports_avx2() ? CABOR_SCAN_AVX2 : CABOR_SCAN_SSE2;
+#elif defined(CABOR_SCAN_X86)
+    if (__builtin_cpu_supports("avx2"))
+        return CABOR_SCAN_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return CABOR_SCAN_SSE2;
+    return CABOR_SCAN_SCALAR;
+#else
+    return CABOR_SCAN_SCALAR;
+#endif
+}
+
+const cabor_scanner* cabor_get_scanner(cabor_scan_level level)
+{
+    if (level > cabor_detect_scan_level())
+        return NULL;
+
+    switch (level)
+    {
+    case CABOR_SCAN_SCALAR:
+        return &g_scalar_scanner;
+#ifdef CABOR_SCAN_X86
+    case CABOR_SCAN_SSE2:
+        return &g_sse2_scanner;
+    case CABOR_SCAN_AVX2:
+        return &g_avx2_scanner;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+const char* cabor_scan_level_to_str(cabor_scan_level level)
+{
+    switch (level)
+    {
+    case CABOR_SCAN_SCALAR:
+        return "scalar";
+    case CABOR_SCAN_SSE2:
+        return "sse2";
+    case CABOR_SCAN_AVX2:
+        return "avx2";
+    default:
+        return "unknown";
+    }
+}
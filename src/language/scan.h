@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+
+// Byte run scanners used by the tokenizer. Each one looks at buffer[cursor, size) and returns the index
+// of the first byte that ends the run, or size if the run reaches the end of the buffer.
+//
+// There is a scalar version of every scanner and, on x86, SSE2 (16 bytes per step) and AVX2 (32 bytes
+// per step) versions. All levels return the same results, the tokenizer picks the best one the cpu
+// supports at runtime.
+
+typedef enum
+{
+    CABOR_SCAN_SCALAR,
+    CABOR_SCAN_SSE2,
+    CABOR_SCAN_AVX2,
+    CABOR_SCAN_NUM_LEVELS
+} cabor_scan_level;
+
+typedef size_t (*cabor_scan_func)(const char* buffer, size_t cursor, size_t size);
+
+typedef struct
+{
+    cabor_scan_func skip_whitespace;        // ' ', '\t', '\n', '\r'
+    cabor_scan_func skip_identifier;        // A-Z, a-z, 0-9, _
+    cabor_scan_func skip_digits;            // 0-9
+    cabor_scan_func find_line_end;          // index of the next '\n'
+    cabor_scan_func find_block_comment_end; // index of the '*' of the next "*/"
+} cabor_scanner;
+
+// Best level the cpu and the build support
+cabor_scan_level cabor_detect_scan_level();
+
+// NULL if the build or the cpu doesn't support the level
+const cabor_scanner* cabor_get_scanner(cabor_scan_level level);
+
+const char* cabor_scan_level_to_str(cabor_scan_level level);
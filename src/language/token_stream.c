@@ -0,0 +1,155 @@
+#include "token_stream.h"
+
+#include "../core/memory.h"
+#include "../debug/cabor_debug.h"
+
+#include <string.h>
+
+#define RING_MASK (CABOR_TOKEN_STREAM_RING_SIZE - 1)
+
+static cabor_token* ring_at(cabor_token_stream* stream, size_t index)
+{
+    return (cabor_token*)stream->ring.mem + (index & RING_MASK);
+}
+
+// Tokenizes the next slice of the source into staging, false once the source has run out
+static bool tokenize_slice(cabor_token_stream* stream)
+{
+    cabor_vector* staging = stream->staging;
+    staging->size = 0;
+    stream->staging_cursor = 0;
+
+    // A slice can end in the middle of the only token it has, keep going until one is finished
+    while (staging->size == 0 && stream->tokenizer)
+    {
+        size_t remaining = stream->source_size - stream->source_cursor;
+        if (remaining == 0)
+        {
+            // Flush the last token and don't tokenize anything after this
+            cabor_tokenizer_finish(stream->tokenizer, staging);
+            cabor_destroy_tokenizer(stream->tokenizer);
+            stream->tokenizer = NULL;
+            break;
+        }
+
+        size_t slice = remaining < CABOR_TOKEN_STREAM_SLICE_SIZE ? remaining : CABOR_TOKEN_STREAM_SLICE_SIZE;
+        cabor_tokenizer_feed(stream->tokenizer, stream->source + stream->source_cursor, slice, staging);
+        stream->source_cursor += slice;
+    }
+
+    return staging->size > 0;
+}
+
+// Moves as many staged tokens into the ring as fit without overwriting the current token or anything
+// after it, tokenizing the next slice when staging is empty
+static bool refill(cabor_token_stream* stream)
+{
+    if (stream->tokens)
+        return false;
+
+    if (stream->staging_cursor == stream->staging->size && !tokenize_slice(stream))
+        return false;
+
+    size_t buffered = stream->end - stream->position;
+    size_t free_slots = CABOR_TOKEN_STREAM_RING_SIZE - buffered;
+    CABOR_ASSERT(free_slots > 0, "token stream ring is full");
+
+    size_t staged = stream->staging->size - stream->staging_cursor;
+    size_t count = staged < free_slots ? staged : free_slots;
+
+    for (size_t i = 0; i < count; i++)
+        *ring_at(stream, stream->end++) = *cabor_vector_at_token(stream->staging, stream->staging_cursor++);
+
+    return count > 0;
+}
+
+cabor_token_stream* cabor_create_token_stream(const char* source, size_t size)
+{
+    CABOR_NEW(cabor_token_stream, stream);
+    memset(stream, 0, sizeof(cabor_token_stream));
+    stream->source = source;
+    stream->source_size = size;
+    stream->lines = cabor_create_line_table();
+
+    if (size >= CABOR_TOKENIZER_PARALLEL_MIN_SIZE)
+    {
+        // Splitting the source between threads needs all of it at once, so large programs aren't streamed
+        cabor_file file = { .filename = NULL, .size = size, .file_memory = { .mem = (void*)source }, .mapped = false };
+        stream->tokens = cabor_tokenize_with_lines(&file, stream->lines);
+        stream->owns_tokens = true;
+        return stream;
+    }
+
+    stream->ring = CABOR_MALLOC(CABOR_TOKEN_STREAM_RING_SIZE * sizeof(cabor_token));
+    stream->tokenizer = cabor_create_tokenizer();
+    stream->tokenizer->lines = stream->lines;
+    stream->staging = cabor_create_vector(CABOR_TOKENIZER_VECTOR_DEFAULT_CAPACITY, CABOR_TOKEN, false);
+    return stream;
+}
+
+cabor_token_stream* cabor_create_token_stream_from_vector(cabor_vector* tokens)
+{
+    CABOR_NEW(cabor_token_stream, stream);
+    memset(stream, 0, sizeof(cabor_token_stream));
+    stream->tokens = tokens;
+    return stream;
+}
+
+void cabor_destroy_token_stream(cabor_token_stream* stream)
+{
+    if (stream->tokenizer)
+        cabor_destroy_tokenizer(stream->tokenizer);
+
+    if (stream->staging)
+        cabor_destroy_vector(stream->staging);
+
+    if (stream->owns_tokens)
+        cabor_destroy_vector(stream->tokens);
+
+    if (stream->ring.mem)
+        CABOR_FREE(&stream->ring);
+
+    if (stream->lines)
+        cabor_destroy_line_table(stream->lines);
+
+    CABOR_DELETE(cabor_token_stream, stream);
+}
+
+cabor_token* cabor_token_stream_peek(cabor_token_stream* stream, size_t k)
+{
+    CABOR_ASSERT(k <= CABOR_TOKEN_STREAM_MAX_LOOKAHEAD, "token stream lookahead is too far");
+
+    size_t index = stream->position + k;
+
+    if (stream->tokens)
+        return index < stream->tokens->size ? cabor_vector_at_token(stream->tokens, index) : NULL;
+
+    while (index >= stream->end)
+    {
+        if (!refill(stream))
+            return NULL;
+    }
+
+    return ring_at(stream, index);
+}
+
+cabor_token* cabor_token_stream_next(cabor_token_stream* stream)
+{
+    if (!cabor_token_stream_peek(stream, 1))
+        return NULL;
+
+    stream->position++;
+    return cabor_token_stream_peek(stream, 0);
+}
+
+size_t cabor_token_stream_position(const cabor_token_stream* stream)
+{
+    return stream->position;
+}
+
+cabor_line_table* cabor_token_stream_release_lines(cabor_token_stream* stream)
+{
+    cabor_line_table* lines = stream->lines;
+    stream->lines = NULL;
+    return lines;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "tokenizer.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define CABOR_TOKEN_STREAM_RING_SIZE 256          // tokens, power of two
+#define CABOR_TOKEN_STREAM_MAX_LOOKAHEAD 16
+#define CABOR_TOKEN_STREAM_SLICE_SIZE (16 * 1024) // bytes of source tokenized at a time
+
+// Pull based token source for the parser. Tokens are produced on demand, either by tokenizing the source
+// a slice at a time or by reading an already tokenized vector. The tokens of a slice are handed to the
+// parser through a small ring buffer, so memory doesn't grow with the program size while the tokenizer
+// still gets slices long enough for its vector scanners.
+//
+// A returned pointer stays valid while its token is the current one or ahead of it. Once next() has
+// moved past a token the following peek or next can overwrite it, copy tokens that have to live longer.
+typedef struct
+{
+    // Ring buffer, token with stream index i lives in ring[i % CABOR_TOKEN_STREAM_RING_SIZE]
+    cabor_allocation ring;
+    size_t position;             // stream index of the current token
+    size_t end;                  // one past the last token in the ring
+
+    cabor_tokenizer* tokenizer;  // NULL when reading from a vector or the whole source has been tokenized
+    cabor_vector* staging;       // tokens finished by the last slice
+    size_t staging_cursor;       // first token in staging that hasn't been moved to the ring yet
+    const char* source;
+    size_t source_size;
+    size_t source_cursor;        // first byte that hasn't been tokenized yet
+
+    cabor_vector* tokens;        // set when the tokens were tokenized beforehand
+    bool owns_tokens;            // tokens were tokenized by the stream and are destroyed with it
+    cabor_line_table* lines;     // lines seen so far when tokenizing the source, owned by the stream
+} cabor_token_stream;
+
+// source has to stay alive until the stream is destroyed. Sources of at least CABOR_TOKENIZER_PARALLEL_MIN_SIZE
+// bytes are tokenized up front with cabor_tokenize() so the worker pool can split them, the stream then
+// holds every token of the program instead of a window.
+cabor_token_stream* cabor_create_token_stream(const char* source, size_t size);
+
+// Reads already tokenized input, tokens has to outlive the stream
+cabor_token_stream* cabor_create_token_stream_from_vector(cabor_vector* tokens);
+
+void cabor_destroy_token_stream(cabor_token_stream* stream);
+
+// k tokens ahead of the current one, peek(0) is the current token. NULL past the end of the input.
+cabor_token* cabor_token_stream_peek(cabor_token_stream* stream, size_t k);
+
+// Moves to the next token and returns it. At the last token returns NULL and stays where it is.
+cabor_token* cabor_token_stream_next(cabor_token_stream* stream);
+
+// Number of tokens before the current one
+size_t cabor_token_stream_position(const cabor_token_stream* stream);
+
+// Takes the line table from the stream, the caller destroys it. NULL for streams over a token vector.
+// Lines keep being recorded into it as long as the stream is tokenizing.
+cabor_line_table* cabor_token_stream_release_lines(cabor_token_stream* stream);
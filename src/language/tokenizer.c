@@ -2,453 +2,654 @@
 
 #include "../logging/logging.h"
 #include "../debug/cabor_debug.h"
+#include "../core/intern.h"
+#include "../core/worker_pool.h"
 
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
 
-static const char* cabor_keywords[] = { "if", "then", "else", "while", "return", "for", "do", "var"};
-static const size_t cabor_keyword_count = sizeof(cabor_keywords) / sizeof(cabor_keywords[0]);
+// Every byte is looked up once in g_char_class and the class of the first byte decides which token is
+// scanned, each scan loop only consumes bytes of its own class. Bytes that aren't listed are 0 and
+// don't start any token.
+#define CHAR_SPACE       (1 << 0)
+#define CHAR_IDENT_START (1 << 1) // A-Z, a-z, _
+#define CHAR_DIGIT       (1 << 2)
+#define CHAR_OPERATOR    (1 << 3)
+#define CHAR_PUNCTUATION (1 << 4)
+#define CHAR_IDENT       (CHAR_IDENT_START | CHAR_DIGIT)
+
+#define S CHAR_SPACE
+#define L CHAR_IDENT_START
+#define D CHAR_DIGIT
+#define O CHAR_OPERATOR
+#define P CHAR_PUNCTUATION
+
+static const uint8_t g_char_class[256] =
+{
+//  0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, S, S, 0, 0, S, 0, 0, // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+    S, O, 0, 0, 0, O, 0, 0, P, P, O, O, P, O, 0, O, // 0x20  !%()*+,-/
+    D, D, D, D, D, D, D, D, D, D, P, P, O, O, O, 0, // 0x30  0-9 :;<=>
+    0, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L, // 0x40  A-O
+    L, L, L, L, L, L, L, L, L, L, L, 0, 0, 0, 0, L, // 0x50  P-Z _
+    0, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L, // 0x60  a-o
+    L, L, L, L, L, L, L, L, L, L, L, P, 0, P, 0, 0, // 0x70  p-z { }
+};
+
+#undef S
+#undef L
+#undef D
+#undef O
+#undef P
+
+// Single byte operators and punctuation map straight to their builtin atom, the rest ('!') are interned
+static const cabor_atom g_char_atom[256] =
+{
+    ['('] = CABOR_ATOM_LPAREN,
+    [')'] = CABOR_ATOM_RPAREN,
+    ['{'] = CABOR_ATOM_LBRACE,
+    ['}'] = CABOR_ATOM_RBRACE,
+    [','] = CABOR_ATOM_COMMA,
+    [';'] = CABOR_ATOM_SEMICOLON,
+    [':'] = CABOR_ATOM_COLON,
+    ['='] = CABOR_ATOM_ASSIGN,
+    ['<'] = CABOR_ATOM_LT,
+    ['>'] = CABOR_ATOM_GT,
+    ['+'] = CABOR_ATOM_PLUS,
+    ['-'] = CABOR_ATOM_MINUS,
+    ['*'] = CABOR_ATOM_MULTIPLY,
+    ['/'] = CABOR_ATOM_DIVIDE,
+    ['%'] = CABOR_ATOM_REMAINDER,
+};
+
+// Two byte operators are one of these followed by '='
+static const cabor_atom g_char_eq_atom[256] =
+{
+    ['='] = CABOR_ATOM_EQ,
+    ['!'] = CABOR_ATOM_NE,
+    ['<'] = CABOR_ATOM_LE,
+    ['>'] = CABOR_ATOM_GE,
+};
+
+// Identifiers that are keywords or word operators. KEYWORD_HASH has no collisions for this set,
+// so an identifier is a reserved word only if the single entry it hashes to matches.
+#define KEYWORD_TABLE_SIZE 16
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 6
+#define KEYWORD_HASH(str, length) (((uint8_t)(str)[0] + 2 * (uint8_t)(str)[1] + 2 * (length)) & (KEYWORD_TABLE_SIZE - 1))
+
+typedef struct
+{
+    cabor_atom atom;
+    uint8_t type; // cabor_token_type
+} cabor_keyword_entry;
 
-static bool check_for_ignored_characters(const char c)
+static const cabor_keyword_entry g_keywords[KEYWORD_TABLE_SIZE] =
+{
+    [1]  = { CABOR_ATOM_WHILE,  CABOR_KEYWORD },
+    [2]  = { CABOR_ATOM_NOT,    CABOR_OPERATOR },
+    [3]  = { CABOR_ATOM_AND,    CABOR_OPERATOR },
+    [5]  = { CABOR_ATOM_ELSE,   CABOR_KEYWORD },
+    [6]  = { CABOR_ATOM_DO,     CABOR_KEYWORD },
+    [7]  = { CABOR_ATOM_OR,     CABOR_OPERATOR },
+    [8]  = { CABOR_ATOM_RETURN, CABOR_KEYWORD },
+    [9]  = { CABOR_ATOM_IF,     CABOR_KEYWORD },
+    [10] = { CABOR_ATOM_FOR,    CABOR_KEYWORD },
+    [12] = { CABOR_ATOM_THEN,   CABOR_KEYWORD },
+    [14] = { CABOR_ATOM_VAR,    CABOR_KEYWORD },
+};
+
+static const cabor_keyword_entry* find_keyword(const char* str, size_t length)
 {
-    return (c == '\n' || c == ' ' || c == '\r');
+    if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH)
+        return NULL;
+
+    const cabor_keyword_entry* entry = &g_keywords[KEYWORD_HASH(str, length)];
+    if (entry->atom == CABOR_ATOM_INVALID || cabor_atom_length(entry->atom) != length)
+        return NULL;
+
+    return memcmp(cabor_atom_str(entry->atom), str, length) == 0 ? entry : NULL;
 }
 
-static void copy_to_out_token(size_t cursor, size_t size, size_t token_cursor, char* temp_token, cabor_token* out_token, cabor_token_type type)
+// Tokens point back to their span in the source, the text itself is interned
+static cabor_token make_token(size_t offset, size_t length, cabor_token_type type, cabor_atom atom)
 {
-    // The token cursor that gets passed here is past the last character in the token so technically it is the size
-    if (token_cursor < CABOR_TOKENIZER_MAX_TOKEN_LENGTH)
+    if (offset + length >= CABOR_TOKEN_NO_SOURCE)
     {
-        // Copy results to out_token and add null terminator
-        CABOR_ASSERT(token_cursor < CABOR_TOKENIZER_MAX_TOKEN_LENGTH, "Max token length exceeded!");
-        memcpy(out_token->data, temp_token, token_cursor);
-        out_token->type = type;
-        out_token->data[token_cursor] = '\0';
+        CABOR_RUNTIME_ERROR("source is too large, token offsets are 32-bit");
     }
-    else
+
+    cabor_token token =
     {
-        CABOR_LOG_ERR_F("Token size was %d when max size is %d", token_cursor + 1, CABOR_TOKENIZER_MAX_TOKEN_LENGTH);
-        CABOR_RUNTIME_ERROR("token is larger than CABOR_TOKENIZER_MAX_TOKEN_LENGTH!");
-    }
+        .atom = atom,
+        .offset = (uint32_t)offset,
+        .length = (uint32_t)length,
+        .type = (uint8_t)type
+    };
+    return token;
 }
 
-static size_t match_comment(const char* buffer, size_t cursor, size_t size)
+static void append_token(cabor_vector* tokens, size_t offset, size_t length, cabor_token_type type, cabor_atom atom)
 {
-    char c = buffer[cursor];
+    cabor_token token = make_token(offset, length, type, atom);
+    cabor_vector_append_token(tokens, &token);
+}
 
-    // No space left so there cant be comment
-    if (size - cursor < 2)
-        return cursor;
+// Keywords and word operators (and, or, not) are identifiers until they are looked up
+static void append_word(cabor_vector* tokens, const char* text, size_t length, size_t offset)
+{
+    const cabor_keyword_entry* keyword = find_keyword(text, length);
+    if (keyword)
+        append_token(tokens, offset, length, keyword->type, keyword->atom);
+    else
+        append_token(tokens, offset, length, CABOR_IDENTIFIER, cabor_intern_with_size(text, length));
+}
 
-    // Line comment, find new line and return cursor to the next character after that
-    if (c == '/' && buffer[cursor + 1] == '/')
+// Text is only digits, the scanner made sure of that
+static void parse_integer(cabor_token* token, const char* text, size_t length)
+{
+    int64_t value = 0;
+    for (size_t i = 0; i < length; i++)
     {
-        for (size_t i = cursor + 2; i < size; i++)
+        int64_t digit = text[i] - '0';
+        if (value > (INT64_MAX - digit) / 10)
         {
-            // next character
-            char nc = buffer[i];
-            if (nc == '\n')
-            {
-                return i + 1;
-            }
+            token->flags |= CABOR_TOKEN_FLAG_OVERFLOW;
+            value = INT64_MAX;
+            break;
         }
-        CABOR_LOG_WARN("No new line found after line comment");
-        return cursor;
+        value = value * 10 + digit;
+    }
+
+    token->value = value;
+}
+
+// The literal's text stays in the source, only its value is kept
+static void append_integer(cabor_vector* tokens, const char* text, size_t length, size_t offset)
+{
+    cabor_token token = make_token(offset, length, CABOR_INTEGER_LITERAL, CABOR_ATOM_INVALID);
+    parse_integer(&token, text, length);
+    cabor_vector_append_token(tokens, &token);
+}
+
+// Operator byte c followed by next, which is '\0' at the end of the input. Opens a comment or appends
+// an operator token and returns how many bytes of the two were used.
+static size_t lex_operator(cabor_tokenizer* tokenizer, uint8_t c, uint8_t next, size_t offset, cabor_vector* tokens)
+{
+    if (c == '/' && next == '/')
+    {
+        tokenizer->state = CABOR_TOKENIZER_LINE_COMMENT;
+        return 2;
     }
 
-    // Block comment, find ending token and return character after that
-    if (c == '/' && buffer[cursor + 1] == '*')
+    if (c == '/' && next == '*')
     {
-        for (size_t i = cursor + 2; i < size; i++)
-        {
-            // next character
-            char nc = buffer[i];
-            
-            // Not enough characters left raise error
-            if (size - i < 2)
-            {
-                CABOR_LOG_WARN("Not enough characters to close block comment!");
-                return cursor;
-            }
-        
-            // next next character
-            char nnc = buffer[i + 1];
-            if (nc == '*' && nnc == '/')
-            {
-                return i + 2;
-            }
-        }
-        CABOR_LOG_WARN("No closing token found for block comment!");
+        tokenizer->state = CABOR_TOKENIZER_BLOCK_COMMENT;
+        tokenizer->block_comment_star = false;
+        return 2;
+    }
+
+    if (next == '=' && g_char_eq_atom[c] != CABOR_ATOM_INVALID)
+    {
+        append_token(tokens, offset, 2, CABOR_OPERATOR, g_char_eq_atom[c]);
+        return 2;
+    }
+
+    cabor_atom atom = g_char_atom[c] != CABOR_ATOM_INVALID ? g_char_atom[c] : cabor_intern_with_size((const char*)&c, 1);
+    append_token(tokens, offset, 1, CABOR_OPERATOR, atom);
+    return 1;
+}
+
+static void append_pending(cabor_tokenizer* tokenizer, const char* bytes, size_t size)
+{
+    cabor_vector* pending = tokenizer->pending;
+    cabor_vector_reserve(pending, pending->size + size);
+    memcpy((char*)pending->vector_mem.mem + pending->size, bytes, size);
+    pending->size += size;
+}
+
+// Finishes the token that was cut by the end of the previous chunk and returns where the chunk
+// continues, size if the token goes on into the next chunk as well
+static size_t resume_pending(cabor_tokenizer* tokenizer, const char* chunk, size_t size, cabor_vector* tokens)
+{
+    cabor_vector* pending = tokenizer->pending;
+    const char* text = pending->vector_mem.mem;
+    uint8_t first_class = g_char_class[(uint8_t)text[0]];
+
+    if (first_class & CHAR_OPERATOR)
+    {
+        // Only single operator bytes are carried over
+        size_t used = lex_operator(tokenizer, (uint8_t)text[0], (uint8_t)chunk[0], tokenizer->pending_offset, tokens);
+        pending->size = 0;
+        return used - 1;
     }
 
-    return cursor;
+    cabor_scan_func scan = first_class & CHAR_DIGIT ? tokenizer->scanner->skip_digits : tokenizer->scanner->skip_identifier;
+    size_t end = scan(chunk, 0, size);
+    append_pending(tokenizer, chunk, end);
+
+    if (end == size)
+        return size;
+
+    text = pending->vector_mem.mem;
+    if (first_class & CHAR_DIGIT)
+        append_integer(tokens, text, pending->size, tokenizer->pending_offset);
+    else
+        append_word(tokens, text, pending->size, tokenizer->pending_offset);
+
+    pending->size = 0;
+    return end;
 }
 
-static size_t match_punctuation(const char* buffer, size_t cursor, size_t size, cabor_token* out_token)
+// New lines in chunk[begin, end), whitespace runs are short so this is a plain loop
+static void record_newlines(cabor_tokenizer* tokenizer, const char* chunk, size_t begin, size_t end)
 {
-    char c = buffer[cursor];
+    for (size_t i = begin; i < end; i++)
+    {
+        if (chunk[i] == '\n')
+            cabor_line_table_add_newline(tokenizer->lines, tokenizer->stream_offset + i);
+    }
+}
 
-    if (c == '(' || c == ')' || c == '{' || c == '}' || c == ',' || c == ';' || c == ':')
+// New lines inside a block comment, the comments can be long so this uses the scanner
+static void record_comment_newlines(cabor_tokenizer* tokenizer, const char* chunk, size_t begin, size_t end)
+{
+    size_t cursor = tokenizer->scanner->find_line_end(chunk, begin, end);
+    while (cursor < end)
     {
-        out_token->data[0] = c;
-        out_token->type = CABOR_PUNCTUATION;
-        return cursor + 1;
+        cabor_line_table_add_newline(tokenizer->lines, tokenizer->stream_offset + cursor);
+        cursor = tokenizer->scanner->find_line_end(chunk, cursor + 1, end);
     }
+}
+
+cabor_tokenizer* cabor_create_tokenizer()
+{
+    CABOR_NEW(cabor_tokenizer, tokenizer);
+    tokenizer->state = CABOR_TOKENIZER_DEFAULT;
+    tokenizer->block_comment_star = false;
+    tokenizer->pending = cabor_create_vector(CABOR_TOKENIZER_PENDING_DEFAULT_CAPACITY, CABOR_UCHAR, false);
+    tokenizer->pending_offset = 0;
+    tokenizer->stream_offset = 0;
+    tokenizer->scanner = cabor_get_scanner(cabor_detect_scan_level());
+    tokenizer->lines = NULL;
+    return tokenizer;
+}
 
-    return cursor;
+void cabor_destroy_tokenizer(cabor_tokenizer* tokenizer)
+{
+    cabor_destroy_vector(tokenizer->pending);
+    CABOR_DELETE(cabor_tokenizer, tokenizer);
 }
 
-static size_t match_operator(const char* buffer, size_t cursor, size_t size, cabor_token* out_token)
+size_t cabor_tokenizer_feed(cabor_tokenizer* tokenizer, const char* chunk, size_t size, cabor_vector* tokens)
 {
-    char token[CABOR_TOKENIZER_MAX_TOKEN_LENGTH] = {0};
-    size_t token_cursor = 0;
+    const cabor_scanner* scanner = tokenizer->scanner;
+    size_t first_token = tokens->size;
+    size_t base = tokenizer->stream_offset;
 
-    size_t i = cursor;
+    size_t cursor = 0;
 
-    bool or_matched = false;
-    bool and_mateched = false;
-    bool not_matched = false;
+    if (size > 0 && tokenizer->pending->size > 0)
+        cursor = resume_pending(tokenizer, chunk, size, tokens);
 
     while (cursor < size)
     {
-        char c = buffer[cursor];
-        bool is_char_valid = false;
-
-        // Double character operator matched, e.g !=, <=, >=
-        bool dc_matched = false;
+        if (tokenizer->state == CABOR_TOKENIZER_LINE_COMMENT)
+        {
+            // A comment on the last line doesn't need a new line
+            size_t line_end = scanner->find_line_end(chunk, cursor, size);
+            if (line_end == size)
+                break;
 
-        char prev_c = '\0';
+            if (tokenizer->lines)
+                cabor_line_table_add_newline(tokenizer->lines, base + line_end);
 
-        // Check for double character operators
-        if (prev_c == '=' && c == '=')
-        {
-            dc_matched = true;
-        }
-        else if (prev_c == '!' && c == '=')
-        {
-            dc_matched = true;
+            tokenizer->state = CABOR_TOKENIZER_DEFAULT;
+            cursor = line_end + 1;
+            continue;
         }
-        else if (prev_c == '<' && c == '=')
+
+        if (tokenizer->state == CABOR_TOKENIZER_BLOCK_COMMENT)
         {
-            dc_matched = true;
-        }
+            // The '*' of the closing "*/" was the last byte of the previous chunk
+            if (tokenizer->block_comment_star && chunk[cursor] == '/')
+            {
+                tokenizer->state = CABOR_TOKENIZER_DEFAULT;
+                cursor++;
+                continue;
+            }
 
-        // Not the nicest way to handle this but since character 'o' and 'a' can be
-        // part of identifiers or operators we need to be extra careful when matching these.
+            size_t comment_end = scanner->find_block_comment_end(chunk, cursor, size);
 
-        if (c == 'o' && cursor + 1 < size)
-        {
-            char second = buffer[cursor + 1];
-            if (second == 'r')
+            if (tokenizer->lines)
+                record_comment_newlines(tokenizer, chunk, cursor, comment_end);
+
+            if (comment_end == size)
             {
-                token[token_cursor++] = c;
-                token[token_cursor++] = second;
-                or_matched = true;
-                is_char_valid = true;
-                ++cursor;
+                tokenizer->block_comment_star = chunk[size - 1] == '*';
+                break;
             }
+
+            tokenizer->state = CABOR_TOKENIZER_DEFAULT;
+            cursor = comment_end + 2;
+            continue;
         }
 
-        if (c == 'a' && cursor + 2 < size)
+        size_t start = cursor;
+        uint8_t c = (uint8_t)chunk[cursor];
+        uint8_t char_class = g_char_class[c];
+
+        if (char_class & CHAR_SPACE)
+        {
+            // Most runs are a single space, only call the scanner for longer ones
+            cursor++;
+            if (cursor < size && (g_char_class[(uint8_t)chunk[cursor]] & CHAR_SPACE))
+                cursor = scanner->skip_whitespace(chunk, cursor, size);
+
+            if (tokenizer->lines)
+                record_newlines(tokenizer, chunk, start, cursor);
+        }
+        else if (char_class & (CHAR_IDENT_START | CHAR_DIGIT))
         {
-            char second = buffer[cursor + 1];
-            char third = buffer[cursor + 2];
-            if (second == 'n' && third == 'd')
+            bool is_integer = (char_class & CHAR_DIGIT) != 0;
+            cursor = is_integer ? scanner->skip_digits(chunk, cursor + 1, size) : scanner->skip_identifier(chunk, cursor + 1, size);
+
+            // The next chunk may continue this token
+            if (cursor == size)
             {
-                token[token_cursor++] = c;
-                token[token_cursor++] = second;
-                token[token_cursor++] = third;
-                and_mateched = true;
-                is_char_valid = true;
-                cursor += 2;
+                append_pending(tokenizer, chunk + start, size - start);
+                tokenizer->pending_offset = base + start;
+                break;
             }
-        }
 
-        if (c == 'n' && cursor + 2 < size)
+            if (is_integer)
+                append_integer(tokens, chunk + start, cursor - start, base + start);
+            else
+                append_word(tokens, chunk + start, cursor - start, base + start);
+        }
+        else if (char_class & CHAR_OPERATOR)
         {
-            char second = buffer[cursor + 1];
-            char third = buffer[cursor + 2];
-            if (second == 'o' && third == 't')
+            // Without the next byte we can't tell "/" from "//" or "<" from "<="
+            if (cursor + 1 == size)
             {
-                token[token_cursor++] = c;
-                token[token_cursor++] = second;
-                token[token_cursor++] = third;
-                not_matched = true;
-                is_char_valid = true;
-                cursor += 2;
+                append_pending(tokenizer, chunk + start, 1);
+                tokenizer->pending_offset = base + start;
+                break;
             }
-        }
 
-        if (dc_matched)
+            cursor += lex_operator(tokenizer, c, (uint8_t)chunk[cursor + 1], base + start, tokens);
+        }
+        else if (char_class & CHAR_PUNCTUATION)
         {
-            token[token_cursor++] = c;
-            is_char_valid = true;
+            append_token(tokens, base + start, 1, CABOR_PUNCTUATION, g_char_atom[c]);
             cursor++;
-            break;
         }
-
-        // Match single character operators
-        if (prev_c == '\0' && (c == '+' || c == '-' || c == '*' || c == '/' || c == '=' || c == '<' || c == '>' || c == '!' || c == '%'))
+        else
         {
-            token[token_cursor++] = c;
-            is_char_valid = true;
-            prev_c = c;
+            CABOR_LOG_WARN_F("Tokenizer encountered character that did not match to anything, the character: %c", c);
+            cursor++; // skip over the unmatched character
         }
+    }
 
-        if (!is_char_valid)
-            break;
+    tokenizer->stream_offset += size;
 
-        cursor++;
-    }
+    return tokens->size - first_token;
+}
 
-    // if these were or/and we need to make sure we got exactly 2 or 3 characters
-    // if not these are identifiers and not operators
+size_t cabor_tokenizer_finish(cabor_tokenizer* tokenizer, cabor_vector* tokens)
+{
+    size_t first_token = tokens->size;
+    cabor_vector* pending = tokenizer->pending;
 
-    if (or_matched && token_cursor != 2)
+    if (pending->size > 0)
     {
-        return cursor;
-    }
+        const char* text = pending->vector_mem.mem;
+        uint8_t first_class = g_char_class[(uint8_t)text[0]];
 
-    if (and_mateched && token_cursor != 3)
-    {
-        return cursor;
-    }
+        if (first_class & CHAR_OPERATOR)
+            lex_operator(tokenizer, (uint8_t)text[0], '\0', tokenizer->pending_offset, tokens);
+        else if (first_class & CHAR_DIGIT)
+            append_integer(tokens, text, pending->size, tokenizer->pending_offset);
+        else
+            append_word(tokens, text, pending->size, tokenizer->pending_offset);
 
-    if (not_matched && token_cursor != 3)
-    {
-        return cursor;
+        pending->size = 0;
     }
 
-    if (token_cursor == 0)
-        return cursor;
-
-    copy_to_out_token(cursor, size, token_cursor, token, out_token, CABOR_OPERATOR);
+    if (tokenizer->state == CABOR_TOKENIZER_BLOCK_COMMENT)
+        CABOR_LOG_WARN("No closing token found for block comment!");
 
-    return cursor;
+    tokenizer->state = CABOR_TOKENIZER_DEFAULT;
 
+    return tokens->size - first_token;
 }
 
-static size_t match_integer_literal(const char* buffer, size_t cursor, size_t size, cabor_token* out_token)
+cabor_token cabor_create_synthetic_token(cabor_token_type type, cabor_atom atom)
 {
-    char token[CABOR_TOKENIZER_MAX_TOKEN_LENGTH] = {0};
-    size_t token_cursor = 0;
-
-    bool is_integer = false;
-
-    while (cursor < size)
+    cabor_token token =
     {
-        char c = buffer[cursor];
-
-        bool is_char_valid = false;
-
-        // Match integers 0-9
-        if (c >= '0' && c <= '9')
-        {
-            token[token_cursor++] = c;
-            is_integer = true;
-            is_char_valid = true;
-        }
-
-        // We only accept one minus sign
-        if (!is_integer && c == '-')
-        {
-            token[token_cursor++] = c;
-            is_char_valid = true;
-            cursor++;
-            break;
-        }
+        .atom = atom,
+        .offset = CABOR_TOKEN_NO_SOURCE,
+        .length = (uint32_t)cabor_atom_length(atom),
+        .type = (uint8_t)type
+    };
 
-        if (!is_char_valid)
-            break;
+    if (type == CABOR_INTEGER_LITERAL)
+        parse_integer(&token, cabor_atom_str(atom), token.length);
 
-        cursor++;
-    }
+    return token;
+}
 
-    if (token_cursor == 0)
-        return cursor;
+size_t cabor_get_token_size()
+{
+    return sizeof(cabor_token);
+}
 
-    // If this is just singular - sign then this is not integer literal but operator instead
-    if (token_cursor == 1 && token[0] == '-')
-    {
-        return --cursor;
-    }
+static cabor_vector* tokenize_serial(cabor_file* file, cabor_line_table* lines)
+{
+    cabor_vector* vector = cabor_create_vector(CABOR_TOKENIZER_VECTOR_DEFAULT_CAPACITY, CABOR_TOKEN, true);
 
-    copy_to_out_token(cursor, size, token_cursor, token, out_token, CABOR_INTEGER_LITERAL);
+    // The whole file is a single chunk
+    cabor_tokenizer* tokenizer = cabor_create_tokenizer();
+    tokenizer->lines = lines;
+    cabor_tokenizer_feed(tokenizer, file->file_memory.mem, file->size, vector);
+    cabor_tokenizer_finish(tokenizer, vector);
+    cabor_destroy_tokenizer(tokenizer);
 
-    return cursor;
+    return vector;
 }
 
-// Figure out if the identifier is keyword or just regular identifier. Keywords
-// are special non user defined identifiers such as if, else etc...
-static cabor_token_type get_token_type_identifier_or_keyword(const char* word)
+cabor_vector* cabor_tokenize(cabor_file* file)
 {
-    for (size_t i = 0; i < cabor_keyword_count; i++)
-    {
-        char* kword = cabor_keywords[i];
-        if (strcmp(kword, word) == 0)
-        {
-            return CABOR_KEYWORD;
-        }
-    }
-    return CABOR_IDENTIFIER;
+    return cabor_tokenize_with_lines(file, NULL);
 }
 
-// Return the new cursor position if it was a match otherwise return the original cursor.
-static size_t match_identifier(const char* buffer, size_t cursor, size_t size, cabor_token* out_token)
+cabor_vector* cabor_tokenize_with_lines(cabor_file* file, cabor_line_table* lines)
 {
-    char token[CABOR_TOKENIZER_MAX_TOKEN_LENGTH] = {0};
-    size_t token_cursor = 0;
+    if (file->size < CABOR_TOKENIZER_PARALLEL_MIN_SIZE)
+        return tokenize_serial(file, lines);
 
-    bool first_char_is_letter = false;
-    size_t i = cursor;
+    size_t num_threads = file->size / CABOR_TOKENIZER_PARALLEL_CHUNK_SIZE;
+    size_t num_workers = cabor_get_worker_count() + 1;
+    return cabor_tokenize_parallel(file, num_threads < num_workers ? num_threads : num_workers, lines);
+}
 
-    while(i < size)
-    {
-        char c = buffer[i];
-        bool char_is_valid = false;
+typedef struct
+{
+    const char* source;
+    size_t begin;
+    size_t end;
+    bool track_lines;
+    cabor_tokenizer* tokenizer;
+    cabor_vector* tokens;
+    cabor_line_table* lines;
+    cabor_intern_scope* intern_scope; // scope of the thread that tokenizes the file
+} cabor_tokenizer_chunk;
+
+// Chunks end right after a whitespace byte so no token continues into the next chunk. Whether the
+// whitespace is inside a comment isn't known until the chunks before it have been tokenized.
+static size_t split_chunks(const char* source, size_t size, size_t num_chunks, cabor_tokenizer_chunk* chunks)
+{
+    size_t count = 0;
+    size_t begin = 0;
 
-        // Match A-Z, a-z and _
-        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_')
-        {
-            if (i == cursor)
-                first_char_is_letter = true;
+    for (size_t i = 1; i < num_chunks; i++)
+    {
+        size_t split = size / num_chunks * i;
+        if (split < begin)
+            split = begin;
 
-            token[token_cursor++] = c;
-            char_is_valid = true;
-        }
-        
-        // Match 0-9
-        if (first_char_is_letter && (c >= '0' && c <= '9'))
-        {
-            token[token_cursor++] = c;
-            char_is_valid = true;
-        }
+        while (split < size && !(g_char_class[(uint8_t)source[split]] & CHAR_SPACE))
+            split++;
 
-        if (!char_is_valid)
+        // Nothing left to split, the last chunk takes the rest
+        if (split + 1 >= size)
             break;
 
-        i++;
+        chunks[count++] = (cabor_tokenizer_chunk){ .source = source, .begin = begin, .end = split + 1 };
+        begin = split + 1;
     }
 
-    if (token_cursor == 0)
-        return cursor;
+    chunks[count++] = (cabor_tokenizer_chunk){ .source = source, .begin = begin, .end = size };
+    return count;
+}
 
-    cabor_token_type token_type = get_token_type_identifier_or_keyword(token);
+// Tokenizes the chunk starting in the given state, the first run on the worker pool guesses
+// that every chunk starts outside of a comment
+static void tokenize_chunk(cabor_tokenizer_chunk* chunk, cabor_tokenizer_state state)
+{
+    if (!chunk->tokenizer)
+    {
+        chunk->tokenizer = cabor_create_tokenizer();
+        chunk->tokens = cabor_create_vector(CABOR_TOKENIZER_VECTOR_DEFAULT_CAPACITY, CABOR_TOKEN, false);
+        chunk->lines = chunk->track_lines ? cabor_create_line_table() : NULL;
+        chunk->tokenizer->lines = chunk->lines;
+    }
 
-    copy_to_out_token(cursor, size, token_cursor, token, out_token, token_type);
+    if (chunk->lines)
+        cabor_line_table_clear(chunk->lines);
 
-    return i;
-}
+    chunk->tokens->size = 0;
+    chunk->tokenizer->state = state;
+    chunk->tokenizer->block_comment_star = false;
+    chunk->tokenizer->pending->size = 0;
+    chunk->tokenizer->stream_offset = chunk->begin;
 
-// Append only valid tokens
-static void append_token(cabor_vector* vec, cabor_token* token)
-{
-    cabor_vector_push_token(vec, token);
+    cabor_tokenizer_feed(chunk->tokenizer, chunk->source + chunk->begin, chunk->end - chunk->begin, chunk->tokens);
 }
 
-size_t cabor_get_token_size()
+static void tokenize_chunk_thread(void* arg)
 {
-    return sizeof(cabor_token);
-}
+    cabor_tokenizer_chunk* chunk = arg;
 
-bool is_match(cabor_token* token)
-{
-    return token->type != CABOR_TOKEN_UNKNOWN;
+    cabor_intern_scope* previous_scope = cabor_set_intern_scope(chunk->intern_scope);
+    tokenize_chunk(chunk, CABOR_TOKENIZER_DEFAULT);
+    cabor_set_intern_scope(previous_scope);
 }
 
-bool is_match_comment(size_t old_cursor, size_t new_cursor)
+cabor_vector* cabor_tokenize_parallel(cabor_file* file, size_t num_threads, cabor_line_table* lines)
 {
-    return new_cursor > old_cursor;
-}
+    if (num_threads > CABOR_TOKENIZER_MAX_THREADS)
+        num_threads = CABOR_TOKENIZER_MAX_THREADS;
+
+    if (num_threads <= 1)
+        return tokenize_serial(file, lines);
 
-cabor_vector* cabor_tokenize(cabor_file* file)
-{
     cabor_vector* vector = cabor_create_vector(CABOR_TOKENIZER_VECTOR_DEFAULT_CAPACITY, CABOR_TOKEN, true);
 
-    char* buffer = file->file_memory.mem;
-    size_t size = file->size;
+    // Chunk tokens are allocated on the worker threads and freed here, keep them out of the
+    // caller's allocator which can be an arena
+    cabor_allocator_context* previous_allocator = cabor_set_current_allocator_context(NULL);
 
-    size_t cursor = 0;
+    cabor_tokenizer_chunk chunks[CABOR_TOKENIZER_MAX_THREADS];
+    size_t num_chunks = split_chunks(file->file_memory.mem, file->size, num_threads, chunks);
 
-    while (cursor < size)
+    for (size_t i = 0; i < num_chunks; i++)
     {
-        char c = buffer[cursor];
+        chunks[i].track_lines = lines != NULL;
+        chunks[i].tokenizer = NULL;
+        chunks[i].intern_scope = cabor_get_intern_scope();
+    }
 
-        cabor_token token =
-        {
-            .data = {0},
-            .type = CABOR_TOKEN_UNKNOWN
-        };
+    cabor_worker_pool_run(tokenize_chunk_thread, chunks, sizeof(cabor_tokenizer_chunk), num_chunks);
 
-        // For now we just append the first token that matches any of the checks to the vector
+    // The state at the start of a chunk is the state the previous chunk ended in. A chunk that begins
+    // inside a comment was guessed wrong and is redone on this thread.
+    size_t num_tokens = 0;
+    for (size_t i = 0; i < num_chunks; i++)
+    {
+        cabor_tokenizer_state state = i > 0 ? chunks[i - 1].tokenizer->state : CABOR_TOKENIZER_DEFAULT;
+        if (state != CABOR_TOKENIZER_DEFAULT)
+            tokenize_chunk(&chunks[i], state);
 
-        if (check_for_ignored_characters(c))
-        {
-            cursor++;
-            continue;
-        }
+        num_tokens += chunks[i].tokens->size;
+    }
 
-        // Skips cursor after comment if comment is found
-        size_t new_cursor = match_comment(buffer, cursor, size);
+    cabor_vector_reserve(vector, num_tokens + 1);
+    for (size_t i = 0; i < num_chunks; i++)
+    {
+        cabor_vector* tokens = chunks[i].tokens;
+        memcpy((cabor_token*)vector->vector_mem.mem + vector->size, tokens->vector_mem.mem, tokens->size * sizeof(cabor_token));
+        vector->size += tokens->size;
 
-        if (is_match_comment(cursor, new_cursor))
-        {
-            cursor = new_cursor;
-            continue;
-        }
+        if (lines)
+            cabor_line_table_append(lines, chunks[i].lines);
+    }
 
-        cursor = match_operator(buffer, cursor, size, &token);
-        if (is_match(&token))
-        {
-            append_token(vector, &token);
-            continue;
-        }
+    // Only the last chunk can end in the middle of a token
+    cabor_tokenizer_finish(chunks[num_chunks - 1].tokenizer, vector);
 
-        cursor = match_identifier(buffer, cursor, size, &token);
-        if (is_match(&token))
-        {
-            append_token(vector, &token);
-            continue;
-        }
+    for (size_t i = 0; i < num_chunks; i++)
+    {
+        cabor_destroy_tokenizer(chunks[i].tokenizer);
+        cabor_destroy_vector(chunks[i].tokens);
+        if (chunks[i].lines)
+            cabor_destroy_line_table(chunks[i].lines);
+    }
 
-        cursor = match_integer_literal(buffer, cursor, size, &token);
-        if (is_match(&token))
-        {
-            append_token(vector, &token);
-            continue;
-        }
+    cabor_set_current_allocator_context(previous_allocator);
 
-        cursor = match_punctuation(buffer, cursor, size, &token);
-        if (is_match(&token))
-        {
-            append_token(vector, &token);
-            continue;
-        }
+    return vector;
+}
 
-        // if we end up here there were no matches
-       CABOR_LOG_WARN_F("Tokenizer encountered character that did not match to anything, the character: %c", c);
-        cursor++; // skip over the unmatched character
-    }
+const char* cabor_token_text(const cabor_token* token, char* buffer, size_t size)
+{
+    if (token->type != CABOR_INTEGER_LITERAL)
+        return cabor_token_str(token);
 
-    return vector;
+    snprintf(buffer, size, "%lld", (long long)token->value);
+    return buffer;
 }
 
-void cabor_stringify_tokens(char* buffer, size_t size, cabor_vector* tokens)
+size_t cabor_get_stringified_tokens_size(cabor_vector* tokens)
+{
+    // '[' + ']' + null terminator, quotes and separator for each token
+    size_t size = 3;
+    for (size_t i = 0; i < tokens->size; i++)
+        size += cabor_token_length(cabor_vector_at_token(tokens, i)) + 4;
+    return size;
+}
+
+void cabor_stringify_tokens(char* buffer, size_t size, cabor_vector* tokens, const char* source)
 {
     size_t cursor = 0;
 
     buffer[cursor++] = '[';
     for (size_t i = 0; i < tokens->size; i++)
     {
-        cabor_token* t = cabor_vector_get_token(tokens, i);
-        if (i == tokens->size - 1)
+        cabor_token* t = cabor_vector_at_token(tokens, i);
+        const char* separator = i == tokens->size - 1 ? "" : ", ";
+
+        if (source && cabor_token_has_source(t))
         {
-            cursor += snprintf(buffer + cursor, size - cursor, "'%s'", t->data);
+            cursor += snprintf(buffer + cursor, size - cursor, "'%.*s'%s", (int)cabor_token_length(t), source + t->offset, separator);
         }
         else
         {
-            cursor += snprintf(buffer + cursor, size - cursor, "'%s', ", t->data);
+            char text[CABOR_TOKEN_TEXT_SIZE];
+            cursor += snprintf(buffer + cursor, size - cursor, "'%s'%s", cabor_token_text(t, text, sizeof(text)), separator);
         }
     }
 
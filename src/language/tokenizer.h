@@ -1,10 +1,28 @@
 #pragma once
 
 #include "../core/vector.h"
+#include "../core/intern.h"
 #include "../filesystem/filesystem.h"
+#include "scan.h"
+#include "line_table.h"
+
+#include <stdint.h>
+#include <stdbool.h>
 
 #define CABOR_TOKENIZER_VECTOR_DEFAULT_CAPACITY 1024
-#define CABOR_TOKENIZER_MAX_TOKEN_LENGTH 64
+#define CABOR_TOKENIZER_PENDING_DEFAULT_CAPACITY 64
+
+// cabor_tokenize() splits sources of at least CABOR_TOKENIZER_PARALLEL_MIN_SIZE bytes into chunks of
+// about CABOR_TOKENIZER_PARALLEL_CHUNK_SIZE bytes, one chunk per worker pool thread and one for the caller
+#define CABOR_TOKENIZER_PARALLEL_MIN_SIZE (1024 * 1024)
+#define CABOR_TOKENIZER_PARALLEL_CHUNK_SIZE (256 * 1024)
+#define CABOR_TOKENIZER_MAX_THREADS 64
+
+// Offset of tokens that don't come from the source buffer, e.g. the unit token the parser inserts
+#define CABOR_TOKEN_NO_SOURCE UINT32_MAX
+
+// Token flags
+#define CABOR_TOKEN_FLAG_OVERFLOW (1 << 0) // integer literal doesn't fit in int64_t, value is INT64_MAX
 
 typedef enum
 {
@@ -17,14 +35,99 @@ typedef enum
     CABOR_TOKEN_UNKNOWN,
 } cabor_token_type;
 
+// Tokens don't hold their text. The text is the span [offset, offset + length) of the source buffer
+// and the same text is interned in atom, so comparing a token against a keyword or operator is
+// comparing atoms (CABOR_ATOM_IF, CABOR_ATOM_PLUS...). Use the accessors below instead of the source.
+// Integer literals only keep their value, their atom is CABOR_ATOM_INVALID so programs full of
+// distinct numbers don't fill the intern pool.
 typedef struct cabor_token_t
 {
-    cabor_token_type type;
-    char data[CABOR_TOKENIZER_MAX_TOKEN_LENGTH];
+    cabor_atom atom;
+    uint32_t offset;
+    uint32_t length;
+    uint8_t type;    // cabor_token_type
+    uint8_t flags;   // CABOR_TOKEN_FLAG_*
+    int64_t value;   // integer literals are parsed once by the tokenizer, 0 for other tokens
 } cabor_token;
 
+CABOR_VECTOR_DEFINE_ACCESSORS(token, cabor_token)
+
+// Interned text, empty for integer literals. Messages that can show any token use cabor_token_text().
+static inline const char* cabor_token_str(const cabor_token* token)
+{
+    return cabor_atom_str(token->atom);
+}
+
+static inline size_t cabor_token_length(const cabor_token* token)
+{
+    return token->length;
+}
+
+static inline bool cabor_token_is(const cabor_token* token, cabor_atom atom)
+{
+    return token->atom == atom;
+}
+
+static inline bool cabor_token_has_source(const cabor_token* token)
+{
+    return token->offset != CABOR_TOKEN_NO_SOURCE;
+}
+
+// Token that was not read from the source buffer
+cabor_token cabor_create_synthetic_token(cabor_token_type type, cabor_atom atom);
+
+#define CABOR_TOKEN_TEXT_SIZE 24 // any int64_t in decimal with the null terminator
+
+// Text of any token when the source isn't at hand. Integer literals are printed from their value into
+// buffer of at least CABOR_TOKEN_TEXT_SIZE bytes, other tokens give their interned text.
+const char* cabor_token_text(const cabor_token* token, char* buffer, size_t size);
+
 size_t cabor_get_token_size();
 
+typedef enum
+{
+    CABOR_TOKENIZER_DEFAULT,
+    CABOR_TOKENIZER_LINE_COMMENT,
+    CABOR_TOKENIZER_BLOCK_COMMENT
+} cabor_tokenizer_state;
+
+// Resumable tokenizer for input that arrives in pieces, e.g. from a socket. A token that is cut by the end
+// of a chunk is carried over and finished by the next one, comments can span any number of chunks. Token
+// offsets count from the beginning of the whole input, not the chunk, and the chunks don't have to be
+// kept alive after they have been fed.
+typedef struct
+{
+    cabor_tokenizer_state state;
+    bool block_comment_star;       // previous chunk ended with '*' inside a block comment
+    cabor_vector* pending;         // bytes of the token cut by the end of the previous chunk
+    size_t pending_offset;         // offset of the first pending byte
+    size_t stream_offset;          // offset of the next chunk
+    const cabor_scanner* scanner;
+    cabor_line_table* lines;       // new lines are recorded here when set, not owned
+} cabor_tokenizer;
+
+cabor_tokenizer* cabor_create_tokenizer();
+void cabor_destroy_tokenizer(cabor_tokenizer* tokenizer);
+
+// Appends the tokens completed by this chunk to tokens, returns the number of tokens appended
+size_t cabor_tokenizer_feed(cabor_tokenizer* tokenizer, const char* chunk, size_t size, cabor_vector* tokens);
+
+// End of input, appends the token that was still waiting for more bytes
+size_t cabor_tokenizer_finish(cabor_tokenizer* tokenizer, cabor_vector* tokens);
+
+// Tokenizes the whole file in one go, large files are tokenized in parallel
 cabor_vector* cabor_tokenize(cabor_file* file);
 
-void cabor_stringify_tokens(char* buffer, size_t size, cabor_vector* tokens);
+// Same as above and records where the lines of the file start in lines
+cabor_vector* cabor_tokenize_with_lines(cabor_file* file, cabor_line_table* lines);
+
+// Splits the file into at most num_threads chunks at whitespace and tokenizes them on the worker pool.
+// The tokens are the same as from the serial tokenizer, chunks that turn out to begin inside a comment
+// are tokenized again once the state at their start is known.
+cabor_vector* cabor_tokenize_parallel(cabor_file* file, size_t num_threads, cabor_line_table* lines);
+
+// Buffer size needed by cabor_stringify_tokens(), including the null terminator
+size_t cabor_get_stringified_tokens_size(cabor_vector* tokens);
+// source is the buffer the tokens were read from, each token is printed from its span. Without a source,
+// e.g. for tokens built by hand, they are printed with cabor_token_text().
+void cabor_stringify_tokens(char* buffer, size_t size, cabor_vector* tokens, const char* source);
@@ -1,17 +1,24 @@
 #include "type_checker.h"
 #include "../debug/cabor_debug.h"
+#include "../core/mutex.h"
+#include "../core/worker_pool.h"
 
 #include <string.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
-#define ROOT(n) cabor_access_ast_node(n)
 #define TOKEN(n) cabor_access_ast_token(ast, n)
-#define EDGE(n, e) cabor_access_ast_node(&n->edges[e])
+#define EDGE(n, e) cabor_ast_edge(ast, n, e)
+#define NUM_EDGES(n) cabor_ast_num_edges(ast, n)
+#define NODE_TYPE(n) cabor_ast_node_type_of(ast, n)
+#define TYPE(n) cabor_ast_type_of(ast, n)
+#define SET_TYPE(n, t) cabor_ast_set_type(ast, n, t)
+#define LOCATION(n) cabor_ast_location_str(ast, TOKEN(n), (char[CABOR_SOURCE_LOCATION_STR_SIZE]){0}, CABOR_SOURCE_LOCATION_STR_SIZE)
 
 cabor_symbol_table* cabor_create_symbol_table()
 {
     CABOR_NEW(cabor_symbol_table, table);
-    table->map = cabor_create_hash_map(1024);
+    table->map = cabor_create_hash_map(CABOR_SYMBOL_TABLE_INITIAL_SIZE);
     table->parent_scope = NULL;
     table->child_scope = NULL;
     return table;
@@ -39,252 +46,279 @@ cabor_symbol_table* cabor_create_new_symbol_scope(cabor_symbol_table* symbol_tab
     return new_table;
 }
 
+int cabor_symbol_table_lookup(cabor_symbol_table* symbol_table, cabor_atom name, bool* found)
+{
+    for (cabor_symbol_table* scope = symbol_table; scope; scope = scope->parent_scope)
+    {
+        int value = cabor_map_get_atom(scope->map, name, found);
+        if (*found)
+            return value;
+    }
+
+    return -1;
+}
+
 cabor_type cabor_convert_type_declaration_to_type(cabor_token* type_decl)
 {
-    if (strcmp(type_decl->data, "Int") == 0)
+    if (cabor_token_is(type_decl, CABOR_ATOM_INT))
     {
         return CABOR_TYPE_INT;
     }
-    else if (strcmp(type_decl->data, "Bool") == 0)
+    else if (cabor_token_is(type_decl, CABOR_ATOM_BOOL))
     {
         return CABOR_TYPE_BOOL;
     }
     else 
     {
-        CABOR_LOG_ERR_F("TYPE ERROR: failed to convert %s to cabor_type", type_decl->data);
+        CABOR_LOG_ERR_F("TYPE ERROR: failed to convert %s to cabor_type", cabor_token_str(type_decl));
         return CABOR_TYPE_ERROR;
     }
 }
 
-cabor_type cabor_typecheck_if_then_else(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table)
+cabor_type cabor_typecheck_if_then_else(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table)
 {
-    CABOR_ASSERT(node->node_type == CABOR_NODE_TYPE_IF_THEN_ELSE || node->num_edges == 2 || node->num_edges == 3, "not a valid if-then-else node");
+    CABOR_ASSERT(NODE_TYPE(node) == CABOR_NODE_TYPE_IF_THEN_ELSE || NUM_EDGES(node) == 2 || NUM_EDGES(node) == 3, "not a valid if-then-else node");
     cabor_type if_expr_type = cabor_typecheck(ast, EDGE(node, 0), sym_table);
 
     if (if_expr_type != CABOR_TYPE_BOOL)
     {
-        CABOR_LOG_ERR("TYPE ERROR: if expression didn't evaluate to bool");
+        CABOR_LOG_ERR_F("TYPE ERROR: %s: if expression didn't evaluate to bool", LOCATION(EDGE(node, 0)));
         return CABOR_TYPE_ERROR;
     }
 
     cabor_type then_expr_type = cabor_typecheck(ast, EDGE(node, 1), sym_table);
 
-    if (node->num_edges == 3)
+    if (NUM_EDGES(node) == 3)
     {
         cabor_type else_expr_type = cabor_typecheck(ast, EDGE(node, 2), sym_table);
 
         if (then_expr_type != else_expr_type)
         {
-            CABOR_LOG_ERR("TYPE ERROR: if-then-else branches must have the same type");
-            node->type = CABOR_TYPE_ERROR;
+            CABOR_LOG_ERR_F("TYPE ERROR: %s: if-then-else branches must have the same type", LOCATION(node));
+            SET_TYPE(node, CABOR_TYPE_ERROR);
             return CABOR_TYPE_ERROR;
         }
 
-        node->type = then_expr_type;
+        SET_TYPE(node, then_expr_type);
         return then_expr_type;
     }
 
-    node->type = then_expr_type;
+    SET_TYPE(node, then_expr_type);
     return then_expr_type;
 }
 
-cabor_type cabor_typecheck_binary_op(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table)
+cabor_type cabor_typecheck_binary_op(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table)
 {
-    CABOR_ASSERT(node->node_type == CABOR_NODE_TYPE_BINARY_OP && node->num_edges == 2, "not a valid binary-op node");
+    CABOR_ASSERT(NODE_TYPE(node) == CABOR_NODE_TYPE_BINARY_OP && NUM_EDGES(node) == 2, "not a valid binary-op node");
 
     cabor_type left = cabor_typecheck(ast, EDGE(node, 0), sym_table);
     cabor_type right = cabor_typecheck(ast, EDGE(node, 1), sym_table);
 
     if (left != right)
     {
-        CABOR_LOG_ERR("TYPE ERROR: binary op left and right types didn't match");
+        CABOR_LOG_ERR_F("TYPE ERROR: %s: binary op left and right types didn't match", LOCATION(node));
         return CABOR_TYPE_ERROR;
     }
 
-    node->type = left;
+    SET_TYPE(node, left);
     return left;
 }
 
-cabor_type cabor_typecheck_unary_op(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table)
+cabor_type cabor_typecheck_unary_op(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table)
 {
-    CABOR_ASSERT(node->node_type == CABOR_NODE_TYPE_UNARY_OP && node->num_edges == 1, "not a valid unary-op node");
+    CABOR_ASSERT(NODE_TYPE(node) == CABOR_NODE_TYPE_UNARY_OP && NUM_EDGES(node) == 1, "not a valid unary-op node");
 
     cabor_type expr_type = cabor_typecheck(ast, EDGE(node, 0), sym_table);
 
-    if (strcmp(TOKEN(node)->data, "-") == 0)
+    if (cabor_token_is(TOKEN(node), CABOR_ATOM_MINUS))
     {
         if (expr_type != CABOR_TYPE_INT)
         {
-            CABOR_LOG_ERR("TYPE ERROR: unary op '-' cannot be used with non number types");
+            CABOR_LOG_ERR_F("TYPE ERROR: %s: unary op '-' cannot be used with non number types", LOCATION(node));
             return CABOR_TYPE_ERROR;
         }
-        node->type = expr_type;
+        SET_TYPE(node, expr_type);
         return expr_type;
     }
-    else if (strcmp(TOKEN(node)->data, "not") == 0)
+    else if (cabor_token_is(TOKEN(node), CABOR_ATOM_NOT))
     {
         if (expr_type != CABOR_TYPE_BOOL)
         {
-            CABOR_LOG_ERR("TYPE ERROR: unary op 'not' cannot be used with non bool operands");
+            CABOR_LOG_ERR_F("TYPE ERROR: %s: unary op 'not' cannot be used with non bool operands", LOCATION(node));
             return CABOR_TYPE_ERROR;
         }
-        node->type = CABOR_TYPE_BOOL;
+        SET_TYPE(node, CABOR_TYPE_BOOL);
         return CABOR_TYPE_BOOL;
     }
     else
     {
-        CABOR_LOG_ERR("TYPE ERROR: unary op was not - or not");
+        CABOR_LOG_ERR_F("TYPE ERROR: %s: unary op was not - or not", LOCATION(node));
         return CABOR_TYPE_ERROR;
     }
 }
 
-cabor_type cabor_typecheck_function(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table)
+cabor_type cabor_typecheck_function(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table)
 {
-    CABOR_ASSERT(node->node_type == CABOR_NODE_TYPE_FUNCTION_CALL, "not a valid function call");
+    CABOR_ASSERT(NODE_TYPE(node) == CABOR_NODE_TYPE_FUNCTION_CALL, "not a valid function call");
 
-    for (size_t i = 0; i < node->num_edges; i++)
+    for (size_t i = 0; i < NUM_EDGES(node); i++)
     {
-        cabor_ast_node* arg = ROOT(&node->edges[i]);
+        cabor_ast_node_idx arg = EDGE(node, i);
         cabor_type arg_type = cabor_typecheck(ast, arg, sym_table);
     }
 
     return CABOR_NODE_TYPE_FUNCTION_CALL;
 }
 
-cabor_type cabor_typecheck_while(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table)
+cabor_type cabor_typecheck_while(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table)
 {
-    CABOR_ASSERT(node->node_type == CABOR_NODE_TYPE_WHILE && node->num_edges == 2, "not a valid while expression");
+    CABOR_ASSERT(NODE_TYPE(node) == CABOR_NODE_TYPE_WHILE && NUM_EDGES(node) == 2, "not a valid while expression");
 
     cabor_type cond_type = cabor_typecheck(ast, EDGE(node, 0), sym_table);
 
     if (cond_type != CABOR_TYPE_BOOL)
     {
-        CABOR_LOG_ERR("TYPE ERROR: while condition must be of type bool");
+        CABOR_LOG_ERR_F("TYPE ERROR: %s: while condition must be of type bool", LOCATION(EDGE(node, 0)));
         return CABOR_TYPE_ERROR;
     }
 
     cabor_type body_type = cabor_typecheck(ast, EDGE(node, 1), sym_table);
 
-    node->type = CABOR_TYPE_UNIT;
+    SET_TYPE(node, CABOR_TYPE_UNIT);
     return CABOR_TYPE_UNIT;
 }
 
-cabor_type cabor_typecheck_block(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table)
-{
-    CABOR_ASSERT(node->node_type == CABOR_NODE_TYPE_BLOCK, "not a valid block");
+// cabor_typecheck_task, blocks that cabor_typecheck_parallel() checked ahead of the rest of the tree.
+// Only set on the thread that checks the rest of the tree and only while it does.
+static CABOR_THREAD_LOCAL cabor_vector* t_checked_blocks;
 
+static cabor_typecheck_task* find_checked_block(cabor_vector* checked_blocks, cabor_ast_node_idx node);
+
+static cabor_type check_block(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table)
+{
     cabor_symbol_table* new_scope = cabor_create_new_symbol_scope(sym_table);
 
     cabor_type last_type = CABOR_TYPE_UNIT;
 
-    for (size_t i = 0; i < node->num_edges; i++)
+    for (size_t i = 0; i < NUM_EDGES(node); i++)
     {
         last_type = cabor_typecheck(ast, EDGE(node, i), new_scope);
     }
 
-    node->type = last_type;
+    SET_TYPE(node, last_type);
     return last_type;
 }
 
-cabor_type cabor_typecheck_var_expr(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table)
+cabor_type cabor_typecheck_block(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table)
 {
-    CABOR_ASSERT(node->node_type == CABOR_NODE_TYPE_VAR_EXPR && (node->num_edges == 2 || node->num_edges == 3), "not a valid var expression");
+    CABOR_ASSERT(NODE_TYPE(node) == CABOR_NODE_TYPE_BLOCK, "not a valid block");
+
+    // Blocks that cabor_typecheck_parallel() has already checked only give their type
+    cabor_typecheck_task* task = t_checked_blocks ? find_checked_block(t_checked_blocks, node) : NULL;
+    if (task)
+    {
+        task->reached = true;
+        return task->type;
+    }
+
+    return check_block(ast, node, sym_table);
+}
+
+cabor_type cabor_typecheck_var_expr(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table)
+{
+    CABOR_ASSERT(NODE_TYPE(node) == CABOR_NODE_TYPE_VAR_EXPR && (NUM_EDGES(node) == 2 || NUM_EDGES(node) == 3), "not a valid var expression");
 
     // Check for type declaration here
     cabor_type initializer_type = cabor_typecheck(ast, EDGE(node, 1), sym_table);
 
-    if (node->num_edges == 3) // includes type declaration
+    if (NUM_EDGES(node) == 3) // includes type declaration
     {
-        cabor_ast_node* variable_typedecl_node = EDGE(node, 2);
+        cabor_ast_node_idx variable_typedecl_node = EDGE(node, 2);
         cabor_token* variable_typedecl_token = TOKEN(variable_typedecl_node);
         cabor_type variable_typedecl_type = cabor_convert_type_declaration_to_type(variable_typedecl_token);
 
         if (initializer_type != variable_typedecl_type)
         {
-            CABOR_LOG_ERR("TYPE ERROR: variable initializer type didn't match type declaration");
+            CABOR_LOG_ERR_F("TYPE ERROR: %s: variable initializer type didn't match type declaration", LOCATION(EDGE(node, 1)));
             return CABOR_TYPE_ERROR;
         }
-        variable_typedecl_node->type = CABOR_TYPE_UNIT;
+        SET_TYPE(variable_typedecl_node, CABOR_TYPE_UNIT);
     }
 
     // Should we allow shadowing? for now assume we don't do that, let's check if the the identifier already exist
 
 
-    cabor_ast_node* variable_name_node = EDGE(node, 0);
+    cabor_ast_node_idx variable_name_node = EDGE(node, 0);
     cabor_token* variable_name_token = TOKEN(variable_name_node);
-    const char* variable_name_str = variable_name_token->data;
+    cabor_atom variable_name = variable_name_token->atom;
 
     bool found = false;
-    int value = cabor_map_get(sym_table->map, variable_name_str, &found);
+    int value = cabor_map_get_atom(sym_table->map, variable_name, &found);
 
     if (found)
     {
-        CABOR_LOG_ERR_F("TYPE ERROR: Double variable declaration with same name: %s", TOKEN(node)->data);
+        CABOR_LOG_ERR_F("TYPE ERROR: %s: Double variable declaration with same name: %s", LOCATION(variable_name_node), cabor_token_str(variable_name_token));
         return CABOR_TYPE_ERROR;
     }
 
-    variable_name_node->type = initializer_type;
+    SET_TYPE(variable_name_node, initializer_type);
 
     // initializer type and declared type should be the same
-    cabor_map_insert(sym_table->map, variable_name_str, (int)initializer_type);
+    cabor_map_insert_atom(sym_table->map, variable_name, (int)initializer_type);
 
 
-    node->type = initializer_type;
+    SET_TYPE(node, initializer_type);
     return initializer_type;
 }
 
-cabor_type cabor_typecheck_literal(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* symb_table)
+cabor_type cabor_typecheck_literal(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* symb_table)
 {
-    CABOR_ASSERT(node->node_type == CABOR_NODE_TYPE_LITERAL && node->num_edges == 0, "not a valid literal");
+    CABOR_ASSERT(NODE_TYPE(node) == CABOR_NODE_TYPE_LITERAL && NUM_EDGES(node) == 0, "not a valid literal");
 
-    if (strcmp(TOKEN(node)->data, "true") == 0 || strcmp(TOKEN(node)->data, "false") == 0)
+    if (cabor_token_is(TOKEN(node), CABOR_ATOM_TRUE) || cabor_token_is(TOKEN(node), CABOR_ATOM_FALSE))
     {
-        node->type = CABOR_TYPE_BOOL;
+        SET_TYPE(node, CABOR_TYPE_BOOL);
         return CABOR_TYPE_BOOL;
     }
     else // Check for valid int literal
     {
         cabor_token* token = TOKEN(node);
-        char* c = &token->data[0];
-        while (*c)
+        if (token->flags & CABOR_TOKEN_FLAG_OVERFLOW)
         {
-            if (*c < '0' || *c > '9')
-            {
-                CABOR_LOG_ERR_F("TYPE ERROR: int literal was not a number: %s", TOKEN(node)->data);
-                break;
-            }
-            ++c;
+            CABOR_LOG_ERR_F("TYPE ERROR: %s: int literal doesn't fit in 64 bits", LOCATION(node));
+            SET_TYPE(node, CABOR_TYPE_ERROR);
+            return CABOR_TYPE_ERROR;
         }
-        node->type = CABOR_TYPE_INT;
+        SET_TYPE(node, CABOR_TYPE_INT);
         return CABOR_TYPE_INT;
     }
     return CABOR_TYPE_ERROR;
 }
 
-cabor_type cabor_typecheck_identifier(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* symb_table)
+cabor_type cabor_typecheck_identifier(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* symb_table)
 {
-    CABOR_ASSERT(node->node_type == CABOR_NODE_TYPE_IDENTIFIER && node->num_edges == 0, "not a valid identifier");
+    CABOR_ASSERT(NODE_TYPE(node) == CABOR_NODE_TYPE_IDENTIFIER && NUM_EDGES(node) == 0, "not a valid identifier");
 
-    // All identifiers should be in sym_table for this scope
+    // The innermost declaration of the name in this scope or the ones around it
     bool found = false;
     cabor_token* identifier_token = TOKEN(node);
-    cabor_type identifier_type = cabor_map_get(symb_table->map, identifier_token->data, &found);
+    cabor_type identifier_type = cabor_symbol_table_lookup(symb_table, identifier_token->atom, &found);
 
     if (!found)
     {
-        CABOR_LOG_ERR_F("TYPE ERROR: undeclared identifier encountered %s", TOKEN(node)->data);
+        CABOR_LOG_ERR_F("TYPE ERROR: %s: undeclared identifier encountered %s", LOCATION(node), cabor_token_str(TOKEN(node)));
         return CABOR_TYPE_ERROR;
     }
 
-    node->type = identifier_type;
+    SET_TYPE(node, identifier_type);
     return identifier_type;
 }
 
-cabor_type cabor_typecheck(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table)
+cabor_type cabor_typecheck(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table)
 {
-    cabor_ast_node* root = node;
+    cabor_ast_node_idx root = node;
     cabor_token* token = TOKEN(root);
-    switch (root->node_type)
+    switch (NODE_TYPE(root))
     {
     case CABOR_NODE_TYPE_BINARY_OP:
         return cabor_typecheck_binary_op(ast, root, sym_table);
@@ -326,10 +360,263 @@ cabor_type cabor_typecheck(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_ta
         return cabor_typecheck_var_expr(ast, root, sym_table);
         break;
 
+    case CABOR_NODE_TYPE_ERROR:
+        // The parser has already reported this one
+        SET_TYPE(root, CABOR_TYPE_ERROR);
+        return CABOR_TYPE_ERROR;
+        break;
+
     case CABOR_NODE_TYPE_UNKNOWN:
     default:
-        CABOR_LOG_ERR_F("TYPE ERROR: Unknown type encountered in AST, root token: %s", TOKEN(root)->data);
+        CABOR_LOG_ERR_F("TYPE ERROR: %s: Unknown type encountered in AST, root token: %s", LOCATION(root), cabor_token_text(TOKEN(root), (char[CABOR_TOKEN_TEXT_SIZE]){0}, CABOR_TOKEN_TEXT_SIZE));
+        break;
+    }
+}
+
+static cabor_typecheck_task* find_checked_block(cabor_vector* checked_blocks, cabor_ast_node_idx node)
+{
+    // Tasks are sorted by node
+    size_t begin = 0;
+    size_t end = checked_blocks->size;
+
+    while (begin < end)
+    {
+        size_t middle = begin + (end - begin) / 2;
+        cabor_typecheck_task* task = cabor_vector_at_typecheck_task(checked_blocks, middle);
+
+        if (task->node == node)
+            return task;
+
+        if (task->node < node)
+            begin = middle + 1;
+        else
+            end = middle;
+    }
+
+    return NULL;
+}
+
+typedef struct
+{
+    cabor_ast* ast;
+    cabor_vector* tasks;   // cabor_typecheck_task
+    cabor_mutex* lock;     // guards next_task
+    size_t next_task;
+    cabor_intern_scope* intern_scope; // names of the tree are looked up in the scope of the caller
+} cabor_typecheck_pool;
+
+typedef struct
+{
+    cabor_ast_node_idx root;
+    cabor_vector* tasks;
+} cabor_task_collector;
+
+// Whether an identifier in the subtree of node would be looked up past scope, the subtree is walked in
+// the order cabor_typecheck() checks it and declares names the same way, so a name used before the
+// block declares it counts as an outer one too
+static bool uses_outer_names(const cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* scope)
+{
+    switch (NODE_TYPE(node))
+    {
+    case CABOR_NODE_TYPE_IDENTIFIER:
+    {
+        bool found = false;
+        cabor_symbol_table_lookup(scope, TOKEN(node)->atom, &found);
+        return !found;
+    }
+
+    case CABOR_NODE_TYPE_VAR_EXPR:
+        if (uses_outer_names(ast, EDGE(node, 1), scope))
+            return true;
+        cabor_map_insert_atom(scope->map, TOKEN(EDGE(node, 0))->atom, 0);
+        return false;
+
+    case CABOR_NODE_TYPE_BLOCK:
+        scope = cabor_create_new_symbol_scope(scope);
+        break;
+
+    default:
         break;
     }
+
+    for (size_t i = 0; i < NUM_EDGES(node); i++)
+    {
+        if (uses_outer_names(ast, EDGE(node, i), scope))
+            return true;
+    }
+
+    return false;
 }
 
+// The outermost blocks below the root that only use names they declare themselves, their subtrees are
+// left out of the walk. A block that uses a name from around it has to be checked in place, the blocks
+// inside it can still be tasks.
+static cabor_ast_visit_result collect_task(const cabor_ast* ast, cabor_ast_node_idx node, void* user_data)
+{
+    cabor_task_collector* collector = user_data;
+
+    if (node == collector->root || NODE_TYPE(node) != CABOR_NODE_TYPE_BLOCK)
+        return CABOR_AST_VISIT_CONTINUE;
+
+    if (uses_outer_names(ast, node, cabor_create_symbol_table()))
+        return CABOR_AST_VISIT_CONTINUE;
+
+    cabor_typecheck_task task = { .node = node, .type = CABOR_TYPE_ERROR, .reached = false };
+    cabor_vector_append_typecheck_task(collector->tasks, &task);
+    return CABOR_AST_VISIT_SKIP_CHILDREN;
+}
+
+static int compare_tasks(const void* a, const void* b)
+{
+    cabor_ast_node_idx left = ((const cabor_typecheck_task*)a)->node;
+    cabor_ast_node_idx right = ((const cabor_typecheck_task*)b)->node;
+    return (left > right) - (left < right);
+}
+
+// Tasks are handed out in small batches from a shared cursor, a thread that is done with its batch
+// takes the next one so long and short blocks even out between the threads
+static bool claim_tasks(cabor_typecheck_pool* pool, size_t* begin, size_t* end)
+{
+    CABOR_SCOPED_LOCK(pool->lock)
+    {
+        size_t count = pool->tasks->size;
+        *begin = pool->next_task;
+        *end = *begin + CABOR_TYPECHECK_BATCH_SIZE < count ? *begin + CABOR_TYPECHECK_BATCH_SIZE : count;
+        pool->next_task = *end;
+    }
+
+    return *begin < *end;
+}
+
+static void typecheck_worker(void* arg)
+{
+    cabor_typecheck_pool* pool = *(cabor_typecheck_pool**)arg;
+    cabor_ast* ast = pool->ast;
+
+    // Scopes are never freed one by one, they go with the arena once the thread runs out of blocks
+    cabor_allocator_context arena;
+    create_cabor_arena_allocator_context(&arena, cabor_get_current_allocator_context(), CABOR_TYPECHECK_ARENA_BLOCK_SIZE);
+    cabor_allocator_context* previous_allocator = cabor_set_current_allocator_context(&arena);
+    cabor_intern_scope* previous_scope = cabor_set_intern_scope(pool->intern_scope);
+
+    size_t begin;
+    size_t end;
+    while (claim_tasks(pool, &begin, &end))
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            // Each task writes the types of its own subtree only
+            cabor_typecheck_task* task = cabor_vector_at_typecheck_task(pool->tasks, i);
+            task->type = check_block(ast, task->node, cabor_create_symbol_table());
+        }
+    }
+
+    cabor_set_intern_scope(previous_scope);
+    cabor_set_current_allocator_context(previous_allocator);
+    destroy_cabor_allocator_context(&arena);
+}
+
+// Checks the tree from root, the blocks in checked_blocks only give the type they were checked to
+static cabor_type typecheck_around_checked_blocks(cabor_ast* ast, cabor_ast_node_idx root, cabor_symbol_table* sym_table, cabor_vector* checked_blocks)
+{
+    cabor_vector* previous = t_checked_blocks;
+    t_checked_blocks = checked_blocks;
+    cabor_type type = cabor_typecheck(ast, root, sym_table);
+    t_checked_blocks = previous;
+    return type;
+}
+
+// Nodes are allocated after their edges and a subtree is allocated in one go, so the subtree of node
+// is the range from its first allocated node to node itself
+static cabor_ast_node_idx subtree_first_node(const cabor_ast* ast, cabor_ast_node_idx node)
+{
+    while (NUM_EDGES(node) > 0)
+    {
+        cabor_ast_node_idx first = EDGE(node, 0);
+        for (size_t i = 1; i < NUM_EDGES(node); i++)
+        {
+            if (EDGE(node, i) < first)
+                first = EDGE(node, i);
+        }
+        node = first;
+    }
+
+    return node;
+}
+
+cabor_type cabor_typecheck_parallel(cabor_ast* ast, cabor_ast_node_idx root, cabor_symbol_table* sym_table, size_t num_threads)
+{
+    cabor_task_collector collector =
+    {
+        .root = root,
+        .tasks = cabor_create_vector_with_stride(CABOR_TYPECHECK_BATCH_SIZE, sizeof(cabor_typecheck_task), false),
+    };
+
+    // The scopes of the walk are thrown away with the arena, the tasks outlive it
+    cabor_allocator_context arena;
+    create_cabor_arena_allocator_context(&arena, cabor_get_current_allocator_context(), CABOR_TYPECHECK_ARENA_BLOCK_SIZE);
+    cabor_allocator_context* previous_allocator = cabor_set_current_allocator_context(&arena);
+    cabor_ast_visit_preorder(ast, root, collect_task, &collector);
+    cabor_set_current_allocator_context(previous_allocator);
+    destroy_cabor_allocator_context(&arena);
+
+    cabor_vector* tasks = collector.tasks;
+
+    if (num_threads > CABOR_TYPECHECK_MAX_THREADS)
+        num_threads = CABOR_TYPECHECK_MAX_THREADS;
+    if (num_threads > tasks->size)
+        num_threads = tasks->size;
+
+    if (num_threads <= 1)
+    {
+        cabor_destroy_vector(tasks);
+        return cabor_typecheck(ast, root, sym_table);
+    }
+
+    // Sorted so the results can be looked up and merged in the same order every time
+    qsort(tasks->vector_mem.mem, tasks->size, sizeof(cabor_typecheck_task), compare_tasks);
+
+    cabor_typecheck_pool pool =
+    {
+        .ast = ast,
+        .tasks = tasks,
+        .lock = cabor_create_mutex(),
+        .next_task = 0,
+        .intern_scope = cabor_get_intern_scope(),
+    };
+
+    // One worker per thread, the worker pool runs them and the calling thread takes one too
+    cabor_typecheck_pool* workers[CABOR_TYPECHECK_MAX_THREADS];
+    for (size_t i = 0; i < num_threads; i++)
+        workers[i] = &pool;
+
+    cabor_worker_pool_run(typecheck_worker, workers, sizeof(cabor_typecheck_pool*), num_threads);
+
+    cabor_destroy_mutex(pool.lock);
+
+    cabor_type type = typecheck_around_checked_blocks(ast, root, sym_table, tasks);
+
+    // cabor_typecheck() stops at some errors and leaves the rest of the subtree unchecked, blocks it
+    // didn't get to are put back to unchecked so the result doesn't depend on how the tree was checked
+    for (size_t i = 0; i < tasks->size; i++)
+    {
+        cabor_typecheck_task* task = cabor_vector_at_typecheck_task(tasks, i);
+        if (task->reached)
+            continue;
+
+        for (cabor_ast_node_idx node = subtree_first_node(ast, task->node); node <= task->node; node++)
+            SET_TYPE(node, CABOR_TYPE_ERROR);
+    }
+
+    cabor_destroy_vector(tasks);
+
+    return type;
+}
+
+cabor_type cabor_typecheck_ast(cabor_ast* ast, cabor_symbol_table* sym_table)
+{
+    if (cabor_get_ast_node_count(ast) < CABOR_TYPECHECK_PARALLEL_MIN_NODES)
+        return cabor_typecheck(ast, ast->root, sym_table);
+
+    return cabor_typecheck_parallel(ast, ast->root, sym_table, cabor_get_worker_count() + 1);
+}
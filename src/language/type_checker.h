@@ -5,7 +5,17 @@
 #include "../cabor_defines.h"
 #include "../core/hashmap.h"
 #include <stdint.h>
+#include <stdbool.h>
 
+// Most scopes only declare a handful of names, the map grows when needed
+#define CABOR_SYMBOL_TABLE_INITIAL_SIZE 16
+
+// cabor_typecheck_ast() checks trees of at least this many nodes in parallel, smaller ones are done
+// before the worker pool would have picked them up
+#define CABOR_TYPECHECK_PARALLEL_MIN_NODES (64 * 1024)
+#define CABOR_TYPECHECK_MAX_THREADS 64
+#define CABOR_TYPECHECK_BATCH_SIZE 8                 // blocks a thread claims at a time
+#define CABOR_TYPECHECK_ARENA_BLOCK_SIZE (64 * 1024) // scopes of a thread come from its own arena
 
 typedef struct cabor_symbol_table_t
 {
@@ -14,19 +24,43 @@ typedef struct cabor_symbol_table_t
     struct cabor_symbol_table_t* child_scope;
 } cabor_symbol_table;
 
+// A block below the root that cabor_typecheck_parallel() checks apart from the rest of the tree
+typedef struct
+{
+    cabor_ast_node_idx node;
+    cabor_type type;   // type of the block once checked
+    bool reached;      // the check of the rest of the tree got to the block
+} cabor_typecheck_task;
+
+CABOR_VECTOR_DEFINE_ACCESSORS(typecheck_task, cabor_typecheck_task)
+
 cabor_symbol_table* cabor_create_symbol_table();
 void cabor_destroy_symbol_table(cabor_symbol_table* symbol_table);
 
 cabor_symbol_table* cabor_create_new_symbol_scope(cabor_symbol_table* symbol_table);
 
+// Value of name in the innermost scope that declares it, from symbol_table out to the root scope
+int cabor_symbol_table_lookup(cabor_symbol_table* symbol_table, cabor_atom name, bool* found);
+
 cabor_type cabor_convert_type_declaration_to_type(cabor_token* type_decl);
-cabor_type cabor_typecheck_if_then_else(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table);
-cabor_type cabor_typecheck_binary_op(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table);
-cabor_type cabor_typecheck(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table);
-cabor_type cabor_typecheck_unary_op(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table);
-cabor_type cabor_typecheck_function(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table);
-cabor_type cabor_typecheck_while(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table);
-cabor_type cabor_typecheck_block(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table);
-cabor_type cabor_typecheck_var_expr(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* sym_table);
-cabor_type cabor_typecheck_literal(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* symb_table);
-cabor_type cabor_typecheck_identifier(cabor_ast* ast, cabor_ast_node* node, cabor_symbol_table* symb_table);
+cabor_type cabor_typecheck_if_then_else(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table);
+cabor_type cabor_typecheck_binary_op(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table);
+cabor_type cabor_typecheck(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table);
+
+// Blocks below root that only use names they declare themselves don't depend on the scopes around them.
+// The outermost of those are checked first by num_threads workers on the worker pool, the calling
+// thread included, then the rest of the tree is checked on the calling thread using their types. The
+// types are the same as from cabor_typecheck() however the threads are scheduled. Type errors are logged
+// in a different order, and errors in blocks that cabor_typecheck() would have skipped after an earlier
+// error are logged too.
+cabor_type cabor_typecheck_parallel(cabor_ast* ast, cabor_ast_node_idx root, cabor_symbol_table* sym_table, size_t num_threads);
+
+// Checks the whole tree, on the worker pool when it has at least CABOR_TYPECHECK_PARALLEL_MIN_NODES nodes
+cabor_type cabor_typecheck_ast(cabor_ast* ast, cabor_symbol_table* sym_table);
+cabor_type cabor_typecheck_unary_op(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table);
+cabor_type cabor_typecheck_function(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table);
+cabor_type cabor_typecheck_while(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table);
+cabor_type cabor_typecheck_block(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table);
+cabor_type cabor_typecheck_var_expr(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* sym_table);
+cabor_type cabor_typecheck_literal(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* symb_table);
+cabor_type cabor_typecheck_identifier(cabor_ast* ast, cabor_ast_node_idx node, cabor_symbol_table* symb_table);
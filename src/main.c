@@ -10,9 +10,12 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include "core/vector.h"
 #include "core/memory.h"
+#include "core/intern.h"
+#include "core/worker_pool.h"
 #include "filesystem/filesystem.h"
 #include "language/tokenizer.h"
 #include "language/parser.h"
@@ -29,6 +32,8 @@
 
 #include "language/preamble.h"
 
+#include "bench/tokenizer_bench.h"
+
 #ifdef _DEBUG 
 #define _CRTDBG_MAP_ALLOC
 #include <stdlib.h>
@@ -41,8 +46,9 @@
 #define CABOR_ARG_PARSE (1 << 2)
 #define CABOR_ARG_SERVER (1 << 3)
 #define CABOR_ARG_COMPILE (1 << 4)
+#define CABOR_ARG_BENCH (1 << 5)
 
-static unsigned int parse_cmd_args(int argc, char** argv, int* tokenize_arg, int* parse_arg, int* compile_arg)
+static unsigned int parse_cmd_args(int argc, char** argv, int* tokenize_arg, int* parse_arg, int* compile_arg, int* bench_arg)
 {
 	if (argc < 2)
 		return 0;
@@ -79,6 +85,12 @@ static unsigned int parse_cmd_args(int argc, char** argv, int* tokenize_arg, int
 			bit_flags |= CABOR_ARG_COMPILE;
 			*compile_arg = i + 1;
 		}
+
+		if (!strcmp(arg, "--bench") || !strcmp(arg, "-b"))
+		{
+			bit_flags |= CABOR_ARG_BENCH;
+			*bench_arg = i + 1;
+		}
 	}
 
 	return bit_flags;
@@ -86,12 +98,12 @@ static unsigned int parse_cmd_args(int argc, char** argv, int* tokenize_arg, int
 
 static void run_tokenizer(const char* filename)
 {
-	cabor_file* file = cabor_load_file(filename);
+	cabor_file* file = cabor_map_file(filename);
 	cabor_vector* tokens = cabor_tokenize(file);
 
-	size_t buffer_size = tokens->size * sizeof(cabor_token);
+	size_t buffer_size = cabor_get_stringified_tokens_size(tokens);
 	cabor_allocation buffer = CABOR_MALLOC(buffer_size);
-	cabor_stringify_tokens(buffer.mem, buffer_size, tokens);
+	cabor_stringify_tokens(buffer.mem, buffer_size, tokens, file->file_memory.mem);
 	CABOR_LOG_F("%s", buffer);
 
 	cabor_destroy_file(file);
@@ -105,6 +117,21 @@ static void run_parser(const char* filename)
 	// TODO
 }
 
+// --bench [MiB per program]
+static void run_benchmarks(int argc, char** argv, int bench_arg)
+{
+	cabor_tokenizer_bench_config config = cabor_default_tokenizer_bench_config();
+
+	if (bench_arg < argc)
+	{
+		long mib = strtol(argv[bench_arg], NULL, 10);
+		if (mib > 0)
+			config.source_size = (size_t)mib * 1024 * 1024;
+	}
+
+	cabor_run_tokenizer_benchmarks(&config);
+}
+
 static void run_server()
 {
 	cabor_server_context ctx;
@@ -129,14 +156,17 @@ _CrtSetDbgFlag(CRTDBFLAGS);
 #endif
 
 	CABOR_CREATE_ALLOCATOR();
+	cabor_create_intern_pool();
+	cabor_create_worker_pool();
 	CABOR_INITIALIZE_TEST_FRAMEWORK();
 	CABOR_CREATE_LOGGER();
 
 	int tokenize_arg;
 	int parse_arg;
 	int compile_arg;
+	int bench_arg;
 
-	unsigned int flags = parse_cmd_args(argc, argv, &tokenize_arg, &parse_arg, &compile_arg);
+	unsigned int flags = parse_cmd_args(argc, argv, &tokenize_arg, &parse_arg, &compile_arg, &bench_arg);
 	unsigned int test_results = 0;
 
 	if (flags & CABOR_ARG_ENABLE_TESTING)
@@ -163,9 +193,16 @@ _CrtSetDbgFlag(CRTDBFLAGS);
 	{
 		cabor_compile_premable();
 		const char* filename = argv[compile_arg];
-		cabor_file* code = cabor_load_file(filename);
-		cabor_x64_assembly* asmbl = cabor_compile(code->file_memory.mem, filename);
-		cabor_destroy_x64_assembly(asmbl);
+		cabor_file* code = cabor_map_file(filename);
+		cabor_x64_assembly* asmbl = cabor_compile(code, filename);
+		if (asmbl)
+			cabor_destroy_x64_assembly(asmbl);
+		cabor_destroy_file(code);
+	}
+
+	if (flags & CABOR_ARG_BENCH)
+	{
+		run_benchmarks(argc, argv, bench_arg);
 	}
 
 	if (flags & CABOR_ARG_SERVER)
@@ -176,11 +213,12 @@ _CrtSetDbgFlag(CRTDBFLAGS);
 
 	CABOR_DUMP_LOG_TO_DISK();
 	CABOR_DESTROY_LOGGER();
+	cabor_destroy_worker_pool();
+	cabor_destroy_intern_pool();
 
 #if CABOR_ENABLE_MEMORY_DEBUGGING 
 
 	size_t current_allocated = CABOR_GET_ALLOCATED();
-	cabor_allocator_context* allocator = CABOR_GET_ALLOCATOR();
 
 	// check for memory leaks
 	if (current_allocated > 0)
@@ -189,18 +227,12 @@ _CrtSetDbgFlag(CRTDBFLAGS);
 		const char* prefix = cabor_convert_bytes_to_human_readable(current_allocated, &size);
         printf("\nLeak detected!, there is %.2f %s of unfreed memory!\n", size, prefix);
 #if CABOR_ENABLE_MEMORY_DEBUGGING 
-		printf("\n------------PRINTING ALL ALLOCATOR CALL LOCATIONS------------------\n\n");
-		for (size_t i = 0; i < allocator->debug_size; i++)
-		{
-			printf("%s", allocator->debug[i]);
-		}
-		printf("\n------------------END PRINTING ALLOCATOR CALLS---------------------\n");
-		printf("\n------------PRINTING ALL DEALLOCATOR CALL LOCATIONS----------------\n\n");
-		for (size_t i = 0; i < allocator->dealloc_size; i++)
-		{
-			printf("%s", allocator->dealloc[i]);
-		}
-		printf("\n----------------END PRINTING DEALLOCATOR CALLS---------------------\n");
+		size_t report_size;
+		cabor_allocation report = cabor_create_allocation_trace_report(&report_size);
+		printf("\n------------------ALLOCATIONS PER CALL SITE------------------------\n\n");
+		printf("%.*s", (int)report_size, (char*)report.mem);
+		printf("\n-------------------------------------------------------------------\n");
+		CABOR_FREE(&report);
 #endif
 
 		return 1;
@@ -63,14 +63,14 @@ struct cabor_tcp_client
 static void on_close_timeout(uv_handle_t* timeout)
 {
     cabor_tcp_timeout* cabor_timeout = timeout->data;
-    CABOR_DELETE(cabor_tcp_timeout, cabor_timeout);
+    CABOR_POOL_DELETE(cabor_tcp_timeout, cabor_timeout);
 }
 
 static void on_close_tcp_client(uv_handle_t* client)
 {
     cabor_tcp_client* cabor_client = client->data;
     cabor_destroy_vector(cabor_client->data);
-    CABOR_DELETE(cabor_tcp_client, cabor_client);
+    CABOR_POOL_DELETE(cabor_tcp_client, cabor_client);
 }
 
 static void on_timeout(uv_timer_t* timeout)
@@ -105,7 +105,7 @@ void on_write(uv_write_t* req, int status)
         CABOR_FREE(&alloc);
     }
 
-    CABOR_DELETE(uv_write_t, req);
+    CABOR_POOL_DELETE(uv_write_t, req);
 }
 
 static void alloc_buffer(uv_handle_t* client, size_t suggested_size, uv_buf_t* buf)
@@ -204,10 +204,33 @@ static void on_work(uv_work_t* work)
 
         uint32_t source_hash = cabor_hash_string_with_size((char*)request.source.mem, request.source_size);
 
-        char* filename[128] = {0};
+        char filename[128] = {0};
         int res = snprintf(filename, sizeof(filename), "compile_request_%u", source_hash);
 
-		cabor_x64_assembly* asmbl = cabor_compile((char*)request.source.mem, filename);
+        // The decoded source is not NUL terminated, compile it in place with its length
+        cabor_vector* diagnostics = cabor_create_vector_with_stride(16, sizeof(cabor_diagnostic), false);
+        cabor_x64_assembly* asmbl = cabor_compile_span_with_diagnostics(request.source.mem, request.source_size, filename, diagnostics);
+
+        if (!asmbl)
+        {
+            // Nothing to assemble, answer with every error of the program instead of running gcc on a missing file
+            cabor_network_response resp =
+            {
+                .type = CABOR_COMPILE,
+                .program_text = "failed to parse program",
+                .size = strlen("failed to parse program"),
+                .error = true,
+                .diagnostics = diagnostics,
+            };
+            cabor_encode_network_response(&resp, &cabor_client->response, &cabor_client->response_size);
+
+            cabor_destroy_vector(diagnostics);
+            if (request.source_size > 0)
+                CABOR_FREE(&request.source);
+            return;
+        }
+
+        cabor_destroy_vector(diagnostics);
 
         char* command[128] = { 0 };
         int command_res = snprintf(command, sizeof(command), "gcc -c -no-pie %s.s -o %s.o", filename, filename);
@@ -251,6 +274,7 @@ static void on_work(uv_work_t* work)
         {
             cabor_network_response resp =
             {
+                .type = CABOR_COMPILE,
                 .program_text = cabor_dummy_program,
                 .size = sizeof(cabor_dummy_program),
                 .error = false,
@@ -271,6 +295,22 @@ static void on_work(uv_work_t* work)
         cabor_client->response_size = 0;
         cabor_client->shutdown_requested = true;
     }
+    else if (request.type == CABOR_ALLOCATION_TRACE)
+    {
+        size_t report_size;
+        cabor_allocation report = cabor_create_allocation_trace_report(&report_size);
+
+        cabor_network_response resp =
+        {
+            .type = CABOR_ALLOCATION_TRACE,
+            .program_text = report.mem,
+            .size = report_size,
+            .error = false,
+        };
+        cabor_encode_network_response(&resp, &cabor_client->response, &cabor_client->response_size);
+
+        CABOR_FREE(&report);
+    }
 
     if (request.source_size > 0)
     {
@@ -293,7 +333,7 @@ static void on_after_work(uv_work_t* work, int status)
     cabor_tcp_timeout* cabor_timeout = cabor_client->timeout;
     uv_timer_t* timeout = &cabor_timeout->handle;
 
-    cabor_allocation reqbuf = CABOR_MALLOC(sizeof(uv_write_t));
+    cabor_allocation reqbuf = CABOR_POOL_MALLOC(sizeof(uv_write_t));
     uv_write_t* req = (uv_write_t*)reqbuf.mem;
     req->data = cabor_client;
 
@@ -312,13 +352,13 @@ static void on_after_work(uv_work_t* work, int status)
 
     if (shutdown)
     {
-        CABOR_DELETE(uv_work_t, work);
+        CABOR_POOL_DELETE(uv_work_t, work);
         uv_close((uv_handle_t*)cabor_client->server_context->servermem.mem, NULL);
         CABOR_LOG("SHUTDOWN received, shutting down the server")
         return;
     }
 
-    CABOR_DELETE(uv_work_t, work);
+    CABOR_POOL_DELETE(uv_work_t, work);
 }
 
 static void on_read(uv_stream_t* client, ssize_t nread, const uv_buf_t* buf)
@@ -355,7 +395,7 @@ static void on_read(uv_stream_t* client, ssize_t nread, const uv_buf_t* buf)
             CABOR_LOG("Received: EMFILE");
         }
 
-        cabor_allocation work_alloc = CABOR_MALLOC(sizeof(uv_work_t));
+        cabor_allocation work_alloc = CABOR_POOL_MALLOC(sizeof(uv_work_t));
         uv_work_t* work = work_alloc.mem;
         work->data = cabor_client;
 
@@ -373,12 +413,12 @@ static void on_new_connection(uv_stream_t* server, int status)
         return;
     }
 
-    CABOR_NEW(cabor_tcp_client, cabor_client);
+    CABOR_POOL_NEW(cabor_tcp_client, cabor_client);
     cabor_client->data = cabor_create_vector(2, CABOR_UCHAR, true);
     cabor_client->shutdown_requested = false;
     cabor_client->server_context = server->data;
 
-    cabor_allocation timeoutmem = CABOR_MALLOC(sizeof(cabor_tcp_timeout));
+    cabor_allocation timeoutmem = CABOR_POOL_MALLOC(sizeof(cabor_tcp_timeout));
     cabor_tcp_timeout* cabor_timeout = timeoutmem.mem;
 
     uv_timer_t* timeout = &cabor_timeout->handle;
@@ -403,7 +443,7 @@ static void on_new_connection(uv_stream_t* server, int status)
     else 
     {
         uv_close((uv_handle_t*)client, on_close_tcp_client);
-        CABOR_DELETE(cabor_tcp_timeout, cabor_timeout);
+        CABOR_POOL_DELETE(cabor_tcp_timeout, cabor_timeout);
     }
 }
 
@@ -494,6 +534,13 @@ int cabor_decode_network_request(const void* buffer, const size_t buffer_size, c
         json_decref(root);
         return 0;
     }
+    else if (strcmp(type, "allocations") == 0)
+    {
+        request->type = CABOR_ALLOCATION_TRACE;
+        request->source_size = 0;
+        json_decref(root);
+        return 0;
+    }
     json_decref(root);
     return 1;
 }
@@ -506,11 +553,31 @@ void cabor_encode_network_response(const cabor_network_response* response, cabor
 
     if (!response->error)
     {
-        json_object_set_new(root, "program", json_string(response->program_text));
+        const char* key = response->type == CABOR_ALLOCATION_TRACE ? "trace" : "program";
+        json_object_set_new(root, key, json_string(response->program_text));
     }
     else
     {
         json_object_set_new(root, "error", json_string(response->program_text));
+
+        if (response->diagnostics)
+        {
+            // [{ "line": 1, "column": 5, "message": "..." }, ...], line and column are 0 at the end of the input
+            json_t* diagnostics = json_array();
+
+            for (size_t i = 0; i < response->diagnostics->size; i++)
+            {
+                const cabor_diagnostic* diagnostic = cabor_vector_at_diagnostic(response->diagnostics, i);
+
+                json_t* entry = json_object();
+                json_object_set_new(entry, "line", json_integer(diagnostic->location.line));
+                json_object_set_new(entry, "column", json_integer(diagnostic->location.column));
+                json_object_set_new(entry, "message", json_string(diagnostic->message));
+                json_array_append_new(diagnostics, entry);
+            }
+
+            json_object_set_new(root, "diagnostics", diagnostics);
+        }
     }
 
     char* json_str = json_dumps(root, JSON_INDENT(4));
@@ -2,6 +2,7 @@
 
 #include "../cabor_defines.h"
 #include "../core/memory.h"
+#include "../core/vector.h"
 #include "../filesystem/filesystem.h"
 #include <stdbool.h>
 
@@ -15,7 +16,8 @@ typedef enum
 {
     CABOR_PING,
     CABOR_COMPILE,
-    CABOR_SHUTDOWN
+    CABOR_SHUTDOWN,
+    CABOR_ALLOCATION_TRACE, // responds with allocation statistics per call site, see cabor_create_allocation_trace_report()
 } cabor_command_type;
 
 typedef struct
@@ -27,9 +29,11 @@ typedef struct
 
 typedef struct
 {
+    cabor_command_type type;
     char* program_text;
     size_t size;
     bool error; // error message is placed in program_text when there is a error
+    cabor_vector* diagnostics; // cabor_diagnostic, sent with the error when not NULL so every error is reported at once
 } cabor_network_response;
 
 int cabor_start_compile_server(cabor_server_context* ctx);
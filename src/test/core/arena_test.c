@@ -0,0 +1,98 @@
+#include "arena_test.h"
+
+#ifdef CABOR_ENABLE_TESTING
+
+#include <stdint.h>
+#include <string.h>
+#include "../../core/vector.h"
+#include "../../core/hashmap.h"
+
+int cabor_unit_test_arena_alloc()
+{
+    cabor_allocator_context arena;
+    create_cabor_arena_allocator_context(&arena, cabor_get_current_allocator_context(), 256);
+
+    int res = 0;
+
+    // Enough allocations to span multiple blocks, including one bigger than the block size
+    for (size_t i = 1; i < 100; i++)
+    {
+        cabor_allocation alloc = CABOR_MALLOC_CTX(&arena, i * 3);
+        CABOR_CHECK_EQUALS((uintptr_t)alloc.mem % CABOR_ARENA_ALIGNMENT, 0, res);
+        memset(alloc.mem, 0xAB, i * 3);
+    }
+
+    cabor_allocation big = CABOR_MALLOC_CTX(&arena, 4096);
+    CABOR_CHECK_EQUALS(cabor_arena_owns(&arena.arena, big.mem), true, res);
+    CABOR_CHECK_GREATER(arena.arena.reserved, 4096, res);
+
+    destroy_cabor_allocator_context(&arena);
+
+    CABOR_CHECK_EQUALS(arena.arena.reserved, 0, res);
+    CABOR_CHECK_EQUALS(arena.allocated_mem, 0, res);
+
+    return res;
+}
+
+int cabor_unit_test_arena_realloc()
+{
+    cabor_allocator_context arena;
+    create_cabor_arena_allocator_context(&arena, cabor_get_current_allocator_context(), 1024);
+
+    int res = 0;
+
+    cabor_allocation alloc = CABOR_MALLOC_CTX(&arena, 8);
+    memcpy(alloc.mem, "cabor12", 8);
+
+    // Latest allocation grows in place
+    cabor_allocation grown = CABOR_REALLOC_CTX(&arena, &alloc, 64);
+    CABOR_CHECK_EQUALS((grown.mem == alloc.mem), true, res);
+
+    // Something else allocated in between, realloc has to copy
+    cabor_allocation other = CABOR_MALLOC_CTX(&arena, 16);
+    CABOR_CHECK_EQUALS(cabor_arena_owns(&arena.arena, other.mem), true, res);
+    CABOR_CHECK_EQUALS(((char*)other.mem > (char*)grown.mem), true, res);
+    cabor_allocation moved = CABOR_REALLOC_CTX(&arena, &grown, 128);
+    CABOR_CHECK_EQUALS((moved.mem != grown.mem), true, res);
+    CABOR_CHECK_EQUALS(strcmp(moved.mem, "cabor12"), 0, res);
+    CABOR_CHECK_EQUALS(cabor_arena_allocation_size(moved.mem), 128, res);
+
+    destroy_cabor_allocator_context(&arena);
+
+    return res;
+}
+
+int cabor_unit_test_arena_vector()
+{
+    cabor_allocator_context arena;
+    create_cabor_arena_allocator_context(&arena, cabor_get_current_allocator_context(), CABOR_ARENA_DEFAULT_BLOCK_SIZE);
+    cabor_allocator_context* previous = cabor_set_current_allocator_context(&arena);
+
+    cabor_vector* vec = cabor_create_vector(1, CABOR_INT, false);
+    for (int i = 0; i < 1000; i++)
+        cabor_vector_push_int(vec, i);
+
+    cabor_hash_map* map = cabor_create_hash_map(16);
+    cabor_map_insert(map, "cabor", 1);
+
+    cabor_set_current_allocator_context(previous);
+
+    int res = 0;
+    CABOR_CHECK_EQUALS((vec->allocator == &arena), true, res);
+    CABOR_CHECK_EQUALS(cabor_vector_get_int(vec, 999), 999, res);
+
+    // Pushing after the arena is no longer current still grows inside the arena
+    for (int i = 0; i < 1000; i++)
+        cabor_vector_push_int(vec, i);
+    CABOR_CHECK_EQUALS(cabor_arena_owns(&arena.arena, vec->vector_mem.mem), true, res);
+
+    bool found = false;
+    CABOR_CHECK_EQUALS(cabor_map_get(map, "cabor", &found), 1, res);
+
+    // No need to destroy the vector or the map
+    destroy_cabor_allocator_context(&arena);
+
+    return res;
+}
+
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "../../cabor_defines.h"
+
+#ifdef CABOR_ENABLE_TESTING
+
+#include "../test_framework.h"
+#include "../../core/memory.h"
+
+int cabor_unit_test_arena_alloc();
+int cabor_unit_test_arena_realloc();
+int cabor_unit_test_arena_vector();
+
+#endif
@@ -93,4 +93,71 @@ int cabor_unit_test_hashmap_tiny_collisions()
 
 }
 
+int cabor_unit_test_hashmap_grow()
+{
+    cabor_hash_map* map = cabor_create_hash_map(1);
+
+    int res = 0;
+    CABOR_CHECK_EQUALS(map->table->size, CABOR_HASH_MAP_MIN_CAPACITY, res);
+
+    char key[16];
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(key, sizeof(key), "var%d", i);
+        cabor_map_insert(map, key, i);
+    }
+
+    // Shadowing replaces the value without adding a new entry
+    cabor_map_insert(map, "var10", -10);
+
+    CABOR_CHECK_EQUALS(map->count, 1000, res);
+    CABOR_CHECK_GREATER(map->table->size * CABOR_HASH_MAP_MAX_LOAD_PERCENT, map->count * 100 - 1, res);
+
+    size_t used = 0;
+    for (size_t i = 0; i < map->table->size; i++)
+    {
+        cabor_map_entry* entry = cabor_vector_get_map_entry(map->table, i);
+        if (entry->key)
+        {
+            CABOR_CHECK_EQUALS(entry->hash, cabor_hash_string(entry->key), res);
+            used++;
+        }
+    }
+    CABOR_CHECK_EQUALS(used, 1000, res);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(key, sizeof(key), "var%d", i);
+        bool found = false;
+        int value = cabor_map_get(map, key, &found);
+        CABOR_CHECK_EQUALS(found, true, res);
+        CABOR_CHECK_EQUALS(value, (i == 10 ? -10 : i), res);
+    }
+
+    bool found = true;
+    cabor_map_get(map, "var1000", &found);
+    CABOR_CHECK_EQUALS(found, false, res);
 
+    cabor_destroy_hash_map(map);
+
+    return res;
+}
+
+int cabor_unit_test_hashmap_borrowed_keys()
+{
+    cabor_hash_map* map = cabor_create_hash_map_with_borrowed_keys(4);
+
+    const char* key = "print_int";
+    cabor_map_entry* entry = cabor_map_insert(map, key, 1);
+
+    int res = 0;
+    CABOR_CHECK_EQUALS((entry->key == key), true, res);
+
+    bool found = false;
+    CABOR_CHECK_EQUALS(cabor_map_get(map, "print_int", &found), 1, res);
+    CABOR_CHECK_EQUALS(found, true, res);
+
+    cabor_destroy_hash_map(map);
+
+    return res;
+}
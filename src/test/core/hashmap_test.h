@@ -10,5 +10,7 @@
 int cabor_unit_test_hashmap_insert_and_get();
 int cabor_unit_test_hashmap_collison_test();
 int cabor_unit_test_hashmap_tiny_collisions();
+int cabor_unit_test_hashmap_grow();
+int cabor_unit_test_hashmap_borrowed_keys();
 
 #endif
@@ -0,0 +1,205 @@
+#include "intern_test.h"
+
+#ifdef CABOR_ENABLE_TESTING
+
+#include <stdio.h>
+#include <string.h>
+#include <uv.h>
+
+#include "../../core/hashmap.h"
+#include "../../language/tokenizer.h"
+
+#define CABOR_TEST_INTERN_THREADS 4
+#define CABOR_TEST_INTERN_STRINGS 2048
+
+int cabor_unit_test_intern_builtins()
+{
+    int res = 0;
+
+    CABOR_CHECK_EQUALS(cabor_intern("while"), CABOR_ATOM_WHILE, res);
+    CABOR_CHECK_EQUALS(cabor_intern(">="), CABOR_ATOM_GE, res);
+    CABOR_CHECK_EQUALS(cabor_intern("unary_not"), CABOR_ATOM_UNARY_NOT, res);
+    CABOR_CHECK_EQUALS(cabor_intern(""), CABOR_ATOM_INVALID, res);
+    CABOR_CHECK_EQUALS(strcmp(cabor_atom_str(CABOR_ATOM_PRINT_INT), "print_int"), 0, res);
+
+    CABOR_CHECK_EQUALS(cabor_atom_is_keyword(CABOR_ATOM_VAR), true, res);
+    CABOR_CHECK_EQUALS(cabor_atom_is_keyword(CABOR_ATOM_TRUE), false, res);
+    CABOR_CHECK_EQUALS(cabor_atom_is_keyword(cabor_intern("iffy")), false, res);
+
+    // Only the first size characters count
+    cabor_atom atom = cabor_intern_with_size("intern_test_abc", 13);
+    CABOR_CHECK_EQUALS(atom, cabor_intern("intern_test_a"), res);
+    CABOR_CHECK_EQUALS(cabor_atom_length(atom), 13, res);
+    CABOR_CHECK_EQUALS(cabor_atom_hash(atom), cabor_hash_string("intern_test_a"), res);
+    CABOR_CHECK_EQUALS((atom != cabor_intern("intern_test_abc")), true, res);
+
+    // Atom and string lookups find the same entries
+    cabor_hash_map* map = cabor_create_hash_map_with_borrowed_keys(8);
+    cabor_map_insert_atom(map, atom, 7);
+    cabor_map_insert(map, "intern_test_b", 8);
+
+    bool found = false;
+    CABOR_CHECK_EQUALS(cabor_map_get(map, "intern_test_a", &found), 7, res);
+    CABOR_CHECK_EQUALS(found, true, res);
+    CABOR_CHECK_EQUALS(cabor_map_get_atom(map, cabor_intern("intern_test_b"), &found), 8, res);
+    CABOR_CHECK_EQUALS(found, true, res);
+    cabor_map_get_atom(map, CABOR_ATOM_IF, &found);
+    CABOR_CHECK_EQUALS(found, false, res);
+
+    cabor_destroy_hash_map(map);
+
+    return res;
+}
+
+typedef struct
+{
+    size_t offset; // threads intern the same strings starting from different positions
+    cabor_atom atoms[CABOR_TEST_INTERN_STRINGS];
+} cabor_test_intern_thread;
+
+static void intern_thread(void* arg)
+{
+    cabor_test_intern_thread* thread = arg;
+    char buffer[32];
+
+    for (size_t n = 0; n < CABOR_TEST_INTERN_STRINGS; n++)
+    {
+        size_t i = (n + thread->offset) % CABOR_TEST_INTERN_STRINGS;
+        snprintf(buffer, sizeof(buffer), "intern_thread_%zu", i);
+        thread->atoms[i] = cabor_intern(buffer);
+    }
+}
+
+int cabor_unit_test_intern_threads()
+{
+    int res = 0;
+
+    cabor_test_intern_thread threads[CABOR_TEST_INTERN_THREADS];
+    uv_thread_t handles[CABOR_TEST_INTERN_THREADS];
+
+    for (size_t i = 0; i < CABOR_TEST_INTERN_THREADS; i++)
+    {
+        threads[i].offset = i * (CABOR_TEST_INTERN_STRINGS / CABOR_TEST_INTERN_THREADS);
+        uv_thread_create(&handles[i], intern_thread, &threads[i]);
+    }
+    for (size_t i = 0; i < CABOR_TEST_INTERN_THREADS; i++)
+        uv_thread_join(&handles[i]);
+
+    // Every thread got the same atom for the same string and the atoms are distinct
+    char buffer[32];
+    for (size_t i = 0; i < CABOR_TEST_INTERN_STRINGS; i++)
+    {
+        cabor_atom atom = threads[0].atoms[i];
+        for (size_t t = 1; t < CABOR_TEST_INTERN_THREADS; t++)
+            CABOR_CHECK_EQUALS(threads[t].atoms[i], atom, res);
+
+        snprintf(buffer, sizeof(buffer), "intern_thread_%zu", i);
+        CABOR_CHECK_EQUALS(strcmp(cabor_atom_str(atom), buffer), 0, res);
+        CABOR_CHECK_EQUALS(cabor_intern(buffer), atom, res);
+
+        if (i > 0)
+            CABOR_CHECK_EQUALS((atom != threads[0].atoms[i - 1]), true, res);
+    }
+
+    CABOR_CHECK_GREATER(cabor_get_interned_count(), CABOR_TEST_INTERN_STRINGS, res);
+
+    return res;
+}
+
+// The pool adds chunks as it fills, atoms of earlier chunks keep their strings
+int cabor_unit_test_intern_grow()
+{
+    int res = 0;
+
+    size_t num_strings = 3 * CABOR_INTERN_CHUNK_SIZE;
+    size_t first_count = cabor_get_interned_count();
+    cabor_atom first = CABOR_ATOM_INVALID;
+
+    char buffer[32];
+    for (size_t i = 0; i < num_strings; i++)
+    {
+        snprintf(buffer, sizeof(buffer), "intern_grow_%zu", i);
+        cabor_atom atom = cabor_intern(buffer);
+        if (i == 0)
+            first = atom;
+
+        CABOR_CHECK_EQUALS(atom, first + i, res);
+    }
+
+    CABOR_CHECK_EQUALS(cabor_get_interned_count(), first_count + num_strings, res);
+    CABOR_CHECK_EQUALS(strcmp(cabor_atom_str(first), "intern_grow_0"), 0, res);
+    CABOR_CHECK_EQUALS(strcmp(cabor_atom_str(CABOR_ATOM_WHILE), "while"), 0, res);
+
+    snprintf(buffer, sizeof(buffer), "intern_grow_%zu", num_strings - 1);
+    CABOR_CHECK_EQUALS(cabor_intern(buffer), first + num_strings - 1, res);
+
+    return res;
+}
+
+// Strings interned in a scope go away with it, the pool only keeps the strings it had
+int cabor_unit_test_intern_scope()
+{
+    int res = 0;
+
+    cabor_atom pooled = cabor_intern("intern_scope_pooled");
+    size_t pool_count = cabor_get_interned_count();
+
+    cabor_intern_scope* scope = cabor_create_intern_scope();
+    cabor_intern_scope* previous_scope = cabor_set_intern_scope(scope);
+
+    cabor_atom local = cabor_intern("intern_scope_local");
+    CABOR_CHECK_EQUALS(((local & CABOR_ATOM_LOCAL_BIT) != 0), true, res);
+    CABOR_CHECK_EQUALS(cabor_intern("intern_scope_local"), local, res);
+    CABOR_CHECK_EQUALS(strcmp(cabor_atom_str(local), "intern_scope_local"), 0, res);
+    CABOR_CHECK_EQUALS(cabor_atom_length(local), 18, res);
+    CABOR_CHECK_EQUALS(cabor_atom_hash(local), cabor_hash_string("intern_scope_local"), res);
+
+    // Strings of the pool keep their atom
+    CABOR_CHECK_EQUALS(cabor_intern("print_int"), CABOR_ATOM_PRINT_INT, res);
+    CABOR_CHECK_EQUALS(cabor_intern("intern_scope_pooled"), pooled, res);
+
+    // The scope grows like the pool
+    char buffer[48];
+    size_t num_strings = 2 * CABOR_INTERN_CHUNK_SIZE;
+    cabor_atom first = CABOR_ATOM_INVALID;
+    for (size_t i = 0; i < num_strings; i++)
+    {
+        snprintf(buffer, sizeof(buffer), "intern_scope_%zu", i);
+        cabor_atom atom = cabor_intern(buffer);
+        if (i == 0)
+            first = atom;
+
+        CABOR_CHECK_EQUALS(atom, first + i, res);
+    }
+    CABOR_CHECK_EQUALS(strcmp(cabor_atom_str(first), "intern_scope_0"), 0, res);
+
+    // Tokenizer threads intern into the scope of the thread that tokenizes
+    const size_t num_identifiers = 4096;
+    cabor_allocation source = CABOR_MALLOC(num_identifiers * 32);
+    size_t size = 0;
+    for (size_t i = 0; i < num_identifiers; i++)
+        size += sprintf((char*)source.mem + size, "intern_scope_token_%zu ", i);
+
+    cabor_file* file = cabor_file_from_buffer(source.mem, size);
+    cabor_vector* tokens = cabor_tokenize_parallel(file, 4, NULL);
+    CABOR_CHECK_EQUALS(tokens->size, num_identifiers, res);
+    for (size_t i = 0; i < tokens->size && i < num_identifiers; i++)
+    {
+        snprintf(buffer, sizeof(buffer), "intern_scope_token_%zu", i);
+        CABOR_CHECK_EQUALS(cabor_vector_at_token(tokens, i)->atom, cabor_intern(buffer), res);
+        CABOR_CHECK_EQUALS(strcmp(cabor_atom_str(cabor_vector_at_token(tokens, i)->atom), buffer), 0, res);
+    }
+    cabor_destroy_vector(tokens);
+    cabor_destroy_file(file);
+    CABOR_FREE(&source);
+
+    cabor_set_intern_scope(previous_scope);
+    cabor_destroy_intern_scope(scope);
+
+    CABOR_CHECK_EQUALS(cabor_get_interned_count(), pool_count, res);
+    CABOR_CHECK_EQUALS(cabor_intern("intern_scope_pooled"), pooled, res);
+
+    return res;
+}
+
+#endif
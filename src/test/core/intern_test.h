@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../../cabor_defines.h"
+
+#ifdef CABOR_ENABLE_TESTING
+
+#include "../test_framework.h"
+#include "../../core/intern.h"
+
+int cabor_unit_test_intern_builtins();
+int cabor_unit_test_intern_threads();
+int cabor_unit_test_intern_grow();
+int cabor_unit_test_intern_scope();
+
+#endif
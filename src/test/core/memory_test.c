@@ -0,0 +1,141 @@
+#include "memory_test.h"
+
+#ifdef CABOR_ENABLE_TESTING
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <uv.h>
+
+#define CABOR_TEST_ALLOCATOR_THREADS 4
+#define CABOR_TEST_ALLOCATIONS_PER_THREAD 64
+
+typedef struct
+{
+    cabor_allocator_context* thread_ctx;
+    cabor_allocation allocations[CABOR_TEST_ALLOCATIONS_PER_THREAD];
+} cabor_test_allocator_thread;
+
+static void allocator_thread(void* arg)
+{
+    cabor_test_allocator_thread* thread = arg;
+    thread->thread_ctx = cabor_get_thread_allocator_context();
+
+    for (size_t i = 0; i < CABOR_TEST_ALLOCATIONS_PER_THREAD; i++)
+        thread->allocations[i] = CABOR_MALLOC(i + 1);
+
+    // Free half here, the rest is freed by the main thread
+    for (size_t i = 0; i < CABOR_TEST_ALLOCATIONS_PER_THREAD / 2; i++)
+        CABOR_FREE(&thread->allocations[i]);
+}
+
+int cabor_unit_test_thread_allocator_contexts()
+{
+    int res = 0;
+
+    size_t allocated_before = CABOR_GET_ALLOCATED();
+    cabor_allocator_context* main_ctx = cabor_get_thread_allocator_context();
+
+    cabor_test_allocator_thread threads[CABOR_TEST_ALLOCATOR_THREADS];
+    uv_thread_t handles[CABOR_TEST_ALLOCATOR_THREADS];
+
+    for (size_t i = 0; i < CABOR_TEST_ALLOCATOR_THREADS; i++)
+        uv_thread_create(&handles[i], allocator_thread, &threads[i]);
+
+    // Totals can be read while the threads are still allocating
+    for (size_t i = 0; i < CABOR_TEST_ALLOCATIONS_PER_THREAD; i++)
+        CABOR_GET_ALLOCATED();
+
+    for (size_t i = 0; i < CABOR_TEST_ALLOCATOR_THREADS; i++)
+        uv_thread_join(&handles[i]);
+
+    for (size_t i = 0; i < CABOR_TEST_ALLOCATOR_THREADS; i++)
+    {
+        CABOR_CHECK_EQUALS((threads[i].thread_ctx != main_ctx), true, res);
+        CABOR_CHECK_EQUALS((uintptr_t)threads[i].thread_ctx % CABOR_CACHE_LINE_SIZE, 0, res);
+        for (size_t j = i + 1; j < CABOR_TEST_ALLOCATOR_THREADS; j++)
+            CABOR_CHECK_EQUALS((threads[i].thread_ctx != threads[j].thread_ctx), true, res);
+    }
+
+    for (size_t i = 0; i < CABOR_TEST_ALLOCATOR_THREADS; i++)
+    {
+        for (size_t j = CABOR_TEST_ALLOCATIONS_PER_THREAD / 2; j < CABOR_TEST_ALLOCATIONS_PER_THREAD; j++)
+            CABOR_FREE(&threads[i].allocations[j]);
+    }
+
+    // Memory freed on another thread than it was allocated on still sums up to zero
+    CABOR_CHECK_EQUALS(CABOR_GET_ALLOCATED(), allocated_before, res);
+
+    return res;
+}
+
+static void trace_thread(void* arg)
+{
+    cabor_allocation_trace_table* table = arg;
+
+    static char sites[CABOR_ALLOCATION_TRACE_SITES][16];
+    for (size_t i = 0; i < CABOR_ALLOCATION_TRACE_SITES; i++)
+    {
+        snprintf(sites[i], sizeof(sites[i]), "thread %zu", i);
+        cabor_trace_allocation(table, sites[i], 1);
+    }
+}
+
+int cabor_unit_test_allocation_trace()
+{
+    int res = 0;
+
+    cabor_allocation_trace_table* first = calloc(1, sizeof(cabor_allocation_trace_table));
+    cabor_allocation_trace_table* second = calloc(1, sizeof(cabor_allocation_trace_table));
+
+    // More call sites than the table holds, everything that doesn't fit goes to the overflow entry
+    static char sites[CABOR_ALLOCATION_TRACE_SITES * 2][16];
+    for (size_t i = 0; i < CABOR_ALLOCATION_TRACE_SITES * 2; i++)
+    {
+        snprintf(sites[i], sizeof(sites[i]), "site %zu", i);
+        cabor_trace_allocation(first, sites[i], 1);
+    }
+
+    size_t traced = first->overflow.alloc_count;
+    for (size_t i = 0; i < CABOR_ALLOCATION_TRACE_SITES; i++)
+        traced += first->sites[i].alloc_count;
+
+    CABOR_CHECK_EQUALS(traced, CABOR_ALLOCATION_TRACE_SITES * 2, res);
+    CABOR_CHECK_GREATER(first->overflow.alloc_count, CABOR_ALLOCATION_TRACE_SITES - 1, res);
+
+    // Same call site from two threads is merged into one line
+    memset(first, 0, sizeof(cabor_allocation_trace_table));
+    cabor_trace_allocation(first, "a.c:1", 10);
+    cabor_trace_allocation(second, "a.c:1", 20);
+    cabor_trace_deallocation(second, "b.c:2", 30);
+
+    cabor_allocation_trace_table* tables[] = { first, second };
+    char report[256];
+    size_t report_size = cabor_format_allocation_trace(tables, 2, report, sizeof(report));
+
+    CABOR_CHECK_EQUALS(report_size, strlen(report), res);
+    CABOR_CHECK_EQUALS(strcmp(report,
+        "a.c:1 allocs: 2 (30 B) frees: 0 (0 B)\n"
+        "b.c:2 allocs: 0 (0 B) frees: 1 (30 B)\n"), 0, res);
+
+    // Reports can be made while the owner of a table is still adding sites to it
+    memset(second, 0, sizeof(cabor_allocation_trace_table));
+    uv_thread_t handle;
+    uv_thread_create(&handle, trace_thread, second);
+    for (size_t i = 0; i < 16; i++)
+        cabor_format_allocation_trace(&tables[1], 1, NULL, 0);
+    uv_thread_join(&handle);
+
+    size_t thread_traced = second->overflow.alloc_count;
+    for (size_t i = 0; i < CABOR_ALLOCATION_TRACE_SITES; i++)
+        thread_traced += second->sites[i].alloc_count;
+    CABOR_CHECK_EQUALS(thread_traced, CABOR_ALLOCATION_TRACE_SITES, res);
+
+    free(first);
+    free(second);
+
+    return res;
+}
+
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../../cabor_defines.h"
+
+#ifdef CABOR_ENABLE_TESTING
+
+#include "../test_framework.h"
+#include "../../core/memory.h"
+
+int cabor_unit_test_thread_allocator_contexts();
+int cabor_unit_test_allocation_trace();
+
+#endif
@@ -0,0 +1,76 @@
+#include "pool_test.h"
+
+#ifdef CABOR_ENABLE_TESTING
+
+#include <stdint.h>
+#include <string.h>
+
+int cabor_unit_test_pool_alloc()
+{
+    int res = 0;
+
+    cabor_pool pool;
+    cabor_pool_init(&pool, cabor_get_current_allocator_context(), 24, 4);
+
+    // Consecutive objects are adjacent until the slab runs out
+    char* objects[10];
+    for (size_t i = 0; i < 10; i++)
+    {
+        objects[i] = cabor_pool_alloc(&pool);
+        memset(objects[i], 0xAB, 24);
+        CABOR_CHECK_EQUALS(cabor_pool_owns(&pool, objects[i]), true, res);
+    }
+
+    CABOR_CHECK_EQUALS(objects[1] - objects[0], 24, res);
+    CABOR_CHECK_EQUALS(objects[3] - objects[2], 24, res);
+
+    // Freed objects are reused before the slab cursor moves, last freed first
+    cabor_pool_free(&pool, objects[2]);
+    cabor_pool_free(&pool, objects[5]);
+    CABOR_CHECK_EQUALS((cabor_pool_alloc(&pool) == objects[5]), true, res);
+    CABOR_CHECK_EQUALS((cabor_pool_alloc(&pool) == objects[2]), true, res);
+
+    char* fresh = cabor_pool_alloc(&pool);
+    CABOR_CHECK_EQUALS(fresh - objects[9], 24, res);
+
+    cabor_pool_release(&pool);
+    CABOR_CHECK_EQUALS((pool.slabs == NULL), true, res);
+
+    return res;
+}
+
+int cabor_unit_test_pooled_malloc()
+{
+    int res = 0;
+
+    size_t allocated_before = CABOR_GET_ALLOCATED();
+
+    cabor_allocation small = CABOR_POOL_MALLOC(20);
+    cabor_allocation other = CABOR_POOL_MALLOC(20);
+    cabor_allocation big = CABOR_POOL_MALLOC(CABOR_POOL_MAX_OBJECT_SIZE + 1);
+
+    CABOR_CHECK_EQUALS((other.mem != small.mem), true, res);
+    memset(big.mem, 0, CABOR_POOL_MAX_OBJECT_SIZE + 1);
+
+    CABOR_POOL_FREE(&small, 20);
+    cabor_allocation reused = CABOR_POOL_MALLOC(17);
+    CABOR_CHECK_EQUALS((reused.mem == small.mem), true, res);
+
+    CABOR_POOL_FREE(&reused, 17);
+    CABOR_POOL_FREE(&other, 20);
+    CABOR_POOL_FREE(&big, CABOR_POOL_MAX_OBJECT_SIZE + 1);
+
+    CABOR_CHECK_EQUALS(CABOR_GET_ALLOCATED(), allocated_before, res);
+
+    // Arenas serve pooled allocations themselves
+    cabor_allocator_context arena;
+    create_cabor_arena_allocator_context(&arena, cabor_get_current_allocator_context(), 256);
+    cabor_allocation in_arena = CABOR_POOL_MALLOC_CTX(&arena, 20);
+    CABOR_CHECK_EQUALS(cabor_arena_owns(&arena.arena, in_arena.mem), true, res);
+    CABOR_POOL_FREE_CTX(&arena, &in_arena, 20);
+    destroy_cabor_allocator_context(&arena);
+
+    return res;
+}
+
+#endif
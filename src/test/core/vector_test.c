@@ -84,4 +84,49 @@ int cabor_test_zero_vector_initialized()
     return res;
 }
 
+typedef struct
+{
+    int a;
+    double b;
+    char c[3];
+} cabor_test_vector_element;
+
+CABOR_VECTOR_DEFINE_ACCESSORS(test_element, cabor_test_vector_element)
+
+int cabor_test_vector_stride()
+{
+    cabor_vector* vec = cabor_create_vector_with_stride(0, sizeof(cabor_test_vector_element), false);
+
+    int res = 0;
+    CABOR_CHECK_EQUALS(vec->stride, sizeof(cabor_test_vector_element), res);
+
+    for (int i = 0; i < 100; i++)
+    {
+        cabor_test_vector_element e = { .a = i, .b = i * 0.5, .c = { 'x', 'y', 'z' } };
+        if (i % 2)
+            cabor_vector_append_test_element(vec, &e);
+        else
+            cabor_vector_push(vec, &e);
+    }
+
+    CABOR_CHECK_EQUALS(vec->size, 100, res);
+
+    for (int i = 0; i < 100; i++)
+    {
+        cabor_test_vector_element* e = cabor_vector_at_test_element(vec, i);
+        CABOR_CHECK_EQUALS(e->a, i, res);
+        CABOR_CHECK_EQUALS(e->c[2], 'z', res);
+        CABOR_CHECK_EQUALS((e == cabor_vector_get(vec, i)), true, res);
+    }
+
+    cabor_destroy_vector(vec);
+
+    // Typed vectors get their stride from the element type
+    cabor_vector* ints = cabor_create_vector(4, CABOR_INT, false);
+    CABOR_CHECK_EQUALS(ints->stride, sizeof(int), res);
+    cabor_destroy_vector(ints);
+
+    return res;
+}
+
 #endif // CABOR_ENABLE_TESTING
@@ -11,5 +11,6 @@ int cabor_test_vector_get();
 int cabor_test_vector_peek();
 int cabor_test_vector_resize();
 int cabor_test_zero_vector_initialized();
+int cabor_test_vector_stride();
 
 #endif // CABOR_ENABLE_TESTING
@@ -0,0 +1,92 @@
+#include "worker_pool_test.h"
+
+#ifdef CABOR_ENABLE_TESTING
+
+#include <uv.h>
+
+#define CABOR_TEST_WORKER_ITEMS 1000
+#define CABOR_TEST_WORKER_SUBMITTERS 4
+
+typedef struct
+{
+    size_t value;
+    size_t runs;
+} cabor_test_worker_item;
+
+static void square_item(void* arg)
+{
+    cabor_test_worker_item* item = arg;
+    item->value *= item->value;
+    item->runs++;
+}
+
+static int check_items(cabor_test_worker_item* items, size_t count)
+{
+    int res = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        CABOR_CHECK_EQUALS(items[i].runs, 1, res);
+        CABOR_CHECK_EQUALS(items[i].value, i * i, res);
+    }
+    return res;
+}
+
+int cabor_unit_test_worker_pool_run()
+{
+    int res = 0;
+
+    CABOR_CHECK_GREATER(cabor_get_worker_count(), 0, res);
+
+    // Every item runs exactly once, however many threads took part
+    static cabor_test_worker_item items[CABOR_TEST_WORKER_ITEMS];
+    for (size_t count = 0; count <= CABOR_TEST_WORKER_ITEMS; count += 250)
+    {
+        for (size_t i = 0; i < count; i++)
+            items[i] = (cabor_test_worker_item){ .value = i, .runs = 0 };
+
+        cabor_worker_pool_run(square_item, items, sizeof(cabor_test_worker_item), count);
+
+        if (check_items(items, count))
+            res = 1;
+    }
+
+    return res;
+}
+
+typedef struct
+{
+    cabor_test_worker_item items[CABOR_TEST_WORKER_ITEMS];
+} cabor_test_worker_submitter;
+
+static void submit_items(void* arg)
+{
+    cabor_test_worker_submitter* submitter = arg;
+    for (size_t i = 0; i < CABOR_TEST_WORKER_ITEMS; i++)
+        submitter->items[i] = (cabor_test_worker_item){ .value = i, .runs = 0 };
+
+    cabor_worker_pool_run(square_item, submitter->items, sizeof(cabor_test_worker_item), CABOR_TEST_WORKER_ITEMS);
+}
+
+// Compiles on the server's threads share the pool, their jobs are queued behind each other
+int cabor_unit_test_worker_pool_submitters()
+{
+    int res = 0;
+
+    static cabor_test_worker_submitter submitters[CABOR_TEST_WORKER_SUBMITTERS];
+    uv_thread_t handles[CABOR_TEST_WORKER_SUBMITTERS];
+
+    for (size_t i = 0; i < CABOR_TEST_WORKER_SUBMITTERS; i++)
+        uv_thread_create(&handles[i], submit_items, &submitters[i]);
+    for (size_t i = 0; i < CABOR_TEST_WORKER_SUBMITTERS; i++)
+        uv_thread_join(&handles[i]);
+
+    for (size_t i = 0; i < CABOR_TEST_WORKER_SUBMITTERS; i++)
+    {
+        if (check_items(submitters[i].items, CABOR_TEST_WORKER_ITEMS))
+            res = 1;
+    }
+
+    return res;
+}
+
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../../cabor_defines.h"
+
+#ifdef CABOR_ENABLE_TESTING
+
+#include "../test_framework.h"
+#include "../../core/worker_pool.h"
+
+int cabor_unit_test_worker_pool_run();
+int cabor_unit_test_worker_pool_submitters();
+
+#endif
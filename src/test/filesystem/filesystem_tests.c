@@ -31,4 +31,29 @@ int cabor_test_load_file()
     return res;
 }
 
+int cabor_test_map_file()
+{
+    const char* filename = "cabor_test_programs/test.cc";
+    const char* expected = "hello XD";
+
+    cabor_file* file = cabor_map_file(filename);
+
+    int res = 0;
+
+    // Unlike cabor_load_file there is no NUL terminator
+    CABOR_CHECK_EQUALS(file->mapped, true, res);
+    CABOR_CHECK_EQUALS(file->size, strlen(expected), res);
+
+    for (size_t i = 0; i < file->size; i++)
+    {
+        char a = cabor_read_byte_from_file(file, i);
+        char b = expected[i];
+        CABOR_CHECK_EQUALS(a, b, res);
+    }
+
+    cabor_destroy_file(file);
+
+    return res;
+}
+
 #endif // CABOR_ENABLE_TESTING
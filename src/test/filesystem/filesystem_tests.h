@@ -5,6 +5,7 @@
 #ifdef CABOR_ENABLE_TESTING
 
 int cabor_test_load_file();
+int cabor_test_map_file();
 
 #endif // CABOR_ENABLE_TESTING
 
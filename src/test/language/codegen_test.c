@@ -1,5 +1,6 @@
 #include "codegen_test.h"
 #include <string.h>
+#include <stdio.h>
 
 static void free_codegen_common(cabor_ir_data* ir_data, cabor_symbol_table* symbtab)
 {
@@ -12,9 +13,8 @@ static void codegen_common(cabor_ir_data** ir_data, cabor_symbol_table** symtab,
      cabor_file* file = cabor_file_from_buffer(code, strlen(code));
      cabor_vector* tokens = cabor_tokenize(file);
      cabor_ast* ast = cabor_parse(tokens);
-     cabor_ast_node* root = cabor_access_ast_node(ast->root);
      *symtab = cabor_create_symbol_table();
-     cabor_type type = cabor_typecheck(ast, root, *symtab);
+     cabor_type type = cabor_typecheck(ast, ast->root, *symtab);
      *ir_data = cabor_create_ir_data();
      cabor_generate_ir(*ir_data, ast);
 
@@ -69,8 +69,227 @@ int cabor_integration_test_codegen_print_int()
     return 0;
 }
 
+// Constants that don't fit in a sign extended 32-bit immediate need movabsq
+int cabor_test_codegen_mov_imm()
+{
+    int res = 0;
+
+    cabor_x64_assembly* asmbl = cabor_create_assembly();
+    cabor_emit_mov_imm(asmbl, -2147483648LL, "-8(%rbp)");
+    cabor_emit_mov_imm(asmbl, 5000000000LL, "-16(%rbp)");
+
+    const char* expected[] =
+    {
+        "movq $-2147483648, -8(%rbp)\n",
+        "movabsq $5000000000, %rax\n",
+        "movq %rax, -16(%rbp)\n",
+    };
+
+    CABOR_CHECK_EQUALS(asmbl->instructions->size, 3, res);
+    for (size_t i = 0; i < asmbl->instructions->size && i < 3; i++)
+    {
+        const char* text = (const char*)cabor_vector_at_x64_instruction(asmbl->instructions, i)->text;
+        CABOR_CHECK_EQUALS(strcmp(text, expected[i]), 0, res);
+    }
+
+    cabor_destroy_x64_assembly(asmbl);
+
+    return res;
+}
+
 int cabor_compiler_test1()
 {
     return 0;
 }
 
+// Compile a span in the middle of a bigger buffer, nothing after the span may leak into the program
+int cabor_compiler_test_span()
+{
+    const char* buffer = "garbage var x = 1 + 2; print_int(x) * 3 garbage";
+    const char* program = "var x = 1 + 2; print_int(x)";
+    const char* filename = "cabor_test_compile_span";
+
+    cabor_x64_assembly* span_asmbl = cabor_compile_span(buffer + 8, strlen(program), filename);
+
+    cabor_file* file = cabor_file_from_buffer(program, strlen(program));
+    cabor_x64_assembly* file_asmbl = cabor_compile(file, filename);
+    cabor_destroy_file(file);
+
+    int res = 0;
+
+    CABOR_CHECK_EQUALS(span_asmbl->instructions->size, file_asmbl->instructions->size, res);
+    for (size_t i = 0; i < span_asmbl->instructions->size && i < file_asmbl->instructions->size; i++)
+    {
+        const char* a = (const char*)cabor_vector_at_x64_instruction(span_asmbl->instructions, i)->text;
+        const char* b = (const char*)cabor_vector_at_x64_instruction(file_asmbl->instructions, i)->text;
+        CABOR_CHECK_EQUALS(strcmp(a, b), 0, res);
+    }
+
+    cabor_destroy_x64_assembly(span_asmbl);
+    cabor_destroy_x64_assembly(file_asmbl);
+    remove("cabor_test_compile_span.s");
+
+    return res;
+}
+
+// A program with syntax errors isn't compiled, all of its errors are handed back
+int cabor_compiler_test_diagnostics()
+{
+    const char* program = "{ var x = 1 +; print_int(x); while x print_int(x) }";
+    const char* filename = "cabor_test_compile_diagnostics";
+
+    int res = 0;
+
+    cabor_vector* diagnostics = cabor_create_vector_with_stride(4, sizeof(cabor_diagnostic), false);
+    cabor_x64_assembly* asmbl = cabor_compile_span_with_diagnostics(program, strlen(program), filename, diagnostics);
+
+    CABOR_CHECK_EQUALS((asmbl == NULL), true, res);
+    CABOR_CHECK_EQUALS(diagnostics->size, 2, res);
+
+    if (diagnostics->size == 2)
+    {
+        CABOR_CHECK_EQUALS(cabor_vector_at_diagnostic(diagnostics, 0)->location.column, 14, res);
+        CABOR_CHECK_EQUALS(cabor_vector_at_diagnostic(diagnostics, 1)->location.column, 38, res);
+    }
+
+    if (asmbl)
+        cabor_destroy_x64_assembly(asmbl);
+    cabor_destroy_vector(diagnostics);
+
+    return res;
+}
+
+// Literals too large for 64 bits used to reach codegen with an error type and crash it
+int cabor_compiler_test_integer_overflow()
+{
+    const char* program = "print_int(9223372036854775808)";
+    const char* filename = "cabor_test_compile_integer_overflow";
+
+    int res = 0;
+
+    cabor_vector* diagnostics = cabor_create_vector_with_stride(4, sizeof(cabor_diagnostic), false);
+    cabor_x64_assembly* asmbl = cabor_compile_span_with_diagnostics(program, strlen(program), filename, diagnostics);
+
+    CABOR_CHECK_EQUALS((asmbl == NULL), true, res);
+    CABOR_CHECK_EQUALS(diagnostics->size, 1, res);
+
+    if (diagnostics->size == 1)
+    {
+        cabor_diagnostic* diagnostic = cabor_vector_at_diagnostic(diagnostics, 0);
+        CABOR_CHECK_EQUALS(diagnostic->location.column, 11, res);
+        CABOR_CHECK_EQUALS(strcmp(diagnostic->message, "Integer literal doesn't fit in 64 bits"), 0, res);
+    }
+
+    if (asmbl)
+        cabor_destroy_x64_assembly(asmbl);
+    cabor_destroy_vector(diagnostics);
+
+    // The largest literal that fits still compiles
+    const char* largest = "print_int(9223372036854775807)";
+    asmbl = cabor_compile_span(largest, strlen(largest), filename);
+    CABOR_CHECK_EQUALS((asmbl != NULL), true, res);
+    if (asmbl)
+        cabor_destroy_x64_assembly(asmbl);
+
+    remove("cabor_test_compile_integer_overflow.s");
+
+    return res;
+}
+
+static size_t count_emitted_calls(cabor_x64_assembly* asmbl)
+{
+    size_t num_calls = 0;
+    for (size_t i = 0; i < asmbl->instructions->size; i++)
+    {
+        const char* text = (const char*)cabor_vector_at_x64_instruction(asmbl->instructions, i)->text;
+        if (strncmp(text, "call ", 5) == 0)
+        {
+            num_calls++;
+        }
+    }
+    return num_calls;
+}
+
+// Every statement of the program is compiled, not only the first one
+int cabor_compiler_test_top_level_statements()
+{
+    const char* program = "var y = 5; print_int(y)";
+    const char* filename = "cabor_test_compile_top_level_statements";
+
+    int res = 0;
+
+    cabor_x64_assembly* asmbl = cabor_compile_span(program, strlen(program), filename);
+    CABOR_CHECK_EQUALS((asmbl != NULL), true, res);
+    if (asmbl)
+    {
+        CABOR_CHECK_EQUALS(count_emitted_calls(asmbl), 1, res);
+        cabor_destroy_x64_assembly(asmbl);
+    }
+
+    remove("cabor_test_compile_top_level_statements.s");
+
+    return res;
+}
+
+// The names of a program are freed after it is compiled, a server doesn't keep them
+int cabor_compiler_test_intern_scope()
+{
+    const char* program = "var compile_scope_a = 1; var compile_scope_b = compile_scope_a; print_int(compile_scope_b)";
+    const char* filename = "cabor_test_compile_intern_scope";
+
+    int res = 0;
+
+    size_t pool_count = cabor_get_interned_count();
+
+    cabor_x64_assembly* asmbl = cabor_compile_span(program, strlen(program), filename);
+    CABOR_CHECK_EQUALS((asmbl != NULL), true, res);
+    if (asmbl)
+        cabor_destroy_x64_assembly(asmbl);
+
+    CABOR_CHECK_EQUALS(cabor_get_interned_count(), pool_count, res);
+
+    // Large enough to be tokenized and type checked on the worker pool, the workers see the names too
+    const size_t block_count = CABOR_TYPECHECK_PARALLEL_MIN_NODES / 4;
+    cabor_allocation alloc = CABOR_MALLOC(block_count * 48 + 16);
+    char* large = alloc.mem;
+    size_t size = 0;
+    for (size_t i = 0; i < block_count; i++)
+        size += sprintf(large + size, "{ var scope_%zu = %zu; scope_%zu + 1 };\n", i, i, i);
+    size += sprintf(large + size, "0");
+
+    asmbl = cabor_compile_span(large, size, filename);
+    CABOR_CHECK_EQUALS((asmbl != NULL), true, res);
+    if (asmbl)
+        cabor_destroy_x64_assembly(asmbl);
+
+    CABOR_CHECK_EQUALS(cabor_get_interned_count(), pool_count, res);
+    CABOR_FREE(&alloc);
+
+    remove("cabor_test_compile_intern_scope.s");
+
+    return res;
+}
+
+// Calls with more arguments than intrinsics take still go through codegen, only intrinsics fill arg_refs
+int cabor_compiler_test_many_args()
+{
+    const char* many_args = "print_int(1, 2, 3, 4, 5, 6, 7, 8, 9, 10)";
+    const char* intrinsic = "print_int(1 + 2)";
+    const char* filename = "cabor_test_compile_many_args";
+
+    int res = 0;
+
+    // More than 6 arguments isn't supported by the calling convention, the call is dropped
+    cabor_x64_assembly* asmbl = cabor_compile_span(many_args, strlen(many_args), filename);
+    CABOR_CHECK_EQUALS(count_emitted_calls(asmbl), 0, res);
+    cabor_destroy_x64_assembly(asmbl);
+
+    // + is emitted inline, print_int is the only call
+    asmbl = cabor_compile_span(intrinsic, strlen(intrinsic), filename);
+    CABOR_CHECK_EQUALS(count_emitted_calls(asmbl), 1, res);
+    cabor_destroy_x64_assembly(asmbl);
+
+    remove("cabor_test_compile_many_args.s");
+
+    return res;
+}
@@ -12,7 +12,15 @@
 int cabor_integration_test_codegen_basic();
 int cabor_integration_test_codegen_print_int();
 
+int cabor_test_codegen_mov_imm();
+
 int cabor_compiler_test1();
+int cabor_compiler_test_span();
+int cabor_compiler_test_diagnostics();
+int cabor_compiler_test_integer_overflow();
+int cabor_compiler_test_many_args();
+int cabor_compiler_test_top_level_statements();
+int cabor_compiler_test_intern_scope();
 
 #endif
 
@@ -13,9 +13,8 @@ static void ir_common(cabor_ir_data** ir_data, cabor_symbol_table** symtab, cons
      cabor_file* file = cabor_file_from_buffer(code, strlen(code));
      cabor_vector* tokens = cabor_tokenize(file);
      cabor_ast* ast = cabor_parse(tokens);
-     cabor_ast_node* root = cabor_access_ast_node(ast->root);
      *symtab = cabor_create_symbol_table();
-     cabor_type type = cabor_typecheck(ast, root, *symtab);
+     cabor_type type = cabor_typecheck(ast, ast->root, *symtab);
      *ir_data = cabor_create_ir_data();
      cabor_generate_ir(*ir_data, ast);
 
@@ -121,3 +120,59 @@ int cabor_integration_test_ir_unary_op()
     return 0;
 
 }
+
+// { print_int(1 + 2); print_int(1 + 2); ... } with far more statements and call arguments than fit in the
+// initial argument storage, every call must still see the arguments it was generated with
+int cabor_integration_test_ir_large_block()
+{
+    int res = 0;
+    const size_t count = 20000;
+    const char* statement = "print_int(1 + 2);";
+    size_t statement_size = strlen(statement);
+
+    cabor_allocation code_alloc = CABOR_MALLOC(count * statement_size + 2);
+    char* code = code_alloc.mem;
+    size_t cursor = 0;
+    code[cursor++] = '{';
+    for (size_t i = 0; i < count; i++, cursor += statement_size)
+        memcpy(code + cursor, statement, statement_size);
+    code[cursor - 1] = '}'; // last statement gives the block its value
+
+    cabor_ast* ast = cabor_parse_source(code, cursor);
+    CABOR_CHECK_EQUALS(cabor_ast_num_edges(ast, ast->root), count, res);
+
+    cabor_symbol_table* symtab = cabor_create_symbol_table();
+    cabor_typecheck(ast, ast->root, symtab);
+    cabor_ir_data* ir_data = cabor_create_ir_data();
+    cabor_generate_ir(ir_data, ast);
+
+    cabor_vector* instructions = ir_data->ir_instructions;
+    size_t calls = 0;
+
+    // LoadIntConst(1, a), LoadIntConst(2, b), Call(+, [a, b], c), Call(print_int, [c], d)
+    for (size_t i = 3; i < instructions->size; i++)
+    {
+        cabor_ir_instruction* print = cabor_vector_at_ir_instruction(instructions, i);
+        cabor_ir_instruction* plus = cabor_vector_at_ir_instruction(instructions, i - 1);
+        cabor_ir_instruction* right = cabor_vector_at_ir_instruction(instructions, i - 2);
+        cabor_ir_instruction* left = cabor_vector_at_ir_instruction(instructions, i - 3);
+
+        if (print->type != CABOR_IR_INST_CALL || plus->type != CABOR_IR_INST_CALL || print->call.num_args != 1)
+            continue;
+
+        CABOR_CHECK_EQUALS(plus->call.num_args, 2, res);
+        CABOR_CHECK_EQUALS(cabor_ir_call_arg(ir_data, &print->call, 0), plus->call.dest, res);
+        CABOR_CHECK_EQUALS(cabor_ir_call_arg(ir_data, &plus->call, 0), left->load_int_const.dest, res);
+        CABOR_CHECK_EQUALS(cabor_ir_call_arg(ir_data, &plus->call, 1), right->load_int_const.dest, res);
+        calls++;
+    }
+
+    CABOR_CHECK_EQUALS(calls, count, res);
+
+    cabor_destroy_ir_data(ir_data);
+    cabor_destroy_symbol_table(symtab);
+    cabor_destroy_ast(ast);
+    CABOR_FREE(&code_alloc);
+
+    return res;
+}
@@ -15,6 +15,7 @@ int cabor_integration_test_ir_var_expr2();
 int cabor_integration_test_ir_unary_op();
 int cabor_integration_test_ir_while();
 int cabor_integration_test_blocks();
+int cabor_integration_test_ir_large_block();
 
 
 #endif
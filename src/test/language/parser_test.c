@@ -2,6 +2,7 @@
 
 #include "../../core/vector.h"
 #include "../../language/tokenizer.h"
+#include "../../bench/tokenizer_bench.h"
 
 #include <string.h>
 
@@ -11,11 +12,7 @@
 // them manually here
 static cabor_token create_token(const char* data, cabor_token_type type)
 {
-    cabor_token t;
-    t.type = type;
-    size_t size = strlen(data);
-    strcpy(t.data, data);
-    return t;
+    return cabor_create_synthetic_token(type, cabor_intern(data));
 }
 
 // Unit tests, these are a bit verbose so we don't have many of them.
@@ -42,7 +39,7 @@ int cabor_test_parse_expression_abc()
 
     char token_string[100] = { 0 };
 
-    cabor_stringify_tokens(token_string, 100, tokens);
+    cabor_stringify_tokens(token_string, 100, tokens, NULL);
 
     const char* expected_tokens = "['a', '+', 'b', '*', 'c']";
 
@@ -57,47 +54,41 @@ int cabor_test_parse_expression_abc()
     int res = 0;
     CABOR_CHECK_EQUALS(test, 0, res);
 
-    size_t cursor = 0;
-    cabor_ast_allocated_node ast = cabor_parse_expression(tokens, &cursor);
-    cabor_vector* ast_nodes = cabor_get_ast_node_list_al(&ast);
+    cabor_token_stream* stream = cabor_create_token_stream_from_vector(tokens);
+    cabor_ast* ast = cabor_create_ast();
+    ast->root = cabor_parse_expression(ast, stream);
+    cabor_destroy_token_stream(stream);
+    cabor_vector* ast_nodes = cabor_get_ast_node_list(ast, ast->root);
 
     char buffer[100] = { 0 };
 
     for (size_t i = 0; i < ast_nodes->size; i++)
     {
-        cabor_ast_node* n = cabor_vector_get_ptr(ast_nodes, i);
-        cabor_ast_allocated_node an =
-        {
-            .node_mem.mem = n,
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-            .node_mem.size = sizeof(cabor_ast_node),
-#endif
-        };
         memset(buffer, 0, 100);
-        cabor_ast_node_to_string_al(tokens, &an, buffer, 100, false);
+        cabor_ast_node_to_string(ast, *cabor_vector_at_u32(ast_nodes, i), buffer, 100, false);
         //CABOR_LOG_TRACE_F("%s", buffer);
     }
 
-    cabor_ast_node* plus = cabor_access_ast_node(&ast);
-    cabor_ast_node* a = cabor_access_ast_node(&cabor_access_ast_node(&ast)->edges[0]);
-    cabor_ast_node* star = cabor_access_ast_node(&cabor_access_ast_node(&ast)->edges[1]);
-    cabor_ast_node* b = cabor_access_ast_node(&star->edges[0]);
-    cabor_ast_node* c = cabor_access_ast_node(&star->edges[1]);
+    cabor_ast_node_idx plus = ast->root;
+    cabor_ast_node_idx a = cabor_ast_edge(ast, ast->root, 0);
+    cabor_ast_node_idx star = cabor_ast_edge(ast, ast->root, 1);
+    cabor_ast_node_idx b = cabor_ast_edge(ast, star, 0);
+    cabor_ast_node_idx c = cabor_ast_edge(ast, star, 1);
 
-    cabor_token* plus_t = cabor_vector_get_token(tokens, plus->token_index);
-    cabor_token* a_t = cabor_vector_get_token(tokens, a->token_index);
-    cabor_token* star_t = cabor_vector_get_token(tokens, star->token_index);
-    cabor_token* b_t = cabor_vector_get_token(tokens, b->token_index);
-    cabor_token* c_t = cabor_vector_get_token(tokens, c->token_index);
+    cabor_token* plus_t = cabor_access_ast_token(ast, plus);
+    cabor_token* a_t = cabor_access_ast_token(ast, a);
+    cabor_token* star_t = cabor_access_ast_token(ast, star);
+    cabor_token* b_t = cabor_access_ast_token(ast, b);
+    cabor_token* c_t = cabor_access_ast_token(ast, c);
 
-    CABOR_CHECK_EQUALS(plus_t->data[0], '+', res);
-    CABOR_CHECK_EQUALS(a_t->data[0], 'a', res);
-    CABOR_CHECK_EQUALS(star_t->data[0], '*', res);
-    CABOR_CHECK_EQUALS(b_t->data[0], 'b', res);
-    CABOR_CHECK_EQUALS(c_t->data[0], 'c', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(plus_t)[0], '+', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(a_t)[0], 'a', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(star_t)[0], '*', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(b_t)[0], 'b', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(c_t)[0], 'c', res);
 
     cabor_destroy_vector(ast_nodes);
-    cabor_free_ast(&ast);
+    cabor_destroy_ast(ast);
 
     cabor_destroy_vector(tokens);
 
@@ -125,7 +116,7 @@ int cabor_test_parse_expression_cba()
 
     char token_string[100] = { 0 };
 
-    cabor_stringify_tokens(token_string, 100, tokens);
+    cabor_stringify_tokens(token_string, 100, tokens, NULL);
 
     const char* expected_tokens = "['c', '*', 'b', '+', 'a']";
 
@@ -140,47 +131,41 @@ int cabor_test_parse_expression_cba()
     int res = 0;
     CABOR_CHECK_EQUALS(test, 0, res);
 
-    size_t cursor = 0;
-    cabor_ast_allocated_node ast = cabor_parse_expression(tokens, &cursor);
-    cabor_vector* ast_nodes = cabor_get_ast_node_list_al(&ast);
+    cabor_token_stream* stream = cabor_create_token_stream_from_vector(tokens);
+    cabor_ast* ast = cabor_create_ast();
+    ast->root = cabor_parse_expression(ast, stream);
+    cabor_destroy_token_stream(stream);
+    cabor_vector* ast_nodes = cabor_get_ast_node_list(ast, ast->root);
 
     char buffer[100] = { 0 };
 
     for (size_t i = 0; i < ast_nodes->size; i++)
     {
-        cabor_ast_node* n = cabor_vector_get_ptr(ast_nodes, i);
-        cabor_ast_allocated_node an =
-        {
-            .node_mem.mem = n,
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-            .node_mem.size = sizeof(cabor_ast_node),
-#endif
-        };
         memset(buffer, 0, 100);
-        cabor_ast_node_to_string_al(tokens, &an, buffer, 100, false);
+        cabor_ast_node_to_string(ast, *cabor_vector_at_u32(ast_nodes, i), buffer, 100, false);
         //CABOR_LOG_TRACE_F("%s", buffer);
     }
 
-    cabor_ast_node* plus = cabor_access_ast_node(&ast);
-    cabor_ast_node* star = cabor_access_ast_node(&plus->edges[0]);
-    cabor_ast_node* a = cabor_access_ast_node(&plus->edges[1]);
-    cabor_ast_node* c = cabor_access_ast_node(&star->edges[0]);
-    cabor_ast_node* b = cabor_access_ast_node(&star->edges[1]);
+    cabor_ast_node_idx plus = ast->root;
+    cabor_ast_node_idx star = cabor_ast_edge(ast, plus, 0);
+    cabor_ast_node_idx a = cabor_ast_edge(ast, plus, 1);
+    cabor_ast_node_idx c = cabor_ast_edge(ast, star, 0);
+    cabor_ast_node_idx b = cabor_ast_edge(ast, star, 1);
 
-    cabor_token* plus_t = cabor_vector_get_token(tokens, plus->token_index);
-    cabor_token* a_t = cabor_vector_get_token(tokens, a->token_index);
-    cabor_token* star_t = cabor_vector_get_token(tokens, star->token_index);
-    cabor_token* b_t = cabor_vector_get_token(tokens, b->token_index);
-    cabor_token* c_t = cabor_vector_get_token(tokens, c->token_index);
+    cabor_token* plus_t = cabor_access_ast_token(ast, plus);
+    cabor_token* a_t = cabor_access_ast_token(ast, a);
+    cabor_token* star_t = cabor_access_ast_token(ast, star);
+    cabor_token* b_t = cabor_access_ast_token(ast, b);
+    cabor_token* c_t = cabor_access_ast_token(ast, c);
 
-    CABOR_CHECK_EQUALS(plus_t->data[0], '+', res);
-    CABOR_CHECK_EQUALS(a_t->data[0], 'a', res);
-    CABOR_CHECK_EQUALS(star_t->data[0], '*', res);
-    CABOR_CHECK_EQUALS(b_t->data[0], 'b', res);
-    CABOR_CHECK_EQUALS(c_t->data[0], 'c', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(plus_t)[0], '+', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(a_t)[0], 'a', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(star_t)[0], '*', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(b_t)[0], 'b', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(c_t)[0], 'c', res);
 
     cabor_destroy_vector(ast_nodes);
-    cabor_free_ast(&ast);
+    cabor_destroy_ast(ast);
 
     cabor_destroy_vector(tokens);
 
@@ -210,7 +195,7 @@ int cabor_test_parse_expression_abc_parenthesized()
 
     char token_string[100] = { 0 };
 
-    cabor_stringify_tokens(token_string, 100, tokens);
+    cabor_stringify_tokens(token_string, 100, tokens, NULL);
 
     const char* expected_tokens = "['(', 'a', '+', 'b', ')', '*', 'c']";
 
@@ -225,47 +210,41 @@ int cabor_test_parse_expression_abc_parenthesized()
     int res = 0;
     CABOR_CHECK_EQUALS(test, 0, res);
 
-    size_t cursor = 0;
-    cabor_ast_allocated_node ast = cabor_parse_expression(tokens, &cursor);
-    cabor_vector* ast_nodes = cabor_get_ast_node_list_al(&ast);
+    cabor_token_stream* stream = cabor_create_token_stream_from_vector(tokens);
+    cabor_ast* ast = cabor_create_ast();
+    ast->root = cabor_parse_expression(ast, stream);
+    cabor_destroy_token_stream(stream);
+    cabor_vector* ast_nodes = cabor_get_ast_node_list(ast, ast->root);
 
     char buffer[100] = { 0 };
 
     for (size_t i = 0; i < ast_nodes->size; i++)
     {
-        cabor_ast_node* n = cabor_vector_get_ptr(ast_nodes, i);
-        cabor_ast_allocated_node an =
-        {
-            .node_mem.mem = n,
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-            .node_mem.size = sizeof(cabor_ast_node),
-#endif
-        };
         memset(buffer, 0, 100);
-        cabor_ast_node_to_string_al(tokens, &an, buffer, 100, false);
+        cabor_ast_node_to_string(ast, *cabor_vector_at_u32(ast_nodes, i), buffer, 100, false);
         //CABOR_LOG_TRACE_F("%s", buffer);
     }
 
-    cabor_ast_node* star = cabor_access_ast_node(&ast);
-    cabor_ast_node* plus = cabor_access_ast_node(&star->edges[0]);
-    cabor_ast_node* c = cabor_access_ast_node(&star->edges[1]);
-    cabor_ast_node* a = cabor_access_ast_node(&plus->edges[0]);
-    cabor_ast_node* b = cabor_access_ast_node(&plus->edges[1]);
+    cabor_ast_node_idx star = ast->root;
+    cabor_ast_node_idx plus = cabor_ast_edge(ast, star, 0);
+    cabor_ast_node_idx c = cabor_ast_edge(ast, star, 1);
+    cabor_ast_node_idx a = cabor_ast_edge(ast, plus, 0);
+    cabor_ast_node_idx b = cabor_ast_edge(ast, plus, 1);
 
-    cabor_token* plus_t = cabor_vector_get_token(tokens, plus->token_index);
-    cabor_token* a_t = cabor_vector_get_token(tokens, a->token_index);
-    cabor_token* star_t = cabor_vector_get_token(tokens, star->token_index);
-    cabor_token* b_t = cabor_vector_get_token(tokens, b->token_index);
-    cabor_token* c_t = cabor_vector_get_token(tokens, c->token_index);
+    cabor_token* plus_t = cabor_access_ast_token(ast, plus);
+    cabor_token* a_t = cabor_access_ast_token(ast, a);
+    cabor_token* star_t = cabor_access_ast_token(ast, star);
+    cabor_token* b_t = cabor_access_ast_token(ast, b);
+    cabor_token* c_t = cabor_access_ast_token(ast, c);
 
-    CABOR_CHECK_EQUALS(plus_t->data[0], '+', res);
-    CABOR_CHECK_EQUALS(a_t->data[0],    'a', res);
-    CABOR_CHECK_EQUALS(star_t->data[0], '*', res);
-    CABOR_CHECK_EQUALS(b_t->data[0],    'b', res);
-    CABOR_CHECK_EQUALS(c_t->data[0],    'c', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(plus_t)[0], '+', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(a_t)[0],    'a', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(star_t)[0], '*', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(b_t)[0],    'b', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(c_t)[0],    'c', res);
 
     cabor_destroy_vector(ast_nodes);
-    cabor_free_ast(&ast);
+    cabor_destroy_ast(ast);
 
     cabor_destroy_vector(tokens);
 
@@ -296,61 +275,55 @@ int cabor_test_parse_expression_if_then_else()
     for (size_t j = 0; j < 10; j++)
         cabor_vector_push_token(tokens, &tmp[j]);
 
-    size_t cursor = 0;
-    cabor_ast_allocated_node ast = cabor_parse_if_then_else_expression(tokens, &cursor);
-    cabor_vector* ast_nodes = cabor_get_ast_node_list_al(&ast);
+    cabor_token_stream* stream = cabor_create_token_stream_from_vector(tokens);
+    cabor_ast* ast = cabor_create_ast();
+    ast->root = cabor_parse_if_then_else_expression(ast, stream);
+    cabor_destroy_token_stream(stream);
+    cabor_vector* ast_nodes = cabor_get_ast_node_list(ast, ast->root);
 
     for (size_t i = 0; i < ast_nodes->size; i++)
     {
-        cabor_ast_node* n = cabor_vector_get_ptr(ast_nodes, i);
-        cabor_ast_allocated_node an =
-        {
-            .node_mem.mem = n,
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-            .node_mem.size = sizeof(cabor_ast_node),
-#endif
-        };
         memset(buffer, 0, 100);
-        cabor_ast_node_to_string_al(tokens, &an, buffer, 100, false);
+        cabor_ast_node_to_string(ast, *cabor_vector_at_u32(ast_nodes, i), buffer, 100, false);
         //CABOR_LOG_TRACE_F("%s", buffer);
     }
 
-    cabor_ast_node* root = cabor_access_ast_node(&ast);
-    cabor_ast_node* a = cabor_access_ast_node(&root->edges[0]);
-    cabor_ast_node* plus = cabor_access_ast_node(&root->edges[1]);
-    cabor_ast_node* star = cabor_access_ast_node(&root->edges[2]);
+    cabor_ast_node_idx root = ast->root;
+    cabor_ast_node_idx a = cabor_ast_edge(ast, root, 0);
+    cabor_ast_node_idx plus = cabor_ast_edge(ast, root, 1);
+    cabor_ast_node_idx star = cabor_ast_edge(ast, root, 2);
 
-    cabor_ast_node* b = cabor_access_ast_node(&plus->edges[0]);
-    cabor_ast_node* c = cabor_access_ast_node(&plus->edges[1]);
+    cabor_ast_node_idx b = cabor_ast_edge(ast, plus, 0);
+    cabor_ast_node_idx c = cabor_ast_edge(ast, plus, 1);
 
-    cabor_ast_node* x = cabor_access_ast_node(&star->edges[0]);
-    cabor_ast_node* y = cabor_access_ast_node(&star->edges[1]);
+    cabor_ast_node_idx x = cabor_ast_edge(ast, star, 0);
+    cabor_ast_node_idx y = cabor_ast_edge(ast, star, 1);
 
-    cabor_token* root_t = cabor_vector_get_token(tokens, root->token_index);
-    cabor_token* a_t = cabor_vector_get_token(tokens, a->token_index);
-    cabor_token* plus_t = cabor_vector_get_token(tokens, plus->token_index);
-    cabor_token* star_t = cabor_vector_get_token(tokens, star->token_index);
+    cabor_token* root_t = cabor_access_ast_token(ast, root);
+    cabor_token* a_t = cabor_access_ast_token(ast, a);
+    cabor_token* plus_t = cabor_access_ast_token(ast, plus);
+    cabor_token* star_t = cabor_access_ast_token(ast, star);
 
-    cabor_token* b_t = cabor_vector_get_token(tokens, b->token_index);
-    cabor_token* c_t = cabor_vector_get_token(tokens, c->token_index);
+    cabor_token* b_t = cabor_access_ast_token(ast, b);
+    cabor_token* c_t = cabor_access_ast_token(ast, c);
 
-    cabor_token* x_t = cabor_vector_get_token(tokens, x->token_index);
-    cabor_token* y_t = cabor_vector_get_token(tokens, y->token_index);
+    cabor_token* x_t = cabor_access_ast_token(ast, x);
+    cabor_token* y_t = cabor_access_ast_token(ast, y);
 
     int res = 0;
 
-    CABOR_CHECK_EQUALS(root_t->data[0], 'i', res);
-    CABOR_CHECK_EQUALS(root_t->data[1], 'f', res);
-    CABOR_CHECK_EQUALS(a_t->data[0],    'a', res);
-    CABOR_CHECK_EQUALS(plus_t->data[0], '+', res);
-    CABOR_CHECK_EQUALS(star_t->data[0], '*', res);
-    CABOR_CHECK_EQUALS(b_t->data[0],    'b', res);
-    CABOR_CHECK_EQUALS(c_t->data[0],    'c', res);
-    CABOR_CHECK_EQUALS(x_t->data[0],    'x', res);
-    CABOR_CHECK_EQUALS(y_t->data[0],    'y', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(root_t)[0], 'i', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(root_t)[1], 'f', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(a_t)[0],    'a', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(plus_t)[0], '+', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(star_t)[0], '*', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(b_t)[0],    'b', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(c_t)[0],    'c', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(x_t)[0],    'x', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(y_t)[0],    'y', res);
 
     cabor_destroy_vector(ast_nodes);
-    cabor_free_ast(&ast);
+    cabor_destroy_ast(ast);
     cabor_destroy_vector(tokens);
 
     return res;
@@ -375,49 +348,43 @@ int cabor_test_parse_expression_if_then()
     for (size_t j = 0; j < 6; j++)
         cabor_vector_push_token(tokens, &tmp[j]);
 
-    size_t cursor = 0;
-    cabor_ast_allocated_node ast = cabor_parse_if_then_else_expression(tokens, &cursor);
-    cabor_vector* ast_nodes = cabor_get_ast_node_list_al(&ast);
+    cabor_token_stream* stream = cabor_create_token_stream_from_vector(tokens);
+    cabor_ast* ast = cabor_create_ast();
+    ast->root = cabor_parse_if_then_else_expression(ast, stream);
+    cabor_destroy_token_stream(stream);
+    cabor_vector* ast_nodes = cabor_get_ast_node_list(ast, ast->root);
 
     for (size_t i = 0; i < ast_nodes->size; i++)
     {
-        cabor_ast_node* n = cabor_vector_get_ptr(ast_nodes, i);
-        cabor_ast_allocated_node an =
-        {
-            .node_mem.mem = n,
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-            .node_mem.size = sizeof(cabor_ast_node),
-#endif
-        };
         memset(buffer, 0, 100);
-        cabor_ast_node_to_string_al(tokens, &an, buffer, 100, false);
+        cabor_ast_node_to_string(ast, *cabor_vector_at_u32(ast_nodes, i), buffer, 100, false);
        //CABOR_LOG_TRACE_F("%s", buffer);
     }
 
-    cabor_ast_node* root = cabor_access_ast_node(&ast);
-    cabor_ast_node* a = cabor_access_ast_node(&root->edges[0]);
-    cabor_ast_node* plus = cabor_access_ast_node(&root->edges[1]);
+    cabor_ast_node_idx root = ast->root;
+    cabor_ast_node_idx a = cabor_ast_edge(ast, root, 0);
+    cabor_ast_node_idx plus = cabor_ast_edge(ast, root, 1);
 
-    cabor_ast_node* b = cabor_access_ast_node(&plus->edges[0]);
-    cabor_ast_node* c = cabor_access_ast_node(&plus->edges[1]);
+    cabor_ast_node_idx b = cabor_ast_edge(ast, plus, 0);
+    cabor_ast_node_idx c = cabor_ast_edge(ast, plus, 1);
 
-    cabor_token* root_t = cabor_vector_get_token(tokens, root->token_index);
-    cabor_token* a_t = cabor_vector_get_token(tokens, a->token_index);
-    cabor_token* plus_t = cabor_vector_get_token(tokens, plus->token_index);
+    cabor_token* root_t = cabor_access_ast_token(ast, root);
+    cabor_token* a_t = cabor_access_ast_token(ast, a);
+    cabor_token* plus_t = cabor_access_ast_token(ast, plus);
 
-    cabor_token* b_t = cabor_vector_get_token(tokens, b->token_index);
-    cabor_token* c_t = cabor_vector_get_token(tokens, c->token_index);
+    cabor_token* b_t = cabor_access_ast_token(ast, b);
+    cabor_token* c_t = cabor_access_ast_token(ast, c);
     int res = 0;
 
-    CABOR_CHECK_EQUALS(root_t->data[0], 'i', res);
-    CABOR_CHECK_EQUALS(root_t->data[1], 'f', res);
-    CABOR_CHECK_EQUALS(a_t->data[0],    'a', res);
-    CABOR_CHECK_EQUALS(plus_t->data[0], '+', res);
-    CABOR_CHECK_EQUALS(b_t->data[0],    'b', res);
-    CABOR_CHECK_EQUALS(c_t->data[0],    'c', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(root_t)[0], 'i', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(root_t)[1], 'f', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(a_t)[0],    'a', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(plus_t)[0], '+', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(b_t)[0],    'b', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(c_t)[0],    'c', res);
 
     cabor_destroy_vector(ast_nodes);
-    cabor_free_ast(&ast);
+    cabor_destroy_ast(ast);
     cabor_destroy_vector(tokens);
 
     return res;
@@ -444,66 +411,535 @@ int cabor_test_parse_function_hello()
     for (size_t j = 0; j < 8; j++)
         cabor_vector_push_token(tokens, &tmp[j]);
 
-    size_t cursor = 0;
-    cabor_ast_allocated_node ast = cabor_parse_function(tokens, &cursor);
-    cabor_vector* ast_nodes = cabor_get_ast_node_list_al(&ast);
+    cabor_token_stream* stream = cabor_create_token_stream_from_vector(tokens);
+    cabor_ast* ast = cabor_create_ast();
+    ast->root = cabor_parse_function(ast, stream);
+    cabor_destroy_token_stream(stream);
+    cabor_vector* ast_nodes = cabor_get_ast_node_list(ast, ast->root);
 
     for (size_t i = 0; i < ast_nodes->size; i++)
     {
-        cabor_ast_node* n = cabor_vector_get_ptr(ast_nodes, i);
-        cabor_ast_allocated_node an =
-        {
-            .node_mem.mem = n,
-#ifdef CABOR_ENABLE_ALLOCATOR_FAT_POINTERS
-            .node_mem.size = sizeof(cabor_ast_node),
-#endif
-        };
         memset(buffer, 0, 100);
-        cabor_ast_node_to_string_al(tokens, &an, buffer, 100, false);
+        cabor_ast_node_to_string(ast, *cabor_vector_at_u32(ast_nodes, i), buffer, 100, false);
        //CABOR_LOG_TRACE_F("%s", buffer);
     }
 
-    cabor_ast_node* root = cabor_access_ast_node(&ast);
-    cabor_ast_node* a = cabor_access_ast_node(&root->edges[0]);
-    cabor_ast_node* b = cabor_access_ast_node(&root->edges[1]);
-    cabor_ast_node* c = cabor_access_ast_node(&root->edges[2]);
+    cabor_ast_node_idx root = ast->root;
+    cabor_ast_node_idx a = cabor_ast_edge(ast, root, 0);
+    cabor_ast_node_idx b = cabor_ast_edge(ast, root, 1);
+    cabor_ast_node_idx c = cabor_ast_edge(ast, root, 2);
 
-    cabor_token* root_t = cabor_vector_get_token(tokens, root->token_index);
-    cabor_token* a_t = cabor_vector_get_token(tokens, a->token_index);
-    cabor_token* b_t = cabor_vector_get_token(tokens, b->token_index);
-    cabor_token* c_t = cabor_vector_get_token(tokens, c->token_index);
+    cabor_token* root_t = cabor_access_ast_token(ast, root);
+    cabor_token* a_t = cabor_access_ast_token(ast, a);
+    cabor_token* b_t = cabor_access_ast_token(ast, b);
+    cabor_token* c_t = cabor_access_ast_token(ast, c);
 
     int res = 0;
 
-    CABOR_CHECK_EQUALS(strcmp(root_t->data, "hello"), 0, res);
-    CABOR_CHECK_EQUALS(a_t->data[0], 'a', res);
-    CABOR_CHECK_EQUALS(b_t->data[0], 'b', res);
-    CABOR_CHECK_EQUALS(c_t->data[0], 'c', res);
+    CABOR_CHECK_EQUALS(strcmp(cabor_token_str(root_t), "hello"), 0, res);
+    CABOR_CHECK_EQUALS(cabor_token_str(a_t)[0], 'a', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(b_t)[0], 'b', res);
+    CABOR_CHECK_EQUALS(cabor_token_str(c_t)[0], 'c', res);
 
     cabor_destroy_vector(ast_nodes);
-    cabor_free_ast(&ast);
+    cabor_destroy_ast(ast);
     cabor_destroy_vector(tokens);
 
     return res;
 }
 
-// Integration tests: tokenizer + parser
+// Parse { f(a, b); x = 1 + 2 } and check the flat layout: every node is in the arrays once,
+// children come before their parent and the root is appended last
+int cabor_test_parse_flat_ast()
+{
+    const char* code = "{ f(a, b); x = 1 + 2 }";
+    cabor_file* file = cabor_file_from_buffer(code, strlen(code));
+    cabor_vector* tokens = cabor_tokenize(file);
+    cabor_destroy_file(file);
+
+    int res = 0;
+
+    cabor_ast* ast = cabor_parse(tokens);
+    cabor_vector* nodes = cabor_get_ast_node_list(ast, ast->root);
+
+    size_t node_count = cabor_get_ast_node_count(ast);
+    CABOR_CHECK_EQUALS(node_count, 9, res);
+    CABOR_CHECK_EQUALS(nodes->size, node_count, res);
+    CABOR_CHECK_EQUALS(ast->root, (cabor_ast_node_idx)(node_count - 1), res);
+    CABOR_CHECK_EQUALS(cabor_ast_node_type_of(ast, ast->root), CABOR_NODE_TYPE_BLOCK, res);
+    CABOR_CHECK_EQUALS(ast->edges->size, node_count - 1, res);
+
+    for (size_t i = 0; i < nodes->size; i++)
+    {
+        cabor_ast_node_idx node = *cabor_vector_at_u32(nodes, i);
+        for (size_t e = 0; e < cabor_ast_num_edges(ast, node); e++)
+        {
+            CABOR_CHECK_GREATER(node, cabor_ast_edge(ast, node, e), res);
+        }
+    }
+
+    cabor_destroy_vector(nodes);
+    cabor_destroy_ast(ast);
+    cabor_destroy_vector(tokens);
+
+    return res;
+}
+
+// Peeking and stepping through the stream has to see the same tokens as the tokenizer produces in one go
+static int check_token_stream(const char* code, size_t size, cabor_vector* tokens, size_t max_lookahead)
+{
+    int res = 0;
+
+    cabor_token_stream* stream = cabor_create_token_stream(code, size);
+    for (size_t i = 0; i < tokens->size; i++)
+    {
+        CABOR_CHECK_EQUALS(cabor_token_stream_position(stream), i, res);
+        for (size_t k = 0; k <= max_lookahead; k++)
+        {
+            cabor_token* peeked = cabor_token_stream_peek(stream, k);
+            if (i + k < tokens->size)
+            {
+                cabor_token* expected = cabor_vector_at_token(tokens, i + k);
+                CABOR_CHECK_EQUALS((peeked ? peeked->offset : CABOR_TOKEN_NO_SOURCE), expected->offset, res);
+                CABOR_CHECK_EQUALS((peeked ? peeked->atom : 0), expected->atom, res);
+            }
+            else
+            {
+                CABOR_CHECK_EQUALS((peeked == NULL), true, res);
+            }
+        }
+        cabor_token* next = cabor_token_stream_next(stream);
+        CABOR_CHECK_EQUALS((next == NULL), (i + 1 == tokens->size), res);
+    }
+    CABOR_CHECK_EQUALS(cabor_token_stream_position(stream), tokens->size - 1, res);
+    cabor_destroy_token_stream(stream);
+
+    return res;
+}
+
+// The stream only buffers a window of tokens, it has to match the tokenizer also when the window wraps
+// around the ring, when slices of the source end inside a token and when a large source is tokenized
+// in parallel up front
+int cabor_test_token_stream()
+{
+    const size_t num_terms = 4000;
+    cabor_allocation code_alloc = CABOR_MALLOC(num_terms * 16);
+    char* code = code_alloc.mem;
+
+    size_t size = 0;
+    for (size_t i = 0; i < num_terms; i++)
+    {
+        const char* term = i == 0 ? "x * f(y, 2)" : " - x * f(y, 2)";
+        memcpy(code + size, term, strlen(term));
+        size += strlen(term);
+    }
+
+    int res = 0;
+
+    cabor_file* file = cabor_file_from_buffer(code, size);
+    cabor_vector* tokens = cabor_tokenize(file);
+    cabor_destroy_file(file);
+    CABOR_CHECK_GREATER(tokens->size, CABOR_TOKEN_STREAM_RING_SIZE * 4, res);
+    CABOR_CHECK_GREATER(size, CABOR_TOKEN_STREAM_SLICE_SIZE * 2, res);
+
+    res |= check_token_stream(code, size, tokens, CABOR_TOKEN_STREAM_MAX_LOOKAHEAD);
+
+    // Parsing straight from the source builds the same tree as parsing the token vector
+    cabor_ast* from_tokens = cabor_parse(tokens);
+    cabor_ast* from_source = cabor_parse_source(code, size);
+    CABOR_CHECK_EQUALS(cabor_get_ast_node_count(from_source), cabor_get_ast_node_count(from_tokens), res);
+
+    cabor_vector* expected_nodes = cabor_get_ast_node_list(from_tokens, from_tokens->root);
+    cabor_vector* nodes = cabor_get_ast_node_list(from_source, from_source->root);
+    CABOR_CHECK_EQUALS(nodes->size, expected_nodes->size, res);
+
+    for (size_t i = 0; i < nodes->size && i < expected_nodes->size; i++)
+    {
+        char expected[128] = {0};
+        char buffer[128] = {0};
+        cabor_ast_node_to_string(from_tokens, *cabor_vector_at_u32(expected_nodes, i), expected, 128, false);
+        cabor_ast_node_to_string(from_source, *cabor_vector_at_u32(nodes, i), buffer, 128, false);
+        CABOR_CHECK_EQUALS(strcmp(buffer, expected), 0, res);
+    }
+
+    cabor_destroy_vector(expected_nodes);
+    cabor_destroy_vector(nodes);
+    cabor_destroy_ast(from_source);
+    cabor_destroy_ast(from_tokens);
+    cabor_destroy_vector(tokens);
+    CABOR_FREE(&code_alloc);
+
+    // Large enough to be tokenized in parallel before the parser asks for anything
+    file = cabor_generate_bench_program(CABOR_BENCH_IDENTIFIER_HEAVY, CABOR_TOKENIZER_PARALLEL_MIN_SIZE * 2, 1234);
+    tokens = cabor_tokenize(file);
+    res |= check_token_stream(file->file_memory.mem, file->size, tokens, 1);
+    cabor_destroy_vector(tokens);
+    cabor_destroy_file(file);
 
-int cabor_integration_test_parser_common(const char* code, const char** expected, size_t node_count, cabor_ast_allocated_node(top_level_parser)(cabor_vector* tokens, size_t* cursor))
+    return res;
+}
+
+// Nodes parsed straight from the source can be traced back to their line and column
+int cabor_test_parse_source_locations()
 {
+    const char* code = "{\n    x = 1;\n  /* a\n comment */ y + f(z) }";
+
     int res = 0;
+
+    cabor_ast* ast = cabor_parse_source(code, strlen(code));
+    CABOR_CHECK_EQUALS((ast->lines != NULL), true, res);
+
+    // Root is the block, its edges are '=' and '+'
+    cabor_ast_node_idx assign = cabor_ast_edge(ast, ast->root, 0);
+    cabor_ast_node_idx plus = cabor_ast_edge(ast, ast->root, 1);
+    cabor_ast_node_idx call = cabor_ast_edge(ast, plus, 1);
+
+    char buffer[CABOR_SOURCE_LOCATION_STR_SIZE];
+    CABOR_CHECK_EQUALS(strcmp(cabor_ast_location_str(ast, cabor_access_ast_token(ast, ast->root), buffer, sizeof(buffer)), "1:1"), 0, res);
+    CABOR_CHECK_EQUALS(strcmp(cabor_ast_location_str(ast, cabor_access_ast_token(ast, assign), buffer, sizeof(buffer)), "2:7"), 0, res);
+    CABOR_CHECK_EQUALS(strcmp(cabor_ast_location_str(ast, cabor_access_ast_token(ast, plus), buffer, sizeof(buffer)), "4:15"), 0, res);
+    CABOR_CHECK_EQUALS(strcmp(cabor_ast_location_str(ast, cabor_access_ast_token(ast, call), buffer, sizeof(buffer)), "4:17"), 0, res);
+    CABOR_CHECK_EQUALS(strcmp(cabor_ast_location_str(ast, NULL, buffer, sizeof(buffer)), "end of input"), 0, res);
+
+    cabor_destroy_ast(ast);
+
+    return res;
+}
+
+static cabor_ast_visit_result stop_at_star(const cabor_ast* ast, cabor_ast_node_idx node, void* user_data)
+{
+    size_t* visited = user_data;
+    (*visited)++;
+    return cabor_token_is(cabor_access_ast_token(ast, node), CABOR_ATOM_MULTIPLY) ? CABOR_AST_VISIT_STOP : CABOR_AST_VISIT_CONTINUE;
+}
+
+static cabor_ast_visit_result skip_star(const cabor_ast* ast, cabor_ast_node_idx node, void* user_data)
+{
+    size_t* visited = user_data;
+    (*visited)++;
+    return cabor_token_is(cabor_access_ast_token(ast, node), CABOR_ATOM_MULTIPLY) ? CABOR_AST_VISIT_SKIP_CHILDREN : CABOR_AST_VISIT_CONTINUE;
+}
+
+// Walk a + b * c in both orders and stop or prune at '*'
+int cabor_test_ast_traversal()
+{
+    const char* code = "a + b * c";
     cabor_file* file = cabor_file_from_buffer(code, strlen(code));
     cabor_vector* tokens = cabor_tokenize(file);
     cabor_destroy_file(file);
 
+    int res = 0;
+
+    cabor_ast* ast = cabor_parse(tokens);
+
+    const char* expected_preorder = "+*cba";
+    const char* expected_postorder = "abc*+";
+
+    cabor_vector* preorder = cabor_get_ast_node_list(ast, ast->root);
+    cabor_vector* postorder = cabor_get_ast_node_list_postorder(ast, ast->root);
+
+    CABOR_CHECK_EQUALS(preorder->size, 5, res);
+    CABOR_CHECK_EQUALS(postorder->size, 5, res);
+
+    for (size_t i = 0; i < 5; i++)
+    {
+        CABOR_CHECK_EQUALS(cabor_token_str(cabor_access_ast_token(ast, *cabor_vector_at_u32(preorder, i)))[0], expected_preorder[i], res);
+        CABOR_CHECK_EQUALS(cabor_token_str(cabor_access_ast_token(ast, *cabor_vector_at_u32(postorder, i)))[0], expected_postorder[i], res);
+    }
+
+    size_t visited = 0;
+    CABOR_CHECK_EQUALS(cabor_ast_visit_preorder(ast, ast->root, stop_at_star, &visited), false, res);
+    CABOR_CHECK_EQUALS(visited, 2, res);
+
+    visited = 0;
+    CABOR_CHECK_EQUALS(cabor_ast_visit_postorder(ast, ast->root, stop_at_star, &visited), false, res);
+    CABOR_CHECK_EQUALS(visited, 4, res);
+
+    visited = 0;
+    CABOR_CHECK_EQUALS(cabor_ast_visit_preorder(ast, ast->root, skip_star, &visited), true, res);
+    CABOR_CHECK_EQUALS(visited, 3, res);
+
+    cabor_destroy_vector(preorder);
+    cabor_destroy_vector(postorder);
+    cabor_destroy_ast(ast);
+    cabor_destroy_vector(tokens);
+
+    return res;
+}
+
+// 1 + 1 + ... + 1 is a left leaning chain as deep as the number of operators,
+// the walk must not recurse and must finish in linear time
+int cabor_test_ast_traversal_deep()
+{
+    const size_t num_terms = 20000;
+    cabor_allocation code_alloc = CABOR_MALLOC(num_terms * 4);
+    char* code = code_alloc.mem;
+
     size_t cursor = 0;
-    cabor_ast_allocated_node ast = top_level_parser(tokens, &cursor);
-    cabor_vector* nodes = cabor_get_ast_node_list_al(&ast);
+    for (size_t i = 0; i < num_terms; i++)
+    {
+        memcpy(code + cursor, i == 0 ? "1" : " + 1", i == 0 ? 1 : 4);
+        cursor += i == 0 ? 1 : 4;
+    }
+
+    cabor_file* file = cabor_file_from_buffer(code, cursor);
+    cabor_vector* tokens = cabor_tokenize(file);
+    cabor_destroy_file(file);
+    CABOR_FREE(&code_alloc);
+
+    int res = 0;
+
+    cabor_ast* ast = cabor_parse(tokens);
+    cabor_vector* preorder = cabor_get_ast_node_list(ast, ast->root);
+    cabor_vector* postorder = cabor_get_ast_node_list_postorder(ast, ast->root);
+
+    CABOR_CHECK_EQUALS(preorder->size, (num_terms * 2 - 1), res);
+    CABOR_CHECK_EQUALS(postorder->size, (num_terms * 2 - 1), res);
+    CABOR_CHECK_EQUALS(*cabor_vector_at_u32(preorder, 0), ast->root, res);
+    CABOR_CHECK_EQUALS(*cabor_vector_at_u32(postorder, postorder->size - 1), ast->root, res);
+
+    cabor_destroy_vector(preorder);
+    cabor_destroy_vector(postorder);
+    cabor_destroy_ast(ast);
+    cabor_destroy_vector(tokens);
+
+    return res;
+}
+
+// open * depth + "1" + close * depth
+static cabor_allocation make_nested_source(const char* open, const char* close, size_t depth, size_t* size)
+{
+    size_t open_size = strlen(open);
+    size_t close_size = strlen(close);
+    cabor_allocation alloc = CABOR_MALLOC(depth * (open_size + close_size) + 1);
+    char* code = alloc.mem;
+
+    size_t cursor = 0;
+    for (size_t i = 0; i < depth; i++, cursor += open_size)
+        memcpy(code + cursor, open, open_size);
+    code[cursor++] = '1';
+    for (size_t i = 0; i < depth; i++, cursor += close_size)
+        memcpy(code + cursor, close, close_size);
+
+    *size = cursor;
+    return alloc;
+}
+
+// Nesting up to the limit parses, one level more fails without crashing
+int cabor_test_parse_nesting_limit()
+{
+    int res = 0;
+
+    const char* shapes[][2] = { { "(", ")" }, { "{", "}" }, { "-", "" }, { "if true then ", "" }, { "f(", ")" } };
+    const size_t max_depth = 64;
+
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++)
+    {
+        for (size_t depth = max_depth; depth <= max_depth + 1; depth++)
+        {
+            size_t size;
+            cabor_allocation code = make_nested_source(shapes[i][0], shapes[i][1], depth, &size);
+
+            cabor_ast* ast = cabor_parse_source_with_max_depth(code.mem, size, max_depth);
+            CABOR_CHECK_EQUALS((ast->root != CABOR_AST_NODE_INVALID), (depth <= max_depth), res);
+            CABOR_CHECK_EQUALS(ast->pending_edges->size, 0, res);
+            CABOR_CHECK_EQUALS(ast->depth, 0, res);
+
+            cabor_destroy_ast(ast);
+            CABOR_FREE(&code);
+        }
+    }
+
+    // The default limit is deep enough for generated code and is parsed on the normal stack
+    size_t size;
+    cabor_allocation code = make_nested_source("{", "}", CABOR_PARSER_DEFAULT_MAX_DEPTH, &size);
+    cabor_ast* ast = cabor_parse_source(code.mem, size);
+    CABOR_CHECK_EQUALS((ast->root != CABOR_AST_NODE_INVALID), true, res);
+    CABOR_CHECK_EQUALS(cabor_get_ast_node_count(ast), (CABOR_PARSER_DEFAULT_MAX_DEPTH + 1), res);
+    cabor_destroy_ast(ast);
+    CABOR_FREE(&code);
+
+    return res;
+}
+
+// Blocks and calls have no fixed limit on their number of children
+int cabor_test_parse_wide_nodes()
+{
+    int res = 0;
+    const size_t count = 5000;
+
+    // { 1; 1; ... 1 } and f(1, 1, ... 1)
+    const char* shapes[][3] = { { "{", "1;", "1}" }, { "f(", "1,", "1)" } };
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        size_t open_size = strlen(shapes[i][0]);
+        cabor_allocation alloc = CABOR_MALLOC(open_size + count * 2);
+        char* code = alloc.mem;
+
+        memcpy(code, shapes[i][0], open_size);
+        size_t cursor = open_size;
+        for (size_t j = 0; j < count; j++, cursor += 2)
+            memcpy(code + cursor, j + 1 < count ? shapes[i][1] : shapes[i][2], 2);
+
+        cabor_ast* ast = cabor_parse_source(code, cursor);
+        CABOR_CHECK_EQUALS((ast->root != CABOR_AST_NODE_INVALID), true, res);
+        CABOR_CHECK_EQUALS(cabor_ast_num_edges(ast, ast->root), count, res);
+        CABOR_CHECK_EQUALS(ast->pending_edges->size, 0, res);
+
+        cabor_destroy_ast(ast);
+        CABOR_FREE(&alloc);
+    }
+
+    return res;
+}
+
+// Every syntax error of a block is reported in one parse, the statements around them still parse
+int cabor_test_parse_error_recovery()
+{
+    const char* code =
+        "{\n"
+        "    var x = ;\n"
+        "    print_int(1);\n"
+        "    if x 2;\n"
+        "    f(1 2);\n"
+        "    { (y };\n"
+        "    z\n"
+        "}";
+
+    struct { uint32_t line; uint32_t column; const char* message; } expected[] =
+    {
+        { 2, 13, "Unexpected ;" },
+        { 4, 10, "Expected 'then' after 'if' but got 2" },
+        { 5, 9, "Expected , or ) after argument of f but got 2" },
+        { 6, 10, "Expected ) but got }" },
+    };
+    const size_t expected_count = sizeof(expected) / sizeof(expected[0]);
+
+    int res = 0;
+
+    cabor_ast* ast = cabor_parse_source(code, strlen(code));
+    CABOR_CHECK_EQUALS(ast->diagnostics->size, expected_count, res);
+    CABOR_CHECK_EQUALS(ast->panic, false, res);
+    CABOR_CHECK_EQUALS(ast->pending_edges->size, 0, res);
+
+    for (size_t i = 0; i < expected_count && i < ast->diagnostics->size; i++)
+    {
+        cabor_diagnostic* diagnostic = cabor_vector_at_diagnostic(ast->diagnostics, i);
+        CABOR_CHECK_EQUALS(diagnostic->location.line, expected[i].line, res);
+        CABOR_CHECK_EQUALS(diagnostic->location.column, expected[i].column, res);
+        CABOR_CHECK_EQUALS(strcmp(diagnostic->message, expected[i].message), 0, res);
+    }
+
+    // The broken statements are error nodes in the block
+    const cabor_ast_node_type statements[] =
+    {
+        CABOR_NODE_TYPE_ERROR, CABOR_NODE_TYPE_FUNCTION_CALL, CABOR_NODE_TYPE_ERROR,
+        CABOR_NODE_TYPE_ERROR, CABOR_NODE_TYPE_BLOCK, CABOR_NODE_TYPE_IDENTIFIER
+    };
+    const size_t statement_count = sizeof(statements) / sizeof(statements[0]);
+
+    CABOR_CHECK_EQUALS(cabor_ast_node_type_of(ast, ast->root), CABOR_NODE_TYPE_BLOCK, res);
+    CABOR_CHECK_EQUALS(cabor_ast_num_edges(ast, ast->root), statement_count, res);
+    for (size_t i = 0; i < statement_count && i < cabor_ast_num_edges(ast, ast->root); i++)
+        CABOR_CHECK_EQUALS(cabor_ast_node_type_of(ast, cabor_ast_edge(ast, ast->root, i)), statements[i], res);
+
+    cabor_destroy_ast(ast);
+
+    // Input that ends inside nested blocks is one error, not one per block
+    const char* unfinished = "{ { a";
+    ast = cabor_parse_source(unfinished, strlen(unfinished));
+    CABOR_CHECK_EQUALS(ast->diagnostics->size, 1, res);
+    CABOR_CHECK_EQUALS(cabor_vector_at_diagnostic(ast->diagnostics, 0)->location.line, 0, res);
+    CABOR_CHECK_EQUALS(ast->pending_edges->size, 0, res);
+    cabor_destroy_ast(ast);
+
+    ast = cabor_parse_source("", 0);
+    CABOR_CHECK_EQUALS(ast->diagnostics->size, 1, res);
+    CABOR_CHECK_EQUALS(cabor_ast_node_type_of(ast, ast->root), CABOR_NODE_TYPE_ERROR, res);
+    cabor_destroy_ast(ast);
+
+    return res;
+}
+
+static size_t count_diagnostics(const char* code)
+{
+    cabor_ast* ast = cabor_parse_source(code, strlen(code));
+    size_t count = ast->diagnostics->size;
+    cabor_destroy_ast(ast);
+    return count;
+}
+
+int cabor_test_parse_top_level()
+{
+    int res = 0;
+
+    // Statements at the top level recover from errors like they do in a block
+    const char* statements = "var x = ;\nvar y = ;\nvar z = 1;\nz + ;";
+    const char* in_block = "{var x = ;\nvar y = ;\nvar z = 1;\nz + ;}";
+    CABOR_CHECK_EQUALS(count_diagnostics(statements), 3, res);
+    CABOR_CHECK_EQUALS(count_diagnostics(in_block), 3, res);
+
+    // Input after the first statement used to be dropped without an error
+    const char* stray = "print_int(1);\n)\nprint_int(2);\n)";
+    cabor_ast* ast = cabor_parse_source(stray, strlen(stray));
+    CABOR_CHECK_GREATER((int)ast->diagnostics->size, 0, res);
+    if (ast->diagnostics->size > 0)
+    {
+        cabor_diagnostic* diagnostic = cabor_vector_at_diagnostic(ast->diagnostics, 0);
+        CABOR_CHECK_EQUALS(diagnostic->location.line, 2, res);
+        CABOR_CHECK_EQUALS(strcmp(diagnostic->message, "Unexpected )"), 0, res);
+    }
+    cabor_destroy_ast(ast);
+
+    const char* missing_semicolon = "1 2";
+    ast = cabor_parse_source(missing_semicolon, strlen(missing_semicolon));
+    CABOR_CHECK_EQUALS(ast->diagnostics->size, 1, res);
+    if (ast->diagnostics->size == 1)
+        CABOR_CHECK_EQUALS(strcmp(cabor_vector_at_diagnostic(ast->diagnostics, 0)->message, "Expected ';' or end of input after expression but got 2"), 0, res);
+    cabor_destroy_ast(ast);
+
+    // More than one statement is a block, a trailing ';' makes it evaluate to unit
+    const char* program = "var y = 5; print_int(y);";
+    ast = cabor_parse_source(program, strlen(program));
+    CABOR_CHECK_EQUALS(ast->diagnostics->size, 0, res);
+    CABOR_CHECK_EQUALS(ast->pending_edges->size, 0, res);
+    CABOR_CHECK_EQUALS(cabor_ast_node_type_of(ast, ast->root), CABOR_NODE_TYPE_BLOCK, res);
+    CABOR_CHECK_EQUALS(cabor_ast_num_edges(ast, ast->root), 3, res);
+    if (cabor_ast_num_edges(ast, ast->root) == 3)
+    {
+        CABOR_CHECK_EQUALS(cabor_ast_node_type_of(ast, cabor_ast_edge(ast, ast->root, 0)), CABOR_NODE_TYPE_VAR_EXPR, res);
+        CABOR_CHECK_EQUALS(cabor_ast_node_type_of(ast, cabor_ast_edge(ast, ast->root, 1)), CABOR_NODE_TYPE_FUNCTION_CALL, res);
+        CABOR_CHECK_EQUALS(cabor_ast_node_type_of(ast, cabor_ast_edge(ast, ast->root, 2)), CABOR_NODE_TYPE_UNIT, res);
+    }
+    cabor_destroy_ast(ast);
+
+    // A single expression is the root itself
+    const char* single = "1 + 2";
+    ast = cabor_parse_source(single, strlen(single));
+    CABOR_CHECK_EQUALS(cabor_ast_node_type_of(ast, ast->root), CABOR_NODE_TYPE_BINARY_OP, res);
+    cabor_destroy_ast(ast);
+
+    return res;
+}
+
+// Integration tests: tokenizer + parser
+
+int cabor_integration_test_parser_common(const char* code, const char** expected, size_t node_count, cabor_ast_node_idx(top_level_parser)(cabor_ast* ast, cabor_token_stream* stream))
+{
+    int res = 0;
+
+    // Tokens are produced on demand while parsing
+    cabor_token_stream* stream = cabor_create_token_stream(code, strlen(code));
+    cabor_ast* ast = cabor_create_ast();
+    ast->root = top_level_parser(ast, stream);
+    cabor_destroy_token_stream(stream);
+    cabor_vector* nodes = cabor_get_ast_node_list(ast, ast->root);
     CABOR_CHECK_EQUALS(nodes->size, node_count, res);
     for (size_t i = 0; i < node_count; i++)
     {
         char buffer[128] = {0};
-        cabor_ast_node_to_string(tokens, cabor_vector_get_ptr(nodes, i), buffer, 128, false);
+        cabor_ast_node_to_string(ast, *cabor_vector_at_u32(nodes, i), buffer, 128, false);
         int comp = strcmp(buffer, expected[i]);
         //CABOR_LOG(buffer);
         if (comp != 0)
@@ -515,8 +951,7 @@ int cabor_integration_test_parser_common(const char* code, const char** expected
     }
 
     cabor_destroy_vector(nodes);
-    cabor_destroy_vector(tokens);
-    cabor_free_ast(&ast);
+    cabor_destroy_ast(ast);
 
     return res;
 }
@@ -565,6 +1000,65 @@ int cabor_integration_test_parse_expression_abc_parenthesized()
     return cabor_integration_test_parser_common(code, expected, 5, cabor_parse_expression);
 }
 
+int cabor_integration_test_parse_operator_precedence()
+{
+    // One operator from every precedence level, loosest first
+    const char* code = "x = a or b and c == d < e + f * g - h";
+    const char* expected[] = 
+    {
+        "root: =, edges: ['x', 'or']",
+        "root: or, edges: ['a', 'and']",
+        "root: and, edges: ['b', '==']",
+        "root: ==, edges: ['c', '<']",
+        "root: <, edges: ['d', '-']",
+        "root: -, edges: ['+', 'h']",
+        "root: h, edges: []",
+        "root: +, edges: ['e', '*']",
+        "root: *, edges: ['f', 'g']",
+        "root: g, edges: []",
+        "root: f, edges: []",
+        "root: e, edges: []",
+        "root: d, edges: []",
+        "root: c, edges: []",
+        "root: b, edges: []",
+        "root: a, edges: []",
+        "root: x, edges: []",
+    };
+    return cabor_integration_test_parser_common(code, expected, 17, cabor_parse_expression);
+}
+
+int cabor_integration_test_parse_left_associativity()
+{
+    const char* code = "a - b - c % d % e";
+    const char* expected[] = 
+    {
+        "root: -, edges: ['-', '%']",
+        "root: %, edges: ['%', 'e']",
+        "root: e, edges: []",
+        "root: %, edges: ['c', 'd']",
+        "root: d, edges: []",
+        "root: c, edges: []",
+        "root: -, edges: ['a', 'b']",
+        "root: b, edges: []",
+        "root: a, edges: []",
+    };
+    return cabor_integration_test_parser_common(code, expected, 9, cabor_parse_expression);
+}
+
+int cabor_integration_test_parse_block_operand()
+{
+    // Blocks and parenthesized expressions are operands whose token isn't a term
+    const char* code = "{1} + (2)";
+    const char* expected[] =
+    {
+        "root: +, edges: ['{', '2']",
+        "root: 2, edges: []",
+        "root: {, edges: ['1']",
+        "root: 1, edges: []",
+    };
+    return cabor_integration_test_parser_common(code, expected, 4, cabor_parse_expression);
+}
+
 int cabor_integration_test_parse_expression_if_then_else()
 {
     const char* code = "if a then b + c else x * y";
@@ -962,4 +1456,19 @@ int cabor_integration_test_parse_variable_assignment_with_type_declaration()
     return cabor_integration_test_parser_common(code, expected, 6, cabor_parse_expression);
 }
 
+// The token after an if without else belongs to the block
+int cabor_integration_test_parse_if_then_inside_block()
+{
+    const char* code = "{ if a then b; c }";
+    const char* expected[] =
+    {
+        "root: {, edges: ['if', 'c']",
+        "root: c, edges: []",
+        "root: if, edges: ['a', 'b']",
+        "root: b, edges: []",
+        "root: a, edges: []",
+    };
+    return cabor_integration_test_parser_common(code, expected, 5, cabor_parse_expression);
+}
+
 #endif // CABOR_ENABLE_TESTING
@@ -14,11 +14,23 @@ int cabor_test_parse_expression_abc_parenthesized();
 int cabor_test_parse_expression_if_then_else();
 int cabor_test_parse_expression_if_then();
 int cabor_test_parse_function_hello();
+int cabor_test_parse_flat_ast();
+int cabor_test_token_stream();
+int cabor_test_parse_source_locations();
+int cabor_test_ast_traversal();
+int cabor_test_ast_traversal_deep();
+int cabor_test_parse_nesting_limit();
+int cabor_test_parse_wide_nodes();
+int cabor_test_parse_error_recovery();
+int cabor_test_parse_top_level();
 
 // Integration tokenizer + parser
 int cabor_integration_test_parse_expression_abc();
 int cabor_integration_test_parse_expression_cba();
 int cabor_integration_test_parse_expression_abc_parenthesized();
+int cabor_integration_test_parse_operator_precedence();
+int cabor_integration_test_parse_left_associativity();
+int cabor_integration_test_parse_block_operand();
 int cabor_integration_test_parse_expression_if_then_else();
 int cabor_integration_test_parse_expression_if_then();
 int cabor_integration_test_parse_function_hello1();
@@ -43,6 +55,7 @@ int cabor_integration_test_parse_block_expression();
 int cabor_integration_test_parse_block_expression_ending_none();
 int cabor_integration_test_parse_block_complex_expression();
 int cabor_integration_test_parse_variable_assignment_with_type_declaration();
+int cabor_integration_test_parse_if_then_inside_block();
 
 
 #endif // CABOR_ENABLE_TESTING
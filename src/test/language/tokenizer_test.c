@@ -3,6 +3,7 @@
 #include "../../filesystem/filesystem.h"
 #include "../../logging/logging.h"
 #include "../../debug/cabor_debug.h"
+#include "../../bench/tokenizer_bench.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -20,7 +21,7 @@ int cabor_test_tokenize_hello_world()
     cabor_vector* tokens = cabor_tokenize(file);
     char token_string[CABOR_TOKEN_STRINGIFY_STR_SIZE] = { 0 };
 
-    cabor_stringify_tokens(token_string, CABOR_TOKEN_STRINGIFY_STR_SIZE, tokens);
+    cabor_stringify_tokens(token_string, CABOR_TOKEN_STRINGIFY_STR_SIZE, tokens, file->file_memory.mem);
 
     int cmp_result = strcmp(token_string, expected);
     int res = 0;
@@ -39,5 +40,418 @@ int cabor_test_tokenize_hello_world()
     return res;
 }
 
+int cabor_test_tokenize_spans()
+{
+    int res = 0;
+
+    // Identifiers are no longer limited by an inline buffer
+    const char* source = "var a_rather_long_identifier_that_does_not_fit_into_sixty_four_characters = 12 + b;";
+    cabor_file* file = cabor_file_from_buffer(source, strlen(source));
+    cabor_vector* tokens = cabor_tokenize(file);
+
+    CABOR_CHECK_EQUALS(cabor_get_token_size(), 24, res);
+    CABOR_CHECK_EQUALS(tokens->size, 7, res);
+
+    // Every token points back to its text in the source, all but integer literals carry the same text interned
+    for (size_t i = 0; i < tokens->size; i++)
+    {
+        cabor_token* token = cabor_vector_at_token(tokens, i);
+        CABOR_CHECK_EQUALS(cabor_token_has_source(token), true, res);
+        if (token->type == CABOR_INTEGER_LITERAL)
+            continue;
+
+        CABOR_CHECK_EQUALS(strncmp(source + token->offset, cabor_token_str(token), cabor_token_length(token)), 0, res);
+        CABOR_CHECK_EQUALS(strlen(cabor_token_str(token)), cabor_token_length(token), res);
+    }
+
+    cabor_token* identifier = cabor_vector_at_token(tokens, 1);
+    CABOR_CHECK_EQUALS(identifier->type, CABOR_IDENTIFIER, res);
+    CABOR_CHECK_EQUALS(identifier->offset, 4, res);
+    CABOR_CHECK_GREATER(cabor_token_length(identifier), 64, res);
+
+    CABOR_CHECK_EQUALS(cabor_token_is(cabor_vector_at_token(tokens, 0), CABOR_ATOM_VAR), true, res);
+    CABOR_CHECK_EQUALS(cabor_token_is(cabor_vector_at_token(tokens, 4), CABOR_ATOM_PLUS), true, res);
+
+    cabor_token* literal = cabor_vector_at_token(tokens, 3);
+    char text[CABOR_TOKEN_TEXT_SIZE];
+    CABOR_CHECK_EQUALS(literal->atom, CABOR_ATOM_INVALID, res);
+    CABOR_CHECK_EQUALS(literal->value, 12, res);
+    CABOR_CHECK_EQUALS(strncmp(source + literal->offset, "12", cabor_token_length(literal)), 0, res);
+    CABOR_CHECK_EQUALS(strcmp(cabor_token_text(literal, text, sizeof(text)), "12"), 0, res);
+
+    cabor_token unit = cabor_create_synthetic_token(CABOR_UNIT, CABOR_ATOM_UNIT);
+    CABOR_CHECK_EQUALS(cabor_token_has_source(&unit), false, res);
+
+    cabor_destroy_vector(tokens);
+    cabor_destroy_file(file);
+
+    return res;
+}
+
+int cabor_test_tokenize_keywords_and_operators()
+{
+    int res = 0;
+
+    // Reserved words only match whole identifiers, operators take the longest match
+    const char* source = "orange or android and\tnotes not iffy if x!=-1 // trailing comment";
+    const char* expected = "['orange', 'or', 'android', 'and', 'notes', 'not', 'iffy', 'if', 'x', '!=', '-', '1']";
+
+    cabor_file* file = cabor_file_from_buffer(source, strlen(source));
+    cabor_vector* tokens = cabor_tokenize(file);
+
+    char token_string[CABOR_TOKEN_STRINGIFY_STR_SIZE] = { 0 };
+    cabor_stringify_tokens(token_string, CABOR_TOKEN_STRINGIFY_STR_SIZE, tokens, source);
+
+    int cmp_result = strcmp(token_string, expected);
+    if (cmp_result)
+    {
+        CABOR_LOG_ERR_F("EXPECTED : %s", expected);
+        CABOR_LOG_ERR_F("ACTUAL   : %s", token_string);
+    }
+    CABOR_CHECK_EQUALS(cmp_result, 0, res);
+
+    const cabor_token_type expected_types[] =
+    {
+        CABOR_IDENTIFIER, CABOR_OPERATOR, CABOR_IDENTIFIER, CABOR_OPERATOR, CABOR_IDENTIFIER, CABOR_OPERATOR,
+        CABOR_IDENTIFIER, CABOR_KEYWORD, CABOR_IDENTIFIER, CABOR_OPERATOR, CABOR_OPERATOR, CABOR_INTEGER_LITERAL
+    };
+
+    CABOR_CHECK_EQUALS(tokens->size, 12, res);
+    for (size_t i = 0; i < tokens->size && i < 12; i++)
+    {
+        CABOR_CHECK_EQUALS(cabor_vector_at_token(tokens, i)->type, expected_types[i], res);
+    }
+
+    CABOR_CHECK_EQUALS(cabor_token_is(cabor_vector_at_token(tokens, 1), CABOR_ATOM_OR), true, res);
+    CABOR_CHECK_EQUALS(cabor_token_is(cabor_vector_at_token(tokens, 9), CABOR_ATOM_NE), true, res);
+
+    cabor_destroy_vector(tokens);
+    cabor_destroy_file(file);
+
+    return res;
+}
+
+// Every vector scanner has to agree with the scalar one at every start position, including the
+// tails that are shorter than a vector and bytes right next to the character class ranges
+int cabor_test_tokenize_scan_levels()
+{
+    int res = 0;
+
+    const char* source =
+        "  \t\r\n                                      identifier_with_Digits_0123456789_and_MORE_letters"
+        " @[`{/:\xC3\xA9 12345678901234567890123456789012345678 /* block * comment / ** still going */ tail */"
+        "// line comment that is longer than thirty two bytes\n"
+        "aZ_09  \n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n x*/";
+
+    size_t length = strlen(source);
+    const cabor_scanner* scalar = cabor_get_scanner(CABOR_SCAN_SCALAR);
+
+    CABOR_CHECK_EQUALS((scalar != NULL), true, res);
+    CABOR_CHECK_EQUALS((cabor_get_scanner(cabor_detect_scan_level()) != NULL), true, res);
+
+    for (int level = CABOR_SCAN_SSE2; level < CABOR_SCAN_NUM_LEVELS; level++)
+    {
+        const cabor_scanner* scanner = cabor_get_scanner((cabor_scan_level)level);
+        if (!scanner)
+            continue;
+
+        CABOR_LOG_TEST_F("-- checking %s scanner", cabor_scan_level_to_str((cabor_scan_level)level));
+
+        // Shorter sizes move the end of the buffer over every vector boundary
+        for (size_t size = length - 40; size <= length; size++)
+        {
+            for (size_t cursor = 0; cursor <= size; cursor++)
+            {
+                CABOR_CHECK_EQUALS(scanner->skip_whitespace(source, cursor, size), scalar->skip_whitespace(source, cursor, size), res);
+                CABOR_CHECK_EQUALS(scanner->skip_identifier(source, cursor, size), scalar->skip_identifier(source, cursor, size), res);
+                CABOR_CHECK_EQUALS(scanner->skip_digits(source, cursor, size), scalar->skip_digits(source, cursor, size), res);
+                CABOR_CHECK_EQUALS(scanner->find_line_end(source, cursor, size), scalar->find_line_end(source, cursor, size), res);
+                CABOR_CHECK_EQUALS(scanner->find_block_comment_end(source, cursor, size), scalar->find_block_comment_end(source, cursor, size), res);
+            }
+        }
+    }
+
+    return res;
+}
+
+static int check_same_tokens(cabor_vector* expected, cabor_vector* actual)
+{
+    int res = 0;
+    CABOR_CHECK_EQUALS(actual->size, expected->size, res);
+
+    for (size_t i = 0; i < expected->size && i < actual->size; i++)
+    {
+        cabor_token* e = cabor_vector_at_token(expected, i);
+        cabor_token* a = cabor_vector_at_token(actual, i);
+        CABOR_CHECK_EQUALS(a->atom, e->atom, res);
+        CABOR_CHECK_EQUALS(a->offset, e->offset, res);
+        CABOR_CHECK_EQUALS(a->length, e->length, res);
+        CABOR_CHECK_EQUALS(a->type, e->type, res);
+    }
+
+    return res;
+}
+
+// Feeding the source in pieces has to give the same tokens as tokenizing it in one go,
+// wherever the chunk boundaries fall
+int cabor_test_tokenize_chunked()
+{
+    int res = 0;
+
+    const char* source =
+        "var x = 123; // line comment\n"
+        "/* block * comment **/ while x >= 10 do { x = x-1; print_int(x) }\n"
+        "if not a != b or c <= 4 then y else z/2 // no new line at the end";
+
+    size_t size = strlen(source);
+
+    cabor_file* file = cabor_file_from_buffer(source, size);
+    cabor_vector* expected = cabor_tokenize(file);
+    cabor_destroy_file(file);
+
+    // Two chunks, split at every position
+    for (size_t split = 0; split <= size; split++)
+    {
+        cabor_vector* tokens = cabor_create_vector(64, CABOR_TOKEN, false);
+        cabor_tokenizer* tokenizer = cabor_create_tokenizer();
+
+        cabor_tokenizer_feed(tokenizer, source, split, tokens);
+        cabor_tokenizer_feed(tokenizer, source + split, size - split, tokens);
+        cabor_tokenizer_finish(tokenizer, tokens);
+
+        if (check_same_tokens(expected, tokens))
+        {
+            CABOR_LOG_ERR_F("Chunked tokens differ when split at %zu", split);
+            res = 1;
+        }
+
+        cabor_destroy_tokenizer(tokenizer);
+        cabor_destroy_vector(tokens);
+    }
+
+    // One byte at a time, a token is yielded as soon as the byte after it arrives
+    cabor_vector* tokens = cabor_create_vector(64, CABOR_TOKEN, false);
+    cabor_tokenizer* tokenizer = cabor_create_tokenizer();
+
+    size_t yielded = 0;
+    for (size_t i = 0; i < size; i++)
+        yielded += cabor_tokenizer_feed(tokenizer, source + i, 1, tokens);
+
+    // The source ends in a comment so the last token was finished by the space after it
+    CABOR_CHECK_EQUALS(yielded, expected->size, res);
+    CABOR_CHECK_EQUALS(cabor_tokenizer_finish(tokenizer, tokens), 0, res);
+    CABOR_CHECK_EQUALS(check_same_tokens(expected, tokens), 0, res);
+
+    cabor_destroy_tokenizer(tokenizer);
+    cabor_destroy_vector(tokens);
+    cabor_destroy_vector(expected);
+
+    return res;
+}
+
+// Comments with whitespace in them make the workers guess the state at the start of their chunk
+// wrong, the joined tokens still have to match the serial tokenizer for any number of threads
+int cabor_test_tokenize_parallel()
+{
+    int res = 0;
+
+    const char* lines[] =
+    {
+        "var x = 123; // line comment with a few words in it\n",
+        "/* block comment\n that spans\n   a few lines * / */ while x >= 10 do { x = x-1; print_int(x) }\n",
+        "if not a != b or c <= 4 then y else z/2\n",
+        "{ f(a, b); g(1 + 2 * 3) }   \t\r\n",
+    };
+
+    const size_t num_lines = 400;
+    size_t size = 0;
+    for (size_t i = 0; i < num_lines; i++)
+        size += strlen(lines[i % 4]);
+
+    cabor_allocation source_alloc = CABOR_MALLOC(size);
+    char* source = source_alloc.mem;
+
+    size_t cursor = 0;
+    for (size_t i = 0; i < num_lines; i++)
+    {
+        // Skewed order so the comments land at different places relative to the chunk boundaries
+        const char* line = lines[(i * 7 / 3) % 4];
+        size_t length = strlen(line);
+        memcpy(source + cursor, line, length);
+        cursor += length;
+    }
+    size = cursor;
+
+    cabor_file* file = cabor_file_from_buffer(source, size);
+    cabor_vector* expected = cabor_tokenize_parallel(file, 1, NULL);
+
+    for (size_t num_threads = 2; num_threads <= 16; num_threads++)
+    {
+        cabor_vector* tokens = cabor_tokenize_parallel(file, num_threads, NULL);
+        if (check_same_tokens(expected, tokens))
+        {
+            CABOR_LOG_ERR_F("Parallel tokens differ with %zu threads", num_threads);
+            res = 1;
+        }
+        cabor_destroy_vector(tokens);
+    }
+
+    cabor_destroy_vector(expected);
+    cabor_destroy_file(file);
+    CABOR_FREE(&source_alloc);
+
+    return res;
+}
+
+// Integer literals carry their value, literals that don't fit in 64 bits are flagged
+int cabor_test_tokenize_integer_values()
+{
+    int res = 0;
+
+    const char* source = "0 7 0042 123456789 9223372036854775807 9223372036854775808 99999999999999999999 x";
+    cabor_file* file = cabor_file_from_buffer(source, strlen(source));
+    cabor_vector* tokens = cabor_tokenize(file);
+    cabor_destroy_file(file);
+
+    const int64_t expected[] = { 0, 7, 42, 123456789, INT64_MAX, INT64_MAX, INT64_MAX, 0 };
+    const bool overflow[] = { false, false, false, false, false, true, true, false };
+
+    CABOR_CHECK_EQUALS(tokens->size, 8, res);
+    for (size_t i = 0; i < tokens->size && i < 8; i++)
+    {
+        cabor_token* token = cabor_vector_at_token(tokens, i);
+        CABOR_CHECK_EQUALS(token->value, expected[i], res);
+        CABOR_CHECK_EQUALS(((token->flags & CABOR_TOKEN_FLAG_OVERFLOW) != 0), overflow[i], res);
+    }
+
+    // Synthetic literals are parsed too
+    cabor_token synthetic = cabor_create_synthetic_token(CABOR_INTEGER_LITERAL, cabor_intern("1234"));
+    CABOR_CHECK_EQUALS(synthetic.value, 1234, res);
+
+    cabor_destroy_vector(tokens);
+
+    return res;
+}
+
+static int check_line_table(const char* source, size_t size, cabor_vector* tokens, cabor_line_table* lines)
+{
+    int res = 0;
+
+    size_t num_lines = 1;
+    for (size_t i = 0; i < size; i++)
+        num_lines += source[i] == '\n';
+    CABOR_CHECK_EQUALS(cabor_line_table_line_count(lines), num_lines, res);
+
+    // Count lines and columns by hand while walking the tokens in order
+    uint32_t line = 1;
+    uint32_t column = 1;
+    size_t cursor = 0;
+    for (size_t i = 0; i < tokens->size; i++)
+    {
+        cabor_token* token = cabor_vector_at_token(tokens, i);
+        for (; cursor < token->offset; cursor++)
+        {
+            column++;
+            if (source[cursor] == '\n')
+            {
+                line++;
+                column = 1;
+            }
+        }
+
+        cabor_source_location location = cabor_line_table_lookup(lines, token->offset);
+        CABOR_CHECK_EQUALS(location.line, line, res);
+        CABOR_CHECK_EQUALS(location.column, column, res);
+    }
+
+    return res;
+}
+
+// Lines are recorded from whitespace, line comments and block comments, serially and in parallel
+int cabor_test_tokenize_line_table()
+{
+    int res = 0;
+
+    const char* source =
+        "var x = 123; // line comment\n"
+        "/* block comment\n spanning\n\n lines */ while x >= 10 do {\n"
+        "\tx = x-1;\r\n"
+        "    print_int(x) }\n\n"
+        "if a then\n b\n else c";
+
+    const size_t repeat = 50;
+    size_t length = strlen(source);
+    cabor_allocation source_alloc = CABOR_MALLOC(length * repeat);
+    for (size_t i = 0; i < repeat; i++)
+        memcpy((char*)source_alloc.mem + i * length, source, length);
+
+    size_t size = length * repeat;
+    cabor_file* file = cabor_file_from_buffer(source_alloc.mem, size);
+
+    for (size_t num_threads = 1; num_threads <= 8; num_threads++)
+    {
+        cabor_line_table* lines = cabor_create_line_table();
+        cabor_vector* tokens = cabor_tokenize_parallel(file, num_threads, lines);
+
+        if (check_line_table(source_alloc.mem, size, tokens, lines))
+        {
+            CABOR_LOG_ERR_F("Line table is wrong with %zu threads", num_threads);
+            res = 1;
+        }
+
+        cabor_destroy_vector(tokens);
+        cabor_destroy_line_table(lines);
+    }
+
+    cabor_destroy_file(file);
+    CABOR_FREE(&source_alloc);
+
+    return res;
+}
+
+int cabor_test_tokenize_bench_programs()
+{
+    int res = 0;
+    const size_t size = 64 * 1024;
+
+    for (int shape = 0; shape < CABOR_BENCH_NUM_SHAPES; shape++)
+    {
+        cabor_file* file = cabor_generate_bench_program((cabor_bench_shape)shape, size, 1234);
+        cabor_file* again = cabor_generate_bench_program((cabor_bench_shape)shape, size, 1234);
+
+        // Programs are at least the requested size and only depend on the seed
+        CABOR_CHECK_GREATER_EQ(file->size, size, res);
+        CABOR_CHECK_EQUALS(file->size, again->size, res);
+        CABOR_CHECK_EQUALS(memcmp(file->file_memory.mem, again->file_memory.mem, file->size), 0, res);
+
+        // Every byte is something the tokenizer understands
+        cabor_vector* tokens = cabor_tokenize(file);
+        CABOR_CHECK_GREATER(tokens->size, 0, res);
+        for (size_t i = 0; i < tokens->size; i++)
+        {
+            cabor_token* token = cabor_vector_at_token(tokens, i);
+            CABOR_CHECK_EQUALS((token->type != CABOR_TOKEN_UNKNOWN), true, res);
+        }
+
+        cabor_destroy_vector(tokens);
+        cabor_destroy_file(file);
+        cabor_destroy_file(again);
+    }
+
+    cabor_tokenizer_bench_config config = cabor_default_tokenizer_bench_config();
+    config.source_size = 16 * 1024;
+    config.warmup_runs = 1;
+    config.runs = 5;
+
+    cabor_tokenizer_bench_result result;
+    cabor_run_tokenizer_bench(CABOR_BENCH_IDENTIFIER_HEAVY, &config, &result);
+
+    CABOR_CHECK_GREATER_EQ(result.bytes, config.source_size, res);
+    CABOR_CHECK_GREATER(result.tokens, 0, res);
+    CABOR_CHECK_EQUALS((result.min <= result.p50 && result.p50 <= result.p90 && result.p90 <= result.p99 && result.p99 <= result.max), true, res);
+    CABOR_CHECK_GREATER(result.tokens_per_sec, 0, res);
+
+    return res;
+}
 
 #endif // CABOR_ENABLE_TESTING
@@ -6,7 +6,16 @@
 
 #include "../test_framework.h"
 #include "../../language/tokenizer.h"
+#include "../../language/scan.h"
 
 int cabor_test_tokenize_hello_world();
+int cabor_test_tokenize_spans();
+int cabor_test_tokenize_keywords_and_operators();
+int cabor_test_tokenize_scan_levels();
+int cabor_test_tokenize_chunked();
+int cabor_test_tokenize_parallel();
+int cabor_test_tokenize_line_table();
+int cabor_test_tokenize_integer_values();
+int cabor_test_tokenize_bench_programs();
 
 #endif // CABOR_ENABLE_TESTING
@@ -2,6 +2,7 @@
 
 #ifdef CABOR_ENABLE_TESTING
 
+#include <stdio.h>
 #include <string.h>
 #include "../../language/type_checker.h"
 
@@ -13,16 +14,15 @@ static int test_typecheck_common(const char* code, size_t node_count, const char
     cabor_destroy_file(file);
 
     cabor_ast* ast = cabor_parse(tokens);
-    cabor_vector* nodes = cabor_get_ast_node_list_al(ast->root);
+    cabor_vector* nodes = cabor_get_ast_node_list(ast, ast->root);
 
     cabor_symbol_table* root_sym_table = cabor_create_symbol_table();
-    cabor_ast_node* root = cabor_access_ast_node(ast->root);
-    cabor_type type = cabor_typecheck(ast, root, root_sym_table);
+    cabor_type type = cabor_typecheck(ast, ast->root, root_sym_table);
     CABOR_CHECK_EQUALS(nodes->size, node_count, res);
     for (size_t i = 0; i < node_count; i++)
     {
         char buffer[256] = { 0 };
-        cabor_ast_node_to_string(tokens, cabor_vector_get_ptr(nodes, i), buffer, 128, true);
+        cabor_ast_node_to_string(ast, *cabor_vector_at_u32(nodes, i), buffer, 128, true);
         int comp = strcmp(buffer, expected[i]);
         //CABOR_LOG(buffer);
         if (comp != 0)
@@ -51,8 +51,7 @@ static int test_typecheck_common_expect_fail(const char* code)
     cabor_ast* ast = cabor_parse(tokens);
 
     cabor_symbol_table* root_sym_table = cabor_create_symbol_table();
-    cabor_ast_node* root = cabor_access_ast_node(ast->root);
-    cabor_type type = cabor_typecheck(ast, root, root_sym_table);
+    cabor_type type = cabor_typecheck(ast, ast->root, root_sym_table);
 
     CABOR_CHECK_EQUALS(type, CABOR_TYPE_ERROR, res);
 
@@ -187,10 +186,138 @@ int cabor_integration_test_typecheck_not_bool_while()
     return test_typecheck_common_expect_fail(code);
 }
 
+// Type of the whole program, sibling scopes are only freed with the arena they came from
+static cabor_type typecheck_source(const char* code, bool parallel)
+{
+    cabor_allocator_context arena;
+    create_cabor_arena_allocator_context(&arena, cabor_get_current_allocator_context(), 64 * 1024);
+    cabor_allocator_context* previous_allocator = cabor_set_current_allocator_context(&arena);
+
+    cabor_ast* ast = cabor_parse_source(code, strlen(code));
+    cabor_type type = parallel
+        ? cabor_typecheck_parallel(ast, ast->root, cabor_create_symbol_table(), 4)
+        : cabor_typecheck(ast, ast->root, cabor_create_symbol_table());
+
+    cabor_set_current_allocator_context(previous_allocator);
+    destroy_cabor_allocator_context(&arena);
+
+    return type;
+}
+
+// Blocks see the names declared around them, the names they declare end with the block
 int cabor_integration_test_typecheck_scoping_rules()
 {
-    const char* code = "{ var x: Int = 1; { var y: Int = x + 1 } }";
-    return test_typecheck_common_expect_fail(code);
+    int res = 0;
+
+    CABOR_CHECK_EQUALS(typecheck_source("{ var x: Int = 1; { var y: Int = x + 1 } }", false), CABOR_TYPE_INT, res);
+    CABOR_CHECK_EQUALS(typecheck_source("{ var x = true; { var x = 1; x } }", false), CABOR_TYPE_INT, res);
+    CABOR_CHECK_EQUALS(typecheck_source("{ { var y: Int = 1 }; y }", false), CABOR_TYPE_ERROR, res);
+    CABOR_CHECK_EQUALS(typecheck_source("{ var x = 1; var x = 2 }", false), CABOR_TYPE_ERROR, res);
+
+    return res;
+}
+
+// Blocks with and without type errors, blocks used as values and blocks behind a condition that fails.
+// The parallel check has to give every node the same type as the serial one.
+int cabor_integration_test_typecheck_parallel()
+{
+    const size_t block_count = 256;
+    const char* patterns[] =
+    {
+        "{ var a = %zu; a * 2 };\n",
+        "var r%zu = { var b = true; if b then { var c = 1; c } else 2 };\n",
+        "{ var d = %zu; d + true };\n",
+        "if 1 then { var e = %zu; e } else 0;\n",
+    };
+    const size_t pattern_count = sizeof(patterns) / sizeof(patterns[0]);
+
+    int res = 0;
+
+    cabor_allocation alloc = CABOR_MALLOC(block_count * 96 + 16);
+    char* code = alloc.mem;
+    size_t size = 0;
+
+    size += sprintf(code + size, "{\n");
+    for (size_t i = 0; i < block_count; i++)
+        size += sprintf(code + size, patterns[i % pattern_count], i);
+    size += sprintf(code + size, "1 }");
+
+    // Sibling scopes are only freed with the allocator they came from, like in the compiler
+    cabor_allocator_context arena;
+    create_cabor_arena_allocator_context(&arena, cabor_get_current_allocator_context(), 64 * 1024);
+    cabor_allocator_context* previous_allocator = cabor_set_current_allocator_context(&arena);
+
+    cabor_ast* serial = cabor_parse_source(code, size);
+    cabor_ast* parallel = cabor_parse_source(code, size);
+    CABOR_CHECK_EQUALS(serial->diagnostics->size, 0, res);
+
+    cabor_type serial_type = cabor_typecheck(serial, serial->root, cabor_create_symbol_table());
+    cabor_type parallel_type = cabor_typecheck_parallel(parallel, parallel->root, cabor_create_symbol_table(), 4);
+
+    CABOR_CHECK_EQUALS(parallel_type, serial_type, res);
+    CABOR_CHECK_EQUALS(cabor_get_ast_node_count(parallel), cabor_get_ast_node_count(serial), res);
+    CABOR_CHECK_EQUALS(memcmp(parallel->types->vector_mem.mem, serial->types->vector_mem.mem, serial->types->size), 0, res);
+
+    cabor_set_current_allocator_context(previous_allocator);
+    destroy_cabor_allocator_context(&arena);
+    CABOR_FREE(&alloc);
+
+    return res;
+}
+
+// Blocks that use names declared around them can't be checked on their own, a worker would find the
+// names undeclared. The types have to match the serial check, and the blocks inside them still go to
+// the workers.
+int cabor_integration_test_typecheck_parallel_outer_names()
+{
+    const size_t block_count = 256;
+    const char* patterns[] =
+    {
+        "{ var a = base + %zu; { var b = 2; b * 2 } };\n",
+        "{ var c = base; var base = true; if base then %zu else c };\n",
+        "{ var base = %zu; base };\n",
+        "if true then { base + %zu } else { var d = 1; d };\n",
+    };
+    const size_t pattern_count = sizeof(patterns) / sizeof(patterns[0]);
+
+    int res = 0;
+
+    cabor_allocation alloc = CABOR_MALLOC(block_count * 96 + 32);
+    char* code = alloc.mem;
+    size_t size = 0;
+
+    size += sprintf(code + size, "var base = 1;\n");
+    for (size_t i = 0; i < block_count; i++)
+        size += sprintf(code + size, patterns[i % pattern_count], i);
+    size += sprintf(code + size, "base");
+
+    cabor_allocator_context arena;
+    create_cabor_arena_allocator_context(&arena, cabor_get_current_allocator_context(), 64 * 1024);
+    cabor_allocator_context* previous_allocator = cabor_set_current_allocator_context(&arena);
+
+    cabor_ast* serial = cabor_parse_source(code, size);
+    cabor_ast* parallel = cabor_parse_source(code, size);
+    CABOR_CHECK_EQUALS(serial->diagnostics->size, 0, res);
+
+    cabor_type serial_type = cabor_typecheck(serial, serial->root, cabor_create_symbol_table());
+    cabor_type parallel_type = cabor_typecheck_parallel(parallel, parallel->root, cabor_create_symbol_table(), 4);
+
+    CABOR_CHECK_EQUALS(serial_type, CABOR_TYPE_INT, res);
+    CABOR_CHECK_EQUALS(parallel_type, serial_type, res);
+    CABOR_CHECK_EQUALS(memcmp(parallel->types->vector_mem.mem, serial->types->vector_mem.mem, serial->types->size), 0, res);
+
+    // Every statement of the program is well typed, a block checked without the names around it isn't
+    for (size_t i = 0; i < cabor_ast_num_edges(parallel, parallel->root); i++)
+    {
+        cabor_ast_node_idx statement = cabor_ast_edge(parallel, parallel->root, i);
+        CABOR_CHECK_EQUALS((cabor_ast_type_of(parallel, statement) != CABOR_TYPE_ERROR), true, res);
+    }
+
+    cabor_set_current_allocator_context(previous_allocator);
+    destroy_cabor_allocator_context(&arena);
+    CABOR_FREE(&alloc);
+
+    return res;
 }
 
 #endif
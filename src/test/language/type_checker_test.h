@@ -21,6 +21,8 @@ int cabor_integration_test_typecheck_mismatched_branch_types();
 int cabor_integration_test_typecheck_not_bool_if();
 int cabor_integration_test_typecheck_not_bool_while();
 int cabor_integration_test_typecheck_scoping_rules();
+int cabor_integration_test_typecheck_parallel();
+int cabor_integration_test_typecheck_parallel_outer_names();
 
 
 #endif
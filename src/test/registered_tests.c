@@ -5,6 +5,11 @@
 #include "core/vector_test.h"
 #include "core/stack_test.h"
 #include "core/hashmap_test.h"
+#include "core/arena_test.h"
+#include "core/memory_test.h"
+#include "core/pool_test.h"
+#include "core/intern_test.h"
+#include "core/worker_pool_test.h"
 #include "filesystem/filesystem_tests.h"
 #include "language/tokenizer_test.h"
 #include "language/parser_test.h"
@@ -20,11 +25,37 @@ void register_all_tests()
     CABOR_REGISTER_TEST("UNIT vector peek", cabor_test_vector_peek);
     CABOR_REGISTER_TEST("UNIT vector resize", cabor_test_vector_resize);
     CABOR_REGISTER_TEST("UNIT vector zero initialized", cabor_test_zero_vector_initialized);
+    CABOR_REGISTER_TEST("UNIT vector stride", cabor_test_vector_stride);
 
     // Hashmap tests
     CABOR_REGISTER_TEST("UNIT hashmap insert and get", cabor_unit_test_hashmap_insert_and_get);
     CABOR_REGISTER_TEST("UNIT hashmap collisions", cabor_unit_test_hashmap_collison_test);
     CABOR_REGISTER_TEST("UNIT hashmap tiny collisions", cabor_unit_test_hashmap_tiny_collisions);
+    CABOR_REGISTER_TEST("UNIT hashmap grow", cabor_unit_test_hashmap_grow);
+    CABOR_REGISTER_TEST("UNIT hashmap borrowed keys", cabor_unit_test_hashmap_borrowed_keys);
+
+    // Arena tests
+    CABOR_REGISTER_TEST("UNIT arena alloc", cabor_unit_test_arena_alloc);
+    CABOR_REGISTER_TEST("UNIT arena realloc", cabor_unit_test_arena_realloc);
+    CABOR_REGISTER_TEST("UNIT arena vector", cabor_unit_test_arena_vector);
+
+    // Allocator tests
+    CABOR_REGISTER_TEST("UNIT thread allocator contexts", cabor_unit_test_thread_allocator_contexts);
+    CABOR_REGISTER_TEST("UNIT allocation trace", cabor_unit_test_allocation_trace);
+
+    // Pool tests
+    CABOR_REGISTER_TEST("UNIT pool alloc", cabor_unit_test_pool_alloc);
+    CABOR_REGISTER_TEST("UNIT pooled malloc", cabor_unit_test_pooled_malloc);
+
+    // Intern tests
+    CABOR_REGISTER_TEST("UNIT intern builtins", cabor_unit_test_intern_builtins);
+    CABOR_REGISTER_TEST("UNIT intern threads", cabor_unit_test_intern_threads);
+    CABOR_REGISTER_TEST("UNIT intern grow", cabor_unit_test_intern_grow);
+    CABOR_REGISTER_TEST("UNIT intern scope", cabor_unit_test_intern_scope);
+
+    // Worker pool tests
+    CABOR_REGISTER_TEST("UNIT worker pool run", cabor_unit_test_worker_pool_run);
+    CABOR_REGISTER_TEST("UNIT worker pool submitters", cabor_unit_test_worker_pool_submitters);
 
     // Stack tests
     CABOR_REGISTER_TEST("UNIT stack push", cabor_test_stack_push);
@@ -33,19 +64,40 @@ void register_all_tests()
 
     // Filesystem tests
     CABOR_REGISTER_TEST("INTEGRATION load file", cabor_test_load_file);
+    CABOR_REGISTER_TEST("INTEGRATION map file", cabor_test_map_file);
 
     // Language tests
     CABOR_REGISTER_TEST("UNIT tokenize hello world", cabor_test_tokenize_hello_world);
+    CABOR_REGISTER_TEST("UNIT tokenize spans", cabor_test_tokenize_spans);
+    CABOR_REGISTER_TEST("UNIT tokenize keywords and operators", cabor_test_tokenize_keywords_and_operators);
+    CABOR_REGISTER_TEST("UNIT tokenize scan levels", cabor_test_tokenize_scan_levels);
+    CABOR_REGISTER_TEST("UNIT tokenize chunked", cabor_test_tokenize_chunked);
+    CABOR_REGISTER_TEST("UNIT tokenize parallel", cabor_test_tokenize_parallel);
+    CABOR_REGISTER_TEST("UNIT tokenize line table", cabor_test_tokenize_line_table);
+    CABOR_REGISTER_TEST("UNIT tokenize integer values", cabor_test_tokenize_integer_values);
+    CABOR_REGISTER_TEST("UNIT tokenize bench programs", cabor_test_tokenize_bench_programs);
     CABOR_REGISTER_TEST("UNIT parse expression abc", cabor_test_parse_expression_abc);
     CABOR_REGISTER_TEST("UNIT parse expression cba", cabor_test_parse_expression_cba);
     CABOR_REGISTER_TEST("UNIT parse expression abc parenthesized", cabor_test_parse_expression_abc_parenthesized);
     CABOR_REGISTER_TEST("UNIT parse expression if then else", cabor_test_parse_expression_if_then_else);
     CABOR_REGISTER_TEST("UNIT parse expression if then", cabor_test_parse_expression_if_then);
     CABOR_REGISTER_TEST("UNIT parse function hello()", cabor_test_parse_function_hello);
+    CABOR_REGISTER_TEST("UNIT parse flat ast", cabor_test_parse_flat_ast);
+    CABOR_REGISTER_TEST("UNIT token stream", cabor_test_token_stream);
+    CABOR_REGISTER_TEST("UNIT parse source locations", cabor_test_parse_source_locations);
+    CABOR_REGISTER_TEST("UNIT ast traversal", cabor_test_ast_traversal);
+    CABOR_REGISTER_TEST("UNIT ast traversal deep", cabor_test_ast_traversal_deep);
+    CABOR_REGISTER_TEST("UNIT parse nesting limit", cabor_test_parse_nesting_limit);
+    CABOR_REGISTER_TEST("UNIT parse wide nodes", cabor_test_parse_wide_nodes);
+    CABOR_REGISTER_TEST("UNIT parse error recovery", cabor_test_parse_error_recovery);
+    CABOR_REGISTER_TEST("UNIT parse top level", cabor_test_parse_top_level);
 
     CABOR_REGISTER_TEST("INTEGRATION parse expression abc", cabor_integration_test_parse_expression_abc);
     CABOR_REGISTER_TEST("INTEGRATION parse expression cba", cabor_integration_test_parse_expression_cba);
     CABOR_REGISTER_TEST("INTEGRATION parse expression abc parenthesized", cabor_integration_test_parse_expression_abc_parenthesized);
+    CABOR_REGISTER_TEST("INTEGRATION parse operator precedence", cabor_integration_test_parse_operator_precedence);
+    CABOR_REGISTER_TEST("INTEGRATION parse left associativity", cabor_integration_test_parse_left_associativity);
+    CABOR_REGISTER_TEST("INTEGRATION parse block operand", cabor_integration_test_parse_block_operand);
     CABOR_REGISTER_TEST("INTEGRATION parse expression if then else", cabor_integration_test_parse_expression_if_then_else);
     CABOR_REGISTER_TEST("INTEGRATION parse expression if then", cabor_integration_test_parse_expression_if_then);
     CABOR_REGISTER_TEST("INTEGRATION parse function hello1()", cabor_integration_test_parse_function_hello1);
@@ -70,6 +122,7 @@ void register_all_tests()
     CABOR_REGISTER_TEST("INTEGRATION parse block expression ending none", cabor_integration_test_parse_block_expression_ending_none);
     CABOR_REGISTER_TEST("INTEGRATION parse block complex expression", cabor_integration_test_parse_block_complex_expression);
     CABOR_REGISTER_TEST("INTEGRATION parse variable assignment with type decl", cabor_integration_test_parse_variable_assignment_with_type_declaration);
+    CABOR_REGISTER_TEST("INTEGRATION parse if then inside block", cabor_integration_test_parse_if_then_inside_block);
    
     // Typechecker tests
     CABOR_REGISTER_TEST("INTEGRATION typecheck var declaration", cabor_integration_test_typecheck_var_declaration);
@@ -86,6 +139,8 @@ void register_all_tests()
     CABOR_REGISTER_TEST("INTEGRATION typecheck not bool if", cabor_integration_test_typecheck_not_bool_if);
     CABOR_REGISTER_TEST("INTEGRATION typecheck not bool while", cabor_integration_test_typecheck_not_bool_while);
     CABOR_REGISTER_TEST("INTEGRATION typecheck scoping rules", cabor_integration_test_typecheck_scoping_rules);
+    CABOR_REGISTER_TEST("INTEGRATION typecheck parallel", cabor_integration_test_typecheck_parallel);
+    CABOR_REGISTER_TEST("INTEGRATION typecheck parallel outer names", cabor_integration_test_typecheck_parallel_outer_names);
 
     // IR tests
     CABOR_REGISTER_TEST("INTEGRATION IR basic expression", cabor_integration_test_ir_basic_expression);
@@ -96,13 +151,21 @@ void register_all_tests()
     CABOR_REGISTER_TEST("INTEGRATION IR unary op", cabor_integration_test_ir_unary_op);
     CABOR_REGISTER_TEST("INTEGRATION IR while", cabor_integration_test_ir_while);
     CABOR_REGISTER_TEST("INTEGARTION IR blocks", cabor_integration_test_blocks);
+    CABOR_REGISTER_TEST("INTEGRATION IR large block", cabor_integration_test_ir_large_block);
 
     // Codegen tests
     CABOR_REGISTER_TEST("INTEGRATION codegen basic", cabor_integration_test_codegen_basic);
     CABOR_REGISTER_TEST("INTEGRATION codegen print_int", cabor_integration_test_codegen_print_int);
 
     // end to end
+    CABOR_REGISTER_TEST("UNIT codegen mov imm", cabor_test_codegen_mov_imm);
     CABOR_REGISTER_TEST("COMPILER test 1", cabor_compiler_test1);
+    CABOR_REGISTER_TEST("COMPILER compile span", cabor_compiler_test_span);
+    CABOR_REGISTER_TEST("COMPILER compile diagnostics", cabor_compiler_test_diagnostics);
+    CABOR_REGISTER_TEST("COMPILER compile integer overflow", cabor_compiler_test_integer_overflow);
+    CABOR_REGISTER_TEST("COMPILER compile many args", cabor_compiler_test_many_args);
+    CABOR_REGISTER_TEST("COMPILER compile top level statements", cabor_compiler_test_top_level_statements);
+    CABOR_REGISTER_TEST("COMPILER compile intern scope", cabor_compiler_test_intern_scope);
 
 }
 #else